@@ -219,11 +219,14 @@ extern struct _StatsOptions *last_stats_options;
 %token KW_FRAC_DIGITS                 10152
 
 %token KW_LOG_FIFO_SIZE               10160
+%token KW_LOG_FIFO_TYPE               10161
 %token KW_LOG_FETCH_LIMIT             10162
 %token KW_LOG_IW_SIZE                 10163
 %token KW_LOG_PREFIX                  10164
 %token KW_PROGRAM_OVERRIDE            10165
 %token KW_HOST_OVERRIDE               10166
+%token KW_ADAPTIVE_FLOW_CONTROL       10167
+%token KW_LOG_IW_RESERVE_SIZE         10168
 
 %token KW_THROTTLE                    10170
 %token KW_THREADED                    10171
@@ -326,6 +329,10 @@ extern struct _StatsOptions *last_stats_options;
 
 %token KW_RETRIES                     10511
 
+%token KW_BATCH_LINES                 10512
+%token KW_BATCH_TIMEOUT               10513
+%token KW_CPU_AFFINITY                10514
+
 /* END_DECLS */
 
 %code {
@@ -1008,6 +1015,8 @@ parser_opt
 source_option
         /* NOTE: plugins need to set "last_source_options" in order to incorporate this rule in their grammar */
 	: KW_LOG_IW_SIZE '(' LL_NUMBER ')'	{ last_source_options->init_window_size = $3; }
+	| KW_LOG_IW_RESERVE_SIZE '(' LL_NUMBER ')' { last_source_options->window_reserve_size = $3; }
+	| KW_ADAPTIVE_FLOW_CONTROL '(' yesno ')' { last_source_options->adaptive_flow_control = $3; }
 	| KW_CHAIN_HOSTNAMES '(' yesno ')'	{ last_source_options->chain_hostnames = $3; }
 	| KW_KEEP_HOSTNAME '(' yesno ')'	{ last_source_options->keep_hostname = $3; }
 	| KW_PROGRAM_OVERRIDE '(' string ')'	{ last_source_options->program_override = g_strdup($3); free($3); }
@@ -1081,11 +1090,32 @@ threaded_dest_driver_option
         {
           log_threaded_dest_driver_set_max_retries(last_driver, $3);
         }
+        | KW_BATCH_LINES '(' LL_NUMBER ')'
+        {
+          CHECK_ERROR($3 >= 0, @3, "batch-lines() must not be negative");
+          log_threaded_dest_driver_set_batch_lines(last_driver, $3);
+        }
+        | KW_BATCH_TIMEOUT '(' LL_NUMBER ')'
+        {
+          CHECK_ERROR($3 >= 0, @3, "batch-timeout() must not be negative");
+          log_threaded_dest_driver_set_batch_timeout(last_driver, $3);
+        }
+        | KW_CPU_AFFINITY '(' string ')'
+        {
+          CHECK_ERROR(log_threaded_dest_driver_set_cpu_affinity(last_driver, $3), @3, "Invalid CPU list in cpu-affinity(): %s", $3);
+          free($3);
+        }
+        ;
 
 dest_driver_option
         /* NOTE: plugins need to set "last_driver" in order to incorporate this rule in their grammar */
 
 	: KW_LOG_FIFO_SIZE '(' LL_NUMBER ')'	{ ((LogDestDriver *) last_driver)->log_fifo_size = $3; }
+	| KW_LOG_FIFO_TYPE '(' string ')'
+          {
+            CHECK_ERROR(log_dest_driver_set_log_fifo_type((LogDestDriver *) last_driver, $3), @3, "Unknown log-fifo-type() value %s, expected list or ring", $3);
+            free($3);
+          }
 	| KW_THROTTLE '(' LL_NUMBER ')'         { ((LogDestDriver *) last_driver)->throttle = $3; }
         | LL_IDENTIFIER
           {
@@ -122,8 +122,11 @@ static CfgLexerKeyword main_keywords[] = {
   { "use_uniqid",         KW_USE_UNIQID },
 
   { "log_fifo_size",      KW_LOG_FIFO_SIZE },
+  { "log_fifo_type",      KW_LOG_FIFO_TYPE },
   { "log_fetch_limit",    KW_LOG_FETCH_LIMIT },
   { "log_iw_size",        KW_LOG_IW_SIZE },
+  { "log_iw_reserve_size", KW_LOG_IW_RESERVE_SIZE },
+  { "adaptive_flow_control", KW_ADAPTIVE_FLOW_CONTROL },
   { "log_msg_size",       KW_LOG_MSG_SIZE },
   { "log_prefix",         KW_LOG_PREFIX, KWS_OBSOLETE, "program_override" },
   { "program_override",   KW_PROGRAM_OVERRIDE },
@@ -152,6 +155,9 @@ static CfgLexerKeyword main_keywords[] = {
   { "pass_unix_credentials", KW_PASS_UNIX_CREDENTIALS },
 
   { "retries",            KW_RETRIES },
+  { "batch_lines",        KW_BATCH_LINES },
+  { "batch_timeout",      KW_BATCH_TIMEOUT },
+  { "cpu_affinity",       KW_CPU_AFFINITY },
 
   /* filter items */
   { "type",               KW_TYPE },
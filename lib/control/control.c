@@ -28,7 +28,9 @@
 #include "messages.h"
 #include "stats/stats-csv.h"
 #include "stats/stats-counter.h"
+#include "stats/stats-query.h"
 #include "mainloop.h"
+#include "cpu-affinity.h"
 
 #include <errno.h>
 #include <string.h>
@@ -57,6 +59,26 @@ control_connection_send_stats(GString *command)
   return result;
 }
 
+/* QUERY <format> [<component-glob> [<id-glob> [<instance-glob>]]] */
+static GString *
+control_connection_query_stats(GString *command)
+{
+  gchar **cmds = g_strsplit(command->str, " ", 5);
+  StatsQueryFormat format;
+  GString *result;
+
+  if (!cmds[1] || !stats_query_lookup_format(cmds[1], &format))
+    {
+      result = g_string_new("Invalid arguments received, expected the output format (csv or compact)");
+      goto exit;
+    }
+
+  result = stats_query(format, cmds[2], cmds[2] ? cmds[3] : NULL, cmds[2] && cmds[3] ? cmds[4] : NULL);
+exit:
+  g_strfreev(cmds);
+  return result;
+}
+
 static GString *
 control_connection_reset_stats(GString *command)
 {
@@ -127,12 +149,20 @@ control_connection_reload(GString *command)
   return result;
 }
 
+static GString *
+control_connection_list_threads(GString *command)
+{
+  return cpu_affinity_format_threads();
+}
+
 ControlCommand default_commands[] = {
   { "STATS", NULL, control_connection_send_stats },
   { "RESET_STATS", NULL, control_connection_reset_stats },
+  { "QUERY", NULL, control_connection_query_stats },
   { "LOG", NULL, control_connection_message_log },
   { "STOP", NULL, control_connection_stop_process },
   { "RELOAD", NULL, control_connection_reload },
+  { "THREADS", NULL, control_connection_list_threads },
   { NULL, NULL, NULL },
 };
 
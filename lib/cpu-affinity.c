@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2002-2016 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "cpu-affinity.h"
+#include "messages.h"
+#include "tls-support.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define CPU_AFFINITY_MAX_CPUS 1024
+
+static gint
+_compare_cpus(gconstpointer a, gconstpointer b)
+{
+  return *(const gint *) a - *(const gint *) b;
+}
+
+static gboolean
+_parse_cpu_number(const gchar *str, const gchar **end, gint *cpu)
+{
+  gchar *endptr;
+  glong value;
+
+  if (!g_ascii_isdigit(*str))
+    return FALSE;
+
+  value = strtol(str, &endptr, 10);
+  if (value >= CPU_AFFINITY_MAX_CPUS)
+    return FALSE;
+
+  *cpu = value;
+  *end = endptr;
+  return TRUE;
+}
+
+/*
+ * Parses a CPU list in the format used by taskset(1) and the kernel's
+ * cpuset files, e.g. "0-3,8,10-11".  Returns NULL if the list is
+ * invalid or empty.
+ */
+GArray *
+cpu_affinity_parse(const gchar *spec)
+{
+  GArray *cpus = g_array_new(FALSE, FALSE, sizeof(gint));
+  const gchar *p = spec;
+  gint first, last, cpu, i;
+
+  while (*p)
+    {
+      while (*p == ' ')
+        p++;
+      if (!_parse_cpu_number(p, &p, &first))
+        goto error;
+
+      last = first;
+      if (*p == '-' && !_parse_cpu_number(p + 1, &p, &last))
+        goto error;
+      if (last < first)
+        goto error;
+
+      for (cpu = first; cpu <= last; cpu++)
+        g_array_append_val(cpus, cpu);
+
+      while (*p == ' ')
+        p++;
+      if (*p == ',')
+        p++;
+      else if (*p)
+        goto error;
+    }
+
+  if (cpus->len == 0)
+    goto error;
+
+  g_array_sort(cpus, _compare_cpus);
+  for (i = cpus->len - 1; i > 0; i--)
+    {
+      if (g_array_index(cpus, gint, i) == g_array_index(cpus, gint, i - 1))
+        g_array_remove_index(cpus, i);
+    }
+  return cpus;
+
+error:
+  g_array_free(cpus, TRUE);
+  return NULL;
+}
+
+/* returns a set containing the index-th CPU of @cpus, wrapping around */
+GArray *
+cpu_affinity_select(GArray *cpus, gint index)
+{
+  GArray *result = g_array_sized_new(FALSE, FALSE, sizeof(gint), 1);
+
+  g_array_append_val(result, g_array_index(cpus, gint, index % cpus->len));
+  return result;
+}
+
+void
+cpu_affinity_format(GArray *cpus, GString *result)
+{
+  gint i, first;
+
+  for (i = 0; i < cpus->len; i++)
+    {
+      first = g_array_index(cpus, gint, i);
+      while (i + 1 < cpus->len && g_array_index(cpus, gint, i + 1) == g_array_index(cpus, gint, i) + 1)
+        i++;
+
+      if (i > 0 && first != g_array_index(cpus, gint, 0))
+        g_string_append_c(result, ',');
+      if (first == g_array_index(cpus, gint, i))
+        g_string_append_printf(result, "%d", first);
+      else
+        g_string_append_printf(result, "%d-%d", first, g_array_index(cpus, gint, i));
+    }
+}
+
+/* binds the calling thread to the CPUs in @cpus */
+gboolean
+cpu_affinity_apply(GArray *cpus)
+{
+#ifdef SYSLOG_NG_HAVE_SCHED_SETAFFINITY
+  cpu_set_t set;
+  gint i;
+
+  CPU_ZERO(&set);
+  for (i = 0; i < cpus->len; i++)
+    {
+      gint cpu = g_array_index(cpus, gint, i);
+
+      if (cpu < CPU_SETSIZE)
+        CPU_SET(cpu, &set);
+    }
+
+  if (sched_setaffinity(0, sizeof(set), &set) < 0)
+    {
+      msg_error("Error setting the CPU affinity of thread",
+                evt_tag_errno("error", errno));
+      return FALSE;
+    }
+  return TRUE;
+#else
+  msg_warning("WARNING: CPU affinity is not supported on this platform, ignoring");
+  return FALSE;
+#endif
+}
+
+void
+cpu_affinity_free(GArray *cpus)
+{
+  if (cpus)
+    g_array_free(cpus, TRUE);
+}
+
+/************************************************************************************
+ * Thread registry
+ ************************************************************************************/
+
+typedef struct _CpuAffinityThread
+{
+  gchar *name;
+  gint tid;
+} CpuAffinityThread;
+
+TLS_BLOCK_START
+{
+  CpuAffinityThread *current_thread;
+}
+TLS_BLOCK_END;
+
+#define current_thread __tls_deref(current_thread)
+
+static GStaticMutex cpu_affinity_threads_lock = G_STATIC_MUTEX_INIT;
+static GList *cpu_affinity_threads;
+
+static gint
+_get_tid(void)
+{
+#ifdef SYS_gettid
+  return syscall(SYS_gettid);
+#else
+  return getpid();
+#endif
+}
+
+void
+cpu_affinity_register_thread(const gchar *name)
+{
+  g_static_mutex_lock(&cpu_affinity_threads_lock);
+  if (!current_thread)
+    {
+      current_thread = g_new0(CpuAffinityThread, 1);
+      current_thread->tid = _get_tid();
+      cpu_affinity_threads = g_list_append(cpu_affinity_threads, current_thread);
+    }
+  g_free(current_thread->name);
+  current_thread->name = g_strdup(name);
+  g_static_mutex_unlock(&cpu_affinity_threads_lock);
+}
+
+void
+cpu_affinity_unregister_thread(void)
+{
+  if (!current_thread)
+    return;
+
+  g_static_mutex_lock(&cpu_affinity_threads_lock);
+  cpu_affinity_threads = g_list_remove(cpu_affinity_threads, current_thread);
+  g_static_mutex_unlock(&cpu_affinity_threads_lock);
+
+  g_free(current_thread->name);
+  g_free(current_thread);
+  current_thread = NULL;
+}
+
+static void
+_format_allowed_cpus(gint tid, GString *result)
+{
+#ifdef SYSLOG_NG_HAVE_SCHED_GETAFFINITY
+  cpu_set_t set;
+  GArray *cpus;
+  gint cpu;
+
+  if (sched_getaffinity(tid, sizeof(set), &set) < 0)
+    {
+      g_string_append_c(result, '-');
+      return;
+    }
+
+  cpus = g_array_new(FALSE, FALSE, sizeof(gint));
+  for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+      if (CPU_ISSET(cpu, &set))
+        g_array_append_val(cpus, cpu);
+    }
+  cpu_affinity_format(cpus, result);
+  g_array_free(cpus, TRUE);
+#else
+  g_string_append_c(result, '-');
+#endif
+}
+
+/* the CPU the thread last ran on, the 39th field of /proc/<pid>/task/<tid>/stat */
+static gint
+_get_current_cpu(gint tid)
+{
+  gchar *filename = g_strdup_printf("/proc/self/task/%d/stat", tid);
+  gchar *contents = NULL;
+  gchar **fields;
+  gchar *p;
+  gint cpu = -1;
+
+  if (!g_file_get_contents(filename, &contents, NULL, NULL))
+    goto exit;
+
+  /* the command name may contain spaces, skip it along with the pid */
+  p = strrchr(contents, ')');
+  if (!p)
+    goto exit;
+
+  fields = g_strsplit(p + 2, " ", 0);
+  if (g_strv_length(fields) > 36)
+    cpu = atoi(fields[36]);
+  g_strfreev(fields);
+
+exit:
+  g_free(contents);
+  g_free(filename);
+  return cpu;
+}
+
+static gint
+_get_numa_node(gint cpu)
+{
+  gchar *dirname = g_strdup_printf("/sys/devices/system/cpu/cpu%d", cpu);
+  GDir *dir;
+  const gchar *entry;
+  gint node = -1;
+
+  dir = g_dir_open(dirname, 0, NULL);
+  g_free(dirname);
+  if (!dir)
+    return -1;
+
+  while ((entry = g_dir_read_name(dir)))
+    {
+      if (strncmp(entry, "node", 4) == 0 && g_ascii_isdigit(entry[4]))
+        {
+          node = atoi(&entry[4]);
+          break;
+        }
+    }
+  g_dir_close(dir);
+  return node;
+}
+
+GString *
+cpu_affinity_format_threads(void)
+{
+  GString *result = g_string_new("Thread;TID;AllowedCPUs;CPU;NUMANode\n");
+  GList *l;
+
+  g_static_mutex_lock(&cpu_affinity_threads_lock);
+  for (l = cpu_affinity_threads; l; l = l->next)
+    {
+      CpuAffinityThread *thread = (CpuAffinityThread *) l->data;
+      gint cpu, node;
+
+      g_string_append_printf(result, "%s;%d;", thread->name, thread->tid);
+      _format_allowed_cpus(thread->tid, result);
+
+      cpu = _get_current_cpu(thread->tid);
+      node = cpu >= 0 ? _get_numa_node(cpu) : -1;
+      if (cpu >= 0)
+        g_string_append_printf(result, ";%d", cpu);
+      else
+        g_string_append(result, ";-");
+      if (node >= 0)
+        g_string_append_printf(result, ";%d\n", node);
+      else
+        g_string_append(result, ";-\n");
+    }
+  g_static_mutex_unlock(&cpu_affinity_threads_lock);
+  return result;
+}
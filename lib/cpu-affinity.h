@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2002-2016 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef CPU_AFFINITY_H_INCLUDED
+#define CPU_AFFINITY_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/*
+ * CPU sets are GArrays of gint CPU numbers, sorted and without
+ * duplicates, as parsed from a "0-3,8" style CPU list.
+ */
+GArray *cpu_affinity_parse(const gchar *spec);
+GArray *cpu_affinity_select(GArray *cpus, gint index);
+void cpu_affinity_format(GArray *cpus, GString *result);
+gboolean cpu_affinity_apply(GArray *cpus);
+void cpu_affinity_free(GArray *cpus);
+
+/* registry of running threads, for reporting their placement */
+void cpu_affinity_register_thread(const gchar *name);
+void cpu_affinity_unregister_thread(void);
+GString *cpu_affinity_format_threads(void);
+
+#endif
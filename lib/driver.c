@@ -24,6 +24,7 @@
   
 #include "driver.h"
 #include "logqueue-fifo.h"
+#include "logqueue-ring.h"
 #include "afinter.h"
 #include "cfg-tree.h"
 
@@ -188,6 +189,18 @@ log_src_driver_free(LogPipe *s)
 
 /* LogDestDriver */
 
+gboolean
+log_dest_driver_set_log_fifo_type(LogDestDriver *self, const gchar *fifo_type)
+{
+  if (strcmp(fifo_type, "list") == 0)
+    self->log_fifo_type = LDD_FIFO_TYPE_LIST;
+  else if (strcmp(fifo_type, "ring") == 0)
+    self->log_fifo_type = LDD_FIFO_TYPE_RING;
+  else
+    return FALSE;
+  return TRUE;
+}
+
 /* returns a reference */
 static LogQueue *
 log_dest_driver_acquire_queue_method(LogDestDriver *self, gchar *persist_name, gpointer user_data)
@@ -200,9 +213,16 @@ log_dest_driver_acquire_queue_method(LogDestDriver *self, gchar *persist_name, g
   if (persist_name)
     queue = cfg_persist_config_fetch(cfg, persist_name);
 
+  /* NOTE: a queue kept over a reload is reused even if log-fifo-type()
+   * was changed, so that its contents are not lost */
   if (!queue)
     {
-      queue = log_queue_fifo_new(self->log_fifo_size < 0 ? cfg->log_fifo_size : self->log_fifo_size, persist_name);
+      gint log_fifo_size = self->log_fifo_size < 0 ? cfg->log_fifo_size : self->log_fifo_size;
+
+      if (self->log_fifo_type == LDD_FIFO_TYPE_RING)
+        queue = log_queue_ring_new(log_fifo_size, persist_name);
+      else
+        queue = log_queue_fifo_new(log_fifo_size, persist_name);
       log_queue_set_throttle(queue, self->throttle);
     }
   return queue;
@@ -297,6 +317,7 @@ log_dest_driver_init_instance(LogDestDriver *self, GlobalConfig *cfg)
   self->acquire_queue = log_dest_driver_acquire_queue_method;
   self->release_queue = log_dest_driver_release_queue_method;
   self->log_fifo_size = -1;
+  self->log_fifo_type = LDD_FIFO_TYPE_LIST;
   self->throttle = 0;
 }
 
@@ -146,6 +146,13 @@ void log_src_driver_free(LogPipe *s);
 
 typedef struct _LogDestDriver LogDestDriver;
 
+/* in-memory queue implementation used when no queueing plugin is attached */
+enum
+{
+  LDD_FIFO_TYPE_LIST,
+  LDD_FIFO_TYPE_RING,
+};
+
 struct _LogDestDriver
 {
   LogDriver super;
@@ -160,6 +167,7 @@ struct _LogDestDriver
   GList *queues;
 
   gint log_fifo_size;
+  gint log_fifo_type;
   gint throttle;
   StatsCounterItem *queued_global_messages;
 };
@@ -193,6 +201,7 @@ log_dest_driver_release_queue(LogDestDriver *self, LogQueue *q)
     }
 }
 
+gboolean log_dest_driver_set_log_fifo_type(LogDestDriver *self, const gchar *fifo_type);
 gboolean log_dest_driver_init_method(LogPipe *s);
 gboolean log_dest_driver_deinit_method(LogPipe *s);
 void log_dest_driver_queue_method(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options, gpointer user_data);
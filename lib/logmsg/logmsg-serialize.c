@@ -55,33 +55,71 @@
 #define NV_TABLE_MAGIC_V2  "NVT2"
 #define NVT_SF_BE           0x1
 
+/*
+ * Version 26 stored every integer in fixed size big endian fields,
+ * version 27 uses variable length integers and the compact NVTable
+ * format.  Both are accepted when reading.
+ */
+#define LOGMSG_SERIALIZE_VERSION_FIXED_INTS 26
+#define LOGMSG_SERIALIZE_VERSION            27
+
 gboolean
 log_msg_serialize(LogMessage *self, SerializeArchive *sa)
 {
-  guint8 version = 26;
+  guint8 version = LOGMSG_SERIALIZE_VERSION;
   gint i = 0;
 
   serialize_write_uint8(sa, version);
-  serialize_write_uint64(sa, self->rcptid);
+  serialize_write_varint(sa, self->rcptid);
   g_assert(sizeof(self->flags) == 4);
-  serialize_write_uint32(sa, self->flags & ~LF_STATE_MASK);
-  serialize_write_uint16(sa, self->pri);
+  serialize_write_varint(sa, self->flags & ~LF_STATE_MASK);
+  serialize_write_varint(sa, self->pri);
   g_sockaddr_serialize(sa, self->saddr);
   timestamp_serialize(sa, self->timestamps);
-  serialize_write_uint32(sa, self->host_id);
+  serialize_write_varint(sa, self->host_id);
   tags_serialize(self, sa);
   serialize_write_uint8(sa, self->initial_parse);
   serialize_write_uint8(sa, self->num_matches);
   serialize_write_uint8(sa, self->num_sdata);
   serialize_write_uint8(sa, self->alloc_sdata);
   for (i = 0; i < self->num_sdata; i++)
-    serialize_write_uint32(sa, self->sdata[i]);
+    serialize_write_varint(sa, self->sdata[i]);
   nv_table_serialize(sa, self->payload);
   return TRUE;
 }
 
 static gboolean
-_deserialize_sdata(LogMessage *self, SerializeArchive *sa)
+_read_uint64(SerializeArchive *sa, guint8 version, guint64 *value)
+{
+  if (version == LOGMSG_SERIALIZE_VERSION_FIXED_INTS)
+    return serialize_read_uint64(sa, value);
+  return serialize_read_varint(sa, value);
+}
+
+static gboolean
+_read_uint32(SerializeArchive *sa, guint8 version, guint32 *value)
+{
+  if (version == LOGMSG_SERIALIZE_VERSION_FIXED_INTS)
+    return serialize_read_uint32(sa, value);
+  return serialize_read_varint32(sa, value);
+}
+
+static gboolean
+_read_uint16(SerializeArchive *sa, guint8 version, guint16 *value)
+{
+  guint32 n;
+
+  if (version == LOGMSG_SERIALIZE_VERSION_FIXED_INTS)
+    return serialize_read_uint16(sa, value);
+
+  if (!serialize_read_varint32(sa, &n) || n > G_MAXUINT16)
+    return FALSE;
+  *value = n;
+  return TRUE;
+}
+
+static gboolean
+_deserialize_sdata(LogMessage *self, SerializeArchive *sa, guint8 version)
 {
   gint i;
 
@@ -96,29 +134,29 @@ _deserialize_sdata(LogMessage *self, SerializeArchive *sa)
 
   for (i = 0; i < self->num_sdata; i++)
     {
-      if (!serialize_read_uint32(sa, (guint32 *)(&self->sdata[i])))
+      if (!_read_uint32(sa, version, (guint32 *)(&self->sdata[i])))
         return FALSE;
     }
   return TRUE;
 }
 
 static gboolean
-_deserialize_message(LogMessage *self, SerializeArchive *sa)
+_deserialize_message(LogMessage *self, SerializeArchive *sa, guint8 version)
 {
   guint8 initial_parse = 0;
 
-  if (!serialize_read_uint64(sa, &self->rcptid))
+  if (!_read_uint64(sa, version, &self->rcptid))
      return FALSE;
-  if (!serialize_read_uint32(sa, &self->flags))
+  if (!_read_uint32(sa, version, &self->flags))
      return FALSE;
   self->flags |= LF_STATE_MASK;
-  if (!serialize_read_uint16(sa, &self->pri))
+  if (!_read_uint16(sa, version, &self->pri))
      return FALSE;
   if (!g_sockaddr_deserialize(sa, &self->saddr))
      return FALSE;
   if (!timestamp_deserialize(sa, self->timestamps))
     return FALSE;
-  if (!serialize_read_uint32(sa, &self->host_id))
+  if (!_read_uint32(sa, version, &self->host_id))
     return FALSE;
 
   if (!tags_deserialize(self, sa))
@@ -131,7 +169,7 @@ _deserialize_message(LogMessage *self, SerializeArchive *sa)
   if (!serialize_read_uint8(sa, &self->num_matches))
     return FALSE;
 
-  if (!_deserialize_sdata(self, sa))
+  if (!_deserialize_sdata(self, sa, version))
     return FALSE;
 
   nv_table_unref(self->payload);
@@ -144,13 +182,14 @@ _deserialize_message(LogMessage *self, SerializeArchive *sa)
 }
 
 static gboolean
-_check_msg_version(SerializeArchive *sa)
+_check_msg_version(SerializeArchive *sa, guint8 *version_out)
 {
   guint8 version;
 
   if (!serialize_read_uint8(sa, &version))
     return FALSE;
-  if (version != 26)
+  *version_out = version;
+  if (version != LOGMSG_SERIALIZE_VERSION_FIXED_INTS && version != LOGMSG_SERIALIZE_VERSION)
     {
       msg_error("Error deserializing log message, unsupported version",
           evt_tag_int("version", version));
@@ -162,9 +201,11 @@ _check_msg_version(SerializeArchive *sa)
 gboolean
 log_msg_deserialize(LogMessage *self, SerializeArchive *sa)
 {
-  if (!_check_msg_version(sa))
+  guint8 version;
+
+  if (!_check_msg_version(sa, &version))
     {
       return FALSE;
     }
-  return _deserialize_message(self, sa);
+  return _deserialize_message(self, sa, version);
 }
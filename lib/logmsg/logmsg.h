@@ -195,6 +195,10 @@ struct _LogMessage
 
   guint64 rcptid;
 
+  /* monotonic clock value when the message was read, in microseconds, 0
+   * if unknown.  Used to measure the latency of destinations. */
+  guint64 recvd_monotonic_usec;
+
   /* preallocated LogQueueNodes used to insert this message into a LogQueue */
   LogMessageQueueNode nodes[0];
 
@@ -32,6 +32,7 @@
 #include "logmsg/logmsg.h"
 
 #define NV_TABLE_MAGIC_V2  "NVT2"
+#define NV_TABLE_MAGIC_V3  "NVT3"
 #define NVT_SF_BE           0x1
 
 
@@ -290,13 +291,20 @@ _read_metadata(SerializeArchive *sa, NVTableMetaData *meta_data)
       meta_data->magic = GUINT32_SWAP_LE_BE(meta_data->magic);
     }
 
-  if (memcmp((void *)&meta_data->magic, (const void *)NV_TABLE_MAGIC_V2, 4) != 0)
+  if (memcmp((void *)&meta_data->magic, (const void *)NV_TABLE_MAGIC_V2, 4) != 0 &&
+      memcmp((void *)&meta_data->magic, (const void *)NV_TABLE_MAGIC_V3, 4) != 0)
     {
       return FALSE;
     }
   return TRUE;
 }
 
+static inline gboolean
+_is_compact_format(NVTableMetaData *meta_data)
+{
+  return memcmp((void *)&meta_data->magic, (const void *)NV_TABLE_MAGIC_V3, 4) == 0;
+}
+
 static gboolean
 _read_header(SerializeArchive *sa, NVTable **nvtable)
 {
@@ -338,6 +346,83 @@ _read_payload(SerializeArchive *sa, NVTable *res)
   return serialize_read_blob(sa, NV_TABLE_ADDR(res, res->size - res->used), res->used);
 }
 
+/*
+ * The compact (NVT3) format stores the static and dynamic entry arrays as
+ * a single blob in the byte order of the writer, followed by the payload,
+ * so both can be read straight into place.  Byte swapping is only needed
+ * if the queue file was written on a host with different endianness.
+ */
+static inline gsize
+_get_index_size(guint8 num_static_entries, guint16 num_dyn_entries)
+{
+  return num_static_entries * sizeof(guint32) + num_dyn_entries * sizeof(NVDynValue);
+}
+
+static void
+_index_swap_bytes(NVTable *self)
+{
+  NVDynValue *dyn_entries;
+  guint16 i;
+
+  for (i = 0; i < self->num_static_entries; i++)
+    self->static_entries[i] = GUINT32_SWAP_LE_BE(self->static_entries[i]);
+
+  dyn_entries = nv_table_get_dyn_entries(self);
+  for (i = 0; i < self->num_dyn_entries; i++)
+    {
+      dyn_entries[i].handle = GUINT32_SWAP_LE_BE(dyn_entries[i].handle);
+      dyn_entries[i].ofs = GUINT32_SWAP_LE_BE(dyn_entries[i].ofs);
+    }
+}
+
+static NVTable *
+_deserialize_compact(SerializeArchive *sa, NVTableMetaData *meta_data)
+{
+  guint32 size, used, num_dyn_entries;
+  guint8 num_static_entries;
+  gsize index_size;
+  NVTable *res;
+
+  if (!serialize_read_varint32(sa, &size) ||
+      !serialize_read_varint32(sa, &used) ||
+      !serialize_read_varint32(sa, &num_dyn_entries) ||
+      !serialize_read_uint8(sa, &num_static_entries))
+    return NULL;
+
+  index_size = _get_index_size(num_static_entries, MIN(num_dyn_entries, G_MAXUINT16));
+  if (num_dyn_entries > G_MAXUINT16 || size > NV_TABLE_MAX_BYTES ||
+      sizeof(NVTable) + index_size + used > size)
+    {
+      msg_error("Error deserializing NVTable, inconsistent header",
+                evt_tag_int("size", size),
+                evt_tag_int("used", used),
+                evt_tag_int("num_dyn_entries", num_dyn_entries));
+      return NULL;
+    }
+
+  res = (NVTable *) g_malloc(size);
+  res->size = size;
+  res->used = used;
+  res->num_dyn_entries = num_dyn_entries;
+  res->num_static_entries = num_static_entries;
+  res->borrowed = FALSE;
+  res->ref_cnt = 1;
+
+  if (!serialize_read_blob(sa, res->static_entries, index_size) ||
+      !_read_payload(sa, res))
+    {
+      g_free(res);
+      return NULL;
+    }
+
+  if (_has_to_swap_bytes(meta_data->flags))
+    {
+      _index_swap_bytes(res);
+      nv_table_data_swap_bytes(res);
+    }
+  return res;
+}
+
 NVTable *
 nv_table_deserialize(SerializeArchive *sa)
 {
@@ -349,6 +434,9 @@ nv_table_deserialize(SerializeArchive *sa)
       goto error;
     }
 
+  if (_is_compact_format(&meta_data))
+    return _deserialize_compact(sa, &meta_data);
+
   if (!_read_header(sa, &res))
     {
       goto error;
@@ -377,32 +465,16 @@ error:
   return NULL;
 }
 
-static void
-_serialize_nv_dyn_value(SerializeArchive *sa, NVDynValue *dyn_value)
-{
-  serialize_write_nvhandle(sa, dyn_value->handle);
-  serialize_write_uint32(sa, dyn_value->ofs);
-};
-
 static void
 _write_struct(SerializeArchive *sa, NVTable *self)
 {
-  guint16 i;
-  NVDynValue *dyn_entries;
-
-  serialize_write_uint32(sa, self->size);
-  serialize_write_uint32(sa, self->used);
-  serialize_write_uint16(sa, self->num_dyn_entries);
+  serialize_write_varint(sa, self->size);
+  serialize_write_varint(sa, self->used);
+  serialize_write_varint(sa, self->num_dyn_entries);
   serialize_write_uint8(sa, self->num_static_entries);
-  for (i = 0; i < self->num_static_entries; i++)
-    {
-      serialize_write_uint32(sa, self->static_entries[i]);
-    }
-  dyn_entries = nv_table_get_dyn_entries(self);
-  for (i = 0; i < self->num_dyn_entries; i++)
-    {
-      _serialize_nv_dyn_value(sa, &dyn_entries[i]);
-    }
+
+  /* static and dynamic entries are adjacent in memory */
+  serialize_write_blob(sa, self->static_entries, _get_index_size(self->num_static_entries, self->num_dyn_entries));
 }
 
 static void
@@ -415,7 +487,7 @@ _write_meta_data(SerializeArchive *sa, NVTableMetaData *meta_data)
 static void
 _fill_meta_data(NVTable *self, NVTableMetaData *meta_data)
 {
-  memcpy((void *)&meta_data->magic,(const void *) NV_TABLE_MAGIC_V2, 4);
+  memcpy((void *)&meta_data->magic,(const void *) NV_TABLE_MAGIC_V3, 4);
   if (G_BYTE_ORDER == G_BIG_ENDIAN)
      meta_data->flags |= NVT_SF_BE;
 }
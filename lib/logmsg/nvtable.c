@@ -23,6 +23,7 @@
  */
 #include "logmsg/nvtable.h"
 #include "messages.h"
+#include "tls-support.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -31,15 +32,114 @@ GStaticMutex nv_registry_lock = G_STATIC_MUTEX_INIT;
 
 const gchar *null_string = "";
 
+#define NV_REGISTRY_MAX_HANDLES 65535
+#define NV_REGISTRY_INDEX_INITIAL_SIZE 256
+
+typedef struct _NVRegistryIndexSlot
+{
+  const gchar *name;
+  guint hash;
+  NVHandle handle;
+} NVRegistryIndexSlot;
+
+struct _NVRegistryIndex
+{
+  guint mask;
+  guint count;
+  NVRegistryIndexSlot slots[0];
+};
+
+static NVRegistryIndex *
+_index_new(guint size)
+{
+  NVRegistryIndex *index = g_malloc0(sizeof(NVRegistryIndex) + size * sizeof(NVRegistryIndexSlot));
+
+  index->mask = size - 1;
+  return index;
+}
+
+/*
+ * A slot is published by setting its name pointer (with a full barrier),
+ * after its hash and handle have been filled in.  As the table is kept at
+ * most half full, the probe sequence always ends at an empty slot.
+ */
+static NVHandle
+_index_lookup(NVRegistryIndex *index, const gchar *name, guint hash)
+{
+  guint i = hash & index->mask;
+
+  while (TRUE)
+    {
+      NVRegistryIndexSlot *slot = &index->slots[i];
+      const gchar *slot_name = g_atomic_pointer_get((gpointer *) &slot->name);
+
+      if (!slot_name)
+        return 0;
+
+      if (slot->hash == hash && strcmp(slot_name, name) == 0)
+        return g_atomic_int_get((gint *) &slot->handle);
+
+      i = (i + 1) & index->mask;
+    }
+}
+
+/* must be called with nv_registry_lock held, @name must stay alive with the registry */
+static void
+_index_insert(NVRegistryIndex *index, const gchar *name, guint hash, NVHandle handle)
+{
+  guint i = hash & index->mask;
+  NVRegistryIndexSlot *slot;
+
+  while (TRUE)
+    {
+      slot = &index->slots[i];
+      if (!slot->name)
+        break;
+
+      if (slot->hash == hash && strcmp(slot->name, name) == 0)
+        {
+          g_atomic_int_set((gint *) &slot->handle, handle);
+          return;
+        }
+      i = (i + 1) & index->mask;
+    }
+
+  slot->hash = hash;
+  slot->handle = handle;
+  g_atomic_pointer_set((gpointer *) &slot->name, (gpointer) name);
+  index->count++;
+}
+
+/* must be called with nv_registry_lock held */
+static void
+_register_name(NVRegistry *self, const gchar *name, NVHandle handle)
+{
+  NVRegistryIndex *index = self->index;
+  guint hash = g_str_hash(name);
+  guint i;
+
+  if ((index->count + 1) * 2 > index->mask + 1)
+    {
+      NVRegistryIndex *new_index = _index_new((index->mask + 1) * 2);
+
+      for (i = 0; i <= index->mask; i++)
+        {
+          if (index->slots[i].name)
+            _index_insert(new_index, index->slots[i].name, index->slots[i].hash, index->slots[i].handle);
+        }
+      g_atomic_pointer_set((gpointer *) &self->index, new_index);
+
+      /* readers may still be probing the old one, it is freed with the registry */
+      self->retired_indexes = g_list_prepend(self->retired_indexes, index);
+      index = new_index;
+    }
+  _index_insert(index, name, hash, handle);
+}
+
 NVHandle
 nv_registry_get_handle(NVRegistry *self, const gchar *name)
 {
-  gpointer p;
-
-  p = g_hash_table_lookup(self->name_map, name);
-  if (p)
-    return GPOINTER_TO_UINT(p);
-  return 0;
+  return _index_lookup(g_atomic_pointer_get((gpointer *) &self->index), name, g_str_hash(name));
 }
 
 NVHandle
@@ -50,6 +150,10 @@ nv_registry_alloc_handle(NVRegistry *self, const gchar *name)
   gsize len;
   NVHandle res = 0;
 
+  res = nv_registry_get_handle(self, name);
+  if (G_LIKELY(res))
+    return res;
+
   g_static_mutex_lock(&nv_registry_lock);
   p = g_hash_table_lookup(self->name_map, name);
   if (p)
@@ -69,7 +173,7 @@ nv_registry_alloc_handle(NVRegistry *self, const gchar *name)
                 evt_tag_str("value", name));
       goto exit;
     }
-  else if (self->names->len >= 65535)
+  else if (self->names->len >= NV_REGISTRY_MAX_HANDLES)
     {
       msg_error("Hard wired limit of 65535 name-value pairs have been reached, all further name-value pair will expand to nothing",
                 evt_tag_str("value", name));
@@ -83,6 +187,7 @@ nv_registry_alloc_handle(NVRegistry *self, const gchar *name)
   g_array_append_val(self->names, stored);
   g_hash_table_insert(self->name_map, stored.name, GUINT_TO_POINTER(self->names->len));
   res = self->names->len;
+  _register_name(self, stored.name, res);
  exit:
   g_static_mutex_unlock(&nv_registry_lock);
   return res;
@@ -96,8 +201,13 @@ nv_registry_alloc_handle(NVRegistry *self, const gchar *name)
 void
 nv_registry_add_alias(NVRegistry *self, NVHandle handle, const gchar *alias)
 {
+  gpointer stored_alias;
+
   g_static_mutex_lock(&nv_registry_lock);
+  /* if the alias already exists, the stored key is kept and the copy is freed */
   g_hash_table_insert(self->name_map, g_strdup(alias), GUINT_TO_POINTER((glong) handle));
+  g_hash_table_lookup_extended(self->name_map, alias, &stored_alias, NULL);
+  _register_name(self, stored_alias, handle);
   g_static_mutex_unlock(&nv_registry_lock);
 }
 
@@ -126,7 +236,9 @@ nv_registry_new(const gchar **static_names)
   gint i;
 
   self->name_map = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-  self->names = g_array_new(FALSE, FALSE, sizeof(NVHandleDesc));
+  /* reserved in full so that lock-free readers never see it reallocated */
+  self->names = g_array_sized_new(FALSE, FALSE, sizeof(NVHandleDesc), NV_REGISTRY_MAX_HANDLES);
+  self->index = _index_new(NV_REGISTRY_INDEX_INITIAL_SIZE);
   for (i = 0; static_names[i]; i++)
     {
       nv_registry_alloc_handle(self, static_names[i]);
@@ -139,6 +251,9 @@ nv_registry_free(NVRegistry *self)
 {
   g_array_free(self->names, TRUE);
   g_hash_table_destroy(self->name_map);
+  g_list_foreach(self->retired_indexes, (GFunc) g_free, NULL);
+  g_list_free(self->retired_indexes);
+  g_free(self->index);
   g_free(self);
 }
 
@@ -218,34 +333,70 @@ nv_table_resolve_entry(NVTable *self, NVEntry *entry, gssize *length)
     return nv_table_resolve_indirect(self, entry, length);
 }
 
-NVEntry *
-nv_table_get_entry_slow(NVTable *self, NVHandle handle, NVDynValue **dyn_slot)
+/*
+ * Messages coming from the same source tend to carry the same set of
+ * names, parsed in the same order, so a given handle usually sits at the
+ * same position of the sorted dynamic value array in every message.  We
+ * remember that position per handle and check it before falling back to
+ * the binary search, which turns both lookups and appending inserts into
+ * O(1) operations for such messages.
+ *
+ * The hints are kept per thread, as threads parsing different sources see
+ * different layouts and sharing them would only make them fight over both
+ * the hints and the cache lines holding them.  Handles are folded into a
+ * table much smaller than the registry, a hint is only a guess which is
+ * verified against the table before use, so a collision or a stale hint
+ * can only cost us a binary search.
+ */
+#define NV_TABLE_DYN_SLOT_HINTS 4096
+
+TLS_BLOCK_START
+{
+  guint16 nv_table_dyn_slot_hints[NV_TABLE_DYN_SLOT_HINTS];
+}
+TLS_BLOCK_END;
+
+#define nv_table_dyn_slot_hints __tls_deref(nv_table_dyn_slot_hints)
+
+/*
+ * Returns TRUE and the index of @handle in @ndx if it is present in the
+ * dynamic value array, otherwise FALSE and the index where it should be
+ * inserted to keep the array sorted.
+ */
+static inline gboolean
+nv_table_find_dyn_slot(NVTable *self, NVHandle handle, gint *ndx)
 {
-  guint32 ofs;
-  gint l, h, m;
   NVDynValue *dyn_entries = nv_table_get_dyn_entries(self);
-  guint32 mv;
+  guint16 *hint = &nv_table_dyn_slot_hints[handle % NV_TABLE_DYN_SLOT_HINTS];
+  gint l, h, m;
+  NVHandle mv;
 
-  if (!self->num_dyn_entries)
+  m = *hint;
+  if (m < self->num_dyn_entries && NV_TABLE_DYNVALUE_HANDLE(dyn_entries[m]) == handle)
     {
-      *dyn_slot = NULL;
-      return NULL;
+      *ndx = m;
+      return TRUE;
+    }
+  if (m <= self->num_dyn_entries &&
+      (m == self->num_dyn_entries || NV_TABLE_DYNVALUE_HANDLE(dyn_entries[m]) > handle) &&
+      (m == 0 || NV_TABLE_DYNVALUE_HANDLE(dyn_entries[m - 1]) < handle))
+    {
+      *ndx = m;
+      return FALSE;
     }
 
   /* open-coded binary search */
-  *dyn_slot = NULL;
   l = 0;
   h = self->num_dyn_entries - 1;
-  ofs = 0;
   while (l <= h)
     {
       m = (l+h) >> 1;
       mv = NV_TABLE_DYNVALUE_HANDLE(dyn_entries[m]);
       if (mv == handle)
         {
-          *dyn_slot = &dyn_entries[m];
-          ofs = NV_TABLE_DYNVALUE_OFS(dyn_entries[m]);
-          break;
+          *hint = m;
+          *ndx = m;
+          return TRUE;
         }
       else if (mv > handle)
         {
@@ -256,9 +407,25 @@ nv_table_get_entry_slow(NVTable *self, NVHandle handle, NVDynValue **dyn_slot)
           l = m + 1;
         }
     }
+  *hint = l;
+  *ndx = l;
+  return FALSE;
+}
 
-  NVEntry *entry = nv_table_get_entry_at_ofs(self, ofs);
-  return entry;
+NVEntry *
+nv_table_get_entry_slow(NVTable *self, NVHandle handle, NVDynValue **dyn_slot)
+{
+  NVDynValue *dyn_entries = nv_table_get_dyn_entries(self);
+  gint ndx;
+
+  if (!self->num_dyn_entries || !nv_table_find_dyn_slot(self, handle, &ndx))
+    {
+      *dyn_slot = NULL;
+      return NULL;
+    }
+
+  *dyn_slot = &dyn_entries[ndx];
+  return nv_table_get_entry_at_ofs(self, NV_TABLE_DYNVALUE_OFS(dyn_entries[ndx]));
 }
 
 static gboolean
@@ -267,44 +434,18 @@ nv_table_reserve_table_entry(NVTable *self, NVHandle handle, NVDynValue **dyn_sl
   if (G_UNLIKELY(!(*dyn_slot) && handle > self->num_static_entries))
     {
       /* this is a dynamic value */
-      NVDynValue *dyn_entries = nv_table_get_dyn_entries(self);;
-      gint l, h, m, ndx;
-      gboolean found = FALSE;
+      NVDynValue *dyn_entries = nv_table_get_dyn_entries(self);
+      gint ndx;
+      gboolean found;
 
       if (!nv_table_alloc_check(self, sizeof(dyn_entries[0])))
         return FALSE;
 
-      l = 0;
-      h = self->num_dyn_entries - 1;
-      ndx = -1;
-      while (l <= h)
-        {
-          guint16 mv;
-
-          m = (l+h) >> 1;
-          mv = NV_TABLE_DYNVALUE_HANDLE(dyn_entries[m]);
-
-          if (mv == handle)
-            {
-              ndx = m;
-              found = TRUE;
-              break;
-            }
-          else if (mv > handle)
-            {
-              h = m - 1;
-            }
-          else
-            {
-              l = m + 1;
-            }
-        }
       /* if we find the proper slot we set that, if we don't, we insert a new entry */
-      if (!found)
-        ndx = l;
+      found = nv_table_find_dyn_slot(self, handle, &ndx);
 
       g_assert(ndx >= 0 && ndx <= self->num_dyn_entries);
-      if (ndx < self->num_dyn_entries)
+      if (!found && ndx < self->num_dyn_entries)
         {
           memmove(&dyn_entries[ndx + 1], &dyn_entries[ndx], (self->num_dyn_entries - ndx) * sizeof(dyn_entries[0]));
         }
@@ -29,6 +29,7 @@
 
 typedef struct _NVTable NVTable;
 typedef struct _NVRegistry NVRegistry;
+typedef struct _NVRegistryIndex NVRegistryIndex;
 typedef struct _NVDynValue NVDynValue;
 typedef struct _NVEntry NVEntry;
 typedef guint32 NVHandle;
@@ -49,12 +50,21 @@ struct _NVHandleDesc
   guint8 name_len;
 };
 
+/*
+ * Handles are looked up by name without locking: @index is an
+ * open-addressing hash table whose slots are only ever filled in, and it
+ * is replaced atomically by a larger copy when it grows.  Inserting new
+ * names is serialized by a mutex.  @names never grows beyond its initial
+ * allocation, so the handle descriptors never move either.
+ */
 struct _NVRegistry
 {
   /* number of static names that are statically allocated in each payload */
   gint num_static_names;
   GArray *names;
   GHashTable *name_map;
+  NVRegistryIndex *index;
+  GList *retired_indexes;
 };
 
 extern const gchar *null_string;
@@ -168,6 +178,8 @@ nv_entry_get_name(NVEntry *self)
  * Dynamic values:
  *   - a dynamically sized NVDynEntry array (contains ID + offset)
  *   - dynamic values are sorted by the global ID
+ *   - the position of each handle is remembered across tables, so that
+ *     messages with the same set of names can skip the binary search
  *
  * Memory allocation
  * =================
@@ -174,6 +174,18 @@ test_pe_serialized_message()
   serialize_archive_free(sa);
 }
 
+static void
+test_serialized_message_uses_compact_format()
+{
+  GString *stream = g_string_new("");
+  SerializeArchive *sa = _serialize_message_for_test(stream);
+
+  assert_gint(stream->str[0], 27, ERROR_MSG);
+
+  serialize_archive_free(sa);
+  g_string_free(stream, TRUE);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -184,6 +196,7 @@ main(int argc, char **argv)
   msg_format_options_init(&parse_options, cfg);
   test_serialize();
   test_pe_serialized_message();
+  test_serialized_message_uses_compact_format();
   cfg_free(cfg);
   app_shutdown();
   return 0;
@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2002-2016 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logqueue-ring.h"
+#include "logpipe.h"
+#include "messages.h"
+#include "ringbuffer.h"
+#include "stats/stats-registry.h"
+#include "mainloop-worker.h"
+
+const QueueType log_queue_ring_type = "RING";
+
+/*
+ * LogQueueRing has the same structure and threading assumptions as
+ * LogQueueFifo (per-thread input -> locked wait -> output), but instead
+ * of linking a separately allocated LogMessageQueueNode per message, the
+ * entries are stored by value in contiguous, growable ring buffers:
+ *
+ *   - each input thread appends to its own ring segment (unlocked)
+ *
+ *   - once the input thread finishes its batch, the segment is copied to
+ *     the locked wait ring in one go
+ *
+ *   - the output thread drains the wait ring into the output ring when it
+ *     becomes depleted
+ *
+ * The output ring stores the backlog too: the first qbacklog_len entries
+ * (starting at the head) are the ones that were popped but not yet acked,
+ * the rest are waiting to be sent.  This turns pop_head(), ack_backlog()
+ * and rewind_backlog() into index arithmetic instead of list
+ * manipulations.
+ */
+
+#define LOG_QUEUE_RING_INITIAL_CAPACITY 256
+
+typedef struct _LogQueueRingEntry
+{
+  LogMessage *msg;
+  guint ack_needed:1, flow_control_requested:1;
+} LogQueueRingEntry;
+
+typedef struct _LogQueueRing
+{
+  LogQueue super;
+
+  RingBuffer qoutput;           /* backlog entries followed by the output entries */
+  gint qbacklog_len;
+  RingBuffer qwait;
+  gint qoverflow_size;          /* in number of elements */
+
+  struct
+  {
+    RingBuffer items;
+    WorkerBatchCallback cb;
+    guint16 finish_cb_registered;
+  } qoverflow_input[0];
+} LogQueueRing;
+
+static LogQueueRingEntry *
+_ring_push(RingBuffer *rb)
+{
+  if (!ring_buffer_is_allocated(rb))
+    ring_buffer_alloc(rb, sizeof(LogQueueRingEntry), LOG_QUEUE_RING_INITIAL_CAPACITY);
+  else if (ring_buffer_is_full(rb))
+    ring_buffer_grow(rb, ring_buffer_capacity(rb) * 2);
+  return (LogQueueRingEntry *) ring_buffer_push(rb);
+}
+
+static LogQueueRingEntry *
+_ring_push_head(RingBuffer *rb)
+{
+  if (!ring_buffer_is_allocated(rb))
+    ring_buffer_alloc(rb, sizeof(LogQueueRingEntry), LOG_QUEUE_RING_INITIAL_CAPACITY);
+  else if (ring_buffer_is_full(rb))
+    ring_buffer_grow(rb, ring_buffer_capacity(rb) * 2);
+  return (LogQueueRingEntry *) ring_buffer_push_head(rb);
+}
+
+static void
+_ring_move_all(RingBuffer *dst, RingBuffer *src)
+{
+  LogQueueRingEntry *entry;
+
+  if (!ring_buffer_is_allocated(src))
+    return;
+
+  while ((entry = ring_buffer_pop(src)))
+    *_ring_push(dst) = *entry;
+}
+
+static void
+_ring_drop_entry(LogQueueRingEntry *entry)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  path_options.ack_needed = entry->ack_needed;
+  path_options.flow_control_requested = entry->flow_control_requested;
+  if (path_options.flow_control_requested)
+    log_msg_drop(entry->msg, &path_options, AT_SUSPENDED);
+  else
+    log_msg_drop(entry->msg, &path_options, AT_PROCESSED);
+}
+
+static gint
+_ring_count(RingBuffer *rb)
+{
+  return ring_buffer_is_allocated(rb) ? ring_buffer_count(rb) : 0;
+}
+
+static gint
+log_queue_ring_get_output_len(LogQueueRing *self)
+{
+  return _ring_count(&self->qoutput) - self->qbacklog_len;
+}
+
+/* NOTE: this is inherently racy, see log_queue_fifo_get_length() */
+static gint64
+log_queue_ring_get_length(LogQueue *s)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+
+  return _ring_count(&self->qwait) + log_queue_ring_get_output_len(self);
+}
+
+static gboolean
+log_queue_ring_is_empty_racy(LogQueue *s)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  gboolean has_message_in_queue = FALSE;
+
+  g_static_mutex_lock(&self->super.lock);
+  if (log_queue_ring_get_length(s) > 0)
+    {
+      has_message_in_queue = TRUE;
+    }
+  else
+    {
+      gint i;
+      for (i = 0; i < log_queue_max_threads && !has_message_in_queue; i++)
+        {
+          has_message_in_queue |= self->qoverflow_input[i].finish_cb_registered;
+        }
+    }
+  g_static_mutex_unlock(&self->super.lock);
+  return !has_message_in_queue;
+}
+
+/* NOTE: this is inherently racy, can only be called if log processing is suspended (e.g. reload time) */
+static gboolean
+log_queue_ring_keep_on_reload(LogQueue *s)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  return log_queue_ring_get_length(s) > 0 || self->qbacklog_len > 0;
+}
+
+/* move items from the per-thread input segment to the lock-protected "wait" ring */
+static void
+log_queue_ring_move_input_unlocked(LogQueueRing *self, gint thread_id)
+{
+  RingBuffer *input = &self->qoverflow_input[thread_id].items;
+  gint queue_len;
+  gint input_len;
+
+  /* the same race applies here as in log_queue_fifo_move_input_unlocked() */
+  queue_len = log_queue_ring_get_length(&self->super);
+  input_len = _ring_count(input);
+  if (queue_len + input_len > self->qoverflow_size)
+    {
+      gint i;
+      gint n;
+
+      n = input_len - MAX(0, (self->qoverflow_size - queue_len));
+      for (i = 0; i < n; i++)
+        {
+          stats_counter_inc(self->super.dropped_messages);
+          _ring_drop_entry(ring_buffer_pop(input));
+        }
+      input_len -= n;
+      msg_debug("Destination queue full, dropping messages",
+                evt_tag_int("queue_len", queue_len),
+                evt_tag_int("log_fifo_size", self->qoverflow_size),
+                evt_tag_int("count", n),
+                evt_tag_str("persist_name", self->super.persist_name));
+    }
+  stats_counter_add(self->super.stored_messages, input_len);
+  _ring_move_all(&self->qwait, input);
+}
+
+static gpointer
+log_queue_ring_move_input(gpointer user_data)
+{
+  LogQueueRing *self = (LogQueueRing *) user_data;
+  gint thread_id;
+
+  thread_id = main_loop_worker_get_thread_id();
+
+  g_assert(thread_id >= 0);
+
+  g_static_mutex_lock(&self->super.lock);
+  log_queue_ring_move_input_unlocked(self, thread_id);
+  log_queue_push_notify(&self->super);
+  g_static_mutex_unlock(&self->super.lock);
+  self->qoverflow_input[thread_id].finish_cb_registered = FALSE;
+  return NULL;
+}
+
+/*
+ * Same as log_queue_fifo_push_tail(): input threads append to their
+ * per-thread segment, others go directly to the wait ring.
+ *
+ * NOTE: It consumes the reference passed by the caller.
+ */
+static void
+log_queue_ring_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  LogQueueRingEntry *entry;
+  gint thread_id;
+
+  thread_id = main_loop_worker_get_thread_id();
+
+  g_assert(thread_id < 0 || log_queue_max_threads > thread_id);
+
+  if (thread_id >= 0)
+    {
+      /* fastpath, use per-thread input segments */
+      if (!self->qoverflow_input[thread_id].finish_cb_registered)
+        {
+          main_loop_worker_register_batch_callback(&self->qoverflow_input[thread_id].cb);
+          self->qoverflow_input[thread_id].finish_cb_registered = TRUE;
+        }
+
+      entry = _ring_push(&self->qoverflow_input[thread_id].items);
+      entry->msg = msg;
+      entry->ack_needed = path_options->ack_needed;
+      entry->flow_control_requested = path_options->flow_control_requested;
+      return;
+    }
+
+  /* slow path, put the pending item to the wait ring */
+
+  g_static_mutex_lock(&self->super.lock);
+  if (log_queue_ring_get_length(s) < self->qoverflow_size)
+    {
+      entry = _ring_push(&self->qwait);
+      entry->msg = msg;
+      entry->ack_needed = path_options->ack_needed;
+      entry->flow_control_requested = path_options->flow_control_requested;
+      log_queue_push_notify(&self->super);
+
+      stats_counter_inc(self->super.stored_messages);
+      g_static_mutex_unlock(&self->super.lock);
+    }
+  else
+    {
+      stats_counter_inc(self->super.dropped_messages);
+      g_static_mutex_unlock(&self->super.lock);
+
+      if (path_options->flow_control_requested)
+        log_msg_drop(msg, path_options, AT_SUSPENDED);
+      else
+        log_msg_drop(msg, path_options, AT_PROCESSED);
+
+      msg_debug("Destination queue full, dropping message",
+                evt_tag_int("queue_len", log_queue_ring_get_length(&self->super)),
+                evt_tag_int("log_fifo_size", self->qoverflow_size),
+                evt_tag_str("persist_name", self->super.persist_name));
+    }
+}
+
+/*
+ * Put an item back to the front of the output, right after the backlog.
+ *
+ * This is assumed to be called only from the output thread. If the
+ * backlog is not empty, its entries have to be shifted, but this is a
+ * rarely used path.
+ *
+ * NOTE: It consumes the reference passed by the caller.
+ */
+static void
+log_queue_ring_push_head(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  LogQueueRingEntry *entry;
+  gint i;
+
+  entry = _ring_push_head(&self->qoutput);
+  for (i = 0; i < self->qbacklog_len; i++)
+    {
+      *entry = *(LogQueueRingEntry *) ring_buffer_element_at(&self->qoutput, i + 1);
+      entry = ring_buffer_element_at(&self->qoutput, i + 1);
+    }
+  entry->msg = msg;
+  entry->ack_needed = path_options->ack_needed;
+  entry->flow_control_requested = path_options->flow_control_requested;
+
+  stats_counter_inc(self->super.stored_messages);
+}
+
+/*
+ * Can only run from the output thread.
+ *
+ * NOTE: this returns a reference which the caller must take care to free.
+ */
+static LogMessage *
+log_queue_ring_pop_head(LogQueue *s, LogPathOptions *path_options)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  LogQueueRingEntry *entry;
+  LogMessage *msg;
+
+  if (log_queue_ring_get_output_len(self) == 0)
+    {
+      /* slow path, output is empty, get the elements from the wait ring */
+      g_static_mutex_lock(&self->super.lock);
+      _ring_move_all(&self->qoutput, &self->qwait);
+      g_static_mutex_unlock(&self->super.lock);
+    }
+
+  if (log_queue_ring_get_output_len(self) == 0)
+    return NULL;
+
+  entry = ring_buffer_element_at(&self->qoutput, self->qbacklog_len);
+  msg = entry->msg;
+  path_options->ack_needed = entry->ack_needed;
+
+  if (self->super.use_backlog)
+    {
+      /* the entry keeps its reference while it is on the backlog */
+      log_msg_ref(msg);
+      self->qbacklog_len++;
+    }
+  else
+    {
+      ring_buffer_pop(&self->qoutput);
+    }
+  stats_counter_dec(self->super.stored_messages);
+
+  return msg;
+}
+
+/*
+ * Can only run from the output thread.
+ */
+static void
+log_queue_ring_ack_backlog(LogQueue *s, gint rewind_count)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gint pos;
+
+  for (pos = 0; pos < rewind_count && self->qbacklog_len > 0; pos++)
+    {
+      LogQueueRingEntry *entry = ring_buffer_pop(&self->qoutput);
+
+      self->qbacklog_len--;
+      path_options.ack_needed = entry->ack_needed;
+      log_msg_ack(entry->msg, &path_options, AT_PROCESSED);
+      log_msg_unref(entry->msg);
+    }
+}
+
+/*
+ * The backlog is directly followed by the output entries in the ring, so
+ * rewinding only moves the boundary between the two.
+ *
+ * NOTE: this is assumed to be called from the output thread.
+ */
+static void
+log_queue_ring_rewind_backlog_all(LogQueue *s)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+
+  stats_counter_add(self->super.stored_messages, self->qbacklog_len);
+  self->qbacklog_len = 0;
+}
+
+static void
+log_queue_ring_rewind_backlog(LogQueue *s, guint rewind_count)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+
+  if (rewind_count > self->qbacklog_len)
+    rewind_count = self->qbacklog_len;
+
+  self->qbacklog_len -= rewind_count;
+  stats_counter_add(self->super.stored_messages, rewind_count);
+}
+
+static void
+log_queue_ring_free_queue(RingBuffer *rb)
+{
+  LogQueueRingEntry *entry;
+
+  if (!ring_buffer_is_allocated(rb))
+    return;
+
+  while ((entry = ring_buffer_pop(rb)))
+    {
+      LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+      path_options.ack_needed = entry->ack_needed;
+      log_msg_ack(entry->msg, &path_options, AT_ABORTED);
+      log_msg_unref(entry->msg);
+    }
+  ring_buffer_free(rb);
+}
+
+static void
+log_queue_ring_free(LogQueue *s)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  gint i;
+
+  for (i = 0; i < log_queue_max_threads; i++)
+    log_queue_ring_free_queue(&self->qoverflow_input[i].items);
+
+  log_queue_ring_free_queue(&self->qwait);
+  log_queue_ring_free_queue(&self->qoutput);
+  log_queue_free_method(s);
+}
+
+LogQueue *
+log_queue_ring_new(gint qoverflow_size, const gchar *persist_name)
+{
+  LogQueueRing *self;
+  gint i;
+
+  self = g_malloc0(sizeof(LogQueueRing) + log_queue_max_threads * sizeof(self->qoverflow_input[0]));
+
+  log_queue_init_instance(&self->super, persist_name);
+  self->super.type = log_queue_ring_type;
+  self->super.use_backlog = FALSE;
+  self->super.get_length = log_queue_ring_get_length;
+  self->super.is_empty_racy = log_queue_ring_is_empty_racy;
+  self->super.keep_on_reload = log_queue_ring_keep_on_reload;
+  self->super.push_tail = log_queue_ring_push_tail;
+  self->super.push_head = log_queue_ring_push_head;
+  self->super.pop_head = log_queue_ring_pop_head;
+  self->super.ack_backlog = log_queue_ring_ack_backlog;
+  self->super.rewind_backlog = log_queue_ring_rewind_backlog;
+  self->super.rewind_backlog_all = log_queue_ring_rewind_backlog_all;
+
+  self->super.free_fn = log_queue_ring_free;
+
+  for (i = 0; i < log_queue_max_threads; i++)
+    {
+      ring_buffer_init(&self->qoverflow_input[i].items);
+      worker_batch_callback_init(&self->qoverflow_input[i].cb);
+      self->qoverflow_input[i].cb.user_data = self;
+      self->qoverflow_input[i].cb.func = log_queue_ring_move_input;
+    }
+  ring_buffer_init(&self->qwait);
+  ring_buffer_init(&self->qoutput);
+
+  self->qoverflow_size = qoverflow_size;
+  return &self->super;
+}
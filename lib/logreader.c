@@ -26,6 +26,7 @@
 #include "mainloop-io-worker.h"
 #include "mainloop-call.h"
 #include "ack_tracker.h"
+#include "timeutils.h"
 
 #include <iv_event.h>
 
@@ -50,6 +51,13 @@ struct _LogReader
   MainLoopIOWorkerJob io_job;
   gboolean watches_running:1, suspended:1;
   gint notify_code;
+  /* in multi-reactor mode schedule_wakeup is registered asynchronously */
+  volatile gboolean wakeup_registered;
+
+  /* the number of messages fetched in a single poll iteration, equals
+   * options->fetch_limit unless adaptive-flow-control() is enabled */
+  gint fetch_limit;
+  StatsCounterItem *fetch_limit_stat;
 
 
   /* proto & poll_events pending to be applied. As long as the previous
@@ -88,6 +96,16 @@ log_reader_work_perform(void *s)
   self->notify_code = log_reader_fetch_log(self);
 }
 
+static gpointer
+log_reader_notify_deferred(gpointer s)
+{
+  gpointer *args = (gpointer *) s;
+  LogReader *self = args[0];
+
+  log_pipe_notify(self->control, GPOINTER_TO_INT(args[1]), self);
+  return NULL;
+}
+
 static void
 log_reader_work_finished(void *s)
 {
@@ -116,7 +134,18 @@ log_reader_work_finished(void *s)
       gint notify_code = self->notify_code;
 
       self->notify_code = 0;
-      log_pipe_notify(self->control, notify_code, self);
+      if (self->io_job.reactor >= 0)
+        {
+          /* control notifications are processed in the main thread, it
+           * may deinitialize us, which is checked below */
+          gpointer args[] = { self, GINT_TO_POINTER(notify_code) };
+
+          main_loop_call((MainLoopTaskFunc) log_reader_notify_deferred, args, TRUE);
+        }
+      else
+        {
+          log_pipe_notify(self->control, notify_code, self);
+        }
     }
   if (self->super.super.flags & PIF_INITIALIZED)
     {
@@ -163,7 +192,7 @@ log_reader_wakeup(LogSource *s)
    *
    */
 
-  if (self->super.super.flags & PIF_INITIALIZED)
+  if ((self->super.super.flags & PIF_INITIALIZED) && self->wakeup_registered)
     iv_event_post(&self->schedule_wakeup);
 }
 
@@ -176,6 +205,7 @@ log_reader_io_process_input(gpointer s)
   log_pipe_ref(&self->super.super);
   if ((self->options->flags & LR_THREADED))
     {
+      /* in multi-reactor mode this runs the job inline, in the reactor thread */
       main_loop_io_worker_job_submit(&self->io_job);
     }
   else
@@ -270,7 +300,10 @@ log_reader_update_watches(LogReader *self)
   gboolean free_to_send;
   gboolean line_is_ready_in_buffer;
 
-  main_loop_assert_main_thread();
+  if (self->io_job.reactor >= 0)
+    g_assert(main_loop_io_worker_is_reactor_thread(self->io_job.reactor));
+  else
+    main_loop_assert_main_thread();
 
   if (!log_reader_is_opened(self))
     return;
@@ -312,6 +345,7 @@ log_reader_handle_line(LogReader *self, const guchar *line, gint length, LogTran
   m = log_msg_new((gchar *) line, length,
                   aux->peer_addr ? : self->peer_addr,
                   &self->options->parse_options);
+  m->recvd_monotonic_usec = get_monotonic_usec();
 
   log_msg_refcache_start_producer(m);
   
@@ -322,12 +356,41 @@ log_reader_handle_line(LogReader *self, const guchar *line, gint length, LogTran
   return log_source_free_to_send(&self->super);
 }
 
+/*
+ * In adaptive mode the fetch limit is raised (up to the window size) while
+ * the source has more input than the current limit and there's room in
+ * the window, and is halved (down to log-fetch-limit()) when the window
+ * gets exhausted, e.g. because the destination is slow to acknowledge
+ * messages or its queue is filling up.  This way bursty sources are
+ * processed in larger batches, while slow paths yield the worker thread
+ * to other sources earlier.
+ */
+static void
+log_reader_adapt_fetch_limit(LogReader *self, gint msg_count, gboolean window_full)
+{
+  gint fetch_limit = self->fetch_limit;
+  gint max_fetch_limit = MAX(self->options->fetch_limit, log_source_get_init_window_size(&self->super));
+
+  if (window_full)
+    fetch_limit = MAX(fetch_limit / 2, self->options->fetch_limit);
+  else if (msg_count == fetch_limit)
+    fetch_limit = MIN(fetch_limit * 2, max_fetch_limit);
+
+  if (fetch_limit != self->fetch_limit)
+    {
+      self->fetch_limit = fetch_limit;
+      stats_counter_set(self->fetch_limit_stat, fetch_limit);
+    }
+}
+
 /* returns: notify_code (NC_XXXX) or 0 for success */
 static gint
 log_reader_fetch_log(LogReader *self)
 {
   gint msg_count = 0;
+  gint fetch_limit = self->fetch_limit;
   gboolean may_read = TRUE;
+  gboolean window_full = FALSE;
   LogTransportAuxData aux;
 
   if (self->waiting_for_preemption)
@@ -338,7 +401,7 @@ log_reader_fetch_log(LogReader *self)
    * fetch_limit).
    */
   log_transport_aux_data_init(&aux);
-  while (msg_count < self->options->fetch_limit && !main_loop_worker_job_quit())
+  while (msg_count < fetch_limit && !main_loop_worker_job_quit())
     {
       Bookmark *bookmark;
       const guchar *msg;
@@ -381,6 +444,7 @@ log_reader_fetch_log(LogReader *self)
           if (!log_reader_handle_line(self, msg, msg_len, &aux))
             {
               /* window is full, don't generate further messages */
+              window_full = TRUE;
               break;
             }
         }
@@ -398,11 +462,48 @@ log_reader_fetch_log(LogReader *self)
           self->waiting_for_preemption = TRUE;
         }
     }
-  if (msg_count == self->options->fetch_limit)
+  if (msg_count == fetch_limit)
     self->immediate_check = TRUE;
+  if (self->options->super.adaptive_flow_control)
+    log_reader_adapt_fetch_limit(self, msg_count, window_full);
   return 0;
 }
 
+/* NOTE: runs in the reactor thread */
+static gpointer
+log_reader_start_in_reactor(gpointer s)
+{
+  LogReader *self = (LogReader *) s;
+
+  if ((self->super.super.flags & PIF_INITIALIZED) && !self->wakeup_registered)
+    {
+      iv_event_register(&self->schedule_wakeup);
+      self->wakeup_registered = TRUE;
+
+      /* a parked job rearms the watches when the reactor is resumed */
+      if (!self->io_job.working)
+        log_reader_update_watches(self);
+    }
+  log_pipe_unref(&self->super.super);
+  return NULL;
+}
+
+/* NOTE: runs in the reactor thread */
+static gpointer
+log_reader_stop_in_reactor(gpointer s)
+{
+  LogReader *self = (LogReader *) s;
+
+  if (self->wakeup_registered)
+    {
+      self->wakeup_registered = FALSE;
+      iv_event_unregister(&self->schedule_wakeup);
+    }
+  log_reader_stop_watches(self);
+  log_pipe_unref(&self->super.super);
+  return NULL;
+}
+
 static gboolean
 log_reader_init(LogPipe *s)
 {
@@ -421,10 +522,35 @@ log_reader_init(LogPipe *s)
       return FALSE;
     }
 
+  if (self->options->super.adaptive_flow_control)
+    {
+      gchar *instance = log_source_format_stats_instance(&self->super, "fetch_limit");
+
+      stats_lock();
+      stats_register_counter(self->super.stats_level, self->super.stats_source | SCS_SOURCE, self->super.stats_id, instance, SC_TYPE_STORED, &self->fetch_limit_stat);
+      stats_unlock();
+      stats_counter_set(self->fetch_limit_stat, self->fetch_limit);
+      g_free(instance);
+    }
+
   poll_events_set_callback(self->poll_events, log_reader_io_process_input, self);
 
-  log_reader_update_watches(self);
-  iv_event_register(&self->schedule_wakeup);
+  /* the reactor is assigned once, when the reader is first initialized
+   * (e.g. at accept time), and is kept over reloads */
+  if ((self->options->flags & LR_THREADED) && self->io_job.reactor < 0)
+    self->io_job.reactor = main_loop_io_worker_assign_reactor();
+
+  if (self->io_job.reactor >= 0)
+    {
+      log_pipe_ref(&self->super.super);
+      main_loop_io_worker_reactor_call(self->io_job.reactor, log_reader_start_in_reactor, self);
+    }
+  else
+    {
+      log_reader_update_watches(self);
+      iv_event_register(&self->schedule_wakeup);
+      self->wakeup_registered = TRUE;
+    }
 
   return TRUE;
 }
@@ -433,11 +559,28 @@ static gboolean
 log_reader_deinit(LogPipe *s)
 {
   LogReader *self = (LogReader *) s;
+  gchar *instance;
   
   main_loop_assert_main_thread();
 
-  iv_event_unregister(&self->schedule_wakeup);
-  log_reader_stop_watches(self);
+  if (self->io_job.reactor >= 0)
+    {
+      log_pipe_ref(&self->super.super);
+      main_loop_io_worker_reactor_call(self->io_job.reactor, log_reader_stop_in_reactor, self);
+    }
+  else
+    {
+      self->wakeup_registered = FALSE;
+      iv_event_unregister(&self->schedule_wakeup);
+      log_reader_stop_watches(self);
+    }
+
+  instance = log_source_format_stats_instance(&self->super, "fetch_limit");
+  stats_lock();
+  stats_unregister_counter(self->super.stats_source | SCS_SOURCE, self->super.stats_id, instance, SC_TYPE_STORED, &self->fetch_limit_stat);
+  stats_unlock();
+  g_free(instance);
+
   if (!log_source_deinit(s))
     return FALSE;
 
@@ -478,14 +621,45 @@ log_reader_set_options(LogReader *s, LogPipe *control, LogReaderOptions *options
   self->control = control;
 
   self->options = options;
+  self->fetch_limit = options->fetch_limit;
   if (self->proto)
     log_proto_server_set_options(self->proto, &self->options->proto_options.super);
 }
 
+/* NOTE: runs in the reactor thread, applies the proto & poll_events
+ * passed to log_reader_reopen() unless a job is parked, in which case
+ * log_reader_work_finished() applies them once the reactor resumes. */
+static gpointer
+log_reader_reopen_in_reactor(gpointer s)
+{
+  LogReader *self = (LogReader *) s;
+
+  if (!self->io_job.working)
+    {
+      g_static_mutex_lock(&self->pending_proto_lock);
+      if (self->pending_proto_present)
+        {
+          log_reader_stop_watches(self);
+          log_reader_apply_proto_and_poll_events(self, self->pending_proto, self->pending_poll_events);
+          self->pending_proto = NULL;
+          self->pending_poll_events = NULL;
+          self->pending_proto_present = FALSE;
+          g_cond_signal(self->pending_proto_cond);
+        }
+      g_static_mutex_unlock(&self->pending_proto_lock);
+
+      if (self->super.super.flags & PIF_INITIALIZED)
+        log_reader_update_watches(self);
+    }
+  log_pipe_unref(&self->super.super);
+  return NULL;
+}
+
 /* run in the main thread in reaction to a log_reader_reopen to change
  * the source LogProtoServer instance. It needs to be ran in the main
  * thread as it reregisters the watches associated with the main
- * thread. */
+ * thread. In multi-reactor mode the watches belong to the reactor
+ * thread, so the change is passed over there. */
 void
 log_reader_reopen_deferred(gpointer s)
 {
@@ -494,6 +668,25 @@ log_reader_reopen_deferred(gpointer s)
   LogProtoServer *proto = args[1];
   PollEvents *poll_events = args[2];
 
+  if (self->io_job.reactor >= 0)
+    {
+      g_static_mutex_lock(&self->pending_proto_lock);
+      if (self->pending_proto_present)
+        {
+          /* a previous reopen was not applied yet, it is superseded */
+          log_proto_server_free(self->pending_proto);
+          poll_events_free(self->pending_poll_events);
+        }
+      self->pending_proto = proto;
+      self->pending_poll_events = poll_events;
+      self->pending_proto_present = TRUE;
+      g_static_mutex_unlock(&self->pending_proto_lock);
+
+      log_pipe_ref(&self->super.super);
+      main_loop_io_worker_reactor_call(self->io_job.reactor, log_reader_reopen_in_reactor, self);
+      return;
+    }
+
   if (self->io_job.working)
     {
       self->pending_proto = proto;
@@ -504,7 +697,10 @@ log_reader_reopen_deferred(gpointer s)
 
   log_reader_stop_watches(self);
   log_reader_apply_proto_and_poll_events(self, proto, poll_events);
-  log_reader_update_watches(self);
+
+  /* watches are started by log_reader_init() if we are not initialized yet */
+  if (self->super.super.flags & PIF_INITIALIZED)
+    log_reader_update_watches(self);
 }
 
 void
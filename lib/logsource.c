@@ -35,6 +35,105 @@
 
 gboolean accurate_nanosleep = FALSE;
 
+/*
+ * Window slots shared by all the sources of a driver in
+ * adaptive-flow-control(yes) mode.  When a source exhausts its own window,
+ * it borrows up to init_window_size slots from here, which are given back
+ * as the messages are acknowledged.  Sources that do not exhaust their
+ * windows never touch the reserve, so their share is not affected by busy
+ * neighbours.
+ *
+ * Reference counted, as sources (e.g. kept-alive connections) may survive
+ * the options they were created with.
+ */
+struct _LogSourceWindowReserve
+{
+  GAtomicCounter ref_cnt;
+  gint free_slots;
+};
+
+static LogSourceWindowReserve *
+_window_reserve_new(gint size)
+{
+  LogSourceWindowReserve *self = g_new0(LogSourceWindowReserve, 1);
+
+  g_atomic_counter_set(&self->ref_cnt, 1);
+  self->free_slots = size;
+  return self;
+}
+
+static LogSourceWindowReserve *
+_window_reserve_ref(LogSourceWindowReserve *self)
+{
+  g_atomic_counter_inc(&self->ref_cnt);
+  return self;
+}
+
+static void
+_window_reserve_unref(LogSourceWindowReserve *self)
+{
+  if (self && g_atomic_counter_dec_and_test(&self->ref_cnt))
+    g_free(self);
+}
+
+static gint
+_window_reserve_take(LogSourceWindowReserve *self, gint count)
+{
+  gint free_slots, taken;
+
+  do
+    {
+      free_slots = g_atomic_int_get(&self->free_slots);
+      taken = MIN(free_slots, count);
+      if (taken <= 0)
+        return 0;
+    }
+  while (!g_atomic_int_compare_and_exchange(&self->free_slots, free_slots, free_slots - taken));
+  return taken;
+}
+
+static inline void
+_update_window_size_stat(LogSource *self)
+{
+  stats_counter_set(self->window_size_stat, self->options->init_window_size + g_atomic_int_get(&self->window_borrowed));
+}
+
+/* runs in the source's thread, right after the window was exhausted */
+static void
+_flow_control_borrow_window(LogSource *self)
+{
+  gint borrowed;
+
+  borrowed = _window_reserve_take(self->window_reserve, self->options->init_window_size);
+  if (borrowed == 0)
+    return;
+
+  g_atomic_int_add(&self->window_borrowed, borrowed);
+  g_atomic_counter_exchange_and_add(&self->window_size, borrowed);
+  _update_window_size_stat(self);
+}
+
+/* runs in the destination's thread, returns the part of the increment
+ * that belongs to the source's own window */
+static guint32
+_flow_control_return_borrowed_window(LogSource *self, guint32 window_size_increment)
+{
+  gint borrowed, returned;
+
+  do
+    {
+      borrowed = g_atomic_int_get(&self->window_borrowed);
+      returned = MIN(borrowed, (gint) window_size_increment);
+      if (returned <= 0)
+        return window_size_increment;
+    }
+  while (!g_atomic_int_compare_and_exchange(&self->window_borrowed, borrowed, borrowed - returned));
+
+  g_atomic_int_add(&self->window_reserve->free_slots, returned);
+  _update_window_size_stat(self);
+  return window_size_increment - returned;
+}
+
 void
 log_source_wakeup(LogSource *self)
 {
@@ -47,6 +146,9 @@ _flow_control_window_size_adjust(LogSource *self, guint32 window_size_increment)
 {
   guint32 old_window_size;
 
+  if (self->window_reserve)
+    window_size_increment = _flow_control_return_borrowed_window(self, window_size_increment);
+
   window_size_increment += g_atomic_counter_get(&self->suspended_window_size);
   old_window_size = g_atomic_counter_exchange_and_add(&self->window_size, window_size_increment);
   g_atomic_counter_set(&self->suspended_window_size, 0);
@@ -197,6 +299,13 @@ log_source_mangle_hostname(LogSource *self, LogMessage *msg)
     }
 }
 
+/* instance name for auxiliary per-source values, e.g. "<instance>,window_size" */
+gchar *
+log_source_format_stats_instance(LogSource *self, const gchar *suffix)
+{
+  return g_strdup_printf("%s,%s", self->stats_instance ? self->stats_instance : "", suffix);
+}
+
 gboolean
 log_source_init(LogPipe *s)
 {
@@ -205,6 +314,15 @@ log_source_init(LogPipe *s)
   stats_lock();
   stats_register_counter(self->stats_level, self->stats_source | SCS_SOURCE, self->stats_id, self->stats_instance, SC_TYPE_PROCESSED, &self->recvd_messages);
   stats_register_counter(self->stats_level, self->stats_source | SCS_SOURCE, self->stats_id, self->stats_instance, SC_TYPE_STAMP, &self->last_message_seen);
+  /* NOTE: log_reader_reopen() calls us before options are set */
+  if (self->options && self->options->adaptive_flow_control)
+    {
+      gchar *instance = log_source_format_stats_instance(self, "window_size");
+
+      stats_register_counter(self->stats_level, self->stats_source | SCS_SOURCE, self->stats_id, instance, SC_TYPE_STORED, &self->window_size_stat);
+      g_free(instance);
+      _update_window_size_stat(self);
+    }
   stats_unlock();
   return TRUE;
 }
@@ -213,10 +331,14 @@ gboolean
 log_source_deinit(LogPipe *s)
 {
   LogSource *self = (LogSource *) s;
+  gchar *instance;
   
   stats_lock();
   stats_unregister_counter(self->stats_source | SCS_SOURCE, self->stats_id, self->stats_instance, SC_TYPE_PROCESSED, &self->recvd_messages);
   stats_unregister_counter(self->stats_source | SCS_SOURCE, self->stats_id, self->stats_instance, SC_TYPE_STAMP, &self->last_message_seen);
+  instance = log_source_format_stats_instance(self, "window_size");
+  stats_unregister_counter(self->stats_source | SCS_SOURCE, self->stats_id, instance, SC_TYPE_STORED, &self->window_size_stat);
+  g_free(instance);
   stats_unlock();
   return TRUE;
 }
@@ -246,6 +368,8 @@ log_source_post(LogSource *self, LogMessage *msg)
    */
 
   g_assert(old_window_size > 0);
+  if (old_window_size == 1 && self->window_reserve)
+    _flow_control_borrow_window(self);
   log_pipe_queue(&self->super, msg, &path_options);
 }
 
@@ -350,6 +474,10 @@ log_source_set_options(LogSource *self, LogSourceOptions *options, gint stats_le
   
   if (g_atomic_counter_get(&self->window_size) == -1)
     g_atomic_counter_set(&self->window_size, options->init_window_size);
+  /* same applies to the window reserve, a source keeps borrowing from the
+   * one it was created with */
+  if (!self->window_reserve && options->window_reserve)
+    self->window_reserve = _window_reserve_ref(options->window_reserve);
   self->options = options;
   self->stats_level = stats_level;
   self->stats_source = stats_source;
@@ -387,12 +515,15 @@ log_source_free(LogPipe *s)
   log_pipe_free_method(s);
 
   ack_tracker_free(self->ack_tracker);
+  _window_reserve_unref(self->window_reserve);
 }
 
 void
 log_source_options_defaults(LogSourceOptions *options)
 {
   options->init_window_size = 100;
+  options->adaptive_flow_control = FALSE;
+  options->window_reserve_size = -1;
   options->keep_hostname = -1;
   options->chain_hostnames = -1;
   options->keep_timestamp = -1;
@@ -420,12 +551,23 @@ log_source_options_init(LogSourceOptions *options, GlobalConfig *cfg, const gcha
   options->source_group_tag = log_tags_get_by_name(source_group_name);
   g_free(source_group_name);
   host_resolve_options_init(&options->host_resolve_options, cfg);
+
+  /* by default the reserve equals a single source's window */
+  if (options->adaptive_flow_control && !options->window_reserve)
+    {
+      gint reserve_size = options->window_reserve_size < 0 ? options->init_window_size : options->window_reserve_size;
+
+      if (reserve_size > 0)
+        options->window_reserve = _window_reserve_new(reserve_size);
+    }
 }
 
 void
 log_source_options_destroy(LogSourceOptions *options)
 {
   host_resolve_options_destroy(&options->host_resolve_options);
+  _window_reserve_unref(options->window_reserve);
+  options->window_reserve = NULL;
   if (options->program_override)
     g_free(options->program_override);
   if (options->host_override)
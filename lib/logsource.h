@@ -28,9 +28,16 @@
 #include "logpipe.h"
 #include "stats/stats-registry.h"
 
+typedef struct _LogSourceWindowReserve LogSourceWindowReserve;
+
 typedef struct _LogSourceOptions
 {
   gint init_window_size;
+  gboolean adaptive_flow_control;
+  /* window slots shared between the sources using these options, a source
+   * that exhausted its own window may borrow from here */
+  gint window_reserve_size;
+  LogSourceWindowReserve *window_reserve;
   const gchar *group_name;
   gboolean keep_timestamp;
   gboolean keep_hostname;
@@ -73,6 +80,9 @@ struct _LogSource
   glong window_full_sleep_nsec;
   struct timespec last_ack_rate_time;
   AckTracker *ack_tracker;
+  LogSourceWindowReserve *window_reserve;
+  gint window_borrowed;
+  StatsCounterItem *window_size_stat;
 
   void (*wakeup)(LogSource *s);
 };
@@ -89,6 +99,7 @@ log_source_get_init_window_size(LogSource *self)
   return self->options->init_window_size;
 }
 
+gchar *log_source_format_stats_instance(LogSource *self, const gchar *suffix);
 gboolean log_source_init(LogPipe *s);
 gboolean log_source_deinit(LogPipe *s);
 
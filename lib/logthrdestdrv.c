@@ -24,6 +24,8 @@
 
 #include "logthrdestdrv.h"
 #include "seqnum.h"
+#include "cpu-affinity.h"
+#include "timeutils.h"
 
 #define MAX_RETRIES_OF_FAILED_INSERT_DEFAULT 3
 
@@ -93,6 +95,8 @@ log_threaded_dest_driver_shutdown(gpointer data)
 {
   LogThrDestDriver *self = (LogThrDestDriver *)data;
   log_threaded_dest_driver_stop_watches(self);
+  if (iv_timer_registered(&self->timer_flush))
+    iv_timer_unregister(&self->timer_flush);
   iv_quit();
 }
 
@@ -134,10 +138,166 @@ _disconnect_and_suspend(LogThrDestDriver *self)
 {
   self->suspended = TRUE;
   __disconnect(self);
+  log_threaded_dest_driver_batch_rewind(self);
   log_queue_reset_parallel_push(self->queue);
   log_threaded_dest_driver_suspend(self);
 }
 
+static void
+log_threaded_dest_driver_process_batch_result(LogThrDestDriver *self, worker_insert_result_t result)
+{
+  switch (result)
+    {
+    case WORKER_INSERT_RESULT_DROP:
+      log_threaded_dest_driver_batch_drop(self, self->batch.size);
+      _disconnect_and_suspend(self);
+      break;
+
+    case WORKER_INSERT_RESULT_ERROR:
+      self->retries.counter++;
+
+      if (self->retries.counter >= self->retries.max)
+        {
+          msg_error("Error occurred while trying to flush a batch of messages, dropping the batch",
+                    evt_tag_int("batch_size", self->batch.size),
+                    evt_tag_str("driver", self->super.super.id));
+          log_threaded_dest_driver_batch_drop(self, self->batch.size);
+        }
+      else
+        {
+          _disconnect_and_suspend(self);
+        }
+      break;
+
+    case WORKER_INSERT_RESULT_REJECTED:
+      log_threaded_dest_driver_batch_drop(self, self->batch.size);
+      break;
+
+    case WORKER_INSERT_RESULT_NOT_CONNECTED:
+      _disconnect_and_suspend(self);
+      break;
+
+    case WORKER_INSERT_RESULT_REWIND:
+      log_threaded_dest_driver_batch_rewind(self);
+      break;
+
+    case WORKER_INSERT_RESULT_SUCCESS:
+      log_threaded_dest_driver_batch_accept(self, self->batch.size);
+      break;
+
+    default:
+      g_assert_not_reached();
+      break;
+    }
+}
+
+static void
+log_threaded_dest_driver_flush(LogThrDestDriver *self)
+{
+  if (iv_timer_registered(&self->timer_flush))
+    iv_timer_unregister(&self->timer_flush);
+
+  self->batch.flush_requested = FALSE;
+  if (self->batch.size == 0)
+    return;
+
+  log_threaded_dest_driver_process_batch_result(self, self->worker.flush(self));
+}
+
+static void
+log_threaded_dest_driver_schedule_flush(LogThrDestDriver *self)
+{
+  if (self->batch.size == 0 || iv_timer_registered(&self->timer_flush))
+    return;
+
+  if (self->batch.timeout <= 0)
+    {
+      log_threaded_dest_driver_flush(self);
+      return;
+    }
+
+  iv_validate_now();
+  self->timer_flush.expires = iv_now;
+  timespec_add_msec(&self->timer_flush.expires, self->batch.timeout);
+  iv_timer_register(&self->timer_flush);
+}
+
+static inline void
+log_threaded_dest_driver_record_latency(LogThrDestDriver *self, guint64 recvd_monotonic_usec)
+{
+  if (self->latency && recvd_monotonic_usec)
+    stats_histogram_record(self->latency, get_monotonic_usec() - recvd_monotonic_usec);
+}
+
+static void
+log_threaded_dest_driver_process_insert_result(LogThrDestDriver *self, worker_insert_result_t result, LogMessage *msg)
+{
+  switch (result)
+    {
+    case WORKER_INSERT_RESULT_DROP:
+      log_threaded_dest_driver_message_drop(self, msg);
+      _disconnect_and_suspend(self);
+      break;
+
+    case WORKER_INSERT_RESULT_ERROR:
+      self->retries.counter++;
+
+      if (self->retries.counter >= self->retries.max)
+        {
+          if (self->messages.retry_over)
+            self->messages.retry_over(self, msg);
+          log_threaded_dest_driver_message_drop(self, msg);
+        }
+      else
+        {
+          log_threaded_dest_driver_message_rewind(self, msg);
+          _disconnect_and_suspend(self);
+        }
+      break;
+
+    case WORKER_INSERT_RESULT_REJECTED:
+      log_threaded_dest_driver_message_drop(self, msg);
+      break;
+
+    case WORKER_INSERT_RESULT_NOT_CONNECTED:
+      log_threaded_dest_driver_message_rewind(self, msg);
+      _disconnect_and_suspend(self);
+      break;
+
+    case WORKER_INSERT_RESULT_REWIND:
+      log_threaded_dest_driver_message_rewind(self, msg);
+      break;
+
+    case WORKER_INSERT_RESULT_SUCCESS:
+      log_threaded_dest_driver_record_latency(self, msg->recvd_monotonic_usec);
+      log_threaded_dest_driver_message_accept(self, msg);
+      break;
+
+    case WORKER_INSERT_RESULT_QUEUED:
+      /* the message stays in the backlog until the batch is flushed */
+      if (self->batch.size == 0)
+        self->batch.seq_num = self->seq_num;
+      step_sequence_number(&self->seq_num);
+      self->batch.size++;
+      g_array_append_val(self->batch.recvd_monotonic_usecs, msg->recvd_monotonic_usec);
+      log_msg_unref(msg);
+      break;
+
+    default:
+      break;
+    }
+}
+
+static gboolean
+log_threaded_dest_driver_is_batch_full(LogThrDestDriver *self)
+{
+  if (self->batch.size == 0)
+    return FALSE;
+
+  return self->batch.flush_requested ||
+         (self->batch.lines > 0 && self->batch.size >= self->batch.lines);
+}
+
 static void
 log_threaded_dest_driver_do_insert(LogThrDestDriver *self)
 {
@@ -153,49 +313,33 @@ log_threaded_dest_driver_do_insert(LogThrDestDriver *self)
 
       result = self->worker.insert(self, msg);
 
-      switch (result)
-        {
-        case WORKER_INSERT_RESULT_DROP:
-          log_threaded_dest_driver_message_drop(self, msg);
-          _disconnect_and_suspend(self);
-          break;
-
-        case WORKER_INSERT_RESULT_ERROR:
-          self->retries.counter++;
-
-          if (self->retries.counter >= self->retries.max)
-            {
-              if (self->messages.retry_over)
-                self->messages.retry_over(self, msg);
-              log_threaded_dest_driver_message_drop(self, msg);
-            }
-          else
-            {
-              log_threaded_dest_driver_message_rewind(self, msg);
-              _disconnect_and_suspend(self);
-            }
-          break;
-
-        case WORKER_INSERT_RESULT_NOT_CONNECTED:
-          log_threaded_dest_driver_message_rewind(self, msg);
-          _disconnect_and_suspend(self);
-          break;
+      if (self->batch.size > 0 && result == WORKER_INSERT_RESULT_SUCCESS)
+        result = WORKER_INSERT_RESULT_QUEUED;
 
-        case WORKER_INSERT_RESULT_REWIND:
+      if (self->batch.size > 0 && result != WORKER_INSERT_RESULT_QUEUED)
+        {
+          /* acks and rewinds operate on the two ends of the backlog, so
+           * the pending batch has to be settled before this message.  Put
+           * it back to the queue, it is retried once the batch is flushed. */
           log_threaded_dest_driver_message_rewind(self, msg);
-          break;
+          msg_set_context(NULL);
+          log_msg_refcache_stop();
 
-        case WORKER_INSERT_RESULT_SUCCESS:
-          log_threaded_dest_driver_message_accept(self, msg);
-          break;
-
-        default:
-          break;
+          log_threaded_dest_driver_flush(self);
+          continue;
         }
 
+      log_threaded_dest_driver_process_insert_result(self, result, msg);
+
       msg_set_context(NULL);
       log_msg_refcache_stop();
+
+      if (log_threaded_dest_driver_is_batch_full(self))
+        log_threaded_dest_driver_flush(self);
     }
+  if (!self->suspended)
+    log_threaded_dest_driver_schedule_flush(self);
+
   if (!self->suspended)
     {
       if (self->worker.worker_message_queue_empty)
@@ -205,6 +349,42 @@ log_threaded_dest_driver_do_insert(LogThrDestDriver *self)
     }
 }
 
+static void
+log_threaded_dest_driver_flush_timeout(gpointer data)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)data;
+
+  log_threaded_dest_driver_flush(self);
+}
+
+static void
+log_threaded_dest_driver_flush_on_shutdown(LogThrDestDriver *self)
+{
+  if (self->batch.size == 0)
+    return;
+
+  if (!self->worker.connected)
+    {
+      log_threaded_dest_driver_batch_rewind(self);
+      return;
+    }
+
+  switch (self->worker.flush(self))
+    {
+    case WORKER_INSERT_RESULT_SUCCESS:
+      log_threaded_dest_driver_batch_accept(self, self->batch.size);
+      break;
+
+    case WORKER_INSERT_RESULT_REJECTED:
+      log_threaded_dest_driver_batch_drop(self, self->batch.size);
+      break;
+
+    default:
+      log_threaded_dest_driver_batch_rewind(self);
+      break;
+    }
+}
+
 static void
 log_threaded_dest_driver_do_work(gpointer data)
 {
@@ -258,6 +438,10 @@ log_threaded_dest_driver_init_watches(LogThrDestDriver* self)
   self->timer_throttle.cookie = self;
   self->timer_throttle.handler = log_threaded_dest_driver_do_work;
 
+  IV_TIMER_INIT(&self->timer_flush);
+  self->timer_flush.cookie = self;
+  self->timer_flush.handler = log_threaded_dest_driver_flush_timeout;
+
   IV_TASK_INIT(&self->do_work);
   self->do_work.cookie = self;
   self->do_work.handler = log_threaded_dest_driver_do_work;
@@ -284,6 +468,7 @@ log_threaded_dest_driver_worker_thread_main(gpointer arg)
 
   iv_main();
 
+  log_threaded_dest_driver_flush_on_shutdown(self);
   __disconnect(self);
   if (self->worker.thread_deinit)
     self->worker.thread_deinit(self);
@@ -304,6 +489,7 @@ log_threaded_dest_driver_stop_thread(gpointer s)
 static void
 log_threaded_dest_driver_start_thread(LogThrDestDriver *self)
 {
+  self->worker_options.name = self->super.super.id;
   main_loop_create_worker_thread(log_threaded_dest_driver_worker_thread_main,
                                  log_threaded_dest_driver_stop_thread,
                                  self, &self->worker_options);
@@ -336,6 +522,14 @@ log_threaded_dest_driver_start(LogPipe *s)
       self->retries.max = MAX_RETRIES_OF_FAILED_INSERT_DEFAULT;
     }
 
+  if (!self->worker.flush && log_threaded_dest_driver_is_batching_configured(self))
+    {
+      msg_warning("WARNING: this destination does not support batch-lines() and batch-timeout(), sending messages one by one",
+                  evt_tag_str("driver", self->super.super.id));
+      self->batch.lines = 0;
+      self->batch.timeout = 0;
+    }
+
   stats_lock();
   stats_register_counter(0, self->stats_source | SCS_DESTINATION, self->super.super.id,
                          self->format.stats_instance(self),
@@ -347,6 +541,8 @@ log_threaded_dest_driver_start(LogPipe *s)
                          self->format.stats_instance(self),
                          SC_TYPE_PROCESSED, &self->processed_messages);
   stats_unlock();
+  self->latency = stats_register_histogram(STATS_LEVEL1, self->stats_source | SCS_DESTINATION, self->super.super.id,
+                                           self->format.stats_instance(self));
 
   log_queue_set_counters(self->queue, self->stored_messages,
                          self->dropped_messages);
@@ -384,6 +580,8 @@ log_threaded_dest_driver_deinit_method(LogPipe *s)
                            self->format.stats_instance(self),
                            SC_TYPE_PROCESSED, &self->processed_messages);
   stats_unlock();
+  stats_unregister_histogram(self->stats_source | SCS_DESTINATION, self->super.super.id,
+                             self->format.stats_instance(self), &self->latency);
 
   if (!log_dest_driver_deinit_method(s))
     return FALSE;
@@ -396,6 +594,8 @@ log_threaded_dest_driver_free(LogPipe *s)
 {
   LogThrDestDriver *self = (LogThrDestDriver *)s;
 
+  cpu_affinity_free(self->worker_options.cpu_affinity);
+  g_array_free(self->batch.recvd_monotonic_usecs, TRUE);
   log_dest_driver_free((LogPipe *)self);
 }
 
@@ -435,6 +635,9 @@ log_threaded_dest_driver_init_instance(LogThrDestDriver *self, GlobalConfig *cfg
   self->time_reopen = -1;
 
   self->retries.max = MAX_RETRIES_OF_FAILED_INSERT_DEFAULT;
+  self->batch.lines = 0;
+  self->batch.timeout = 0;
+  self->batch.recvd_monotonic_usecs = g_array_new(FALSE, FALSE, sizeof(guint64));
 }
 
 void
@@ -463,6 +666,50 @@ log_threaded_dest_driver_message_rewind(LogThrDestDriver *self,
   log_msg_unref(msg);
 }
 
+static void
+log_threaded_dest_driver_batch_ack(LogThrDestDriver *self, gint count)
+{
+  gint i;
+
+  g_assert(count <= self->batch.size);
+
+  self->retries.counter = 0;
+  log_queue_ack_backlog(self->queue, count);
+  g_array_remove_range(self->batch.recvd_monotonic_usecs, 0, count);
+  self->batch.size -= count;
+  for (i = 0; i < count; i++)
+    step_sequence_number(&self->batch.seq_num);
+}
+
+void
+log_threaded_dest_driver_batch_accept(LogThrDestDriver *self, gint count)
+{
+  gint i;
+
+  for (i = 0; i < count && i < self->batch.recvd_monotonic_usecs->len; i++)
+    log_threaded_dest_driver_record_latency(self, g_array_index(self->batch.recvd_monotonic_usecs, guint64, i));
+  log_threaded_dest_driver_batch_ack(self, count);
+}
+
+void
+log_threaded_dest_driver_batch_drop(LogThrDestDriver *self, gint count)
+{
+  stats_counter_add(self->dropped_messages, count);
+  log_threaded_dest_driver_batch_ack(self, count);
+}
+
+void
+log_threaded_dest_driver_batch_rewind(LogThrDestDriver *self)
+{
+  /* the rewound messages get the same $SEQNUM when they are resent */
+  if (self->batch.size > 0)
+    self->seq_num = self->batch.seq_num;
+  log_queue_rewind_backlog(self->queue, self->batch.size);
+  g_array_set_size(self->batch.recvd_monotonic_usecs, 0);
+  self->batch.size = 0;
+  self->batch.flush_requested = FALSE;
+}
+
 void
 log_threaded_dest_driver_set_max_retries(LogDriver *s, gint max_retries)
 {
@@ -470,3 +717,33 @@ log_threaded_dest_driver_set_max_retries(LogDriver *s, gint max_retries)
 
   self->retries.max = max_retries;
 }
+
+void
+log_threaded_dest_driver_set_batch_lines(LogDriver *s, gint batch_lines)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)s;
+
+  self->batch.lines = batch_lines;
+}
+
+void
+log_threaded_dest_driver_set_batch_timeout(LogDriver *s, gint batch_timeout)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)s;
+
+  self->batch.timeout = batch_timeout;
+}
+
+gboolean
+log_threaded_dest_driver_set_cpu_affinity(LogDriver *s, const gchar *cpus)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)s;
+  GArray *cpu_affinity = cpu_affinity_parse(cpus);
+
+  if (!cpu_affinity)
+    return FALSE;
+
+  cpu_affinity_free(self->worker_options.cpu_affinity);
+  self->worker_options.cpu_affinity = cpu_affinity;
+  return TRUE;
+}
@@ -28,6 +28,7 @@
 #include "syslog-ng.h"
 #include "driver.h"
 #include "stats/stats-registry.h"
+#include "stats/stats-histogram.h"
 #include "logqueue.h"
 #include "mainloop-worker.h"
 #include <iv.h>
@@ -39,7 +40,14 @@ typedef enum
   WORKER_INSERT_RESULT_ERROR,
   WORKER_INSERT_RESULT_REWIND,
   WORKER_INSERT_RESULT_SUCCESS,
-  WORKER_INSERT_RESULT_NOT_CONNECTED
+  WORKER_INSERT_RESULT_NOT_CONNECTED,
+  /* the message was added to the current batch, it will be acked or
+   * rewound when the batch is flushed via worker.flush() */
+  WORKER_INSERT_RESULT_QUEUED,
+  /* the destination permanently refused the message (or the batch), it is
+   * dropped but unlike WORKER_INSERT_RESULT_DROP the connection is kept
+   * and the driver is not suspended */
+  WORKER_INSERT_RESULT_REJECTED
 } worker_insert_result_t;
 
 typedef struct _LogThrDestDriver LogThrDestDriver;
@@ -50,6 +58,7 @@ struct _LogThrDestDriver
   StatsCounterItem *dropped_messages;
   StatsCounterItem *stored_messages;
   StatsCounterItem *processed_messages;
+  StatsHistogram *latency;
 
   gboolean suspended;
   time_t time_reopen;
@@ -66,8 +75,27 @@ struct _LogThrDestDriver
     gboolean (*connect) (LogThrDestDriver *s);
     void (*worker_message_queue_empty)(LogThrDestDriver *s);
     void (*disconnect) (LogThrDestDriver *s);
+    worker_insert_result_t (*flush) (LogThrDestDriver *s);
   } worker;
 
+  /* batching, used by drivers that return WORKER_INSERT_RESULT_QUEUED */
+  struct
+  {
+    gint lines;
+    gint timeout;
+    /* number of messages queued since the last flush, all of them are
+     * sitting in the backlog of the queue */
+    gint size;
+    /* set by insert() to flush right after the current message, e.g. when
+     * a driver specific size limit is reached */
+    gboolean flush_requested;
+    /* receive timestamps of the queued messages, for measuring latency */
+    GArray *recvd_monotonic_usecs;
+    /* $SEQNUM of the first queued message: seq_num is stepped as messages
+     * are formatted, but only the accepted ones keep their numbers */
+    gint32 seq_num;
+  } batch;
+
   struct
   {
     void (*retry_over) (LogThrDestDriver *s, LogMessage *msg);
@@ -93,6 +121,7 @@ struct _LogThrDestDriver
   struct iv_event shutdown_event;
   struct iv_timer timer_reopen;
   struct iv_timer timer_throttle;
+  struct iv_timer timer_flush;
   struct iv_task  do_work;
 };
 
@@ -111,6 +140,19 @@ void log_threaded_dest_driver_message_drop(LogThrDestDriver *self,
 void log_threaded_dest_driver_message_rewind(LogThrDestDriver *self,
                                              LogMessage *msg);
 
+void log_threaded_dest_driver_batch_accept(LogThrDestDriver *self, gint count);
+void log_threaded_dest_driver_batch_drop(LogThrDestDriver *self, gint count);
+void log_threaded_dest_driver_batch_rewind(LogThrDestDriver *self);
+
+static inline gboolean
+log_threaded_dest_driver_is_batching_configured(LogThrDestDriver *self)
+{
+  return self->batch.lines > 0 || self->batch.timeout > 0;
+}
+
 void log_threaded_dest_driver_set_max_retries(LogDriver *s, gint max_retries);
+void log_threaded_dest_driver_set_batch_lines(LogDriver *s, gint batch_lines);
+void log_threaded_dest_driver_set_batch_timeout(LogDriver *s, gint batch_timeout);
+gboolean log_threaded_dest_driver_set_cpu_affinity(LogDriver *s, const gchar *cpus);
 
 #endif
@@ -25,6 +25,7 @@
 #include "logwriter.h"
 #include "messages.h"
 #include "stats/stats-registry.h"
+#include "stats/stats-histogram.h"
 #include "hostname.h"
 #include "host-resolve.h"
 #include "seqnum.h"
@@ -35,6 +36,7 @@
 #include "mainloop-call.h"
 #include "ml-batched-timer.h"
 #include "str-format.h"
+#include "timeutils.h"
 
 #include <unistd.h>
 #include <assert.h>
@@ -66,6 +68,7 @@ struct _LogWriter
   StatsCounterItem *suppressed_messages;
   StatsCounterItem *processed_messages;
   StatsCounterItem *stored_messages;
+  StatsHistogram *latency;
   LogPipe *control;
   LogWriterOptions *options;
   LogMessage *last_msg;
@@ -1146,6 +1149,9 @@ log_writer_write_message(LogWriter *self, LogMessage *msg, LogPathOptions *path_
       if (msg->flags & LF_LOCAL)
         step_sequence_number(&self->seq_num);
 
+      if (self->latency && msg->recvd_monotonic_usec)
+        stats_histogram_record(self->latency, get_monotonic_usec() - msg->recvd_monotonic_usec);
+
       log_msg_unref(msg);
       msg_set_context(NULL);
       log_msg_refcache_stop();
@@ -1284,6 +1290,9 @@ log_writer_init(LogPipe *s)
       
       stats_register_counter(self->stats_level, self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_STORED, &self->stored_messages);
       stats_unlock();
+
+      /* latencies are somewhat costly to measure, don't do it at level 0 */
+      self->latency = stats_register_histogram(MAX(self->stats_level, STATS_LEVEL1), self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance);
     }
   log_queue_set_counters(self->queue, self->stored_messages, self->dropped_messages);
   if (self->proto)
@@ -1333,6 +1342,7 @@ log_writer_deinit(LogPipe *s)
   stats_unregister_counter(self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_PROCESSED, &self->processed_messages);
   stats_unregister_counter(self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_STORED, &self->stored_messages);
   stats_unlock();
+  stats_unregister_histogram(self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, &self->latency);
   
   return TRUE;
 }
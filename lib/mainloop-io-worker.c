@@ -25,6 +25,11 @@
 #include "mainloop-worker.h"
 #include "mainloop-call.h"
 #include "logqueue.h"
+#include "tls-support.h"
+#include "cpu-affinity.h"
+#include "messages.h"
+
+#include <iv_event.h>
 
 /************************************************************************************
  * I/O worker threads
@@ -32,11 +37,333 @@
 
 static struct iv_work_pool main_loop_io_workers;
 
+/************************************************************************************
+ * CPU placement
+ *
+ * With --worker-cpus, the I/O worker pool is bound to the given CPUs, and
+ * each reactor thread is pinned to a single CPU of the set.  As a
+ * connection in multi-reactor mode is always read by the same reactor,
+ * the messages it allocates come from that thread's malloc arena, and
+ * are first touched on its CPU, thus they stay local to its NUMA node.
+ ************************************************************************************/
+
+static gchar *main_loop_io_worker_cpus_spec;
+static GArray *main_loop_io_worker_cpus;
+static WorkerOptions main_loop_io_worker_options;
+
+/************************************************************************************
+ * I/O reactor threads
+ *
+ * In multi-reactor mode (--reactor-threads), jobs bound to a reactor are
+ * not dispatched to the worker pool.  Each reactor thread runs its own
+ * ivykis loop, the owner of the job registers its watches there, and the
+ * work and the completion of the job run inline in the reactor thread
+ * once the watch fires.  The main thread only communicates with the
+ * reactors asynchronously, using main_loop_io_worker_reactor_call().
+ *
+ * Reactors take part in intrusive operations (reload, termination) the
+ * same way as other worker threads: an active reactor counts as a running
+ * job, and once it gets the exit notification, it pauses (jobs triggered
+ * while paused are parked) and completes its job.  When jobs are
+ * reenabled, the reactors are resumed and the completion of the parked
+ * jobs is invoked, so that their owners can rearm their watches.
+ ************************************************************************************/
+
+typedef struct _MainLoopIOReactorCall
+{
+  struct iv_list_head list;
+  MainLoopTaskFunc func;
+  gpointer user_data;
+} MainLoopIOReactorCall;
+
+typedef struct _MainLoopIOReactor
+{
+  GThread *thread;
+  WorkerOptions worker_options;
+  struct iv_event call_posted;
+  GStaticMutex call_lock;
+  struct iv_list_head calls;
+
+  /* main thread only */
+  gboolean active;
+
+  /* reactor thread only */
+  gboolean paused;
+  struct iv_list_head parked_jobs;
+} MainLoopIOReactor;
+
+TLS_BLOCK_START
+{
+  MainLoopIOReactor *current_reactor;
+}
+TLS_BLOCK_END;
+
+#define current_reactor __tls_deref(current_reactor)
+
+static gint main_loop_io_reactors_num;
+static gint main_loop_io_reactors_next;
+static MainLoopIOReactor *main_loop_io_reactors;
+
+static GStaticMutex main_loop_io_reactors_startup_lock = G_STATIC_MUTEX_INIT;
+static GCond *main_loop_io_reactors_startup_cond;
+static gint main_loop_io_reactors_started;
+
+static void
+_reactor_run_calls(gpointer s)
+{
+  MainLoopIOReactor *self = (MainLoopIOReactor *) s;
+
+  g_static_mutex_lock(&self->call_lock);
+  while (!iv_list_empty(&self->calls))
+    {
+      MainLoopIOReactorCall *call = iv_list_entry(self->calls.next, MainLoopIOReactorCall, list);
+
+      iv_list_del(&call->list);
+      g_static_mutex_unlock(&self->call_lock);
+
+      call->func(call->user_data);
+      g_free(call);
+
+      g_static_mutex_lock(&self->call_lock);
+    }
+  g_static_mutex_unlock(&self->call_lock);
+}
+
+/* NOTE: can be called from any thread, @func is run asynchronously in the reactor thread */
+void
+main_loop_io_worker_reactor_call(gint reactor, MainLoopTaskFunc func, gpointer user_data)
+{
+  MainLoopIOReactor *self = &main_loop_io_reactors[reactor];
+  MainLoopIOReactorCall *call = g_new0(MainLoopIOReactorCall, 1);
+
+  call->func = func;
+  call->user_data = user_data;
+
+  g_static_mutex_lock(&self->call_lock);
+  iv_list_add_tail(&call->list, &self->calls);
+  g_static_mutex_unlock(&self->call_lock);
+  iv_event_post(&self->call_posted);
+}
+
+gboolean
+main_loop_io_worker_is_reactor_thread(gint reactor)
+{
+  return current_reactor == &main_loop_io_reactors[reactor];
+}
+
+/* NOTE: runs in the main thread, returns -1 if multi-reactor mode is disabled */
+gint
+main_loop_io_worker_assign_reactor(void)
+{
+  gint reactor;
+
+  if (main_loop_io_reactors_num == 0)
+    return -1;
+
+  reactor = main_loop_io_reactors_next;
+  main_loop_io_reactors_next = (main_loop_io_reactors_next + 1) % main_loop_io_reactors_num;
+  return reactor;
+}
+
+static gpointer
+_reactor_job_complete(gpointer user_data)
+{
+  main_loop_worker_job_complete();
+  return NULL;
+}
+
+/* NOTE: runs in the reactor thread */
+static gpointer
+_reactor_pause(gpointer s)
+{
+  MainLoopIOReactor *self = (MainLoopIOReactor *) s;
+
+  self->paused = TRUE;
+  main_loop_call(_reactor_job_complete, NULL, TRUE);
+  return NULL;
+}
+
+/* NOTE: runs in the reactor thread */
+static gpointer
+_reactor_resume(gpointer s)
+{
+  MainLoopIOReactor *self = (MainLoopIOReactor *) s;
+
+  self->paused = FALSE;
+  while (!iv_list_empty(&self->parked_jobs))
+    {
+      MainLoopIOWorkerJob *job = iv_list_entry(self->parked_jobs.next, MainLoopIOWorkerJob, parked);
+
+      iv_list_del_init(&job->parked);
+      job->working = FALSE;
+      job->completion(job->user_data);
+    }
+  return NULL;
+}
+
+/* NOTE: runs in the main thread, as an exit notification callback */
+static void
+_reactor_request_pause(gpointer s)
+{
+  MainLoopIOReactor *self = (MainLoopIOReactor *) s;
+
+  self->active = FALSE;
+  main_loop_io_worker_reactor_call(self - main_loop_io_reactors, _reactor_pause, self);
+}
+
 /* NOTE: runs in the main thread */
+static void
+_reactor_activate(MainLoopIOReactor *self)
+{
+  self->active = TRUE;
+  main_loop_worker_job_start();
+  main_loop_worker_register_exit_notification_callback(_reactor_request_pause, self);
+}
+
+/* NOTE: runs in the main thread, once worker jobs are reenabled */
+void
+main_loop_io_worker_resume_reactors(void)
+{
+  gint i;
+
+  for (i = 0; i < main_loop_io_reactors_num; i++)
+    {
+      MainLoopIOReactor *self = &main_loop_io_reactors[i];
+
+      if (self->active)
+        continue;
+      _reactor_activate(self);
+      main_loop_io_worker_reactor_call(i, _reactor_resume, self);
+    }
+}
+
+/* NOTE: runs in the reactor thread */
+static gpointer
+_reactor_quit(gpointer s)
+{
+  iv_quit();
+  return NULL;
+}
+
+static gpointer
+_reactor_thread(gpointer s)
+{
+  MainLoopIOReactor *self = (MainLoopIOReactor *) s;
+
+  iv_init();
+  main_loop_worker_thread_start(&self->worker_options);
+  current_reactor = self;
+
+  IV_EVENT_INIT(&self->call_posted);
+  self->call_posted.cookie = self;
+  self->call_posted.handler = _reactor_run_calls;
+  iv_event_register(&self->call_posted);
+
+  g_static_mutex_lock(&main_loop_io_reactors_startup_lock);
+  main_loop_io_reactors_started++;
+  g_cond_signal(main_loop_io_reactors_startup_cond);
+  g_static_mutex_unlock(&main_loop_io_reactors_startup_lock);
+
+  iv_main();
+
+  iv_event_unregister(&self->call_posted);
+  current_reactor = NULL;
+  main_loop_worker_thread_stop();
+  iv_deinit();
+  return NULL;
+}
+
+static void
+_reactors_start(void)
+{
+  gint i;
+
+  if (main_loop_io_reactors_num <= 0)
+    {
+      main_loop_io_reactors_num = 0;
+      return;
+    }
+
+  main_loop_io_reactors = g_new0(MainLoopIOReactor, main_loop_io_reactors_num);
+  main_loop_io_reactors_startup_cond = g_cond_new();
+  for (i = 0; i < main_loop_io_reactors_num; i++)
+    {
+      MainLoopIOReactor *self = &main_loop_io_reactors[i];
+
+      g_static_mutex_init(&self->call_lock);
+      INIT_IV_LIST_HEAD(&self->calls);
+      INIT_IV_LIST_HEAD(&self->parked_jobs);
+      self->worker_options.name = "reactor";
+      if (main_loop_io_worker_cpus)
+        self->worker_options.cpu_affinity = cpu_affinity_select(main_loop_io_worker_cpus, i);
+      self->thread = g_thread_create(_reactor_thread, self, TRUE, NULL);
+      g_assert(self->thread != NULL);
+    }
+
+  /* the reactors' iv_events have to be registered before anything is posted to them */
+  g_static_mutex_lock(&main_loop_io_reactors_startup_lock);
+  while (main_loop_io_reactors_started < main_loop_io_reactors_num)
+    g_cond_wait(main_loop_io_reactors_startup_cond, g_static_mutex_get_mutex(&main_loop_io_reactors_startup_lock));
+  g_static_mutex_unlock(&main_loop_io_reactors_startup_lock);
+
+  for (i = 0; i < main_loop_io_reactors_num; i++)
+    _reactor_activate(&main_loop_io_reactors[i]);
+}
+
+static void
+_reactors_stop(void)
+{
+  gint i;
+
+  for (i = 0; i < main_loop_io_reactors_num; i++)
+    main_loop_io_worker_reactor_call(i, _reactor_quit, NULL);
+
+  for (i = 0; i < main_loop_io_reactors_num; i++)
+    {
+      g_thread_join(main_loop_io_reactors[i].thread);
+      g_static_mutex_free(&main_loop_io_reactors[i].call_lock);
+      cpu_affinity_free(main_loop_io_reactors[i].worker_options.cpu_affinity);
+    }
+
+  g_free(main_loop_io_reactors);
+  main_loop_io_reactors = NULL;
+  if (main_loop_io_reactors_startup_cond)
+    g_cond_free(main_loop_io_reactors_startup_cond);
+  main_loop_io_reactors_startup_cond = NULL;
+  main_loop_io_reactors_started = 0;
+}
+
+/* NOTE: runs in the reactor thread */
+static void
+_reactor_job_submit(MainLoopIOWorkerJob *self)
+{
+  MainLoopIOReactor *reactor = &main_loop_io_reactors[self->reactor];
+
+  g_assert(current_reactor == reactor);
+
+  self->working = TRUE;
+  if (reactor->paused)
+    {
+      iv_list_add_tail(&self->parked, &reactor->parked_jobs);
+      return;
+    }
+
+  self->work(self->user_data);
+  main_loop_worker_invoke_batch_callbacks();
+  self->working = FALSE;
+  self->completion(self->user_data);
+}
+
+/* NOTE: runs in the main thread, or in the job's reactor thread in multi-reactor mode */
 void
 main_loop_io_worker_job_submit(MainLoopIOWorkerJob *self)
 {
   g_assert(self->working == FALSE);
+  if (self->reactor >= 0)
+    {
+      _reactor_job_submit(self);
+      return;
+    }
   if (main_loop_workers_quit)
     return;
   main_loop_worker_job_start();
@@ -69,6 +396,8 @@ main_loop_io_worker_job_init(MainLoopIOWorkerJob *self)
   self->work_item.cookie = self;
   self->work_item.work = (void (*)(void *)) _work;
   self->work_item.completion = (void (*)(void *)) _complete;
+  self->reactor = -1;
+  INIT_IV_LIST_HEAD(&self->parked);
 }
 
 static gint
@@ -89,27 +418,43 @@ main_loop_io_worker_init(void)
       main_loop_io_workers.max_threads = MIN(MAX(MAIN_LOOP_MIN_WORKER_THREADS, get_processor_count()), MAIN_LOOP_MAX_WORKER_THREADS);
     }
 
+  if (main_loop_io_worker_cpus_spec && !main_loop_io_worker_cpus)
+    {
+      main_loop_io_worker_cpus = cpu_affinity_parse(main_loop_io_worker_cpus_spec);
+      if (!main_loop_io_worker_cpus)
+        msg_error("Invalid CPU list in --worker-cpus, worker threads are not bound to CPUs",
+                  evt_tag_str("cpus", main_loop_io_worker_cpus_spec));
+    }
+  main_loop_io_worker_options.name = "io-worker";
+  main_loop_io_worker_options.cpu_affinity = main_loop_io_worker_cpus;
+
+  main_loop_io_workers.cookie = &main_loop_io_worker_options;
   main_loop_io_workers.thread_start = (void (*)(void *)) main_loop_worker_thread_start;
   main_loop_io_workers.thread_stop = (void (*)(void *)) main_loop_worker_thread_stop;
   iv_work_pool_create(&main_loop_io_workers);
   
-  log_queue_set_max_threads(MIN(main_loop_io_workers.max_threads, MAIN_LOOP_MAX_WORKER_THREADS));
+  main_loop_io_reactors_num = MIN(main_loop_io_reactors_num, MAIN_LOOP_MAX_WORKER_THREADS - main_loop_io_workers.max_threads);
+  log_queue_set_max_threads(MIN(main_loop_io_workers.max_threads + MAX(main_loop_io_reactors_num, 0), MAIN_LOOP_MAX_WORKER_THREADS));
+  _reactors_start();
 }
 
 void
 main_loop_io_worker_deinit(void)
 {
+  _reactors_stop();
   iv_work_pool_put(&main_loop_io_workers);
 }
 
-static GOptionEntry main_loop_io_worker_options[] =
+static GOptionEntry main_loop_io_worker_option_entries[] =
 {
   { "worker-threads",      0,         0, G_OPTION_ARG_INT, &main_loop_io_workers.max_threads, "Set the number of I/O worker threads", "<max>" },
+  { "reactor-threads",     0,         0, G_OPTION_ARG_INT, &main_loop_io_reactors_num, "Set the number of I/O reactor threads owning threaded source connections, 0 disables multi-reactor mode", "<num>" },
+  { "worker-cpus",         0,         0, G_OPTION_ARG_STRING, &main_loop_io_worker_cpus_spec, "Bind I/O worker and reactor threads to the given CPUs, e.g. 0-3,8", "<cpulist>" },
   { NULL },
 };
 
 void
 main_loop_io_worker_add_options(GOptionContext *ctx)
 {
-  g_option_context_add_main_entries(ctx, main_loop_io_worker_options, NULL);
+  g_option_context_add_main_entries(ctx, main_loop_io_worker_option_entries, NULL);
 }
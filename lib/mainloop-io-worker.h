@@ -35,11 +35,21 @@ typedef struct _MainLoopIOWorkerJob
   gpointer user_data;
   gboolean working:1;
   struct iv_work_item work_item;
+
+  /* in multi-reactor mode, the index of the reactor thread running this
+   * job, -1 if the job is submitted to the worker pool */
+  gint reactor;
+  struct iv_list_head parked;
 } MainLoopIOWorkerJob;
 
 void main_loop_io_worker_job_init(MainLoopIOWorkerJob *self);
 void main_loop_io_worker_job_submit(MainLoopIOWorkerJob *self);
 
+gint main_loop_io_worker_assign_reactor(void);
+gboolean main_loop_io_worker_is_reactor_thread(gint reactor);
+void main_loop_io_worker_reactor_call(gint reactor, MainLoopTaskFunc func, gpointer user_data);
+void main_loop_io_worker_resume_reactors(void);
+
 void main_loop_io_worker_add_options(GOptionContext *ctx);
 
 void main_loop_io_worker_init(void);
@@ -22,9 +22,11 @@
  *
  */
 #include "mainloop-worker.h"
+#include "mainloop-io-worker.h"
 #include "mainloop-call.h"
 #include "tls-support.h"
 #include "apphook.h"
+#include "cpu-affinity.h"
 
 #include <iv.h>
 
@@ -140,6 +142,16 @@ _register_exit_notification_callback(WorkerExitNotificationFunc func, gpointer u
   exit_notification_list = g_list_append(exit_notification_list, cfunc);
 }
 
+/* the callback is invoked once, when an intrusive operation (reload,
+ * termination) requests worker threads to finish their jobs */
+void
+main_loop_worker_register_exit_notification_callback(WorkerExitNotificationFunc func, gpointer user_data)
+{
+  main_loop_assert_main_thread();
+
+  _register_exit_notification_callback(func, user_data);
+}
+
 static void
 _invoke_worker_exit_callback(WorkerExitNotification *func)
 {
@@ -156,6 +168,22 @@ _request_all_threads_to_exit(void)
   main_loop_workers_quit = TRUE;
 }
 
+static void
+_register_thread_placement(WorkerOptions *worker_options)
+{
+  static const gchar *default_names[MAIN_LOOP_WORKER_TYPE_MAX] = { "worker", "output", "input" };
+  gchar *name;
+
+  name = g_strdup_printf("%s#%d",
+                         worker_options && worker_options->name ? worker_options->name : default_names[main_loop_worker_type],
+                         main_loop_worker_get_thread_id());
+  cpu_affinity_register_thread(name);
+  g_free(name);
+
+  if (worker_options && worker_options->cpu_affinity)
+    cpu_affinity_apply(worker_options->cpu_affinity);
+}
+
 /* Call this function from worker threads, when you start up */
 void
 main_loop_worker_thread_start(void *cookie)
@@ -174,6 +202,7 @@ main_loop_worker_thread_start(void *cookie)
 
   _allocate_thread_id();
   INIT_IV_LIST_HEAD(&batch_callbacks);
+  _register_thread_placement(worker_options);
   app_thread_start();
 }
 
@@ -182,6 +211,7 @@ void
 main_loop_worker_thread_stop(void)
 {
   app_thread_stop();
+  cpu_affinity_unregister_thread();
   _release_thread_id();
 }
 
@@ -327,6 +357,7 @@ _reenable_worker_jobs(void *s)
 {
   main_loop_workers_quit = FALSE;
   main_loop_workers_sync_func = NULL;
+  main_loop_io_worker_resume_reactors();
 }
 
 void
@@ -52,6 +52,10 @@ typedef struct _WorkerOptions
 {
   gboolean is_output_thread;
   gboolean is_external_input;
+  /* name reported in the thread placement list, defaults to the thread type */
+  const gchar *name;
+  /* CPUs the thread is bound to, NULL means no binding */
+  GArray *cpu_affinity;
 } WorkerOptions;
 
 static inline void
@@ -76,6 +80,7 @@ void main_loop_worker_thread_start(void *cookie);
 void main_loop_worker_thread_stop(void);
 
 void main_loop_create_worker_thread(WorkerThreadFunc func, WorkerExitNotificationFunc terminate_func, gpointer data, WorkerOptions *worker_options);
+void main_loop_worker_register_exit_notification_callback(WorkerExitNotificationFunc func, gpointer user_data);
 
 void main_loop_worker_sync_call(void (*func)(void));
 
@@ -39,6 +39,8 @@
 #include "debugger/debugger-main.h"
 #include "plugin.h"
 #include "resolved-configurable-paths.h"
+#include "cpu-affinity.h"
+#include "timeutils.h"
 
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -160,6 +162,25 @@ static GlobalConfig *main_loop_old_config;
 /* the pending configuration we wish to switch to */
 static GlobalConfig *main_loop_new_config;
 
+/* when the current reload was requested and when processing was stopped to apply it */
+static struct timespec main_loop_reload_started;
+static struct timespec main_loop_reload_paused;
+
+static StatsCounterItem *count_config_reloads;
+static StatsCounterItem *config_reload_duration;
+static StatsCounterItem *config_reload_pause;
+
+static void
+main_loop_reload_config_update_stats(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  stats_counter_inc(count_config_reloads);
+  stats_counter_set(config_reload_duration, timespec_diff_msec(&now, &main_loop_reload_started));
+  stats_counter_set(config_reload_pause, timespec_diff_msec(&now, &main_loop_reload_paused));
+}
+
 
 /* called when syslog-ng first starts up */
 gboolean
@@ -182,7 +203,14 @@ main_loop_initialize_state(GlobalConfig *cfg, const gchar *persist_filename)
   return success;
 }
 
-/* called to apply the new configuration once all I/O worker threads have finished */
+/*
+ * Called to apply the new configuration once all I/O worker threads have
+ * finished.  Every pipe of the old configuration is deinitialized and every
+ * pipe of the new one is initialized, even the ones whose definition did
+ * not change, so the pause grows with the number of log paths.  Only the
+ * state kept in persist-config (queues, connections, pattern databases)
+ * survives; LogPipe instances are not reused across configurations.
+ */
 static void
 main_loop_reload_config_apply(void)
 {
@@ -232,7 +260,10 @@ main_loop_reload_config_apply(void)
 
   /* this is already running with the new config in place */
   app_post_config_loaded();
-  msg_notice("Configuration reload request received, reloading configuration");
+  main_loop_reload_config_update_stats();
+  msg_notice("Configuration reload request received, reloading configuration",
+             evt_tag_long("duration_msec", stats_counter_get(config_reload_duration)),
+             evt_tag_long("pause_msec", stats_counter_get(config_reload_pause)));
 
  finish:
   main_loop_new_config = NULL;
@@ -262,6 +293,7 @@ main_loop_reload_config_initiate(void)
       main_loop_new_config = NULL;
     }
 
+  clock_gettime(CLOCK_MONOTONIC, &main_loop_reload_started);
   main_loop_old_config = current_configuration;
   app_pre_config_loaded();
   main_loop_new_config = cfg_new(0);
@@ -275,6 +307,22 @@ main_loop_reload_config_initiate(void)
       service_management_publish_status("Error parsing new configuration, using the old config");
       return;
     }
+
+  /* resolve references and build the pipe graph of the new configuration
+   * while the old one is still processing messages, so that only the
+   * deinit/init of the pipes happens while the workers are stopped */
+  if (!cfg_tree_compile(&main_loop_new_config->tree))
+    {
+      cfg_free(main_loop_new_config);
+      main_loop_new_config = NULL;
+      main_loop_old_config = NULL;
+      msg_error("Error compiling configuration",
+                evt_tag_str(EVT_TAG_FILENAME, resolvedConfigurablePaths.cfgfilename));
+      service_management_publish_status("Error compiling new configuration, using the old config");
+      return;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &main_loop_reload_paused);
   main_loop_worker_sync_call(main_loop_reload_config_apply);
 }
 
@@ -424,6 +472,7 @@ main_loop_init(void)
   service_management_publish_status("Starting up...");
 
   main_thread_handle = get_thread_id();
+  cpu_affinity_register_thread("main");
   main_loop_worker_init();
   main_loop_io_worker_init();
   main_loop_call_init();
@@ -431,6 +480,12 @@ main_loop_init(void)
   main_loop_init_events();
   if (!syntax_only)
     control_init(resolvedConfigurablePaths.ctlfilename);
+
+  stats_lock();
+  stats_register_counter(0, SCS_GLOBAL, "config_reloads", NULL, SC_TYPE_PROCESSED, &count_config_reloads);
+  stats_register_counter(0, SCS_GLOBAL, "config_reload_duration_msec", NULL, SC_TYPE_STORED, &config_reload_duration);
+  stats_register_counter(0, SCS_GLOBAL, "config_reload_pause_msec", NULL, SC_TYPE_STORED, &config_reload_pause);
+  stats_unlock();
   setup_signals();
 }
 
@@ -478,6 +533,7 @@ main_loop_deinit(void)
   main_loop_call_deinit();
   main_loop_io_worker_deinit();
   main_loop_worker_deinit();
+  cpu_affinity_unregister_thread();
 }
 
 void
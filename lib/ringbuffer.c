@@ -24,6 +24,8 @@
 
 #include "ringbuffer.h"
 
+#include <string.h>
+
 void
 ring_buffer_init(RingBuffer *self)
 {
@@ -93,6 +95,22 @@ ring_buffer_push(RingBuffer *self)
   return r;
 }
 
+/* put an element in front of the head, used to put back items that were
+ * already popped */
+gpointer
+ring_buffer_push_head(RingBuffer *self)
+{
+  g_assert(self->buffer != NULL);
+
+  if (ring_buffer_is_full(self))
+    return NULL;
+
+  self->head = (self->head + self->capacity - 1) % self->capacity;
+  ++self->count;
+
+  return self->buffer + self->head * self->element_size;
+}
+
 gpointer
 ring_buffer_tail (RingBuffer *self)
 {
@@ -140,6 +158,29 @@ ring_buffer_drop(RingBuffer *self, guint32 n)
   return TRUE;
 }
 
+/* reallocate the buffer with a larger capacity, elements are kept in order
+ * and moved to the beginning of the new buffer */
+void
+ring_buffer_grow(RingBuffer *self, guint32 capacity)
+{
+  gpointer new_buffer;
+  guint32 first_chunk;
+
+  g_assert(self->buffer != NULL);
+  g_assert(capacity >= self->count);
+
+  new_buffer = g_malloc0(self->element_size * capacity);
+  first_chunk = MIN(self->count, self->capacity - self->head);
+  memcpy(new_buffer, self->buffer + self->head * self->element_size, first_chunk * self->element_size);
+  memcpy(new_buffer + first_chunk * self->element_size, self->buffer, (self->count - first_chunk) * self->element_size);
+  g_free(self->buffer);
+
+  self->buffer = new_buffer;
+  self->capacity = capacity;
+  self->head = 0;
+  self->tail = self->count % capacity;
+}
+
 guint32
 ring_buffer_capacity(RingBuffer *self)
 {
@@ -50,8 +50,10 @@ gboolean ring_buffer_is_empty(RingBuffer *self);
 gpointer ring_buffer_push(RingBuffer *self);
 gpointer ring_buffer_pop(RingBuffer *self);
 gpointer ring_buffer_tail(RingBuffer *self);
+gpointer ring_buffer_push_head(RingBuffer *self);
 
 gboolean ring_buffer_drop(RingBuffer *self, guint32 n);
+void ring_buffer_grow(RingBuffer *self, guint32 capacity);
 guint32 ring_buffer_capacity(RingBuffer *self);
 guint32 ring_buffer_count(RingBuffer *self);
 
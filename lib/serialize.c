@@ -400,4 +400,71 @@ serialize_read_uint8(SerializeArchive *archive, guint8 *value)
   return FALSE;
 }
 
+/*
+ * Variable length integers: 7 bits per byte, least significant group
+ * first, the highest bit is set on every byte but the last one.  Values
+ * below 128 take a single byte.
+ */
+gboolean
+serialize_write_varint(SerializeArchive *archive, guint64 value)
+{
+  guint8 buf[10];
+  gsize len = 0;
+
+  while (value >= 0x80)
+    {
+      buf[len++] = (value & 0x7f) | 0x80;
+      value >>= 7;
+    }
+  buf[len++] = value;
+  return serialize_archive_write_bytes(archive, (gchar *) buf, len);
+}
+
+static gboolean
+serialize_archive_set_invalid_varint(SerializeArchive *self)
+{
+  g_set_error(&self->error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "Invalid variable length integer");
+  if (!self->silent)
+    {
+      msg_error("Error reading serialized data",
+                evt_tag_str("error", self->error->message));
+    }
+  return FALSE;
+}
 
+gboolean
+serialize_read_varint(SerializeArchive *archive, guint64 *value)
+{
+  guint64 result = 0;
+  guint8 n;
+  gint shift;
+
+  for (shift = 0; shift < 64; shift += 7)
+    {
+      if (!serialize_archive_read_bytes(archive, (gchar *) &n, sizeof(n)))
+        return FALSE;
+
+      result |= ((guint64) (n & 0x7f)) << shift;
+      if ((n & 0x80) == 0)
+        {
+          *value = result;
+          return TRUE;
+        }
+    }
+  return serialize_archive_set_invalid_varint(archive);
+}
+
+gboolean
+serialize_read_varint32(SerializeArchive *archive, guint32 *value)
+{
+  guint64 n;
+
+  if (!serialize_read_varint(archive, &n))
+    return FALSE;
+
+  if (n > G_MAXUINT32)
+    return serialize_archive_set_invalid_varint(archive);
+
+  *value = n;
+  return TRUE;
+}
@@ -24,6 +24,7 @@
 #include "stats/stats-counter.h"
 #include "stats/stats-cluster.h"
 #include "stats/stats-registry.h"
+#include "stats/stats-histogram.h"
 
 static void
 _reset_counter(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointer user_data)
@@ -46,5 +47,6 @@ stats_reset_non_stored_counters(void)
   stats_lock();
   stats_foreach_counter(_reset_non_stored_counter, NULL);
   stats_unlock();
+  stats_histograms_reset();
 }
 
@@ -23,6 +23,7 @@
  */
 #include "stats/stats-csv.h"
 #include "stats/stats-registry.h"
+#include "stats/stats-histogram.h"
 #include "utf8utils.h"
 
 #include <string.h>
@@ -57,7 +58,7 @@ stats_format_csv_escapevar(const gchar *var)
   return escaped_result;
 }
 
-static void
+void
 stats_format_csv(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointer user_data)
 {
   GString *csv = (GString *) user_data;
@@ -85,14 +86,22 @@ stats_format_csv(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointe
 }
 
 
+void
+stats_format_csv_header(GString *csv)
+{
+  g_string_append_printf(csv, "%s;%s;%s;%s;%s;%s\n", "SourceName", "SourceId", "SourceInstance", "State", "Type", "Number");
+}
+
 gchar *
 stats_generate_csv(void)
 {
   GString *csv = g_string_sized_new(1024);
+  StatsSnapshot *snapshot;
 
-  g_string_append_printf(csv, "%s;%s;%s;%s;%s;%s\n", "SourceName", "SourceId", "SourceInstance", "State", "Type", "Number");
-  stats_lock();
-  stats_foreach_counter(stats_format_csv, csv);
-  stats_unlock();
+  stats_format_csv_header(csv);
+  stats_histograms_publish();
+  snapshot = stats_snapshot_acquire();
+  stats_snapshot_foreach_counter(snapshot, stats_format_csv, csv);
+  stats_snapshot_release(snapshot);
   return g_string_free(csv, FALSE);
 }
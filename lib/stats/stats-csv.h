@@ -25,7 +25,10 @@
 #define STATS_CSV_H_INCLUDED 1
 
 #include "syslog-ng.h"
+#include "stats/stats-cluster.h"
 
+void stats_format_csv_header(GString *csv);
+void stats_format_csv(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointer user_data);
 gchar *stats_generate_csv(void);
 
 #endif
@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2002-2016 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "stats/stats-histogram.h"
+#include "stats/stats-registry.h"
+#include "mainloop-worker.h"
+
+#include <string.h>
+
+#define STATS_HISTOGRAM_SUB_BUCKETS 8
+#define STATS_HISTOGRAM_SUB_BUCKET_BITS 3
+#define STATS_HISTOGRAM_MAX_VALUE G_MAXUINT32
+
+struct _StatsHistogram
+{
+  gint buckets[STATS_HISTOGRAM_SHARDS][STATS_HISTOGRAM_BUCKETS];
+
+  /* the rest is only used by registered histograms, protected by stats_lock() */
+  gint ref_cnt;
+  gint component;
+  gchar *id;
+  gchar *instance;
+  StatsCounterItem *p50;
+  StatsCounterItem *p99;
+  StatsCounterItem *p999;
+};
+
+static GList *registered_histograms;
+
+/*
+ * Values below 8 get a bucket of their own, above that each power of two
+ * range [2^msb, 2^(msb+1)) is divided into 8 equally sized buckets, indexed
+ * by the 3 bits below the most significant one.
+ */
+gint
+stats_histogram_bucket_for_value(guint64 value)
+{
+  gint msb;
+
+  if (value > STATS_HISTOGRAM_MAX_VALUE)
+    value = STATS_HISTOGRAM_MAX_VALUE;
+
+  if (value < STATS_HISTOGRAM_SUB_BUCKETS)
+    return value;
+
+  msb = g_bit_storage(value) - 1;
+  return (msb - STATS_HISTOGRAM_SUB_BUCKET_BITS + 1) * STATS_HISTOGRAM_SUB_BUCKETS +
+         ((value >> (msb - STATS_HISTOGRAM_SUB_BUCKET_BITS)) & (STATS_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/* the largest value that falls into @bucket */
+guint64
+stats_histogram_bucket_upper_bound(gint bucket)
+{
+  gint shift, sub_bucket;
+
+  if (bucket < STATS_HISTOGRAM_SUB_BUCKETS)
+    return bucket;
+
+  shift = bucket / STATS_HISTOGRAM_SUB_BUCKETS - 1;
+  sub_bucket = bucket % STATS_HISTOGRAM_SUB_BUCKETS;
+  return ((guint64) (STATS_HISTOGRAM_SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+}
+
+static inline gint
+_get_shard(void)
+{
+  /* main and non-worker threads return -1 */
+  return (main_loop_worker_get_thread_id() + 1) & (STATS_HISTOGRAM_SHARDS - 1);
+}
+
+void
+stats_histogram_record(StatsHistogram *self, guint64 value)
+{
+  if (!self)
+    return;
+
+  g_atomic_int_inc(&self->buckets[_get_shard()][stats_histogram_bucket_for_value(value)]);
+}
+
+/* NOTE: this is _not_ atomic, values recorded concurrently may be lost */
+void
+stats_histogram_reset(StatsHistogram *self)
+{
+  memset(self->buckets, 0, sizeof(self->buckets));
+}
+
+static void
+_sum_buckets(StatsHistogram *self, guint64 *sums)
+{
+  gint shard, bucket;
+
+  memset(sums, 0, sizeof(sums[0]) * STATS_HISTOGRAM_BUCKETS);
+  for (shard = 0; shard < STATS_HISTOGRAM_SHARDS; shard++)
+    for (bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++)
+      sums[bucket] += (guint32) g_atomic_int_get(&self->buckets[shard][bucket]);
+}
+
+guint64
+stats_histogram_get_count(StatsHistogram *self)
+{
+  guint64 sums[STATS_HISTOGRAM_BUCKETS];
+  guint64 count = 0;
+  gint bucket;
+
+  _sum_buckets(self, sums);
+  for (bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++)
+    count += sums[bucket];
+  return count;
+}
+
+static guint64
+_get_percentile_of_sums(const guint64 *sums, gint permille)
+{
+  guint64 count = 0, rank, seen = 0;
+  gint bucket;
+
+  for (bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++)
+    count += sums[bucket];
+
+  if (count == 0)
+    return 0;
+
+  rank = (count * permille + 999) / 1000;
+  if (rank == 0)
+    rank = 1;
+
+  for (bucket = 0; bucket < STATS_HISTOGRAM_BUCKETS; bucket++)
+    {
+      seen += sums[bucket];
+      if (seen >= rank)
+        break;
+    }
+  return stats_histogram_bucket_upper_bound(MIN(bucket, STATS_HISTOGRAM_BUCKETS - 1));
+}
+
+/*
+ * Returns the upper bound of the bucket containing the @permille-th
+ * per-mille value (e.g. 990 for p99), or 0 if nothing was recorded.
+ */
+guint64
+stats_histogram_get_percentile(StatsHistogram *self, gint permille)
+{
+  guint64 sums[STATS_HISTOGRAM_BUCKETS];
+
+  _sum_buckets(self, sums);
+  return _get_percentile_of_sums(sums, permille);
+}
+
+StatsHistogram *
+stats_histogram_new(void)
+{
+  return g_new0(StatsHistogram, 1);
+}
+
+void
+stats_histogram_free(StatsHistogram *self)
+{
+  g_free(self->id);
+  g_free(self->instance);
+  g_free(self);
+}
+
+/************************************************************************************
+ * Registry
+ ************************************************************************************/
+
+static StatsHistogram *
+_lookup_histogram(gint component, const gchar *id, const gchar *instance)
+{
+  GList *l;
+
+  for (l = registered_histograms; l; l = l->next)
+    {
+      StatsHistogram *histogram = (StatsHistogram *) l->data;
+
+      if (histogram->component == component &&
+          strcmp(histogram->id, id ? : "") == 0 &&
+          strcmp(histogram->instance, instance ? : "") == 0)
+        return histogram;
+    }
+  return NULL;
+}
+
+static void
+_register_percentile_counter(StatsHistogram *self, gint level, const gchar *name, StatsCounterItem **counter)
+{
+  gchar *instance = g_strdup_printf("%s,%s", self->instance, name);
+
+  stats_register_counter(level, self->component, self->id, instance, SC_TYPE_STORED, counter);
+  g_free(instance);
+}
+
+static void
+_unregister_percentile_counter(StatsHistogram *self, const gchar *name, StatsCounterItem **counter)
+{
+  gchar *instance = g_strdup_printf("%s,%s", self->instance, name);
+
+  stats_unregister_counter(self->component, self->id, instance, SC_TYPE_STORED, counter);
+  g_free(instance);
+}
+
+StatsHistogram *
+stats_register_histogram(gint level, gint component, const gchar *id, const gchar *instance)
+{
+  StatsHistogram *histogram;
+
+  if (!stats_check_level(level))
+    return NULL;
+
+  stats_lock();
+  histogram = _lookup_histogram(component, id, instance);
+  if (!histogram)
+    {
+      histogram = stats_histogram_new();
+      histogram->component = component;
+      histogram->id = g_strdup(id ? : "");
+      histogram->instance = g_strdup(instance ? : "");
+      _register_percentile_counter(histogram, level, "latency_p50_usec", &histogram->p50);
+      _register_percentile_counter(histogram, level, "latency_p99_usec", &histogram->p99);
+      _register_percentile_counter(histogram, level, "latency_p999_usec", &histogram->p999);
+      registered_histograms = g_list_prepend(registered_histograms, histogram);
+    }
+  histogram->ref_cnt++;
+  stats_unlock();
+  return histogram;
+}
+
+/* must be called with stats_lock() held */
+static void
+_unref_registered_histogram(StatsHistogram *self)
+{
+  if (--self->ref_cnt == 0)
+    {
+      registered_histograms = g_list_remove(registered_histograms, self);
+      _unregister_percentile_counter(self, "latency_p50_usec", &self->p50);
+      _unregister_percentile_counter(self, "latency_p99_usec", &self->p99);
+      _unregister_percentile_counter(self, "latency_p999_usec", &self->p999);
+      stats_histogram_free(self);
+    }
+}
+
+void
+stats_unregister_histogram(gint component, const gchar *id, const gchar *instance, StatsHistogram **histogram)
+{
+  StatsHistogram *self = *histogram;
+
+  if (!self)
+    return;
+
+  stats_lock();
+  _unref_registered_histogram(self);
+  stats_unlock();
+  *histogram = NULL;
+}
+
+typedef struct _StatsHistogramSample
+{
+  StatsHistogram *histogram;
+  guint64 sums[STATS_HISTOGRAM_BUCKETS];
+  guint64 p50, p99, p999;
+} StatsHistogramSample;
+
+/*
+ * Percentiles are only computed when someone is about to look at them,
+ * recording a value is a single atomic increment.  Only the buckets are
+ * copied while stats_lock() is held, the percentiles are computed after
+ * releasing it, the histograms are kept alive by a reference meanwhile.
+ */
+void
+stats_histograms_publish(void)
+{
+  GArray *samples = g_array_new(FALSE, FALSE, sizeof(StatsHistogramSample));
+  StatsHistogramSample *sample;
+  GList *l;
+  guint i;
+
+  stats_lock();
+  g_array_set_size(samples, g_list_length(registered_histograms));
+  for (l = registered_histograms, i = 0; l; l = l->next, i++)
+    {
+      sample = &g_array_index(samples, StatsHistogramSample, i);
+      sample->histogram = (StatsHistogram *) l->data;
+      sample->histogram->ref_cnt++;
+      _sum_buckets(sample->histogram, sample->sums);
+    }
+  stats_unlock();
+
+  for (i = 0; i < samples->len; i++)
+    {
+      sample = &g_array_index(samples, StatsHistogramSample, i);
+      sample->p50 = MIN(_get_percentile_of_sums(sample->sums, 500), G_MAXUINT32);
+      sample->p99 = MIN(_get_percentile_of_sums(sample->sums, 990), G_MAXUINT32);
+      sample->p999 = MIN(_get_percentile_of_sums(sample->sums, 999), G_MAXUINT32);
+    }
+
+  stats_lock();
+  for (i = 0; i < samples->len; i++)
+    {
+      sample = &g_array_index(samples, StatsHistogramSample, i);
+      stats_counter_set(sample->histogram->p50, sample->p50);
+      stats_counter_set(sample->histogram->p99, sample->p99);
+      stats_counter_set(sample->histogram->p999, sample->p999);
+      _unref_registered_histogram(sample->histogram);
+    }
+  stats_unlock();
+  g_array_free(samples, TRUE);
+}
+
+void
+stats_histograms_reset(void)
+{
+  GList *l;
+
+  stats_lock();
+  for (l = registered_histograms; l; l = l->next)
+    {
+      StatsHistogram *histogram = (StatsHistogram *) l->data;
+
+      stats_histogram_reset(histogram);
+      stats_counter_set(histogram->p50, 0);
+      stats_counter_set(histogram->p99, 0);
+      stats_counter_set(histogram->p999, 0);
+    }
+  stats_unlock();
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2002-2016 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef STATS_HISTOGRAM_H_INCLUDED
+#define STATS_HISTOGRAM_H_INCLUDED 1
+
+#include "syslog-ng.h"
+
+/*
+ * Log-linear histogram of microsecond values: every power of two is split
+ * into 8 linear buckets, so the reported percentiles are accurate within
+ * 12.5%.  Values above 2^32-1 usec (~71 minutes) are clamped.
+ */
+#define STATS_HISTOGRAM_BUCKETS 240
+
+/* recording threads are spread over this many bucket sets to avoid
+ * contending on the same cache lines */
+#define STATS_HISTOGRAM_SHARDS 8
+
+typedef struct _StatsHistogram StatsHistogram;
+
+StatsHistogram *stats_histogram_new(void);
+void stats_histogram_free(StatsHistogram *self);
+void stats_histogram_record(StatsHistogram *self, guint64 value);
+void stats_histogram_reset(StatsHistogram *self);
+guint64 stats_histogram_get_count(StatsHistogram *self);
+guint64 stats_histogram_get_percentile(StatsHistogram *self, gint permille);
+
+gint stats_histogram_bucket_for_value(guint64 value);
+guint64 stats_histogram_bucket_upper_bound(gint bucket);
+
+/*
+ * Registered histograms are exported as STORED counters named
+ * "<instance>,latency_p50_usec", "<instance>,latency_p99_usec" and
+ * "<instance>,latency_p999_usec", which are refreshed by
+ * stats_histograms_publish().  Registering returns NULL if @level is not
+ * enabled, recording into a NULL histogram is a no-op.
+ */
+StatsHistogram *stats_register_histogram(gint level, gint component, const gchar *id, const gchar *instance);
+void stats_unregister_histogram(gint component, const gchar *id, const gchar *instance, StatsHistogram **histogram);
+void stats_histograms_publish(void);
+void stats_histograms_reset(void);
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2002-2016 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "stats/stats-query.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-csv.h"
+#include "stats/stats-histogram.h"
+
+#include <string.h>
+
+typedef struct _StatsQuery
+{
+  GPatternSpec *component;
+  GPatternSpec *id;
+  GPatternSpec *instance;
+  StatsForeachCounterFunc format;
+  GString *result;
+} StatsQuery;
+
+gboolean
+stats_query_lookup_format(const gchar *name, StatsQueryFormat *format)
+{
+  if (strcasecmp(name, "csv") == 0)
+    *format = SQF_CSV;
+  else if (strcasecmp(name, "compact") == 0)
+    *format = SQF_COMPACT;
+  else
+    return FALSE;
+  return TRUE;
+}
+
+static void
+_append_compact_field(GString *result, const gchar *value)
+{
+  const gchar *p;
+
+  for (p = value; *p; p++)
+    {
+      switch (*p)
+        {
+        case '\t':
+          g_string_append(result, "\\t");
+          break;
+        case '\n':
+          g_string_append(result, "\\n");
+          break;
+        case '\\':
+          g_string_append(result, "\\\\");
+          break;
+        default:
+          g_string_append_c(result, *p);
+          break;
+        }
+    }
+  g_string_append_c(result, '\t');
+}
+
+static void
+_format_compact(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointer user_data)
+{
+  GString *result = (GString *) user_data;
+  gchar buf[32];
+  gchar state;
+
+  if (sc->dynamic)
+    state = 'd';
+  else if (sc->use_count == 0)
+    state = 'o';
+  else
+    state = 'a';
+
+  g_string_append(result, stats_cluster_get_component_name(sc, buf, sizeof(buf)));
+  g_string_append_c(result, '\t');
+  _append_compact_field(result, sc->id);
+  _append_compact_field(result, sc->instance);
+  g_string_append_printf(result, "%c\t%s\t%u\n", state, stats_cluster_get_type_name(type), stats_counter_get(counter));
+}
+
+static void
+_filter_counter(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointer user_data)
+{
+  StatsQuery *self = (StatsQuery *) user_data;
+  gchar buf[32];
+
+  if (self->component && !g_pattern_match_string(self->component, stats_cluster_get_component_name(sc, buf, sizeof(buf))))
+    return;
+  if (self->id && !g_pattern_match_string(self->id, sc->id))
+    return;
+  if (self->instance && !g_pattern_match_string(self->instance, sc->instance))
+    return;
+
+  self->format(sc, type, counter, self->result);
+}
+
+static GPatternSpec *
+_compile_glob(const gchar *glob)
+{
+  /* a missing or catch-all pattern matches everything, no need to evaluate it */
+  if (!glob || strcmp(glob, "*") == 0)
+    return NULL;
+  return g_pattern_spec_new(glob);
+}
+
+/*
+ * Returns the counters whose component name (e.g. "dst.tcp"), id and
+ * instance match the respective glob patterns, NULL patterns match
+ * everything.  The registry is walked via a snapshot, so this does not
+ * block the registration of new counters.
+ */
+GString *
+stats_query(StatsQueryFormat format, const gchar *component_glob, const gchar *id_glob, const gchar *instance_glob)
+{
+  StatsQuery self;
+  StatsSnapshot *snapshot;
+
+  self.component = _compile_glob(component_glob);
+  self.id = _compile_glob(id_glob);
+  self.instance = _compile_glob(instance_glob);
+  self.result = g_string_sized_new(1024);
+
+  if (format == SQF_CSV)
+    {
+      stats_format_csv_header(self.result);
+      self.format = stats_format_csv;
+    }
+  else
+    self.format = _format_compact;
+
+  stats_histograms_publish();
+  snapshot = stats_snapshot_acquire();
+  stats_snapshot_foreach_counter(snapshot, _filter_counter, &self);
+  stats_snapshot_release(snapshot);
+
+  if (self.component)
+    g_pattern_spec_free(self.component);
+  if (self.id)
+    g_pattern_spec_free(self.id);
+  if (self.instance)
+    g_pattern_spec_free(self.instance);
+  return self.result;
+}
@@ -29,6 +29,64 @@ static GHashTable *counter_hash;
 static GStaticMutex stats_mutex = G_STATIC_MUTEX_INIT;
 gboolean stats_locked;
 
+/*
+ * Snapshots are the read path of the registry: a snapshot is an array of
+ * the clusters registered at the time it was taken, which can be walked
+ * without holding stats_lock().  The latest snapshot is cached and reused
+ * until a cluster is added or removed, so repeated queries of an unchanged
+ * registry only take the lock for a reference count increment.
+ *
+ * Clusters removed from the registry while snapshots exist are kept on
+ * the orphaned list until the last snapshot is released.
+ */
+struct _StatsSnapshot
+{
+  gint ref_cnt;
+  GPtrArray *clusters;
+};
+
+static StatsSnapshot *current_snapshot;
+static gint live_snapshots;
+static GPtrArray *orphaned_clusters;
+
+static void
+_free_snapshot(StatsSnapshot *self)
+{
+  g_assert(stats_locked);
+
+  g_ptr_array_free(self->clusters, TRUE);
+  g_free(self);
+
+  live_snapshots--;
+  if (live_snapshots == 0)
+    {
+      g_ptr_array_foreach(orphaned_clusters, (GFunc) stats_cluster_free, NULL);
+      g_ptr_array_set_size(orphaned_clusters, 0);
+    }
+}
+
+static void
+_invalidate_snapshot(void)
+{
+  StatsSnapshot *snapshot = current_snapshot;
+
+  if (!snapshot)
+    return;
+
+  current_snapshot = NULL;
+  if (g_atomic_int_dec_and_test(&snapshot->ref_cnt))
+    _free_snapshot(snapshot);
+}
+
+static void
+_free_cluster(StatsCluster *sc)
+{
+  if (live_snapshots > 0)
+    g_ptr_array_add(orphaned_clusters, sc);
+  else
+    stats_cluster_free(sc);
+}
+
 void
 stats_lock(void)
 {
@@ -68,6 +126,7 @@ _grab_cluster(gint stats_level, gint component, const gchar *id, const gchar *in
       sc = stats_cluster_new(component, id, instance);
       sc->dynamic = dynamic;
       g_hash_table_insert(counter_hash, sc, sc);
+      _invalidate_snapshot();
     }
   else
     {
@@ -240,7 +299,9 @@ void
 stats_foreach_cluster_remove(StatsForeachClusterRemoveFunc func, gpointer user_data)
 {
   gpointer args[] = { func, user_data };
-  g_hash_table_foreach_remove(counter_hash, _foreach_cluster_remove_helper, args);
+
+  if (g_hash_table_foreach_remove(counter_hash, _foreach_cluster_remove_helper, args) > 0)
+    _invalidate_snapshot();
 }
 
 static void
@@ -262,17 +323,80 @@ stats_foreach_counter(StatsForeachCounterFunc func, gpointer user_data)
   stats_foreach_cluster(_foreach_counter_helper, args);
 }
 
+static void
+_add_cluster_to_snapshot(gpointer key, gpointer value, gpointer user_data)
+{
+  g_ptr_array_add((GPtrArray *) user_data, value);
+}
+
+/*
+ * Returns a reference to a snapshot of the registry, the caller must
+ * not hold stats_lock().
+ */
+StatsSnapshot *
+stats_snapshot_acquire(void)
+{
+  StatsSnapshot *snapshot;
+
+  stats_lock();
+  if (!current_snapshot)
+    {
+      current_snapshot = g_new0(StatsSnapshot, 1);
+      current_snapshot->ref_cnt = 1;
+      current_snapshot->clusters = g_ptr_array_sized_new(g_hash_table_size(counter_hash));
+      g_hash_table_foreach(counter_hash, _add_cluster_to_snapshot, current_snapshot->clusters);
+      live_snapshots++;
+    }
+  snapshot = current_snapshot;
+  g_atomic_int_inc(&snapshot->ref_cnt);
+  stats_unlock();
+  return snapshot;
+}
+
+void
+stats_snapshot_release(StatsSnapshot *snapshot)
+{
+  if (g_atomic_int_dec_and_test(&snapshot->ref_cnt))
+    {
+      stats_lock();
+      _free_snapshot(snapshot);
+      stats_unlock();
+    }
+}
+
+/*
+ * Walks the counters of a snapshot without locking, counter values are
+ * read as they are at the time of the call, the set of clusters is the
+ * one at the time the snapshot was taken.
+ */
+void
+stats_snapshot_foreach_counter(StatsSnapshot *snapshot, StatsForeachCounterFunc func, gpointer user_data)
+{
+  gint i;
+
+  for (i = 0; i < snapshot->clusters->len; i++)
+    stats_cluster_foreach_counter(g_ptr_array_index(snapshot->clusters, i), func, user_data);
+}
+
 void
 stats_registry_init(void)
 {
-  counter_hash = g_hash_table_new_full((GHashFunc) stats_cluster_hash, (GEqualFunc) stats_cluster_equal, NULL, (GDestroyNotify) stats_cluster_free);
+  counter_hash = g_hash_table_new_full((GHashFunc) stats_cluster_hash, (GEqualFunc) stats_cluster_equal, NULL, (GDestroyNotify) _free_cluster);
+  orphaned_clusters = g_ptr_array_new();
   g_static_mutex_init(&stats_mutex);
 }
 
 void
 stats_registry_deinit(void)
 {
+  stats_lock();
+  _invalidate_snapshot();
+  stats_unlock();
   g_hash_table_destroy(counter_hash);
   counter_hash = NULL;
+  g_ptr_array_foreach(orphaned_clusters, (GFunc) stats_cluster_free, NULL);
+  g_ptr_array_free(orphaned_clusters, TRUE);
+  orphaned_clusters = NULL;
+  live_snapshots = 0;
   g_static_mutex_free(&stats_mutex);
 }
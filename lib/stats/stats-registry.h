@@ -27,6 +27,7 @@
 #include "stats/stats.h"
 #include "stats/stats-cluster.h"
 
+typedef struct _StatsSnapshot StatsSnapshot;
 typedef void (*StatsForeachClusterFunc)(StatsCluster *sc, gpointer user_data);
 typedef gboolean (*StatsForeachClusterRemoveFunc)(StatsCluster *sc, gpointer user_data);
 
@@ -44,6 +45,10 @@ void stats_foreach_counter(StatsForeachCounterFunc func, gpointer user_data);
 void stats_foreach_cluster(StatsForeachClusterFunc func, gpointer user_data);
 void stats_foreach_cluster_remove(StatsForeachClusterRemoveFunc func, gpointer user_data);
 
+StatsSnapshot *stats_snapshot_acquire(void);
+void stats_snapshot_release(StatsSnapshot *snapshot);
+void stats_snapshot_foreach_counter(StatsSnapshot *snapshot, StatsForeachCounterFunc func, gpointer user_data);
+
 void stats_registry_init(void);
 void stats_registry_deinit(void);
 
@@ -26,6 +26,7 @@
 #include "stats/stats-syslog.h"
 #include "stats/stats-registry.h"
 #include "stats/stats-log.h"
+#include "stats/stats-histogram.h"
 #include "timeutils.h"
 
 #include <string.h>
@@ -159,7 +160,10 @@ stats_publish_and_prune_counters(void)
   cached_g_current_time(&st.now);
 
   if (publish)
-    st.stats_event = msg_event_create(EVT_PRI_INFO, "Log statistics", NULL);
+    {
+      stats_histograms_publish();
+      st.stats_event = msg_event_create(EVT_PRI_INFO, "Log statistics", NULL);
+    }
 
   stats_lock();
   stats_foreach_cluster_remove(stats_format_and_prune_cluster, &st);
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "testutils.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-histogram.h"
+#include "stats/stats-query.h"
+
+#define STATS_HISTOGRAM_TESTCASE(x, ...) do { testcase_begin("%s(%s)", #x, #__VA_ARGS__); x(__VA_ARGS__); testcase_end(); } while(0)
+
+static void
+test_small_values_have_exact_buckets(void)
+{
+  guint64 value;
+
+  for (value = 0; value < 16; value++)
+    {
+      gint bucket = stats_histogram_bucket_for_value(value);
+
+      assert_guint64(stats_histogram_bucket_upper_bound(bucket), value, "value %d is not in an exact bucket", (gint) value);
+    }
+}
+
+static void
+test_bucket_bounds_are_within_precision(void)
+{
+  guint64 value;
+
+  for (value = 1; value < G_MAXUINT32; value = value * 3 + 1)
+    {
+      gint bucket = stats_histogram_bucket_for_value(value);
+      guint64 upper = stats_histogram_bucket_upper_bound(bucket);
+
+      assert_true(bucket >= 0 && bucket < STATS_HISTOGRAM_BUCKETS, "bucket out of range for value %" G_GUINT64_FORMAT, value);
+      assert_true(upper >= value, "upper bound below value %" G_GUINT64_FORMAT, value);
+      assert_true(upper - value <= value / 8, "bucket too wide for value %" G_GUINT64_FORMAT, value);
+      if (bucket > 0)
+        assert_true(stats_histogram_bucket_upper_bound(bucket - 1) < value, "value %" G_GUINT64_FORMAT " fits the previous bucket", value);
+    }
+
+  assert_gint(stats_histogram_bucket_for_value(G_MAXUINT64), STATS_HISTOGRAM_BUCKETS - 1, "large values are not clamped");
+}
+
+static void
+test_percentiles(void)
+{
+  StatsHistogram *histogram = stats_histogram_new();
+  gint i;
+
+  assert_guint64(stats_histogram_get_percentile(histogram, 500), 0, "empty histogram has a median");
+
+  for (i = 0; i < 990; i++)
+    stats_histogram_record(histogram, 100);
+  for (i = 0; i < 9; i++)
+    stats_histogram_record(histogram, 10000);
+  stats_histogram_record(histogram, 1000000);
+
+  assert_guint64(stats_histogram_get_count(histogram), 1000, "unexpected number of values");
+  assert_guint64(stats_histogram_get_percentile(histogram, 500), 103, "unexpected p50");
+  assert_guint64(stats_histogram_get_percentile(histogram, 990), 103, "unexpected p99");
+  assert_guint64(stats_histogram_get_percentile(histogram, 999), 10239, "unexpected p999");
+  assert_guint64(stats_histogram_get_percentile(histogram, 1000), 1048575, "unexpected maximum");
+
+  stats_histogram_reset(histogram);
+  assert_guint64(stats_histogram_get_count(histogram), 0, "histogram was not reset");
+  stats_histogram_free(histogram);
+}
+
+static void
+test_registered_histogram_is_published_as_counters(void)
+{
+  StatsHistogram *histogram, *shared;
+  GString *result;
+
+  histogram = stats_register_histogram(0, SCS_DESTINATION | SCS_FILE, "d_file", "/var/log/messages");
+  shared = stats_register_histogram(0, SCS_DESTINATION | SCS_FILE, "d_file", "/var/log/messages");
+  assert_gpointer(shared, histogram, "histograms with the same name are not shared");
+
+  stats_histogram_record(histogram, 5);
+  stats_histograms_publish();
+
+  result = stats_query(SQF_COMPACT, "dst.file", "d_file", "*latency_p50_usec");
+  assert_string(result->str, "dst.file\td_file\t/var/log/messages,latency_p50_usec\ta\tstored\t5\n", "percentile was not published");
+  g_string_free(result, TRUE);
+
+  stats_unregister_histogram(SCS_DESTINATION | SCS_FILE, "d_file", "/var/log/messages", &shared);
+  assert_null(shared, "unregistering did not clear the histogram pointer");
+  stats_unregister_histogram(SCS_DESTINATION | SCS_FILE, "d_file", "/var/log/messages", &histogram);
+
+  assert_null(stats_register_histogram(STATS_LEVEL1, SCS_DESTINATION | SCS_FILE, "d_file", "/var/log/messages"),
+              "histogram registered above the stats level");
+}
+
+int
+main(int argc, char *argv[])
+{
+  stats_registry_init();
+
+  STATS_HISTOGRAM_TESTCASE(test_small_values_have_exact_buckets);
+  STATS_HISTOGRAM_TESTCASE(test_bucket_bounds_are_within_precision);
+  STATS_HISTOGRAM_TESTCASE(test_percentiles);
+  STATS_HISTOGRAM_TESTCASE(test_registered_histogram_is_published_as_counters);
+
+  stats_registry_deinit();
+  return 0;
+}
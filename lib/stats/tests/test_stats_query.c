@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "testutils.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-query.h"
+
+#define STATS_QUERY_TESTCASE(x, ...) do { testcase_begin("%s(%s)", #x, #__VA_ARGS__); x(__VA_ARGS__); testcase_end(); } while(0)
+
+static StatsCounterItem *file_counter, *tcp_counter, *global_counter;
+
+static void
+register_counters(void)
+{
+  stats_lock();
+  stats_register_counter(0, SCS_SOURCE | SCS_FILE, "s_file", "/var/log/messages", SC_TYPE_PROCESSED, &file_counter);
+  stats_register_counter(0, SCS_DESTINATION | SCS_TCP, "d_net", "tcp,10.0.0.1:514", SC_TYPE_PROCESSED, &tcp_counter);
+  stats_register_counter(0, SCS_GLOBAL, "msg_clones", NULL, SC_TYPE_PROCESSED, &global_counter);
+  stats_unlock();
+  stats_counter_add(file_counter, 3);
+  stats_counter_add(tcp_counter, 5);
+  stats_counter_add(global_counter, 7);
+}
+
+static void
+assert_query(StatsQueryFormat format, const gchar *component, const gchar *id, const gchar *instance, const gchar *expected)
+{
+  GString *result = stats_query(format, component, id, instance);
+
+  assert_string(result->str, expected, "unexpected stats query result");
+  g_string_free(result, TRUE);
+}
+
+static void
+test_compact_query_filters_by_component(void)
+{
+  assert_query(SQF_COMPACT, "dst.*", NULL, NULL, "dst.tcp\td_net\ttcp,10.0.0.1:514\ta\tprocessed\t5\n");
+  assert_query(SQF_COMPACT, "global", "*", "*", "global\tmsg_clones\t\ta\tprocessed\t7\n");
+}
+
+static void
+test_csv_query_filters_by_id_and_instance(void)
+{
+  assert_query(SQF_CSV, NULL, "s_*", NULL,
+               "SourceName;SourceId;SourceInstance;State;Type;Number\n"
+               "src.file;s_file;/var/log/messages;a;processed;3\n");
+  assert_query(SQF_CSV, "*", "*", "tcp,*",
+               "SourceName;SourceId;SourceInstance;State;Type;Number\n"
+               "dst.tcp;d_net;tcp,10.0.0.1:514;a;processed;5\n");
+  assert_query(SQF_CSV, "src.*", "d_*", NULL,
+               "SourceName;SourceId;SourceInstance;State;Type;Number\n");
+}
+
+static void
+test_compact_query_escapes_separators(void)
+{
+  StatsCounterItem *counter;
+
+  stats_lock();
+  stats_register_counter(0, SCS_SOURCE | SCS_PROGRAM, "s_prg", "a\tb\\c", SC_TYPE_DROPPED, &counter);
+  stats_unlock();
+
+  assert_query(SQF_COMPACT, "src.program", NULL, NULL, "src.program\ts_prg\ta\\tb\\\\c\ta\tdropped\t0\n");
+
+  stats_lock();
+  stats_unregister_counter(SCS_SOURCE | SCS_PROGRAM, "s_prg", "a\tb\\c", SC_TYPE_DROPPED, &counter);
+  stats_unlock();
+}
+
+static void
+test_snapshot_is_reused_until_the_registry_changes(void)
+{
+  StatsSnapshot *first, *second, *third;
+  StatsCounterItem *counter;
+
+  first = stats_snapshot_acquire();
+  second = stats_snapshot_acquire();
+  assert_true(first == second, "snapshot was not reused for an unchanged registry");
+
+  stats_lock();
+  stats_register_counter(0, SCS_SOURCE | SCS_PIPE, "s_pipe", NULL, SC_TYPE_PROCESSED, &counter);
+  stats_unlock();
+
+  third = stats_snapshot_acquire();
+  assert_true(first != third, "snapshot was reused after a new counter was registered");
+
+  stats_snapshot_release(first);
+  stats_snapshot_release(second);
+  stats_snapshot_release(third);
+
+  stats_lock();
+  stats_unregister_counter(SCS_SOURCE | SCS_PIPE, "s_pipe", NULL, SC_TYPE_PROCESSED, &counter);
+  stats_unlock();
+}
+
+int
+main(int argc, char *argv[])
+{
+  stats_registry_init();
+  register_counters();
+
+  STATS_QUERY_TESTCASE(test_compact_query_filters_by_component);
+  STATS_QUERY_TESTCASE(test_csv_query_filters_by_id_and_instance);
+  STATS_QUERY_TESTCASE(test_compact_query_escapes_separators);
+  STATS_QUERY_TESTCASE(test_snapshot_is_reused_until_the_registry_changes);
+
+  stats_registry_deinit();
+  return 0;
+}
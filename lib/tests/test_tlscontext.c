@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "tlscontext.h"
+#include "testutils.h"
+#include "apphook.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#define TICKET_KEY_FILE "test_tlscontext_ticket.key"
+
+static void
+write_ticket_key_file(gsize len)
+{
+  gchar keys[64];
+
+  memset(keys, 'x', sizeof(keys));
+  assert_true(g_file_set_contents(TICKET_KEY_FILE, keys, len, NULL), "Error writing ticket key file");
+}
+
+static TLSContext *
+create_server_context(void)
+{
+  TLSContext *tls_context = tls_context_new(TM_SERVER);
+
+  tls_context->verify_mode = TVM_NONE;
+  return tls_context;
+}
+
+static void
+test_session_cache_is_enabled_by_default(void)
+{
+  TLSContext *tls_context = create_server_context();
+
+  assert_true(tls_context_setup_context(tls_context, "tcp,0.0.0.0:6514"), "Setting up the TLS context failed");
+  assert_gint(SSL_CTX_get_session_cache_mode(tls_context->ssl_ctx), SSL_SESS_CACHE_SERVER, "Server side session cache should be enabled");
+  assert_false((SSL_CTX_get_options(tls_context->ssl_ctx) & SSL_OP_NO_TICKET) != 0, "Session tickets should be enabled");
+  tls_context_free(tls_context);
+}
+
+static void
+test_session_cache_options_are_applied(void)
+{
+  TLSContext *tls_context = create_server_context();
+
+  tls_context->session_cache_size = 100;
+  tls_context->session_timeout = 60;
+  tls_context->session_tickets = FALSE;
+  assert_true(tls_context_setup_context(tls_context, "tcp,0.0.0.0:6514"), "Setting up the TLS context failed");
+  assert_gint(SSL_CTX_sess_get_cache_size(tls_context->ssl_ctx), 100, "session-cache-size() was not applied");
+  assert_gint(SSL_CTX_get_timeout(tls_context->ssl_ctx), 60, "session-timeout() was not applied");
+  assert_true((SSL_CTX_get_options(tls_context->ssl_ctx) & SSL_OP_NO_TICKET) != 0, "session-tickets(no) was not applied");
+  tls_context_free(tls_context);
+}
+
+static void
+test_zero_session_cache_size_disables_the_cache(void)
+{
+  TLSContext *tls_context = create_server_context();
+
+  tls_context->session_cache_size = 0;
+  assert_true(tls_context_setup_context(tls_context, "tcp,0.0.0.0:6514"), "Setting up the TLS context failed");
+  assert_gint(SSL_CTX_get_session_cache_mode(tls_context->ssl_ctx), SSL_SESS_CACHE_OFF, "session-cache-size(0) should disable the cache");
+  tls_context_free(tls_context);
+
+  tls_context = tls_context_new(TM_CLIENT);
+  tls_context->session_cache_size = 0;
+  assert_true(tls_context_setup_context(tls_context, "tcp,localhost:6514"), "Setting up the TLS context failed");
+  assert_gint(SSL_CTX_get_session_cache_mode(tls_context->ssl_ctx), SSL_SESS_CACHE_OFF, "session-cache-size(0) should disable resumption on the client side");
+  tls_context_free(tls_context);
+}
+
+static void
+test_session_id_context_differs_between_servers(void)
+{
+  TLSContext *first = create_server_context();
+  TLSContext *same = create_server_context();
+  TLSContext *other_name = create_server_context();
+  TLSContext *other_ca = create_server_context();
+
+  other_ca->ca_dir = g_strdup("/nonexistent/ca.d");
+  assert_true(tls_context_setup_context(first, "tcp,0.0.0.0:6514"), "Setting up the TLS context failed");
+  assert_true(tls_context_setup_context(same, "tcp,0.0.0.0:6514"), "Setting up the TLS context failed");
+  assert_true(tls_context_setup_context(other_name, "tcp,0.0.0.0:6515"), "Setting up the TLS context failed");
+  assert_true(tls_context_setup_context(other_ca, "tcp,0.0.0.0:6514"), "Setting up the TLS context failed");
+
+  assert_true(first->ssl_ctx->sid_ctx_length > 0, "Session id context is not set");
+  assert_nstring((const gchar *) first->ssl_ctx->sid_ctx, first->ssl_ctx->sid_ctx_length,
+                 (const gchar *) same->ssl_ctx->sid_ctx, same->ssl_ctx->sid_ctx_length,
+                 "The same server should get the same session id context");
+  assert_false(memcmp(first->ssl_ctx->sid_ctx, other_name->ssl_ctx->sid_ctx, first->ssl_ctx->sid_ctx_length) == 0,
+               "Different servers should get different session id contexts");
+  assert_false(memcmp(first->ssl_ctx->sid_ctx, other_ca->ssl_ctx->sid_ctx, first->ssl_ctx->sid_ctx_length) == 0,
+               "Servers trusting different CAs should get different session id contexts");
+
+  tls_context_free(first);
+  tls_context_free(same);
+  tls_context_free(other_name);
+  tls_context_free(other_ca);
+}
+
+static void
+test_ticket_keys_are_loaded(void)
+{
+  TLSContext *tls_context = create_server_context();
+  gchar keys[48];
+  gchar expected[48];
+
+  write_ticket_key_file(48);
+  tls_context->session_ticket_key_file = g_strdup(TICKET_KEY_FILE);
+  assert_true(tls_context_setup_context(tls_context, "tcp,0.0.0.0:6514"), "Setting up the TLS context failed");
+
+  memset(expected, 'x', sizeof(expected));
+  assert_true(SSL_CTX_get_tlsext_ticket_keys(tls_context->ssl_ctx, keys, sizeof(keys)) == 1, "Error querying ticket keys");
+  assert_nstring(keys, sizeof(keys), expected, sizeof(expected), "Ticket keys were not loaded from the key file");
+  tls_context_free(tls_context);
+  unlink(TICKET_KEY_FILE);
+}
+
+static void
+test_ticket_key_file_with_wrong_length_fails(void)
+{
+  TLSContext *tls_context = create_server_context();
+
+  write_ticket_key_file(47);
+  tls_context->session_ticket_key_file = g_strdup(TICKET_KEY_FILE);
+
+  start_grabbing_messages();
+  assert_false(tls_context_setup_context(tls_context, "tcp,0.0.0.0:6514"), "A key file of the wrong length should be rejected");
+  assert_grabbed_messages_contain("must contain exactly 48 bytes", "Missing error message about the key length");
+  stop_grabbing_messages();
+  reset_grabbed_messages();
+
+  assert_null(tls_context->ssl_ctx, "A failed setup should not leave an SSL_CTX behind");
+  tls_context_free(tls_context);
+  unlink(TICKET_KEY_FILE);
+}
+
+static void
+test_missing_ticket_key_file_fails(void)
+{
+  TLSContext *tls_context = create_server_context();
+
+  unlink(TICKET_KEY_FILE);
+  tls_context->session_ticket_key_file = g_strdup(TICKET_KEY_FILE);
+
+  start_grabbing_messages();
+  assert_false(tls_context_setup_context(tls_context, "tcp,0.0.0.0:6514"), "A missing key file should be rejected");
+  assert_grabbed_messages_contain("Error reading TLS session ticket key file", "Missing error message about the key file");
+  stop_grabbing_messages();
+  reset_grabbed_messages();
+
+  tls_context_free(tls_context);
+}
+
+int
+main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
+{
+  app_startup();
+
+  test_session_cache_is_enabled_by_default();
+  test_session_cache_options_are_applied();
+  test_zero_session_cache_size_disables_the_cache();
+  test_session_id_context_differs_between_servers();
+  test_ticket_keys_are_loaded();
+  test_ticket_key_file_with_wrong_length_fails();
+  test_missing_ticket_key_file_fails();
+
+  app_shutdown();
+  return 0;
+}
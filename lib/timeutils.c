@@ -322,6 +322,22 @@ check_nanosleep(void)
   return FALSE;
 }
 
+/**
+ * get_monotonic_usec:
+ *
+ * Returns the value of the monotonic clock in microseconds, to be used
+ * for measuring latencies.  Never returns 0, so that 0 can stand for an
+ * unset timestamp.
+ **/
+guint64
+get_monotonic_usec(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (guint64) now.tv_sec * G_USEC_PER_SEC + now.tv_nsec / 1000 + 1;
+}
+
 /**
  * g_time_val_diff:
  * @t1: time value t1
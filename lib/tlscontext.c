@@ -24,6 +24,7 @@
 #include "tlscontext.h"
 #include "str-utils.h"
 #include "messages.h"
+#include "stats/stats-registry.h"
 
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -32,6 +33,8 @@
 #include <openssl/err.h>
 #include <openssl/rand.h>
 
+#define TLS_SESSION_TICKET_KEYS_LEN 48
+
 gboolean
 tls_get_x509_digest(X509 *x, GString *hash_string)
 {
@@ -258,6 +261,153 @@ tls_session_free(TLSSession *self)
   g_free(self);
 }
 
+static void
+tls_session_info_callback(const SSL *ssl, int where, int ret)
+{
+  TLSSession *self = SSL_get_app_data(ssl);
+  gboolean resumed;
+
+  if ((where & SSL_CB_HANDSHAKE_DONE) == 0 || !self)
+    return;
+
+  resumed = SSL_session_reused((SSL *) ssl);
+  stats_counter_inc(self->ctx->handshakes);
+  if (resumed)
+    stats_counter_inc(self->ctx->resumed_handshakes);
+
+  msg_debug("TLS handshake completed",
+            evt_tag_str("protocol", SSL_get_version(ssl)),
+            evt_tag_str("cipher", SSL_get_cipher_name(ssl)),
+            evt_tag_str("resumed", resumed ? "yes" : "no"));
+}
+
+/* invoked by libssl whenever a client connection receives a resumable
+ * session (or, with TLS 1.3, a new ticket), we keep the latest one */
+static int
+tls_context_new_client_session(SSL *ssl, SSL_SESSION *session)
+{
+  TLSSession *tls_session = SSL_get_app_data(ssl);
+  TLSContext *self;
+  SSL_SESSION *old_session;
+
+  if (!tls_session)
+    return 0;
+
+  self = tls_session->ctx;
+  g_static_mutex_lock(&self->client_session_lock);
+  old_session = self->client_session;
+  self->client_session = session;
+  g_static_mutex_unlock(&self->client_session_lock);
+
+  if (old_session)
+    SSL_SESSION_free(old_session);
+
+  /* returning 1 means that we took over the reference of @session */
+  return 1;
+}
+
+static void
+tls_context_offer_client_session(TLSContext *self, SSL *ssl)
+{
+  g_static_mutex_lock(&self->client_session_lock);
+  if (self->client_session)
+    SSL_set_session(ssl, self->client_session);
+  g_static_mutex_unlock(&self->client_session_lock);
+}
+
+static gboolean
+tls_context_load_session_ticket_keys(TLSContext *self)
+{
+  gchar *keys;
+  gsize keys_len;
+  GError *error = NULL;
+  gboolean result;
+
+  if (!g_file_get_contents(self->session_ticket_key_file, &keys, &keys_len, &error))
+    {
+      msg_error("Error reading TLS session ticket key file",
+                evt_tag_str("filename", self->session_ticket_key_file),
+                evt_tag_str("error", error->message));
+      g_clear_error(&error);
+      return FALSE;
+    }
+
+  if (keys_len != TLS_SESSION_TICKET_KEYS_LEN)
+    {
+      msg_error("TLS session ticket key file must contain exactly 48 bytes of random data",
+                evt_tag_str("filename", self->session_ticket_key_file),
+                evt_tag_int("length", keys_len));
+      result = FALSE;
+    }
+  else if (!SSL_CTX_set_tlsext_ticket_keys(self->ssl_ctx, keys, keys_len))
+    {
+      msg_error("Error setting TLS session ticket keys",
+                evt_tag_str("filename", self->session_ticket_key_file));
+      result = FALSE;
+    }
+  else
+    result = TRUE;
+
+  memset(keys, 0, keys_len);
+  g_free(keys);
+  return result;
+}
+
+/* sessions are only resumed within the same session id context, which
+ * identifies the server and how it verifies its peers, so that a session
+ * established with one source can't be resumed with another one, e.g. one
+ * trusting a different set of CAs */
+static void
+tls_context_set_session_id_context(TLSContext *self, const gchar *name)
+{
+  GString *sid_ctx = g_string_new(name);
+  guchar md[EVP_MAX_MD_SIZE];
+  guint md_len;
+
+  g_string_append_printf(sid_ctx, ",%s,%d", self->ca_dir ? : "", self->verify_mode);
+  EVP_Digest(sid_ctx->str, sid_ctx->len, md, &md_len, EVP_sha1(), NULL);
+  SSL_CTX_set_session_id_context(self->ssl_ctx, md, MIN(md_len, SSL_MAX_SID_CTX_LENGTH));
+  g_string_free(sid_ctx, TRUE);
+}
+
+static void
+tls_context_setup_session_cache(TLSContext *self, const gchar *name)
+{
+  if (self->mode == TM_CLIENT)
+    {
+      /* a client only ever resumes the session of its last connection,
+       * which we store ourselves in self->client_session */
+      if (self->session_cache_size != 0)
+        {
+          SSL_CTX_set_session_cache_mode(self->ssl_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+          SSL_CTX_sess_set_new_cb(self->ssl_ctx, tls_context_new_client_session);
+        }
+      else
+        SSL_CTX_set_session_cache_mode(self->ssl_ctx, SSL_SESS_CACHE_OFF);
+    }
+  else
+    {
+      /* without a session id context libssl refuses to resume sessions
+       * when client certificates are verified */
+      tls_context_set_session_id_context(self, name);
+      if (self->session_cache_size != 0)
+        {
+          SSL_CTX_set_session_cache_mode(self->ssl_ctx, SSL_SESS_CACHE_SERVER);
+          if (self->session_cache_size > 0)
+            SSL_CTX_sess_set_cache_size(self->ssl_ctx, self->session_cache_size);
+        }
+      else
+        SSL_CTX_set_session_cache_mode(self->ssl_ctx, SSL_SESS_CACHE_OFF);
+    }
+
+  if (self->session_timeout > 0)
+    SSL_CTX_set_timeout(self->ssl_ctx, self->session_timeout);
+  if (!self->session_tickets)
+    SSL_CTX_set_options(self->ssl_ctx, SSL_OP_NO_TICKET);
+
+  SSL_CTX_set_info_callback(self->ssl_ctx, tls_session_info_callback);
+}
+
 static gboolean
 file_exists(const gchar *fname)
 {
@@ -273,11 +423,14 @@ file_exists(const gchar *fname)
   return TRUE;
 }
 
-TLSSession *
-tls_context_setup_session(TLSContext *self)
+/*
+ * Sets up the SSL_CTX shared by the sessions of the context, @name
+ * identifies the driver owning the context. It is called when the driver
+ * is initialized, so that a misconfiguration is reported right away.
+ */
+gboolean
+tls_context_setup_context(TLSContext *self, const gchar *name)
 {
-  SSL *ssl;
-  TLSSession *session;
   gint ssl_error;
   long ssl_options;
 
@@ -359,18 +512,16 @@ tls_context_setup_session(TLSContext *self)
           if (!SSL_CTX_set_cipher_list(self->ssl_ctx, self->cipher_suite))
             goto error;
         }
-    }
+      tls_context_setup_session_cache(self, name);
 
-  ssl = SSL_new(self->ssl_ctx);
-
-  if (self->mode == TM_CLIENT)
-    SSL_set_connect_state(ssl);
-  else
-    SSL_set_accept_state(ssl);
-
-  session = tls_session_new(ssl, self);
-  SSL_set_app_data(ssl, session);
-  return session;
+      if (self->mode == TM_SERVER && self->session_ticket_key_file && !tls_context_load_session_ticket_keys(self))
+        {
+          SSL_CTX_free(self->ssl_ctx);
+          self->ssl_ctx = NULL;
+          return FALSE;
+        }
+    }
+  return TRUE;
 
  error:
   ssl_error = ERR_get_error();
@@ -382,7 +533,30 @@ tls_context_setup_session(TLSContext *self)
       SSL_CTX_free(self->ssl_ctx);
       self->ssl_ctx = NULL;
     }
-  return NULL;
+  return FALSE;
+}
+
+TLSSession *
+tls_context_setup_session(TLSContext *self)
+{
+  SSL *ssl;
+  TLSSession *session;
+
+  g_assert(self->ssl_ctx);
+
+  ssl = SSL_new(self->ssl_ctx);
+
+  if (self->mode == TM_CLIENT)
+    {
+      tls_context_offer_client_session(self, ssl);
+      SSL_set_connect_state(ssl);
+    }
+  else
+    SSL_set_accept_state(ssl);
+
+  session = tls_session_new(ssl, self);
+  SSL_set_app_data(ssl, session);
+  return session;
 }
 
 TLSContext *
@@ -393,12 +567,53 @@ tls_context_new(TLSMode mode)
   self->mode = mode;
   self->verify_mode = TVM_REQUIRED | TVM_TRUSTED;
   self->ssl_options = TSO_NOSSLv2;
+  self->session_tickets = TRUE;
+  self->session_cache_size = -1;
+  g_static_mutex_init(&self->client_session_lock);
   return self;
 }
 
+/*
+ * The number of completed handshakes and the number of those that
+ * resumed an earlier session, the resumption ratio is the quotient of the
+ * two.
+ */
+void
+tls_context_register_stats(TLSContext *self, gint stats_level, gint component, const gchar *id, const gchar *instance)
+{
+  gchar *handshakes_instance = g_strdup_printf("%s,tls_handshakes", instance);
+  gchar *resumed_instance = g_strdup_printf("%s,tls_resumed_handshakes", instance);
+
+  stats_lock();
+  stats_register_counter(stats_level, component, id, handshakes_instance, SC_TYPE_PROCESSED, &self->handshakes);
+  stats_register_counter(stats_level, component, id, resumed_instance, SC_TYPE_PROCESSED, &self->resumed_handshakes);
+  stats_unlock();
+
+  g_free(handshakes_instance);
+  g_free(resumed_instance);
+}
+
+void
+tls_context_unregister_stats(TLSContext *self, gint component, const gchar *id, const gchar *instance)
+{
+  gchar *handshakes_instance = g_strdup_printf("%s,tls_handshakes", instance);
+  gchar *resumed_instance = g_strdup_printf("%s,tls_resumed_handshakes", instance);
+
+  stats_lock();
+  stats_unregister_counter(component, id, handshakes_instance, SC_TYPE_PROCESSED, &self->handshakes);
+  stats_unregister_counter(component, id, resumed_instance, SC_TYPE_PROCESSED, &self->resumed_handshakes);
+  stats_unlock();
+
+  g_free(handshakes_instance);
+  g_free(resumed_instance);
+}
+
 void
 tls_context_free(TLSContext *self)
 {
+  if (self->client_session)
+    SSL_SESSION_free(self->client_session);
+  g_static_mutex_free(&self->client_session_lock);
   SSL_CTX_free(self->ssl_ctx);
   g_list_foreach(self->trusted_fingerpint_list, (GFunc) g_free, NULL);
   g_list_foreach(self->trusted_dn_list, (GFunc) g_free, NULL);
@@ -407,6 +622,7 @@ tls_context_free(TLSContext *self)
   g_free(self->ca_dir);
   g_free(self->crl_dir);
   g_free(self->cipher_suite);
+  g_free(self->session_ticket_key_file);
   g_free(self);
 }
 
@@ -25,6 +25,7 @@
 #define TLSCONTEXT_H_INCLUDED
 
 #include "syslog-ng.h"
+#include "stats/stats-counter.h"
 
 #include <openssl/ssl.h>
 
@@ -82,12 +83,29 @@ struct _TLSContext
   GList *trusted_fingerpint_list;
   GList *trusted_dn_list;
   gint ssl_options;
+
+  /* session resumption */
+  gboolean session_tickets;
+  gint session_cache_size;
+  gint session_timeout;
+  gchar *session_ticket_key_file;
+
+  /* client side: the session negotiated by the last handshake, offered
+   * to the server when the destination reconnects */
+  GStaticMutex client_session_lock;
+  SSL_SESSION *client_session;
+
+  StatsCounterItem *handshakes;
+  StatsCounterItem *resumed_handshakes;
 };
 
 
+gboolean tls_context_setup_context(TLSContext *self, const gchar *name);
 TLSSession *tls_context_setup_session(TLSContext *self);
 void tls_session_set_trusted_fingerprints(TLSContext *self, GList *fingerprints);
 void tls_session_set_trusted_dn(TLSContext *self, GList *dns);
+void tls_context_register_stats(TLSContext *self, gint stats_level, gint component, const gchar *id, const gchar *instance);
+void tls_context_unregister_stats(TLSContext *self, gint component, const gchar *id, const gchar *instance);
 TLSContext *tls_context_new(TLSMode mode);
 void tls_context_free(TLSContext *s);
 
@@ -39,6 +39,7 @@ static CfgLexerKeyword afamqp_keywords[] = {
   { "exchange_type",		KW_EXCHANGE_TYPE },
   { "routing_key",		KW_ROUTING_KEY },
   { "persistent",		KW_PERSISTENT },
+  { "publisher_confirms",	KW_PUBLISHER_CONFIRMS },
   { "username",			KW_USERNAME },
   { "password",			KW_PASSWORD },
   { "log_fifo_size",		KW_LOG_FIFO_SIZE  },
@@ -37,6 +37,18 @@
 #include <amqp_framing.h>
 #include <amqp_tcp_socket.h>
 
+/* the number of unconfirmed messages in flight if batch-lines() is not set */
+#define AFAMQP_DEFAULT_CONFIRM_WINDOW 100
+/* seconds to wait for the confirms of a batch when it is flushed */
+#define AFAMQP_CONFIRM_TIMEOUT 30
+
+enum
+{
+  AFAMQP_CONFIRM_PENDING,
+  AFAMQP_CONFIRM_ACKED,
+  AFAMQP_CONFIRM_NACKED,
+};
+
 typedef struct
 {
   LogThrDestDriver super;
@@ -49,6 +61,7 @@ typedef struct
 
   gboolean declare;
   gint persistent;
+  gboolean publisher_confirms;
 
   gchar *vhost;
   gchar *host;
@@ -65,6 +78,16 @@ typedef struct
   amqp_socket_t* sockfd;
   amqp_table_entry_t *entries;
   gint32 max_entries;
+
+  /* with publisher confirms every message of the current batch is
+   * published, and settled when the server confirms its delivery tag */
+  struct
+  {
+    /* the delivery tag of the first message in the batch */
+    guint64 first_tag;
+    /* the state of each message in the batch */
+    GByteArray *states;
+  } confirms;
 } AMQPDestDriver;
 
 /*
@@ -170,6 +193,14 @@ afamqp_dd_set_persistent(LogDriver *s, gboolean persistent)
     self->persistent = 1;
 }
 
+void
+afamqp_dd_set_publisher_confirms(LogDriver *s, gboolean publisher_confirms)
+{
+  AMQPDestDriver *self = (AMQPDestDriver *) s;
+
+  self->publisher_confirms = publisher_confirms;
+}
+
 void
 afamqp_dd_set_value_pairs(LogDriver *d, ValuePairs *vp)
 {
@@ -215,11 +246,20 @@ afamqp_dd_format_persist_name(LogThrDestDriver *s)
   return persist_name;
 }
 
+static void
+_reset_confirms(AMQPDestDriver *self)
+{
+  /* delivery tags are counted from 1 on each channel */
+  self->confirms.first_tag = 1;
+  g_byte_array_set_size(self->confirms.states, 0);
+}
+
 static inline void
 _amqp_connection_deinit(AMQPDestDriver* self)
 {
   amqp_destroy_connection(self->conn);
   self->conn = NULL;
+  _reset_confirms(self);
 }
 
 static void
@@ -379,6 +419,17 @@ afamqp_dd_connect(AMQPDestDriver *self, gboolean reconnect)
         }
     }
 
+  if (self->publisher_confirms)
+    {
+      amqp_confirm_select(self->conn, 1);
+      ret = amqp_get_rpc_reply(self->conn);
+      if (!afamqp_is_ok(self, "Error enabling AMQP publisher confirms", ret))
+        {
+          goto exception_amqp_dd_connect_failed_exchange;
+        }
+      _reset_confirms(self);
+    }
+
   msg_debug ("Connecting to AMQP succeeded",
              evt_tag_str("driver", self->super.super.super.id));
 
@@ -490,10 +541,8 @@ afamqp_worker_publish(AMQPDestDriver *self, LogMessage *msg)
 }
 
 static worker_insert_result_t
-afamqp_worker_insert(LogThrDestDriver *s, LogMessage *msg)
+afamqp_worker_insert_single(AMQPDestDriver *self, LogMessage *msg)
 {
-  AMQPDestDriver *self = (AMQPDestDriver *)s;
-
   if (!afamqp_dd_connect(self, TRUE))
     return WORKER_INSERT_RESULT_NOT_CONNECTED;
 
@@ -503,6 +552,208 @@ afamqp_worker_insert(LogThrDestDriver *s, LogMessage *msg)
   return WORKER_INSERT_RESULT_SUCCESS;
 }
 
+static void
+_settle_deliveries(AMQPDestDriver *self, guint64 delivery_tag, gboolean multiple, guint8 state)
+{
+  guint64 tag = multiple ? self->confirms.first_tag : delivery_tag;
+
+  for (; tag <= delivery_tag; tag++)
+    {
+      guint64 index = tag - self->confirms.first_tag;
+
+      if (tag < self->confirms.first_tag || index >= self->confirms.states->len)
+        continue;
+      if (self->confirms.states->data[index] == AFAMQP_CONFIRM_PENDING)
+        self->confirms.states->data[index] = state;
+    }
+}
+
+/*
+ * Messages can only be acked from the start of the batch, so the confirmed
+ * prefix is acked.  Returns FALSE if the server nacked the first message
+ * that is still in the batch.
+ */
+static gboolean
+_ack_confirmed_prefix(AMQPDestDriver *self)
+{
+  guint count = 0;
+
+  while (count < self->confirms.states->len &&
+         self->confirms.states->data[count] == AFAMQP_CONFIRM_ACKED)
+    count++;
+
+  if (count > 0)
+    {
+      log_threaded_dest_driver_batch_accept(&self->super, count);
+      g_byte_array_remove_range(self->confirms.states, 0, count);
+      self->confirms.first_tag += count;
+    }
+
+  if (self->confirms.states->len > 0 &&
+      self->confirms.states->data[0] == AFAMQP_CONFIRM_NACKED)
+    {
+      msg_error("AMQP server rejected a message, retrying",
+                evt_tag_str("driver", self->super.super.super.id),
+                evt_tag_int("unacknowledged", self->confirms.states->len),
+                evt_tag_int("time_reopen", self->super.time_reopen));
+      return FALSE;
+    }
+  return TRUE;
+}
+
+static gboolean
+_process_confirm_frame(AMQPDestDriver *self, amqp_frame_t *frame)
+{
+  if (frame->frame_type != AMQP_FRAME_METHOD)
+    return TRUE;
+
+  switch (frame->payload.method.id)
+    {
+    case AMQP_BASIC_ACK_METHOD:
+      {
+        amqp_basic_ack_t *ack = (amqp_basic_ack_t *) frame->payload.method.decoded;
+
+        _settle_deliveries(self, ack->delivery_tag, ack->multiple, AFAMQP_CONFIRM_ACKED);
+        break;
+      }
+    case AMQP_BASIC_NACK_METHOD:
+      {
+        amqp_basic_nack_t *nack = (amqp_basic_nack_t *) frame->payload.method.decoded;
+
+        _settle_deliveries(self, nack->delivery_tag, nack->multiple, AFAMQP_CONFIRM_NACKED);
+        break;
+      }
+    case AMQP_CHANNEL_CLOSE_METHOD:
+      {
+        amqp_channel_close_t *m = (amqp_channel_close_t *) frame->payload.method.decoded;
+
+        msg_error("AMQP server closed the channel while waiting for publisher confirms",
+                  evt_tag_str("driver", self->super.super.super.id),
+                  evt_tag_int("code", m->reply_code),
+                  evt_tag_printf("text", "%.*s", (gint) m->reply_text.len, (gchar *) m->reply_text.bytes),
+                  evt_tag_int("time_reopen", self->super.time_reopen));
+        return FALSE;
+      }
+    case AMQP_CONNECTION_CLOSE_METHOD:
+      {
+        amqp_connection_close_t *m = (amqp_connection_close_t *) frame->payload.method.decoded;
+
+        msg_error("AMQP server closed the connection while waiting for publisher confirms",
+                  evt_tag_str("driver", self->super.super.super.id),
+                  evt_tag_int("code", m->reply_code),
+                  evt_tag_printf("text", "%.*s", (gint) m->reply_text.len, (gchar *) m->reply_text.bytes),
+                  evt_tag_int("time_reopen", self->super.time_reopen));
+        return FALSE;
+      }
+    default:
+      break;
+    }
+  return TRUE;
+}
+
+/*
+ * Reads the confirms that arrived and acks the confirmed prefix of the
+ * batch.  Without @wait only the frames already available are processed,
+ * otherwise it returns when every message of the batch is confirmed.
+ */
+static gboolean
+_process_confirms(AMQPDestDriver *self, gboolean wait)
+{
+  amqp_frame_t frame;
+  struct timeval timeout;
+  gint status;
+
+  while (_ack_confirmed_prefix(self))
+    {
+      if (self->confirms.states->len == 0)
+        return TRUE;
+
+      timeout.tv_sec = wait ? AFAMQP_CONFIRM_TIMEOUT : 0;
+      timeout.tv_usec = 0;
+      status = amqp_simple_wait_frame_noblock(self->conn, &frame, &timeout);
+
+      if (status == AMQP_STATUS_TIMEOUT && !wait)
+        return TRUE;
+
+      if (status != AMQP_STATUS_OK)
+        {
+          msg_error("Error while waiting for AMQP publisher confirms",
+                    evt_tag_str("driver", self->super.super.super.id),
+                    evt_tag_str("error", amqp_error_string2(status)),
+                    evt_tag_int("unacknowledged", self->confirms.states->len),
+                    evt_tag_int("time_reopen", self->super.time_reopen));
+          return FALSE;
+        }
+
+      gboolean success = _process_confirm_frame(self, &frame);
+      amqp_maybe_release_buffers(self->conn);
+      if (!success)
+        return FALSE;
+    }
+  return FALSE;
+}
+
+/*
+ * With publisher confirms the messages stay in the batch until the
+ * server confirms them.  Confirms are picked up as further messages are
+ * published, so the window of unconfirmed messages keeps sliding, and the
+ * rest of them is waited for when the batch is flushed.
+ */
+static worker_insert_result_t
+afamqp_worker_insert_confirmed(AMQPDestDriver *self, LogMessage *msg)
+{
+  const guint8 pending = AFAMQP_CONFIRM_PENDING;
+
+  if (self->super.batch.size == 0 && !afamqp_dd_connect(self, TRUE))
+    return WORKER_INSERT_RESULT_NOT_CONNECTED;
+
+  if (!self->conn || !_process_confirms(self, FALSE))
+    return WORKER_INSERT_RESULT_ERROR;
+
+  if (!afamqp_worker_publish(self, msg))
+    return WORKER_INSERT_RESULT_ERROR;
+
+  g_byte_array_append(self->confirms.states, &pending, 1);
+  if (self->super.batch.lines <= 0 &&
+      self->confirms.states->len >= AFAMQP_DEFAULT_CONFIRM_WINDOW)
+    self->super.batch.flush_requested = TRUE;
+
+  return WORKER_INSERT_RESULT_QUEUED;
+}
+
+static worker_insert_result_t
+afamqp_worker_insert(LogThrDestDriver *s, LogMessage *msg)
+{
+  AMQPDestDriver *self = (AMQPDestDriver *)s;
+
+  if (self->publisher_confirms)
+    return afamqp_worker_insert_confirmed(self, msg);
+
+  return afamqp_worker_insert_single(self, msg);
+}
+
+/*
+ * Unconfirmed messages are rewound and published again on a new
+ * connection, as the delivery tags of the old channel are meaningless
+ * after an error.
+ */
+static worker_insert_result_t
+afamqp_worker_flush(LogThrDestDriver *s)
+{
+  AMQPDestDriver *self = (AMQPDestDriver *)s;
+
+  if (!self->conn)
+    return WORKER_INSERT_RESULT_NOT_CONNECTED;
+
+  if (!_process_confirms(self, TRUE))
+    {
+      afamqp_dd_disconnect(s);
+      return WORKER_INSERT_RESULT_ERROR;
+    }
+
+  return WORKER_INSERT_RESULT_SUCCESS;
+}
+
 static void
 afamqp_worker_thread_init(LogThrDestDriver *d)
 {
@@ -540,6 +791,10 @@ afamqp_dd_init(LogPipe *s)
               evt_tag_str("exchange", self->exchange),
               evt_tag_str("exchange_type", self->exchange_type));
 
+  if (!self->publisher_confirms && log_threaded_dest_driver_is_batching_configured(&self->super))
+    msg_warning("WARNING: batch-lines() and batch-timeout() only take effect with publisher-confirms(yes), publishing messages one by one",
+                evt_tag_str("driver", self->super.super.super.id));
+
   return log_threaded_dest_driver_start(s);
 }
 
@@ -559,6 +814,7 @@ afamqp_dd_free(LogPipe *d)
   g_free(self->host);
   g_free(self->vhost);
   g_free(self->entries);
+  g_byte_array_free(self->confirms.states, TRUE);
   value_pairs_unref(self->vp);
 
   log_threaded_dest_driver_free(d);
@@ -581,6 +837,7 @@ afamqp_dd_new(GlobalConfig *cfg)
   self->super.worker.thread_init = afamqp_worker_thread_init;
   self->super.worker.disconnect = afamqp_dd_disconnect;
   self->super.worker.insert = afamqp_worker_insert;
+  self->super.worker.flush = afamqp_worker_flush;
 
   self->super.format.stats_instance = afamqp_dd_format_stats_instance;
   self->super.format.persist_name = afamqp_dd_format_persist_name;
@@ -599,6 +856,8 @@ afamqp_dd_new(GlobalConfig *cfg)
 
   self->max_entries = 256;
   self->entries = g_new(amqp_table_entry_t, self->max_entries);
+  self->confirms.states = g_byte_array_new();
+  self->confirms.first_tag = 1;
 
   log_template_options_defaults(&self->template_options);
   afamqp_dd_set_value_pairs(&self->super.super.super, value_pairs_new_default(cfg));
@@ -32,6 +32,8 @@ static CfgLexerKeyword afmongodb_keywords[] = {
   { "mongodb", KW_MONGODB },
   { "uri", KW_URI },
   { "collection", KW_COLLECTION },
+  { "bulk", KW_BULK },
+  { "bulk_unordered", KW_BULK_UNORDERED },
 #if SYSLOG_NG_ENABLE_LEGACY_MONGODB_OPTIONS
   { "servers", KW_SERVERS, KWS_OBSOLETE, "Use the uri() option instead of servers()" },
   { "database", KW_DATABASE, KWS_OBSOLETE, "Use the uri() option instead of database()" },
@@ -52,6 +52,9 @@ typedef struct _MongoDBDestDriver
   gchar *password;
 #endif
 
+  gboolean bulk;
+  gboolean bulk_unordered;
+
   LogTemplateOptions template_options;
 
   time_t last_msg_stamp;
@@ -72,6 +75,32 @@ typedef struct _MongoDBDestDriver
 
   GString *current_value;
   bson_t *bson;
+  mongoc_bulk_operation_t *bulk_op;
 } MongoDBDestDriver;
 
+typedef struct _MongoDBWriteError
+{
+  gint32 index;
+  gint32 code;
+  const gchar *errmsg;
+} MongoDBWriteError;
+
+/* how a bulk reply with write errors maps to the documents of the batch */
+typedef struct _MongoDBBulkReplyDecision
+{
+  /* the documents before this index were either stored or rejected */
+  gint processed;
+  /* MongoDBWriteError of the rejected documents, in increasing order of index */
+  GArray *rejected;
+  /* what happened to the documents from processed on */
+  worker_insert_result_t result;
+  /* if result is WORKER_INSERT_RESULT_ERROR: the transient error that
+   * stopped processing, or the entry that made the reply malformed */
+  MongoDBWriteError stopped_at;
+  gboolean malformed;
+} MongoDBBulkReplyDecision;
+
+void afmongodb_dd_evaluate_write_errors(const bson_t *reply, gint batch_size, gboolean unordered,
+                                        MongoDBBulkReplyDecision *decision);
+
 #endif
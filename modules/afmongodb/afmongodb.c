@@ -84,6 +84,22 @@ afmongodb_dd_set_value_pairs(LogDriver *d, ValuePairs *vp)
   self->vp = vp;
 }
 
+void
+afmongodb_dd_set_bulk(LogDriver *d, gboolean bulk)
+{
+  MongoDBDestDriver *self = (MongoDBDestDriver *)d;
+
+  self->bulk = bulk;
+}
+
+void
+afmongodb_dd_set_bulk_unordered(LogDriver *d, gboolean bulk_unordered)
+{
+  MongoDBDestDriver *self = (MongoDBDestDriver *)d;
+
+  self->bulk_unordered = bulk_unordered;
+}
+
 /*
  * Utilities
  */
@@ -137,11 +153,20 @@ _format_persist_name(LogThrDestDriver *d)
   return _format_instance_id(d, "afmongodb(%s)");
 }
 
+static void
+_destroy_bulk_operation(MongoDBDestDriver *self)
+{
+  if (self->bulk_op)
+    mongoc_bulk_operation_destroy(self->bulk_op);
+  self->bulk_op = NULL;
+}
+
 static void
 _worker_disconnect(LogThrDestDriver *s)
 {
   MongoDBDestDriver *self = (MongoDBDestDriver *)s;
 
+  _destroy_bulk_operation(self);
   mongoc_client_destroy(self->client);
   self->client = NULL;
 }
@@ -371,16 +396,12 @@ _worker_retry_over_message(LogThrDestDriver *s, LogMessage *msg)
                           LTZ_SEND, &self->template_options));
 }
 
-static worker_insert_result_t
-_worker_insert(LogThrDestDriver *s, LogMessage *msg)
+static gboolean
+_format_document(MongoDBDestDriver *self, LogMessage *msg)
 {
-  MongoDBDestDriver *self = (MongoDBDestDriver *)s;
   gboolean success;
   gboolean drop_silently = self->template_options.on_error & ON_ERROR_SILENT;
 
-  if (!_connect(self, TRUE))
-    return WORKER_INSERT_RESULT_NOT_CONNECTED;
-
   bson_reinit(self->bson);
 
   success = value_pairs_walk(self->vp,
@@ -401,13 +422,26 @@ _worker_insert(LogThrDestDriver *s, LogMessage *msg)
                                         LTZ_SEND, &self->template_options),
                     evt_tag_str("driver", self->super.super.super.id));
         }
-      return WORKER_INSERT_RESULT_DROP;
+      return FALSE;
     }
 
   msg_debug("Outgoing message to MongoDB destination",
             evt_tag_value_pairs("message", self->vp, msg, self->super.seq_num, LTZ_SEND,
                                 &self->template_options),
             evt_tag_str("driver", self->super.super.super.id));
+  return TRUE;
+}
+
+static worker_insert_result_t
+_worker_insert_single(MongoDBDestDriver *self, LogMessage *msg)
+{
+  gboolean success;
+
+  if (!_connect(self, TRUE))
+    return WORKER_INSERT_RESULT_NOT_CONNECTED;
+
+  if (!_format_document(self, msg))
+    return WORKER_INSERT_RESULT_DROP;
 
   bson_error_t error;
   success = mongoc_collection_insert(self->coll_obj, MONGOC_INSERT_NONE,
@@ -435,6 +469,237 @@ _worker_insert(LogThrDestDriver *s, LogMessage *msg)
   return WORKER_INSERT_RESULT_SUCCESS;
 }
 
+/*
+ * In bulk mode documents are collected into a bulk operation, which is
+ * executed when the batch is flushed.  The server is only checked at the
+ * start of a batch instead of once per message.
+ */
+static worker_insert_result_t
+_worker_insert_bulk(MongoDBDestDriver *self, LogMessage *msg)
+{
+  if (self->super.batch.size == 0)
+    {
+      _destroy_bulk_operation(self);
+      if (!_connect(self, TRUE))
+        return WORKER_INSERT_RESULT_NOT_CONNECTED;
+    }
+
+  if (!_format_document(self, msg))
+    return WORKER_INSERT_RESULT_DROP;
+
+  if (!self->bulk_op)
+    self->bulk_op = mongoc_collection_create_bulk_operation(self->coll_obj, !self->bulk_unordered, NULL);
+
+  mongoc_bulk_operation_insert(self->bulk_op, (const bson_t *)self->bson);
+  return WORKER_INSERT_RESULT_QUEUED;
+}
+
+static worker_insert_result_t
+_worker_insert(LogThrDestDriver *s, LogMessage *msg)
+{
+  MongoDBDestDriver *self = (MongoDBDestDriver *)s;
+
+  if (self->bulk)
+    return _worker_insert_bulk(self, msg);
+
+  return _worker_insert_single(self, msg);
+}
+
+/*
+ * Error codes the server returns for a single document when it could not
+ * write it at that moment, e.g. during a replica set failover.  Any other
+ * write error means that the document itself was rejected (duplicate key,
+ * failed validation, ...), which won't change by trying again.
+ */
+static gboolean
+_is_write_error_transient(gint32 code)
+{
+  switch (code)
+    {
+    case 91:     /* ShutdownInProgress */
+    case 189:    /* PrimarySteppedDown */
+    case 10107:  /* NotMaster */
+    case 11600:  /* InterruptedAtShutdown */
+    case 11602:  /* InterruptedDueToReplStateChange */
+    case 13435:  /* NotMasterNoSlaveOk */
+    case 13436:  /* NotMasterOrSecondary */
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+static gint32
+_get_int32_field(const bson_t *document, const gchar *name, gint32 default_value)
+{
+  bson_iter_t iter;
+
+  if (!bson_iter_init_find(&iter, document, name) || !BSON_ITER_HOLDS_INT32(&iter))
+    return default_value;
+  return bson_iter_int32(&iter);
+}
+
+/*
+ * Walks the writeErrors array of a bulk reply, whose entries refer to the
+ * failed documents by their index in the batch, in increasing order.  The
+ * documents before a failed one were stored, rejected documents are to be
+ * dropped.  The result tells what happened to the rest of the batch: the
+ * documents after the first error of an ordered bulk operation were never
+ * attempted, so they are rewound and sent again.
+ *
+ * A transient error stops the walk and the rest of the batch is retried.
+ * In unordered mode the documents after it may already be stored, and as
+ * messages can only be rewound from the end of the batch, they are sent
+ * again as well.
+ *
+ * It only looks at @reply, so that it can be tested without a server.
+ * @decision->rejected must be an initialized GArray of MongoDBWriteError.
+ */
+void
+afmongodb_dd_evaluate_write_errors(const bson_t *reply, gint batch_size, gboolean unordered,
+                                   MongoDBBulkReplyDecision *decision)
+{
+  bson_iter_t iter, errors, field;
+
+  decision->processed = 0;
+  decision->result = WORKER_INSERT_RESULT_ERROR;
+  decision->malformed = TRUE;
+  decision->stopped_at.index = -1;
+  decision->stopped_at.code = 0;
+  decision->stopped_at.errmsg = "";
+  g_array_set_size(decision->rejected, 0);
+
+  if (!bson_iter_init_find(&iter, reply, "writeErrors") ||
+      !BSON_ITER_HOLDS_ARRAY(&iter) ||
+      !bson_iter_recurse(&iter, &errors))
+    return;
+
+  while (bson_iter_next(&errors))
+    {
+      const guint8 *data;
+      guint32 len;
+      bson_t write_error_doc;
+      MongoDBWriteError write_error;
+
+      if (!BSON_ITER_HOLDS_DOCUMENT(&errors))
+        continue;
+      bson_iter_document(&errors, &len, &data);
+      if (!bson_init_static(&write_error_doc, data, len))
+        continue;
+
+      write_error.index = _get_int32_field(&write_error_doc, "index", -1);
+      write_error.code = _get_int32_field(&write_error_doc, "code", 0);
+      write_error.errmsg = "";
+      if (bson_iter_init_find(&field, &write_error_doc, "errmsg") && BSON_ITER_HOLDS_UTF8(&field))
+        write_error.errmsg = bson_iter_utf8(&field, NULL);
+
+      if (write_error.index < decision->processed || write_error.index >= batch_size)
+        {
+          decision->stopped_at = write_error;
+          return;
+        }
+
+      decision->processed = write_error.index;
+      if (_is_write_error_transient(write_error.code))
+        {
+          decision->malformed = FALSE;
+          decision->stopped_at = write_error;
+          return;
+        }
+
+      g_array_append_val(decision->rejected, write_error);
+      decision->processed++;
+    }
+
+  decision->malformed = FALSE;
+  decision->result = unordered ? WORKER_INSERT_RESULT_SUCCESS : WORKER_INSERT_RESULT_REWIND;
+}
+
+static worker_insert_result_t
+_process_write_errors(MongoDBDestDriver *self, const bson_t *reply)
+{
+  MongoDBBulkReplyDecision decision;
+  gint acked = 0;
+  guint i;
+
+  decision.rejected = g_array_new(FALSE, FALSE, sizeof(MongoDBWriteError));
+  afmongodb_dd_evaluate_write_errors(reply, self->super.batch.size, self->bulk_unordered, &decision);
+
+  for (i = 0; i < decision.rejected->len; i++)
+    {
+      MongoDBWriteError *write_error = &g_array_index(decision.rejected, MongoDBWriteError, i);
+
+      log_threaded_dest_driver_batch_accept(&self->super, write_error->index - acked);
+      msg_error("MongoDB rejected document, dropping message",
+                evt_tag_int("code", write_error->code),
+                evt_tag_str("reason", write_error->errmsg),
+                evt_tag_str("driver", self->super.super.super.id));
+      log_threaded_dest_driver_batch_drop(&self->super, 1);
+      acked = write_error->index + 1;
+    }
+  log_threaded_dest_driver_batch_accept(&self->super, decision.processed - acked);
+
+  if (decision.malformed)
+    msg_error("Unexpected document index in MongoDB bulk reply",
+              evt_tag_int("index", decision.stopped_at.index),
+              evt_tag_str("driver", self->super.super.super.id));
+  else if (decision.result == WORKER_INSERT_RESULT_ERROR)
+    msg_error("MongoDB could not write document, retrying the rest of the batch",
+              evt_tag_int("code", decision.stopped_at.code),
+              evt_tag_str("reason", decision.stopped_at.errmsg),
+              evt_tag_int("time_reopen", self->super.time_reopen),
+              evt_tag_str("driver", self->super.super.super.id));
+
+  g_array_free(decision.rejected, TRUE);
+  return decision.result;
+}
+
+static worker_insert_result_t
+_worker_flush(LogThrDestDriver *s)
+{
+  MongoDBDestDriver *self = (MongoDBDestDriver *)s;
+  worker_insert_result_t result;
+  bson_t reply;
+  bson_error_t error;
+
+  if (!self->bulk_op)
+    return WORKER_INSERT_RESULT_NOT_CONNECTED;
+
+  if (mongoc_bulk_operation_execute(self->bulk_op, &reply, &error))
+    {
+      msg_debug("MongoDB bulk insert succeeded",
+                evt_tag_int("documents", self->super.batch.size),
+                evt_tag_str("driver", self->super.super.super.id));
+      result = WORKER_INSERT_RESULT_SUCCESS;
+    }
+  else if (error.domain == MONGOC_ERROR_COMMAND && bson_has_field(&reply, "writeErrors"))
+    {
+      result = _process_write_errors(self, &reply);
+    }
+  else
+    {
+      /* an ordered bulk operation stops at the first failure, the
+       * documents before it are already stored */
+      if (!self->bulk_unordered)
+        log_threaded_dest_driver_batch_accept(&self->super,
+                                              MIN(_get_int32_field(&reply, "nInserted", 0),
+                                                  self->super.batch.size));
+
+      msg_error(error.domain == MONGOC_ERROR_STREAM
+                ? "Network error while inserting into MongoDB"
+                : "Failed to insert into MongoDB",
+                evt_tag_int("unacknowledged", self->super.batch.size),
+                evt_tag_int("time_reopen", self->super.time_reopen),
+                evt_tag_str("reason", error.message),
+                evt_tag_str("driver", self->super.super.super.id));
+      result = error.domain == MONGOC_ERROR_STREAM ? WORKER_INSERT_RESULT_NOT_CONNECTED : WORKER_INSERT_RESULT_ERROR;
+    }
+
+  bson_destroy(&reply);
+  _destroy_bulk_operation(self);
+  return result;
+}
+
 gboolean
 afmongodb_dd_private_uri_init(LogDriver *d)
 {
@@ -470,6 +735,7 @@ afmongodb_dd_private_uri_init(LogDriver *d)
               evt_tag_str("uri", self->uri_str->str),
               evt_tag_str("db", self->const_db),
               evt_tag_str("collection", self->coll),
+              evt_tag_str("bulk", !self->bulk ? "no" : self->bulk_unordered ? "unordered" : "ordered"),
               evt_tag_str("driver", self->super.super.super.id));
 
   return TRUE;
@@ -498,6 +764,7 @@ _worker_thread_deinit(LogThrDestDriver *d)
       self->current_value = NULL;
     }
 
+  _destroy_bulk_operation(self);
   bson_destroy(self->bson);
   self->bson = NULL;
 }
@@ -533,6 +800,10 @@ _init(LogPipe *s)
   if (!afmongodb_dd_private_uri_init(&self->super.super.super))
     return FALSE;
 
+  if (!self->bulk && log_threaded_dest_driver_is_batching_configured(&self->super))
+    msg_warning("WARNING: batch-lines() and batch-timeout() only take effect with bulk(yes), inserting documents one by one",
+                evt_tag_str("driver", self->super.super.super.id));
+
   return log_threaded_dest_driver_start(s);
 }
 
@@ -591,6 +862,7 @@ afmongodb_dd_new(GlobalConfig *cfg)
   self->super.worker.thread_deinit = _worker_thread_deinit;
   self->super.worker.disconnect = _worker_disconnect;
   self->super.worker.insert = _worker_insert;
+  self->super.worker.flush = _worker_flush;
   self->super.format.stats_instance = _format_stats_instance;
   self->super.format.persist_name = _format_persist_name;
   self->super.stats_source = SCS_MONGODB;
@@ -33,6 +33,8 @@ LogDriver *afmongodb_dd_new(GlobalConfig *cfg);
 void afmongodb_dd_set_uri(LogDriver *d, const gchar *uri);
 void afmongodb_dd_set_collection(LogDriver *d, const gchar *collection);
 void afmongodb_dd_set_value_pairs(LogDriver *d, ValuePairs *vp);
+void afmongodb_dd_set_bulk(LogDriver *d, gboolean bulk);
+void afmongodb_dd_set_bulk_unordered(LogDriver *d, gboolean bulk_unordered);
 
 LogTemplateOptions *afmongodb_dd_get_template_options(LogDriver *s);
 
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "syslog-ng.h"
+#include "testutils.h"
+#include "modules/afmongodb/afmongodb-private.h"
+
+static MongoDBBulkReplyDecision decision;
+
+static void
+_evaluate(const gchar *json_reply, gint batch_size, gboolean unordered)
+{
+  bson_error_t error;
+  bson_t *reply = bson_new_from_json((const uint8_t *) json_reply, -1, &error);
+
+  g_assert(reply);
+  afmongodb_dd_evaluate_write_errors(reply, batch_size, unordered, &decision);
+  bson_destroy(reply);
+}
+
+static void
+_assert_rejected(guint count, const gint32 *indexes)
+{
+  guint i;
+
+  assert_gint(decision.rejected->len, count, "Rejected document count mismatch");
+  for (i = 0; i < count; i++)
+    assert_gint(g_array_index(decision.rejected, MongoDBWriteError, i).index, indexes[i],
+                "Rejected document index mismatch at %d", i);
+}
+
+static void
+_test_ordered_rejection(void)
+{
+  const gint32 rejected[] = { 2 };
+
+  testcase_begin("%s", __FUNCTION__);
+  _evaluate("{\"writeErrors\": [{\"index\": 2, \"code\": 11000, \"errmsg\": \"duplicate key\"}]}", 5, FALSE);
+
+  _assert_rejected(1, rejected);
+  assert_string(g_array_index(decision.rejected, MongoDBWriteError, 0).errmsg, "duplicate key",
+                "Error message mismatch");
+  assert_gint(decision.processed, 3, "The documents up to the rejected one should be processed");
+  assert_gint(decision.result, WORKER_INSERT_RESULT_REWIND,
+              "The documents after an ordered failure were not attempted and should be rewound");
+  assert_false(decision.malformed, "Reply should not be malformed");
+  testcase_end();
+}
+
+static void
+_test_unordered_rejections(void)
+{
+  const gint32 rejected[] = { 1, 3 };
+
+  testcase_begin("%s", __FUNCTION__);
+  _evaluate("{\"writeErrors\": [{\"index\": 1, \"code\": 11000, \"errmsg\": \"duplicate key\"},"
+            "                   {\"index\": 3, \"code\": 121, \"errmsg\": \"validation failed\"}]}", 5, TRUE);
+
+  _assert_rejected(2, rejected);
+  assert_gint(decision.processed, 4, "The documents up to the last rejected one should be processed");
+  assert_gint(decision.result, WORKER_INSERT_RESULT_SUCCESS,
+              "The documents after the last unordered failure should be stored");
+  assert_false(decision.malformed, "Reply should not be malformed");
+  testcase_end();
+}
+
+static void
+_test_transient_error(void)
+{
+  const gint32 rejected[] = { 1 };
+
+  testcase_begin("%s", __FUNCTION__);
+  _evaluate("{\"writeErrors\": [{\"index\": 1, \"code\": 11000, \"errmsg\": \"duplicate key\"},"
+            "                   {\"index\": 2, \"code\": 10107, \"errmsg\": \"not master\"},"
+            "                   {\"index\": 4, \"code\": 11000, \"errmsg\": \"duplicate key\"}]}", 5, TRUE);
+
+  _assert_rejected(1, rejected);
+  assert_gint(decision.processed, 2, "The transient failure should not be processed");
+  assert_gint(decision.result, WORKER_INSERT_RESULT_ERROR, "The rest of the batch should be retried");
+  assert_false(decision.malformed, "Reply should not be malformed");
+  assert_gint(decision.stopped_at.code, 10107, "The transient error should be reported");
+  assert_gint(decision.stopped_at.index, 2, "The transient error should be reported");
+  testcase_end();
+}
+
+static void
+_test_out_of_range_index(void)
+{
+  const gint32 rejected[] = { 3 };
+
+  testcase_begin("%s", __FUNCTION__);
+  _evaluate("{\"writeErrors\": [{\"index\": 5, \"code\": 11000, \"errmsg\": \"duplicate key\"}]}", 5, FALSE);
+  _assert_rejected(0, NULL);
+  assert_gint(decision.processed, 0, "Nothing should be processed after an index past the batch");
+  assert_gint(decision.result, WORKER_INSERT_RESULT_ERROR, "Index past the batch should be an error");
+  assert_true(decision.malformed, "Index past the batch should make the reply malformed");
+  assert_gint(decision.stopped_at.index, 5, "The offending index should be reported");
+
+  _evaluate("{\"writeErrors\": [{\"index\": 3, \"code\": 11000, \"errmsg\": \"duplicate key\"},"
+            "                   {\"index\": 1, \"code\": 11000, \"errmsg\": \"duplicate key\"}]}", 5, TRUE);
+  _assert_rejected(1, rejected);
+  assert_gint(decision.processed, 4, "The documents before a decreasing index should be processed");
+  assert_gint(decision.result, WORKER_INSERT_RESULT_ERROR, "Decreasing index should be an error");
+  assert_true(decision.malformed, "Decreasing index should make the reply malformed");
+  assert_gint(decision.stopped_at.index, 1, "The offending index should be reported");
+
+  _evaluate("{\"writeErrors\": [{\"code\": 11000, \"errmsg\": \"duplicate key\"}]}", 5, FALSE);
+  assert_gint(decision.result, WORKER_INSERT_RESULT_ERROR, "Missing index should be an error");
+  assert_true(decision.malformed, "Missing index should make the reply malformed");
+  testcase_end();
+}
+
+static void
+_test_missing_write_errors(void)
+{
+  testcase_begin("%s", __FUNCTION__);
+  _evaluate("{\"nInserted\": 2}", 5, FALSE);
+  _assert_rejected(0, NULL);
+  assert_gint(decision.processed, 0, "Nothing should be processed without writeErrors");
+  assert_gint(decision.result, WORKER_INSERT_RESULT_ERROR, "Missing writeErrors should be an error");
+  assert_true(decision.malformed, "Missing writeErrors should make the reply malformed");
+  testcase_end();
+}
+
+int
+main(int argc, char **argv)
+{
+  decision.rejected = g_array_new(FALSE, FALSE, sizeof(MongoDBWriteError));
+
+  _test_ordered_rejection();
+  _test_unordered_rejections();
+  _test_transient_error();
+  _test_out_of_range_index();
+  _test_missing_write_errors();
+
+  g_array_free(decision.rejected, TRUE);
+  return 0;
+}
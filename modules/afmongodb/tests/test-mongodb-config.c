@@ -187,6 +187,19 @@ _test_uri_error(void)
                        " uri='mongodb://127.0.0.1:27017/'");
 }
 
+static void
+_test_bulk(void)
+{
+  _execute_correct("bulk_default", _execute_find_text_in_log, "collection='messages', bulk='no'");
+
+  afmongodb_dd_set_bulk(mongodb, TRUE);
+  _execute_correct("bulk_ordered", _execute_find_text_in_log, "collection='messages', bulk='ordered'");
+
+  afmongodb_dd_set_bulk(mongodb, TRUE);
+  afmongodb_dd_set_bulk_unordered(mongodb, TRUE);
+  _execute_correct("bulk_unordered", _execute_find_text_in_log, "collection='messages', bulk='unordered'");
+}
+
 #if SYSLOG_NG_ENABLE_LEGACY_MONGODB_OPTIONS
 #define UNSAFEOPTS "?w=0&safe=false&socketTimeoutMS=60000&connectTimeoutMS=60000"
 
@@ -337,6 +350,7 @@ main(int argc, char **argv)
   _test_stats_name();
   _test_uri_correct();
   _test_uri_error();
+  _test_bulk();
 
 #if SYSLOG_NG_ENABLE_LEGACY_MONGODB_OPTIONS
   _test_legacy_correct();
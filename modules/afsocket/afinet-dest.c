@@ -26,6 +26,7 @@
 #include "socket-options-inet.h"
 #include "messages.h"
 #include "gprocess.h"
+#include "stats/stats-registry.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -195,19 +196,39 @@ afinet_dd_get_dest_name(AFSocketDestDriver *s)
   return buf;
 }
 
+static gchar *
+afinet_dd_format_tls_stats_instance(AFInetDestDriver *self)
+{
+  static gchar buf[256];
+
+  g_snprintf(buf, sizeof(buf), "%s,%s", self->super.transport_mapper->transport, afsocket_dd_get_dest_name(&self->super));
+  return buf;
+}
+
 static gboolean
 afinet_dd_init(LogPipe *s)
 {
   AFInetDestDriver *self G_GNUC_UNUSED = (AFInetDestDriver *) s;
+  TransportMapperInet *transport_mapper_inet = (TransportMapperInet *) self->super.transport_mapper;
 
 #if SYSLOG_NG_ENABLE_SPOOF_SOURCE
   if (self->spoof_source)
     self->super.connections_kept_alive_accross_reloads = TRUE;
 #endif
 
+  if (transport_mapper_inet->tls_context &&
+      !tls_context_setup_context(transport_mapper_inet->tls_context, afinet_dd_format_tls_stats_instance(self)))
+    return FALSE;
+
   if (!afsocket_dd_init(s))
     return FALSE;
 
+  if (transport_mapper_inet->tls_context)
+    tls_context_register_stats(transport_mapper_inet->tls_context, STATS_LEVEL1,
+                               self->super.transport_mapper->stats_source | SCS_DESTINATION,
+                               self->super.super.super.id,
+                               afinet_dd_format_tls_stats_instance(self));
+
 #if SYSLOG_NG_ENABLE_SPOOF_SOURCE
   if (self->super.transport_mapper->sock_type == SOCK_DGRAM)
     {
@@ -232,6 +253,20 @@ afinet_dd_init(LogPipe *s)
   return TRUE;
 }
 
+static gboolean
+afinet_dd_deinit(LogPipe *s)
+{
+  AFInetDestDriver *self = (AFInetDestDriver *) s;
+  TransportMapperInet *transport_mapper_inet = (TransportMapperInet *) self->super.transport_mapper;
+
+  if (transport_mapper_inet->tls_context)
+    tls_context_unregister_stats(transport_mapper_inet->tls_context,
+                                 self->super.transport_mapper->stats_source | SCS_DESTINATION,
+                                 self->super.super.super.id,
+                                 afinet_dd_format_tls_stats_instance(self));
+  return afsocket_dd_deinit(s);
+}
+
 #if SYSLOG_NG_ENABLE_SPOOF_SOURCE
 static gboolean
 afinet_dd_construct_ipv4_packet(AFInetDestDriver *self, LogMessage *msg, GString *msg_line)
@@ -432,6 +467,7 @@ afinet_dd_new_instance(TransportMapper *transport_mapper, gchar *hostname, Globa
 
   afsocket_dd_init_instance(&self->super, socket_options_inet_new(), transport_mapper, cfg);
   self->super.super.super.super.init = afinet_dd_init;
+  self->super.super.super.super.deinit = afinet_dd_deinit;
   self->super.super.super.super.queue = afinet_dd_queue;
   self->super.super.super.super.free_fn = afinet_dd_free;
   self->super.construct_writer = afinet_dd_construct_writer;
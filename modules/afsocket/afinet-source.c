@@ -25,6 +25,8 @@
 #include "messages.h"
 #include "transport-mapper-inet.h"
 #include "socket-options-inet.h"
+#include "gsockaddr.h"
+#include "stats/stats-registry.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -62,10 +64,22 @@ afinet_sd_set_tls_context(LogDriver *s, TLSContext *tls_context)
   transport_mapper_inet_set_tls_context((TransportMapperInet *) self->super.transport_mapper, tls_context, NULL, NULL);
 }
 
+static gchar *
+afinet_sd_format_tls_stats_instance(AFInetSourceDriver *self)
+{
+  static gchar buf[256];
+  gchar addr[MAX_SOCKADDR_STRING];
+
+  g_snprintf(buf, sizeof(buf), "%s,%s", self->super.transport_mapper->transport,
+             g_sockaddr_format(self->super.bind_addr, addr, sizeof(addr), GSA_FULL));
+  return buf;
+}
+
 static gboolean
 afinet_sd_setup_addresses(AFSocketSourceDriver *s)
 {
   AFInetSourceDriver *self = (AFInetSourceDriver *) s;
+  TransportMapperInet *transport_mapper_inet = (TransportMapperInet *) self->super.transport_mapper;
 
   if (!afsocket_sd_setup_addresses_method(s))
     return FALSE;
@@ -89,6 +103,12 @@ afinet_sd_setup_addresses(AFSocketSourceDriver *s)
   else
     g_sockaddr_set_port(self->super.bind_addr, afinet_lookup_service(self->super.transport_mapper, self->bind_port));
 
+  /* the TLS context is named after the listener, so set it up once its
+   * address is known, but before it starts accepting connections */
+  if (transport_mapper_inet->tls_context &&
+      !tls_context_setup_context(transport_mapper_inet->tls_context, afinet_sd_format_tls_stats_instance(self)))
+    return FALSE;
+
   return TRUE;
 }
 
@@ -96,13 +116,33 @@ gboolean
 afinet_sd_init(LogPipe *s)
 {
   AFInetSourceDriver *self = (AFInetSourceDriver *) s;
+  TransportMapperInet *transport_mapper_inet = (TransportMapperInet *) self->super.transport_mapper;
 
   if (!afsocket_sd_init_method(&self->super.super.super.super))
     return FALSE;
 
+  if (transport_mapper_inet->tls_context)
+    tls_context_register_stats(transport_mapper_inet->tls_context, STATS_LEVEL1,
+                               self->super.transport_mapper->stats_source | SCS_SOURCE,
+                               self->super.super.super.id,
+                               afinet_sd_format_tls_stats_instance(self));
   return TRUE;
 }
 
+static gboolean
+afinet_sd_deinit(LogPipe *s)
+{
+  AFInetSourceDriver *self = (AFInetSourceDriver *) s;
+  TransportMapperInet *transport_mapper_inet = (TransportMapperInet *) self->super.transport_mapper;
+
+  if (transport_mapper_inet->tls_context)
+    tls_context_unregister_stats(transport_mapper_inet->tls_context,
+                                 self->super.transport_mapper->stats_source | SCS_SOURCE,
+                                 self->super.super.super.id,
+                                 afinet_sd_format_tls_stats_instance(self));
+  return afsocket_sd_deinit_method(s);
+}
+
 void
 afinet_sd_free(LogPipe *s)
 {
@@ -123,6 +163,7 @@ afinet_sd_new_instance(TransportMapper *transport_mapper, GlobalConfig *cfg)
                             transport_mapper,
                             cfg);
   self->super.super.super.super.init = afinet_sd_init;
+  self->super.super.super.super.deinit = afinet_sd_deinit;
   self->super.super.super.super.free_fn = afinet_sd_free;
   self->super.setup_addresses = afinet_sd_setup_addresses;
   return self;
@@ -84,6 +84,7 @@ void afsocket_dd_init_instance(AFSocketDestDriver *self, SocketOptions *socket_o
 LogTransport *afsocket_dd_construct_transport_method(AFSocketDestDriver *self, gint fd);
 
 gboolean afsocket_dd_init(LogPipe *s);
+gboolean afsocket_dd_deinit(LogPipe *s);
 void afsocket_dd_free(LogPipe *s);
 
 #endif
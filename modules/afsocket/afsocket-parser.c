@@ -52,6 +52,10 @@ static CfgLexerKeyword afsocket_keywords[] = {
   { "trusted_dn",         KW_TRUSTED_DN },
   { "cipher_suite",       KW_CIPHER_SUITE },
   { "ssl_options",        KW_SSL_OPTIONS },
+  { "session_tickets",    KW_SESSION_TICKETS },
+  { "session_ticket_key_file", KW_SESSION_TICKET_KEY_FILE },
+  { "session_cache_size", KW_SESSION_CACHE_SIZE },
+  { "session_timeout",    KW_SESSION_TIMEOUT },
 
   { "localip",            KW_LOCALIP },
   { "ip",                 KW_IP },
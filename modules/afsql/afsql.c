@@ -260,6 +260,14 @@ afsql_dd_run_query(AFSqlDestDriver *self, const gchar *query, gboolean silent, d
   return TRUE;
 }
 
+static void
+afsql_dd_discard_pending_rows(AFSqlDestDriver *self)
+{
+  g_string_truncate(self->pending_insert, 0);
+  g_string_truncate(self->pending_table, 0);
+  self->pending_rows = 0;
+}
+
 /**
  * afsql_dd_handle_transaction_error:
  *
@@ -272,6 +280,52 @@ afsql_dd_handle_transaction_error(AFSqlDestDriver *self)
 {
   log_queue_rewind_backlog_all(self->queue);
   self->flush_lines_queued = 0;
+  afsql_dd_discard_pending_rows(self);
+}
+
+/**
+ * afsql_dd_handle_multi_row_insert_error:
+ *
+ * A multi-row INSERT fails as a whole when any of its rows is rejected.
+ * The @rows of the transaction are rewound and replayed one row per
+ * statement, so that only the rejected row counts towards num_retries and
+ * gets dropped.
+ *
+ * NOTE: This function can only be called from the database thread.
+ **/
+static void
+afsql_dd_handle_multi_row_insert_error(AFSqlDestDriver *self, gint rows)
+{
+  msg_error("SQL multi-row INSERT failed, rewinding backlog and replaying it one row at a time",
+            evt_tag_int("rows", rows));
+  afsql_dd_handle_transaction_error(self);
+  self->single_row_replay = rows;
+}
+
+/**
+ * afsql_dd_flush_pending_rows:
+ *
+ * Execute the multi-row INSERT statement collected so far.
+ *
+ * NOTE: This function can only be called from the database thread.
+ **/
+static gboolean
+afsql_dd_flush_pending_rows(AFSqlDestDriver *self)
+{
+  gboolean success;
+
+  if (self->pending_rows == 0)
+    return TRUE;
+
+  success = afsql_dd_run_query(self, self->pending_insert->str, FALSE, NULL);
+
+  msg_debug("Multi-row SQL INSERT executed",
+            evt_tag_str("table", self->pending_table->str),
+            evt_tag_int("rows", self->pending_rows),
+            evt_tag_int("success", success));
+
+  afsql_dd_discard_pending_rows(self);
+  return success;
 }
 
 /**
@@ -289,6 +343,12 @@ afsql_dd_commit_transaction(AFSqlDestDriver *self)
  if (!self->transaction_active)
     return TRUE;
 
+  if (!afsql_dd_flush_pending_rows(self))
+    {
+      afsql_dd_handle_multi_row_insert_error(self, self->flush_lines_queued);
+      return FALSE;
+    }
+
   success = afsql_dd_run_query(self, "COMMIT", FALSE, NULL);
   if (success)
     {
@@ -340,6 +400,7 @@ afsql_dd_rollback_transaction(AFSqlDestDriver *self)
     return TRUE;
 
   self->transaction_active = FALSE;
+  afsql_dd_discard_pending_rows(self);
 
   return afsql_dd_run_query(self, "ROLLBACK", FALSE, NULL);
 }
@@ -671,6 +732,7 @@ afsql_dd_disconnect(AFSqlDestDriver *self)
   dbi_conn_close(self->dbi_ctx);
   self->dbi_ctx = NULL;
   g_hash_table_remove_all(self->syslogng_conform_tables);
+  afsql_dd_discard_pending_rows(self);
 }
 
 static void
@@ -777,72 +839,131 @@ afsql_dd_ensure_accessible_database_table(AFSqlDestDriver *self, LogMessage *msg
   return table;
 }
 
-static GString *
-afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+static inline gboolean
+_is_field_inserted(AFSqlField *field)
 {
-  GString *insert_command = g_string_sized_new(256);
-  GString *value = g_string_sized_new(512);
-  gint i, j;
+  return (field->flags & AFSQL_FF_DEFAULT) == 0 && field->value != NULL;
+}
+
+static void
+afsql_dd_append_insert_header(AFSqlDestDriver *self, GString *insert_command, const gchar *table)
+{
+  gboolean first = TRUE;
+  gint i;
 
-  g_string_printf(insert_command, "INSERT INTO %s (", table->str);
+  g_string_append_printf(insert_command, "INSERT INTO %s (", table);
 
   for (i = 0; i < self->fields_len; i++)
     {
-      if ((self->fields[i].flags & AFSQL_FF_DEFAULT) == 0 && self->fields[i].value != NULL)
-        {
-           g_string_append(insert_command, self->fields[i].name);
+      if (!_is_field_inserted(&self->fields[i]))
+        continue;
 
-           j = i + 1;
-           while (j < self->fields_len && (self->fields[j].flags & AFSQL_FF_DEFAULT) == AFSQL_FF_DEFAULT)
-             j++;
-
-           if (j < self->fields_len)
-             g_string_append(insert_command, ", ");
-        }
+      if (!first)
+        g_string_append(insert_command, ", ");
+      g_string_append(insert_command, self->fields[i].name);
+      first = FALSE;
     }
 
-  g_string_append(insert_command, ") VALUES (");
+  g_string_append(insert_command, ") VALUES ");
+}
+
+static void
+afsql_dd_append_insert_values(AFSqlDestDriver *self, GString *insert_command, LogMessage *msg, GString *value)
+{
+  gboolean first = TRUE;
+  gint i;
 
+  g_string_append_c(insert_command, '(');
   for (i = 0; i < self->fields_len; i++)
     {
       gchar *quoted;
 
-      if ((self->fields[i].flags & AFSQL_FF_DEFAULT) == 0 && self->fields[i].value != NULL)
+      if (!_is_field_inserted(&self->fields[i]))
+        continue;
+
+      if (!first)
+        g_string_append(insert_command, ", ");
+      first = FALSE;
+
+      log_template_format(self->fields[i].value, msg, &self->template_options, LTZ_SEND, self->seq_num, NULL, value);
+      if (self->null_value && strcmp(self->null_value, value->str) == 0)
+        {
+          g_string_append(insert_command, "NULL");
+        }
+      else
         {
-          log_template_format(self->fields[i].value, msg, &self->template_options, LTZ_SEND, self->seq_num, NULL, value);
-          if (self->null_value && strcmp(self->null_value, value->str) == 0)
+          dbi_conn_quote_string_copy(self->dbi_ctx, value->str, &quoted);
+          if (quoted)
             {
-              g_string_append(insert_command, "NULL");
+              g_string_append(insert_command, quoted);
+              free(quoted);
             }
           else
             {
-              dbi_conn_quote_string_copy(self->dbi_ctx, value->str, &quoted);
-              if (quoted)
-                {
-                  g_string_append(insert_command, quoted);
-                  free(quoted);
-                }
-              else
-                {
-                 g_string_append(insert_command, "''");
-                }
+             g_string_append(insert_command, "''");
             }
-
-          j = i + 1;
-          while (j < self->fields_len && (self->fields[j].flags & AFSQL_FF_DEFAULT) == AFSQL_FF_DEFAULT)
-            j++;
-          if (j < self->fields_len)
-            g_string_append(insert_command, ", ");
         }
     }
+  g_string_append_c(insert_command, ')');
+}
 
-  g_string_append(insert_command, ")");
+static GString *
+afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+{
+  GString *insert_command = g_string_sized_new(256);
+  GString *value = g_string_sized_new(512);
+
+  afsql_dd_append_insert_header(self, insert_command, table->str);
+  afsql_dd_append_insert_values(self, insert_command, msg, value);
 
   g_string_free(value, TRUE);
 
   return insert_command;
 }
 
+/**
+ * afsql_dd_append_pending_row:
+ *
+ * Add the values of @msg to the multi-row INSERT statement, the statement
+ * is executed when the transaction is committed.  Rows for a different
+ * table start a new statement.
+ *
+ * NOTE: This function can only be called from the database thread.
+ **/
+static gboolean
+afsql_dd_append_pending_row(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+{
+  GString *value;
+
+  if (self->pending_rows > 0 && strcmp(self->pending_table->str, table->str) != 0)
+    {
+      if (!afsql_dd_flush_pending_rows(self))
+        {
+          afsql_dd_rollback_transaction(self);
+          /* @msg is already on the backlog, it is rewound and replayed as well */
+          afsql_dd_handle_multi_row_insert_error(self, self->flush_lines_queued + 1);
+          return FALSE;
+        }
+    }
+
+  if (self->pending_rows == 0)
+    {
+      g_string_assign(self->pending_table, table->str);
+      afsql_dd_append_insert_header(self, self->pending_insert, table->str);
+    }
+  else
+    {
+      g_string_append(self->pending_insert, ", ");
+    }
+
+  value = g_string_sized_new(256);
+  afsql_dd_append_insert_values(self, self->pending_insert, msg, value);
+  g_string_free(value, TRUE);
+
+  self->pending_rows++;
+  return TRUE;
+}
+
 static inline gboolean
 afsql_dd_is_transaction_handling_enabled(const AFSqlDestDriver *self)
 {
@@ -922,6 +1043,7 @@ afsql_dd_insert_db(AFSqlDestDriver *self)
   GString *insert_command = NULL;
   LogMessage *msg;
   gboolean success = TRUE;
+  gboolean multi_row = (self->flags & AFSQL_DDF_MULTI_ROW_INSERT) && self->single_row_replay == 0;
   LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
 
   if (!afsql_dd_ensure_initialized_connection(self))
@@ -948,8 +1070,15 @@ afsql_dd_insert_db(AFSqlDestDriver *self)
       goto out;
     }
 
-  insert_command = afsql_dd_build_insert_command(self, msg, table);
-  success = afsql_dd_run_query(self, insert_command->str, FALSE, NULL);
+  if (multi_row)
+    {
+      success = afsql_dd_append_pending_row(self, msg, table);
+    }
+  else
+    {
+      insert_command = afsql_dd_build_insert_command(self, msg, table);
+      success = afsql_dd_run_query(self, insert_command->str, FALSE, NULL);
+    }
 
   if (success && self->flush_lines_queued != -1)
     {
@@ -960,9 +1089,6 @@ afsql_dd_insert_db(AFSqlDestDriver *self)
           /* Assuming that in case of error, the queue is rewound by afsql_dd_commit_transaction() */
           afsql_dd_rollback_transaction(self);
 
-          g_string_free(insert_command, TRUE);
-          msg_set_context(NULL);
-
           success = FALSE;
         }
     }
@@ -983,6 +1109,15 @@ afsql_dd_insert_db(AFSqlDestDriver *self)
       log_msg_unref(msg);
       step_sequence_number(&self->seq_num);
       self->failed_message_counter = 0;
+      if (!multi_row && self->single_row_replay > 0)
+        self->single_row_replay--;
+    }
+  else if (multi_row && self->single_row_replay > 0)
+    {
+      /* the multi-row INSERT failed and its rows are replayed one by one,
+       * this is not a failed attempt of @msg */
+      if (!afsql_dd_handle_insert_row_error_depending_on_connection_availability(self, msg, &path_options))
+        return FALSE;
     }
   else
     {
@@ -1000,6 +1135,8 @@ afsql_dd_insert_db(AFSqlDestDriver *self)
           stats_counter_inc(self->dropped_messages);
           log_msg_drop(msg, &path_options, AT_PROCESSED);
           self->failed_message_counter = 0;
+          if (!multi_row && self->single_row_replay > 0)
+            self->single_row_replay--;
           success = TRUE;
         }
     }
@@ -1274,6 +1411,22 @@ afsql_dd_init(LogPipe *s)
   if ((self->flags & AFSQL_DDF_EXPLICIT_COMMITS) && (self->flush_lines > 0 || self->flush_timeout > 0))
     self->flush_lines_queued = 0;
 
+  if (self->flags & AFSQL_DDF_MULTI_ROW_INSERT)
+    {
+      if (self->flush_lines_queued == -1)
+        {
+          msg_warning("WARNING: The multi-row-insert flag requires explicit-commits and flush-lines(), falling back to single-row INSERTs",
+                      evt_tag_str("driver", self->super.super.id));
+          self->flags &= ~AFSQL_DDF_MULTI_ROW_INSERT;
+        }
+      else if (strcmp(self->type, s_oracle) == 0)
+        {
+          msg_warning("WARNING: Oracle does not support multi-row INSERT statements, falling back to single-row INSERTs",
+                      evt_tag_str("driver", self->super.super.id));
+          self->flags &= ~AFSQL_DDF_MULTI_ROW_INSERT;
+        }
+    }
+
   if (!dbi_initialized)
     {
       errno = 0;
@@ -1379,6 +1532,8 @@ afsql_dd_free(LogPipe *s)
   g_hash_table_destroy(self->dbd_options_numeric);
   if (self->session_statements)
     string_list_free(self->session_statements);
+  g_string_free(self->pending_insert, TRUE);
+  g_string_free(self->pending_table, TRUE);
   g_mutex_free(self->db_thread_mutex);
   g_cond_free(self->db_thread_wakeup_cond);
   log_dest_driver_free(s);
@@ -1419,6 +1574,9 @@ afsql_dd_new(GlobalConfig *cfg)
   self->dbd_options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
   self->dbd_options_numeric = g_hash_table_new_full(g_str_hash, g_int_equal, g_free, NULL);
 
+  self->pending_insert = g_string_sized_new(1024);
+  self->pending_table = g_string_sized_new(32);
+
   log_template_options_defaults(&self->template_options);
 
   self->db_thread_wakeup_cond = g_cond_new();
@@ -1435,6 +1593,8 @@ afsql_dd_lookup_flag(const gchar *flag)
     return AFSQL_DDF_EXPLICIT_COMMITS;
   else if (strcmp(flag, "dont-create-tables") == 0 || strcmp(flag, "dont_create_tables") == 0)
     return AFSQL_DDF_DONT_CREATE_TABLES;
+  else if (strcmp(flag, "multi-row-insert") == 0 || strcmp(flag, "multi_row_insert") == 0)
+    return AFSQL_DDF_MULTI_ROW_INSERT;
   else
     msg_warning("Unknown SQL flag",
                 evt_tag_str("flag", flag));
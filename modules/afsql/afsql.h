@@ -46,6 +46,7 @@ enum
 {
   AFSQL_DDF_EXPLICIT_COMMITS = 0x0001,
   AFSQL_DDF_DONT_CREATE_TABLES = 0x0002,
+  AFSQL_DDF_MULTI_ROW_INSERT = 0x0004,
 };
 
 typedef struct _AFSqlField
@@ -115,6 +116,14 @@ typedef struct _AFSqlDestDriver
   guint32 failed_message_counter;
   WorkerOptions worker_options;
   gboolean transaction_active;
+  /* multi-row INSERT statement being built, executed before COMMIT or
+   * when the destination table changes */
+  GString *pending_insert;
+  GString *pending_table;
+  gint pending_rows;
+  /* number of rows of a failed multi-row INSERT still to be replayed one
+   * row per statement */
+  gint single_row_replay;
 } AFSqlDestDriver;
 
 
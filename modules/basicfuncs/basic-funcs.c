@@ -80,6 +80,7 @@ static Plugin basicfuncs_plugins[] =
 
   /* misc funcs */
   TEMPLATE_FUNCTION_PLUGIN(tf_context_length, "context-length"),
+  TEMPLATE_FUNCTION_PLUGIN(tf_distinct_count, "distinct-count"),
   TEMPLATE_FUNCTION_PLUGIN(tf_env, "env"),
   TEMPLATE_FUNCTION_PLUGIN(tf_template, "template")
 };
@@ -44,6 +44,50 @@ TEMPLATE_FUNCTION(NULL, tf_context_length,
                   tf_context_length_prepare, NULL, tf_context_length_call,
                   tf_context_length_free_state, NULL);
 
+static gboolean
+tf_distinct_count_prepare(LogTemplateFunction *self, gpointer s, LogTemplate *parent,
+                          gint argc, gchar *argv[], GError **error)
+{
+  g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+  if (argc != 2)
+    {
+      g_set_error(error, LOG_TEMPLATE_ERROR, LOG_TEMPLATE_ERROR_COMPILE,
+                  "$(%s) requires only one argument", argv[0]);
+      return FALSE;
+    }
+
+  return tf_simple_func_prepare(self, s, parent, argc, argv, error);
+}
+
+/* counts the distinct, non-empty values of its argument in the context */
+static void
+tf_distinct_count_call(LogTemplateFunction *self, gpointer s,
+                       const LogTemplateInvokeArgs *args, GString *result)
+{
+  TFSimpleFuncState *state = (TFSimpleFuncState *) s;
+  GHashTable *values = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  GString *value = g_string_sized_new(64);
+  gint i;
+
+  for (i = 0; i < args->num_messages; i++)
+    {
+      g_string_truncate(value, 0);
+      log_template_format(state->argv[0], args->messages[i], args->opts, args->tz,
+                          args->seq_num, args->context_id, value);
+      if (value->len > 0)
+        g_hash_table_insert(values, g_strndup(value->str, value->len), NULL);
+    }
+
+  g_string_append_printf(result, "%d", g_hash_table_size(values));
+  g_string_free(value, TRUE);
+  g_hash_table_destroy(values);
+}
+
+TEMPLATE_FUNCTION(TFSimpleFuncState, tf_distinct_count,
+                  tf_distinct_count_prepare, NULL, tf_distinct_count_call,
+                  tf_simple_func_free_state, NULL);
+
 static void
 tf_env(LogMessage *msg, gint argc, GString *argv[], GString *result)
 {
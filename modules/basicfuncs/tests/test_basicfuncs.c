@@ -240,6 +240,19 @@ test_numeric_aggregate_funcs(void)
   test_numeric_aggregate_full_invalid_values();
 }
 
+void
+test_distinct_count(void)
+{
+  _test_macros_with_context(
+      "VALUE", (const gchar *[]) { "foo", "bar", "foo", "", "baz", "bar", NULL },
+      (const MacroAndResult[])
+      {
+        { "$(distinct-count ${VALUE})", "3" },
+        { "$(distinct-count ${NONEXISTENT})", "0" },
+        { }
+      });
+}
+
 void
 test_misc_funcs(void)
 {
@@ -269,6 +282,7 @@ main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
   test_str_funcs();
   test_numeric_funcs();
   test_numeric_aggregate_funcs();
+  test_distinct_count();
   test_misc_funcs();
   test_tf_template();
 
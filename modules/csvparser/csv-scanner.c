@@ -26,10 +26,39 @@
 
 #include <string.h>
 
+#define CSV_CHAR_DELIMITER        0x01
+#define CSV_CHAR_STRING_DELIMITER 0x02
+#define CSV_CHAR_QUOTE            0x04
+
 /************************************************************************
  * CSVScannerOptions
  ************************************************************************/
 
+/*
+ * Characters that may end an unquoted run are marked in a lookup table,
+ * so the scanner can skip over ordinary characters with a single table
+ * lookup each, instead of searching the delimiter and quote sets.
+ */
+static void
+_update_char_classes(CSVScannerOptions *options)
+{
+  const gchar *p;
+  GList *l;
+
+  memset(options->char_classes, 0, sizeof(options->char_classes));
+  for (p = options->delimiters; p && *p; p++)
+    options->char_classes[(guchar) *p] |= CSV_CHAR_DELIMITER;
+  for (l = options->string_delimiters; l; l = l->next)
+    {
+      const gchar *delimiter = (const gchar *) l->data;
+
+      if (delimiter[0])
+        options->char_classes[(guchar) delimiter[0]] |= CSV_CHAR_STRING_DELIMITER;
+    }
+  for (p = options->quotes_start; p && *p; p++)
+    options->char_classes[(guchar) *p] |= CSV_CHAR_QUOTE;
+}
+
 void
 csv_scanner_options_set_flags(CSVScannerOptions *options, guint32 flags)
 {
@@ -54,6 +83,7 @@ csv_scanner_options_set_delimiters(CSVScannerOptions *options, const gchar *deli
 {
   g_free(options->delimiters);
   options->delimiters = g_strdup(delimiters);
+  _update_char_classes(options);
 }
 
 void
@@ -61,6 +91,7 @@ csv_scanner_options_set_string_delimiters(CSVScannerOptions *options, GList *str
 {
   string_list_free(options->string_delimiters);
   options->string_delimiters = string_delimiters;
+  _update_char_classes(options);
 }
 
 void
@@ -70,6 +101,7 @@ csv_scanner_options_set_quotes_start_and_end(CSVScannerOptions *options, const g
   g_free(options->quotes_end);
   options->quotes_start = g_strdup(quotes_start);
   options->quotes_end = g_strdup(quotes_end);
+  _update_char_classes(options);
 }
 
 void
@@ -96,6 +128,7 @@ csv_scanner_options_set_quote_pairs(CSVScannerOptions *options, const gchar *quo
     }
   options->quotes_start[i / 2] = 0;
   options->quotes_end[i / 2] = 0;
+  _update_char_classes(options);
 }
 
 
@@ -133,27 +166,92 @@ csv_scanner_options_clean(CSVScannerOptions *options)
  * CSVScanner
  ************************************************************************/
 
-static gboolean
+static inline gboolean
 _is_whitespace_char(const gchar *str)
 {
   return (*str == ' ' || *str == '\t');
 }
 
 static void
-_skip_whitespace(const gchar **src)
+_skip_whitespace(CSVScanner *self)
+{
+  while (self->src < self->src_end && _is_whitespace_char(self->src))
+    self->src++;
+}
+
+static inline gboolean
+_has_more_input(CSVScanner *self)
+{
+  return self->src && self->src < self->src_end;
+}
+
+/*
+ * The current value is a slice of the input as long as it consists of a
+ * single contiguous run of characters, it is only copied into a scratch
+ * buffer if an escape sequence or quote character breaks it up.
+ */
+static void
+_reset_value(CSVScanner *self)
+{
+  self->current_value = self->src;
+  self->current_value_len = 0;
+  self->current_value_copied = FALSE;
+}
+
+static GString *
+_get_value_buffer(CSVScanner *self)
+{
+  if (!self->value_buffer)
+    self->value_buffer = sb_gstring_acquire();
+  return sb_gstring_string(self->value_buffer);
+}
+
+static void
+_append_to_value(CSVScanner *self, const gchar *chars, gsize len)
+{
+  GString *buffer;
+
+  if (len == 0)
+    return;
+
+  if (!self->current_value_copied)
+    {
+      if (self->current_value_len == 0)
+        self->current_value = chars;
+
+      if (self->current_value + self->current_value_len == chars)
+        {
+          self->current_value_len += len;
+          return;
+        }
+
+      buffer = _get_value_buffer(self);
+      g_string_assign_len(buffer, self->current_value, self->current_value_len);
+      self->current_value_copied = TRUE;
+    }
+
+  buffer = _get_value_buffer(self);
+  g_string_append_len(buffer, chars, len);
+  self->current_value = buffer->str;
+  self->current_value_len = buffer->len;
+}
+
+static void
+_truncate_value(CSVScanner *self, gsize len)
 {
-  while (_is_whitespace_char(*src))
-    (*src)++;
+  if (self->current_value_copied)
+    g_string_truncate(sb_gstring_string(self->value_buffer), len);
+  self->current_value_len = len;
 }
 
 static void
 _switch_to_next_column(CSVScanner *self)
 {
-  if (!self->current_column && self->src && self->src[0])
+  if (!self->current_column && _has_more_input(self))
     self->current_column = self->options->columns;
   else if (self->current_column)
     self->current_column = self->current_column->next;
-  g_string_truncate(self->current_value, 0);
+  _reset_value(self);
 }
 
 static gboolean
@@ -171,19 +269,19 @@ _is_at_the_end_of_columns(CSVScanner *self)
 static void
 _parse_opening_quote_character(CSVScanner *self)
 {
-  gchar *quote = _strchr_optimized_for_single_char_haystack(self->options->quotes_start, *self->src);
+  gchar *quote;
 
-  if (quote != NULL)
-    {
-      /* ok, quote character found */
-      self->src++;
-      self->current_quote = self->options->quotes_end[quote - self->options->quotes_start];
-    }
-  else
+  if ((self->options->char_classes[(guchar) *self->src] & CSV_CHAR_QUOTE) == 0)
     {
       /* we didn't start with a quote character, no need for escaping, delimiter terminates */
       self->current_quote = 0;
+      return;
     }
+
+  /* ok, quote character found */
+  quote = _strchr_optimized_for_single_char_haystack(self->options->quotes_start, *self->src);
+  self->src++;
+  self->current_quote = self->options->quotes_end[quote - self->options->quotes_start];
 }
 
 static void
@@ -192,46 +290,62 @@ _parse_left_whitespace(CSVScanner *self)
   if ((self->options->flags & CSV_SCANNER_STRIP_WHITESPACE) == 0)
     return;
 
-  _skip_whitespace(&self->src);
+  _skip_whitespace(self);
+}
+
+static inline gboolean
+_is_escape_character(CSVScanner *self, const gchar *p)
+{
+  if (self->options->dialect == CSV_SCANNER_ESCAPE_BACKSLASH)
+    return *p == '\\' && p + 1 < self->src_end;
+  if (self->options->dialect == CSV_SCANNER_ESCAPE_DOUBLE_CHAR)
+    return *p == self->current_quote && p + 1 < self->src_end && *(p + 1) == self->current_quote;
+  return FALSE;
 }
 
+/* consumes characters up to and including the closing quote */
 static void
-_parse_character_with_quotation(CSVScanner *self)
+_parse_value_with_quotation(CSVScanner *self)
 {
-  /* quoted character */
-  if (self->options->dialect == CSV_SCANNER_ESCAPE_BACKSLASH &&
-      *self->src == '\\' &&
-      *(self->src + 1))
-    {
-      self->src++;
-    }
-  else if (self->options->dialect == CSV_SCANNER_ESCAPE_DOUBLE_CHAR &&
-           *self->src == self->current_quote &&
-           *(self->src+1) == self->current_quote)
-    {
-      self->src++;
-    }
-  else if (*self->src == self->current_quote)
+  const gchar *p = self->src;
+
+  while (p < self->src_end)
     {
-      self->current_quote = 0;
-      self->src++;
-      return;
+      if (_is_escape_character(self, p))
+        {
+          /* the character following the escape is taken literally */
+          _append_to_value(self, self->src, p - self->src);
+          _append_to_value(self, p + 1, 1);
+          p += 2;
+          self->src = p;
+        }
+      else if (*p == self->current_quote)
+        {
+          _append_to_value(self, self->src, p - self->src);
+          self->current_quote = 0;
+          self->src = p + 1;
+          return;
+        }
+      else
+        {
+          p++;
+        }
     }
-  g_string_append_c(self->current_value, *self->src);
-  self->src++;
+  _append_to_value(self, self->src, p - self->src);
+  self->src = p;
 }
 
-/* searches for str in list and returns the first occurence, otherwise NULL */
-static const gboolean
-_match_string_delimiters_at_current_position(const char *input, GList *string_delimiters, int *result_length)
+static gboolean
+_match_string_delimiters_at(CSVScanner *self, const gchar *p, gint *result_length)
 {
   GList *l;
 
-  for (l = string_delimiters; l; l = l->next)
+  for (l = self->options->string_delimiters; l; l = l->next)
     {
-      gint len = strlen(l->data);
+      const gchar *delimiter = (const gchar *) l->data;
+      gsize len = strlen(delimiter);
 
-      if (strncmp(input, l->data, len) == 0)
+      if (len <= self->src_end - p && memcmp(p, delimiter, len) == 0)
         {
           *result_length = len;
           return TRUE;
@@ -240,98 +354,82 @@ _match_string_delimiters_at_current_position(const char *input, GList *string_de
   return FALSE;
 }
 
+/*
+ * Consumes characters up to and including the next delimiter, returns
+ * FALSE if the input ended first.  String delimiters take precedence
+ * over single character ones.
+ */
 static gboolean
-_parse_string_delimiters_at_current_position(CSVScanner *self)
+_parse_value_without_quotation(CSVScanner *self)
 {
-  gint delim_len;
+  const guint8 *char_classes = self->options->char_classes;
+  const gchar *p = self->src;
+  gint delimiter_len;
+  guint8 char_class;
 
-  if (!self->options->string_delimiters)
-    return FALSE;
-
-  if (_match_string_delimiters_at_current_position(self->src,
-                                                   self->options->string_delimiters,
-                                                   &delim_len))
+  while (p < self->src_end)
     {
-      self->src += delim_len;
-      return TRUE;
-    }
-  return FALSE;
-}
+      char_class = char_classes[(guchar) *p] & (CSV_CHAR_DELIMITER | CSV_CHAR_STRING_DELIMITER);
+      if (G_LIKELY(!char_class))
+        {
+          p++;
+          continue;
+        }
 
-static gboolean
-_parse_character_delimiters_at_current_position(CSVScanner *self)
-{
-  if (_strchr_optimized_for_single_char_haystack(self->options->delimiters, *self->src) != NULL)
-    {
-      self->src++;
+      if ((char_class & CSV_CHAR_STRING_DELIMITER) && _match_string_delimiters_at(self, p, &delimiter_len))
+        ;
+      else if (char_class & CSV_CHAR_DELIMITER)
+        delimiter_len = 1;
+      else
+        {
+          p++;
+          continue;
+        }
+
+      _append_to_value(self, self->src, p - self->src);
+      self->src = p + delimiter_len;
       return TRUE;
     }
-  return FALSE;
-}
-
-static gboolean
-_parse_delimiter(CSVScanner *self)
-{
-  if (_parse_string_delimiters_at_current_position(self))
-    return TRUE;
-
-  if (_parse_character_delimiters_at_current_position(self))
-    return TRUE;
 
+  _append_to_value(self, self->src, p - self->src);
+  self->src = p;
   return FALSE;
 }
 
-static void
-_parse_unquoted_literal_character(CSVScanner *self)
-{
-  g_string_append_c(self->current_value, *self->src);
-  self->src++;
-}
-
 static void
 _parse_value_with_whitespace_and_delimiter(CSVScanner *self)
 {
-  while (*self->src)
+  while (self->src < self->src_end)
     {
       if (self->current_quote)
-        {
-          /* within quotation marks */
-          _parse_character_with_quotation(self);
-        }
-      else
-        {
-          /* unquoted value */
-          if (_parse_delimiter(self))
-            break;
-          _parse_unquoted_literal_character(self);
-        }
+        _parse_value_with_quotation(self);
+      else if (_parse_value_without_quotation(self))
+        break;
     }
 }
 
-static gint
-_get_value_length_without_right_whitespace(CSVScanner *self)
-{
-  gint len = self->current_value->len;
-
-  while (len > 0 && _is_whitespace_char(self->current_value->str + len - 1))
-    len--;
-
-  return len;
-}
-
 static void
 _translate_rstrip_whitespace(CSVScanner *self)
 {
-  if (self->options->flags & CSV_SCANNER_STRIP_WHITESPACE)
-    g_string_truncate(self->current_value, _get_value_length_without_right_whitespace(self));
+  gsize len = self->current_value_len;
+
+  if ((self->options->flags & CSV_SCANNER_STRIP_WHITESPACE) == 0)
+    return;
+
+  while (len > 0 && _is_whitespace_char(self->current_value + len - 1))
+    len--;
+  _truncate_value(self, len);
 }
 
 static void
 _translate_null_value(CSVScanner *self)
 {
-  if (self->options->null_value &&
-      strcmp(self->current_value->str, self->options->null_value) == 0)
-    g_string_truncate(self->current_value, 0);
+  const gchar *null_value = self->options->null_value;
+
+  if (null_value &&
+      strlen(null_value) == self->current_value_len &&
+      memcmp(self->current_value, null_value, self->current_value_len) == 0)
+    _truncate_value(self, 0);
 }
 
 static void
@@ -351,11 +449,11 @@ csv_scanner_scan_next(CSVScanner *self)
 
   if (_is_last_column(self) && (self->options->flags & CSV_SCANNER_GREEDY))
     {
-      g_string_assign(self->current_value, self->src);
+      _append_to_value(self, self->src, self->src_end - self->src);
       self->src = NULL;
       return TRUE;
     }
-  else if (self->src[0] == 0)
+  else if (self->src >= self->src_end)
     {
       /* no more input data and a real column, not a greedy one */
       return FALSE;
@@ -376,23 +474,31 @@ csv_scanner_get_current_name(CSVScanner *self)
   return (const gchar *) self->current_column->data;
 }
 
+/* NOTE: the value is not NUL terminated, it may point into the input */
 const gchar *
 csv_scanner_get_current_value(CSVScanner *self)
 {
-  return self->current_value->str;
+  return self->current_value;
 }
 
 gint
 csv_scanner_get_current_value_len(CSVScanner *self)
 {
-  return self->current_value->len;
+  return self->current_value_len;
+}
+
+/* TRUE if the current value is a part of the input, as opposed to a copy */
+gboolean
+csv_scanner_is_current_value_in_input(CSVScanner *self)
+{
+  return !self->current_value_copied;
 }
 
 gboolean
 csv_scanner_is_scan_finished(CSVScanner *self)
 {
   if ((self->options->flags & CSV_SCANNER_DROP_INVALID) &&
-      (!_is_at_the_end_of_columns(self) || (self->src && *self->src)))
+      (!_is_at_the_end_of_columns(self) || _has_more_input(self)))
     {
       /* there are unfilled variables, OR not all of the input was processed
        * and "drop-invalid" flag is specified */
@@ -401,25 +507,32 @@ csv_scanner_is_scan_finished(CSVScanner *self)
   return TRUE;
 }
 
+/* @input need not be NUL terminated, unless @input_len is -1 */
 void
-csv_scanner_input(CSVScanner *self, const gchar *input)
+csv_scanner_input(CSVScanner *self, const gchar *input, gssize input_len)
 {
   self->src = input;
+  self->src_end = input + (input_len < 0 ? strlen(input) : input_len);
   self->current_column = NULL;
 }
 
+/*
+ * The state is cheap to set up, it is meant to live on the stack of the
+ * thread doing the parsing.  A scratch buffer is only taken if a value
+ * has to be copied.
+ */
 void
 csv_scanner_state_init(CSVScanner *self, CSVScannerOptions *options)
 {
+  memset(self, 0, sizeof(*self));
   self->options = options;
   self->current_column = options->columns;
-  self->src = NULL;
-  self->current_value = g_string_sized_new(128);
-  self->current_quote = 0;
 }
 
 void
 csv_scanner_state_clean(CSVScanner *self)
 {
-  g_string_free(self->current_value, TRUE);
+  if (self->value_buffer)
+    sb_gstring_release(self->value_buffer);
+  self->value_buffer = NULL;
 }
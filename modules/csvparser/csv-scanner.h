@@ -26,6 +26,7 @@
 #define CSVSCANNER_H_INCLUDED
 
 #include "syslog-ng.h"
+#include "scratch-buffers.h"
 
 typedef enum
 {
@@ -48,6 +49,8 @@ typedef struct _CSVScannerOptions
   GList *string_delimiters;
   CSVScannerDialect dialect;
   guint32 flags;
+  /* delimiter and quote characters, derived from the fields above */
+  guint8 char_classes[256];
 } CSVScannerOptions;
 
 void csv_scanner_options_clean(CSVScannerOptions *options);
@@ -68,17 +71,22 @@ typedef struct _CSVScanner
   CSVScannerOptions *options;
   GList *current_column;
   const gchar *src;
-  GString *current_value;
+  const gchar *src_end;
+  const gchar *current_value;
+  gsize current_value_len;
+  gboolean current_value_copied;
+  SBGString *value_buffer;
   gchar current_quote;
 } CSVScanner;
 
 const gchar *csv_scanner_get_current_name(CSVScanner *pstate);
 const gchar *csv_scanner_get_current_value(CSVScanner *pstate);
 gint csv_scanner_get_current_value_len(CSVScanner *self);
+gboolean csv_scanner_is_current_value_in_input(CSVScanner *self);
 gboolean csv_scanner_scan_next(CSVScanner *pstate);
 gboolean csv_scanner_is_scan_finished(CSVScanner *pstate);
 
-void csv_scanner_input(CSVScanner *pstate, const gchar *input);
+void csv_scanner_input(CSVScanner *pstate, const gchar *input, gssize input_len);
 gboolean csv_scanner_parse_input(CSVScanner *pstate);
 void csv_scanner_state_init(CSVScanner *pstate, CSVScannerOptions *options);
 void csv_scanner_state_clean(CSVScanner *pstate);
@@ -31,8 +31,6 @@ typedef struct _CSVParser
 {
   LogParser super;
   CSVScannerOptions options;
-  CSVScanner scanner;
-  GString *formatted_key;
   gchar *prefix;
   gint prefix_len;
 } CSVParser;
@@ -97,36 +95,72 @@ csv_parser_set_prefix(LogParser *s, const gchar *prefix)
     }
 }
 
+/* @formatted_key starts out with the prefix, which is kept between columns */
 static const gchar *
-_get_formatted_key(CSVParser *self, const gchar *key)
+_get_formatted_key(CSVParser *self, GString *formatted_key, const gchar *key)
 {
   if (!self->prefix)
     return key;
-  else if (self->formatted_key->len > 0)
-    g_string_truncate(self->formatted_key, self->prefix_len);
-  else
-    g_string_assign(self->formatted_key, self->prefix);
-  g_string_append(self->formatted_key, key);
-  return self->formatted_key->str;
+
+  g_string_truncate(formatted_key, self->prefix_len);
+  g_string_append(formatted_key, key);
+  return formatted_key->str;
+}
+
+/*
+ * Columns that are verbatim copies of a part of $MESSAGE are stored as
+ * references to it instead of copying their contents.  This only works
+ * if @input is $MESSAGE itself, and stops once a column overwrites it.
+ */
+static void
+_store_column(LogMessage *msg, NVHandle handle, CSVScanner *scanner, const gchar *input, gboolean *input_is_message)
+{
+  const gchar *value = csv_scanner_get_current_value(scanner);
+  gint value_len = csv_scanner_get_current_value_len(scanner);
+
+  if (*input_is_message &&
+      handle >= LM_V_MAX &&
+      value_len > 0 &&
+      csv_scanner_is_current_value_in_input(scanner) &&
+      value - input + value_len <= G_MAXUINT16)
+    {
+      log_msg_set_value_indirect(msg, handle, LM_V_MESSAGE, 0, value - input, value_len);
+      return;
+    }
+
+  if (handle == LM_V_MESSAGE)
+    *input_is_message = FALSE;
+  log_msg_set_value(msg, handle, value, value_len);
 }
 
 static gboolean
 csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *path_options, const gchar *input, gsize input_len)
 {
   CSVParser *self = (CSVParser *) s;
-  LogMessage *msg = log_msg_make_writable(pmsg, path_options);
+  SBGString *formatted_key = sb_gstring_acquire();
+  CSVScanner scanner;
+  gboolean input_is_message, result;
+  LogMessage *msg;
+
+  input_is_message = (input == log_msg_get_value(*pmsg, LM_V_MESSAGE, NULL));
+  msg = log_msg_make_writable(pmsg, path_options);
+  if (self->prefix)
+    g_string_assign(sb_gstring_string(formatted_key), self->prefix);
 
-  csv_scanner_input(&self->scanner, input);
-  while (csv_scanner_scan_next(&self->scanner))
+  csv_scanner_state_init(&scanner, &self->options);
+  csv_scanner_input(&scanner, input, input_len);
+  while (csv_scanner_scan_next(&scanner))
     {
+      const gchar *name = _get_formatted_key(self, sb_gstring_string(formatted_key),
+                                             csv_scanner_get_current_name(&scanner));
 
-      log_msg_set_value_by_name(msg,
-                                _get_formatted_key(self, csv_scanner_get_current_name(&self->scanner)),
-                                csv_scanner_get_current_value(&self->scanner),
-                                csv_scanner_get_current_value_len(&self->scanner));
+      _store_column(msg, log_msg_get_value_handle(name), &scanner, input, &input_is_message);
     }
+  result = csv_scanner_is_scan_finished(&scanner);
 
-  return csv_scanner_is_scan_finished(&self->scanner);
+  csv_scanner_state_clean(&scanner);
+  sb_gstring_release(formatted_key);
+  return result;
 }
 
 static LogPipe *
@@ -148,8 +182,6 @@ csv_parser_free(LogPipe *s)
   CSVParser *self = (CSVParser *) s;
 
   csv_scanner_options_clean(&self->options);
-  csv_scanner_state_clean(&self->scanner);
-  g_string_free(self->formatted_key, TRUE);
   g_free(self->prefix);
   log_parser_free_method(s);
 }
@@ -166,12 +198,10 @@ csv_parser_new(GlobalConfig *cfg)
   self->super.super.free_fn = csv_parser_free;
   self->super.super.clone = csv_parser_clone;
   self->super.process = csv_parser_process;
-  self->formatted_key = g_string_sized_new(32);
   csv_scanner_options_set_delimiters(&self->options, " ");
   csv_scanner_options_set_quote_pairs(&self->options, "\"\"''");
   csv_scanner_options_set_flags(&self->options, CSV_SCANNER_STRIP_WHITESPACE);
   csv_scanner_options_set_dialect(&self->options, CSV_SCANNER_ESCAPE_NONE);
-  csv_scanner_state_init(&self->scanner, &self->options);
   return &self->super;
 }
 
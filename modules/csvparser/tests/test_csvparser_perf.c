@@ -62,6 +62,16 @@ _construct_parser(gint max_columns, gint dialect, gchar *delimiters, gchar *quot
     "C28",
     "C29",
     "C30",
+    "C31",
+    "C32",
+    "C33",
+    "C34",
+    "C35",
+    "C36",
+    "C37",
+    "C38",
+    "C39",
+    "C40",
     NULL
   };
 
@@ -103,6 +113,7 @@ static void
 iterate_pattern(LogParser *p, const gchar *input)
 {
   LogMessage *msg;
+  NVTable *payload;
   GTimeVal start, end;
   gint i;
 
@@ -110,7 +121,10 @@ iterate_pattern(LogParser *p, const gchar *input)
   g_get_current_time(&start);
   for (i = 0; i < 100000; i++)
     {
+      /* columns may be copied from $MESSAGE, keep it alive the way log_parser_queue() does */
+      payload = nv_table_ref(msg->payload);
       log_parser_process(p, &msg, NULL, log_msg_get_value(msg, LM_V_MESSAGE, NULL), -1);
+      nv_table_unref(payload);
     }
   log_msg_unref(msg);
 
@@ -140,12 +154,31 @@ test_escaped_parsers(void)
 
 }
 
+static void
+test_wide_firewall_logs(void)
+{
+  /* 40 columns, as in a typical firewall traffic log, mostly unquoted */
+  perftest_parser(_construct_parser(40, CSV_SCANNER_ESCAPE_DOUBLE_CHAR, ",", "\"\"", NULL, NULL),
+                  "1,2016/05/24 10:31:12,001801000043,TRAFFIC,end,1,2016/05/24 10:31:12,192.168.1.10,203.0.113.5,"
+                  "198.51.100.4,203.0.113.5,allow-outbound,,,web-browsing,vsys1,trust,untrust,ethernet1/2,ethernet1/1,"
+                  "Forward-to-Syslog,2016/05/24 10:31:12,37721,1,51234,80,31234,80,0x40001c,tcp,allow,4310,1046,3264,"
+                  "14,2016/05/24 10:30:51,17,\"computer-and-internet-info\",0,3352183");
+
+  perftest_parser(_construct_parser(40, CSV_SCANNER_ESCAPE_DOUBLE_CHAR, ",", "\"\"", NULL, NULL),
+                  "1,2016/05/24 10:31:12,001801000043,TRAFFIC,end,1,2016/05/24 10:31:12,192.168.1.10,203.0.113.5,"
+                  "198.51.100.4,203.0.113.5,\"allow \"\"outbound\"\"\",,,web-browsing,vsys1,trust,untrust,ethernet1/2,"
+                  "ethernet1/1,Forward-to-Syslog,2016/05/24 10:31:12,37721,1,51234,80,31234,80,0x40001c,tcp,allow,4310,"
+                  "1046,3264,14,2016/05/24 10:30:51,17,\"computer-and-internet-info\",0,3352183");
+
+}
+
 int
 main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
 {
   stats_init();
   log_msg_global_init();
   test_escaped_parsers();
+  test_wide_firewall_logs();
   log_msg_global_deinit();
   stats_destroy();
   return 0;
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2016 BalaBit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "accumulator.h"
+#include "parse-number.h"
+#include "logmsg/logmsg.h"
+
+#include <string.h>
+#include <math.h>
+
+/* the distinct-count sketch is a HyperLogLog with 2^8 single byte
+ * registers, its standard error is about 6.5% */
+#define ACCUMULATOR_SKETCH_BITS 8
+#define ACCUMULATOR_SKETCH_SIZE (1 << ACCUMULATOR_SKETCH_BITS)
+
+static guint64
+_hash_value(const gchar *value, gsize value_len)
+{
+  guint64 hash = G_GUINT64_CONSTANT(14695981039346656037);
+  gsize i;
+
+  /* FNV-1a, followed by a finalizer spreading the bits, as the sketch
+   * relies on the high bits of the hash */
+  for (i = 0; i < value_len; i++)
+    {
+      hash ^= (guchar) value[i];
+      hash *= G_GUINT64_CONSTANT(1099511628211);
+    }
+  hash ^= hash >> 33;
+  hash *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+  hash ^= hash >> 33;
+  hash *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static void
+_sketch_add(AccumulatorState *state, const gchar *value, gsize value_len)
+{
+  guint64 hash = _hash_value(value, value_len);
+  guint32 index = hash >> (64 - ACCUMULATOR_SKETCH_BITS);
+  guint64 rest = hash << ACCUMULATOR_SKETCH_BITS;
+  guint8 rank = 1;
+
+  while (rank <= 64 - ACCUMULATOR_SKETCH_BITS && !(rest & G_GUINT64_CONSTANT(0x8000000000000000)))
+    {
+      rank++;
+      rest <<= 1;
+    }
+
+  if (!state->sketch)
+    state->sketch = g_new0(guint8, ACCUMULATOR_SKETCH_SIZE);
+  if (rank > state->sketch[index])
+    state->sketch[index] = rank;
+}
+
+static gint64
+_sketch_estimate(AccumulatorState *state)
+{
+  const gdouble m = ACCUMULATOR_SKETCH_SIZE;
+  gdouble sum = 0, estimate;
+  gint zeros = 0;
+  gint i;
+
+  if (!state->sketch)
+    return 0;
+
+  for (i = 0; i < ACCUMULATOR_SKETCH_SIZE; i++)
+    {
+      sum += ldexp(1.0, -state->sketch[i]);
+      if (state->sketch[i] == 0)
+        zeros++;
+    }
+
+  estimate = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+
+  /* small range correction: linear counting is more accurate while
+   * there are empty registers */
+  if (estimate <= 2.5 * m && zeros > 0)
+    estimate = m * log(m / zeros);
+  return (gint64) (estimate + 0.5);
+}
+
+static void
+_update_number(AccumulatorType type, AccumulatorState *state, gint64 number)
+{
+  if (state->count == 0)
+    {
+      state->value = number;
+      state->count = 1;
+      return;
+    }
+
+  switch (type)
+    {
+    case ACCUMULATOR_SUM:
+    case ACCUMULATOR_AVERAGE:
+      state->value += number;
+      break;
+    case ACCUMULATOR_MIN:
+      if (number < state->value)
+        state->value = number;
+      break;
+    case ACCUMULATOR_MAX:
+      if (number > state->value)
+        state->value = number;
+      break;
+    default:
+      g_assert_not_reached();
+    }
+  state->count++;
+}
+
+void
+accumulator_update(Accumulator *self, AccumulatorState *state, LogMessage *msg, GString *scratch)
+{
+  gint64 number;
+
+  if (self->type == ACCUMULATOR_COUNT)
+    {
+      state->count++;
+      return;
+    }
+
+  g_string_truncate(scratch, 0);
+  log_template_format(self->argument, msg, NULL, LTZ_LOCAL, 0, NULL, scratch);
+
+  if (self->type == ACCUMULATOR_DISTINCT_COUNT)
+    {
+      if (scratch->len > 0)
+        _sketch_add(state, scratch->str, scratch->len);
+      return;
+    }
+
+  /* values that are not numbers are skipped, just like $(sum) and
+   * friends do */
+  if (parse_number_with_suffix(scratch->str, &number))
+    _update_number(self->type, state, number);
+}
+
+void
+accumulator_format(Accumulator *self, AccumulatorState *state, GString *result)
+{
+  switch (self->type)
+    {
+    case ACCUMULATOR_COUNT:
+      g_string_append_printf(result, "%" G_GINT64_FORMAT, state->count);
+      break;
+    case ACCUMULATOR_DISTINCT_COUNT:
+      g_string_append_printf(result, "%" G_GINT64_FORMAT, _sketch_estimate(state));
+      break;
+    case ACCUMULATOR_AVERAGE:
+      if (state->count > 0)
+        g_string_append_printf(result, "%" G_GINT64_FORMAT, state->value / state->count);
+      break;
+    default:
+      if (state->count > 0)
+        g_string_append_printf(result, "%" G_GINT64_FORMAT, state->value);
+      break;
+    }
+}
+
+void
+accumulator_state_clear(AccumulatorState *state)
+{
+  g_free(state->sketch);
+  memset(state, 0, sizeof(*state));
+}
+
+/*
+ * Checks whether @template is a single template function call as a
+ * whole, e.g. "$(sum ${bytes})" and splits it to arguments, the same way
+ * the template compiler does: arguments are separated by whitespace,
+ * unless quoted or nested into parentheses.
+ */
+static gchar **
+_split_function_call(const gchar *template, gint *argc)
+{
+  gchar *call = g_strstrip(g_strdup(template));
+  gsize len = strlen(call);
+  GPtrArray *args = g_ptr_array_new();
+  GString *arg = g_string_new("");
+  gchar quote = 0;
+  gint depth = 1;
+  gsize i;
+
+  if (len < 4 || strncmp(call, "$(", 2) != 0 || call[len - 1] != ')')
+    goto error;
+
+  for (i = 2; i < len - 1; i++)
+    {
+      gchar c = call[i];
+
+      if (quote)
+        {
+          if (c == '\\' && quote == '"' && call[i + 1])
+            g_string_append_c(arg, call[++i]);
+          else if (c == quote)
+            quote = 0;
+          else
+            g_string_append_c(arg, c);
+          continue;
+        }
+
+      if (c == '\'' || c == '"')
+        {
+          quote = c;
+          continue;
+        }
+
+      if (c == '(')
+        depth++;
+      else if (c == ')' && --depth == 0)
+        goto error;
+
+      if (depth == 1 && g_ascii_isspace(c))
+        {
+          if (arg->len > 0)
+            g_ptr_array_add(args, g_string_free(arg, FALSE));
+          arg = g_string_new("");
+          continue;
+        }
+      g_string_append_c(arg, c);
+    }
+
+  if (quote || depth != 1)
+    goto error;
+  if (arg->len > 0)
+    g_ptr_array_add(args, g_string_free(arg, FALSE));
+  else
+    g_string_free(arg, TRUE);
+
+  if (args->len == 0)
+    {
+      g_ptr_array_free(args, TRUE);
+      g_free(call);
+      return NULL;
+    }
+
+  *argc = args->len;
+  g_ptr_array_add(args, NULL);
+  g_free(call);
+  return (gchar **) g_ptr_array_free(args, FALSE);
+
+error:
+  g_string_free(arg, TRUE);
+  g_ptr_array_foreach(args, (GFunc) g_free, NULL);
+  g_ptr_array_free(args, TRUE);
+  g_free(call);
+  return NULL;
+}
+
+static gboolean
+_lookup_function(const gchar *name, gint argc, AccumulatorType *type)
+{
+  static const struct
+  {
+    const gchar *name;
+    AccumulatorType type;
+  } functions[] =
+  {
+    { "sum", ACCUMULATOR_SUM },
+    { "min", ACCUMULATOR_MIN },
+    { "max", ACCUMULATOR_MAX },
+    { "average", ACCUMULATOR_AVERAGE },
+    { "distinct-count", ACCUMULATOR_DISTINCT_COUNT },
+  };
+  gint i;
+
+  if (strcmp(name, "context-length") == 0)
+    {
+      *type = ACCUMULATOR_COUNT;
+      return argc == 1;
+    }
+
+  for (i = 0; i < G_N_ELEMENTS(functions); i++)
+    {
+      if (strcmp(name, functions[i].name) == 0)
+        {
+          *type = functions[i].type;
+          return argc == 2;
+        }
+    }
+  return FALSE;
+}
+
+/*
+ * Compiles a value of a synthetic message into an accumulator, if it
+ * consists of a single call to one of the aggregate template functions
+ * ($(context-length), $(sum), $(min), $(max), $(average),
+ * $(distinct-count)).  Returns NULL otherwise.
+ */
+Accumulator *
+accumulator_new_from_template(LogTemplate *value_template)
+{
+  Accumulator *self = NULL;
+  AccumulatorType type;
+  LogTemplate *argument = NULL;
+  gchar **argv;
+  gint argc;
+
+  argv = _split_function_call(value_template->template, &argc);
+  if (!argv)
+    return NULL;
+
+  if (!_lookup_function(argv[0], argc, &type))
+    goto exit;
+
+  if (argc == 2)
+    {
+      argument = log_template_new(value_template->cfg, NULL);
+      if (!log_template_compile(argument, argv[1], NULL))
+        {
+          log_template_unref(argument);
+          goto exit;
+        }
+    }
+
+  self = g_new0(Accumulator, 1);
+  self->type = type;
+  self->name = g_strdup(value_template->name);
+  self->argument = argument;
+
+exit:
+  g_strfreev(argv);
+  return self;
+}
+
+void
+accumulator_free(Accumulator *self)
+{
+  log_template_unref(self->argument);
+  g_free(self->name);
+  g_free(self);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2016 BalaBit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#ifndef PATTERNDB_ACCUMULATOR_H_INCLUDED
+#define PATTERNDB_ACCUMULATOR_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "template/templates.h"
+
+/*
+ * An Accumulator computes the value of an aggregate expression of a
+ * synthetic message (like $(sum ${bytes})) incrementally, as messages are
+ * added to a context, so that the messages themselves need not be
+ * retained until the context expires.
+ */
+typedef enum
+{
+  ACCUMULATOR_COUNT,
+  ACCUMULATOR_SUM,
+  ACCUMULATOR_MIN,
+  ACCUMULATOR_MAX,
+  ACCUMULATOR_AVERAGE,
+  ACCUMULATOR_DISTINCT_COUNT,
+} AccumulatorType;
+
+/* per-context state of an accumulator */
+typedef struct _AccumulatorState
+{
+  gint64 value;
+  gint64 count;
+  /* registers of the distinct-count sketch, allocated on first use */
+  guint8 *sketch;
+} AccumulatorState;
+
+typedef struct _Accumulator
+{
+  AccumulatorType type;
+  gchar *name;
+  LogTemplate *argument;
+} Accumulator;
+
+Accumulator *accumulator_new_from_template(LogTemplate *value_template);
+void accumulator_update(Accumulator *self, AccumulatorState *state, LogMessage *msg, GString *scratch);
+void accumulator_format(Accumulator *self, AccumulatorState *state, GString *result);
+void accumulator_free(Accumulator *self);
+
+void accumulator_state_clear(AccumulatorState *state);
+
+#endif
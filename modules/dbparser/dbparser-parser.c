@@ -40,6 +40,7 @@ static CfgLexerKeyword dbparser_keywords[] =
   { "scope",              KW_SCOPE },
   { "timeout",            KW_TIMEOUT },
   { "aggregate",          KW_AGGREGATE },
+  { "aggregate_mode",     KW_AGGREGATE_MODE },
   { "inherit_mode",       KW_INHERIT_MODE },
   { "where",              KW_WHERE },
   { "having",             KW_HAVING },
@@ -24,28 +24,73 @@
 #include "correllation.h"
 #include "correllation-context.h"
 #include "synthetic-message.h"
+#include "accumulator.h"
 #include "messages.h"
 #include "str-utils.h"
 #include "filter/filter-expr.h"
+#include "tags.h"
+#include "template/repr.h"
+
+#include <string.h>
 #include <iv.h>
 
-typedef struct _GroupingBy
+/*
+ * Contexts are distributed among shards by the hash of their key, each
+ * shard having its own lock and timer wheel, so that messages of
+ * different contexts can be processed in parallel.
+ */
+#define GROUPING_BY_SHARDS 16
+
+typedef struct _GroupingByShard
 {
-  StatefulParser super;
   GStaticMutex lock;
-  struct iv_timer tick;
   TimerWheel *timer_wheel;
   GTimeVal last_tick;
   CorrellationState *correllation;
+  /* used by the accumulators, protected by lock */
+  GString *scratch;
+} GroupingByShard;
+
+/* the state kept across reloads */
+typedef struct _GroupingByState
+{
+  /* describes the contexts, the state is only reused if it matches */
+  gchar *layout;
+  GroupingByShard shards[GROUPING_BY_SHARDS];
+} GroupingByState;
+
+typedef struct _GroupingBy
+{
+  StatefulParser super;
+  struct iv_timer tick;
+  GroupingByState *state;
   LogTemplate *key_template;
   gint timeout;
   CorrellationScope scope;
+  GroupingByAggregateMode aggregate_mode;
   SyntheticMessage *synthetic_message;
+  /* streaming mode: the values of synthetic_message that are computed
+   * using accumulators, and the message that generates the rest */
+  GPtrArray *accumulators;
+  SyntheticMessage *streaming_message;
   FilterExprNode *trigger_condition_expr;
   FilterExprNode *where_condition_expr;
   FilterExprNode *having_condition_expr;
 } GroupingBy;
 
+/*
+ * In streaming mode, contexts only retain the first and the last message
+ * (as message #2 and #1 of the context, respectively), the values of the
+ * aggregate expressions are accumulated as messages arrive.
+ */
+typedef struct _GroupingByStreamingContext
+{
+  CorrellationContext super;
+  gint64 num_messages;
+  gint num_accumulators;
+  AccumulatorState *accumulators;
+} GroupingByStreamingContext;
+
 static NVHandle context_id_handle = 0;
 
 void
@@ -65,6 +110,14 @@ grouping_by_set_scope(LogParser *s, CorrellationScope scope)
   self->scope = scope;
 }
 
+void
+grouping_by_set_aggregate_mode(LogParser *s, GroupingByAggregateMode aggregate_mode)
+{
+  GroupingBy *self = (GroupingBy *) s;
+
+  self->aggregate_mode = aggregate_mode;
+}
+
 void
 grouping_by_set_timeout(LogParser *s, gint timeout)
 {
@@ -107,9 +160,9 @@ grouping_by_set_synthetic_message(LogParser *s, SyntheticMessage *message)
   self->synthetic_message = message;
 }
 
-/* NOTE: lock should be acquired for writing before calling this function. */
-void
-grouping_by_set_time(GroupingBy *self, const LogStamp *ls)
+/* NOTE: the lock of the shard should be acquired before calling this function. */
+static void
+grouping_by_set_time(GroupingByShard *shard, const LogStamp *ls)
 {
   GTimeVal now;
 
@@ -119,14 +172,14 @@ grouping_by_set_time(GroupingBy *self, const LogStamp *ls)
    * correllation engine too much. */
 
   cached_g_current_time(&now);
-  self->last_tick = now;
+  shard->last_tick = now;
 
   if (ls->tv_sec < now.tv_sec)
     now.tv_sec = ls->tv_sec;
 
-  timer_wheel_set_time(self->timer_wheel, now.tv_sec);
+  timer_wheel_set_time(shard->timer_wheel, now.tv_sec);
   msg_debug("Advancing correllate() current time because of an incoming message",
-            evt_tag_long("utc", timer_wheel_get_time(self->timer_wheel)));
+            evt_tag_long("utc", timer_wheel_get_time(shard->timer_wheel)));
 }
 
 /*
@@ -137,27 +190,27 @@ grouping_by_set_time(GroupingBy *self, const LogStamp *ls)
  * invocation.  See the timing comment at pattern_db_process() for more
  * information.
  */
-void
-_grouping_by_timer_tick(GroupingBy *self)
+static void
+_grouping_by_shard_timer_tick(GroupingByShard *shard)
 {
   GTimeVal now;
   glong diff;
 
-  g_static_mutex_lock(&self->lock);
+  g_static_mutex_lock(&shard->lock);
   cached_g_current_time(&now);
-  diff = g_time_val_diff(&now, &self->last_tick);
+  diff = g_time_val_diff(&now, &shard->last_tick);
 
   if (diff > 1e6)
     {
       glong diff_sec = diff / 1e6;
 
-      timer_wheel_set_time(self->timer_wheel, timer_wheel_get_time(self->timer_wheel) + diff_sec);
+      timer_wheel_set_time(shard->timer_wheel, timer_wheel_get_time(shard->timer_wheel) + diff_sec);
       msg_debug("Advancing correllate() current time because of timer tick",
-                evt_tag_long("utc", timer_wheel_get_time(self->timer_wheel)));
+                evt_tag_long("utc", timer_wheel_get_time(shard->timer_wheel)));
       /* update last_tick, take the fraction of the seconds not calculated into this update into account */
 
-      self->last_tick = now;
-      g_time_val_add(&self->last_tick, -(diff - diff_sec * 1e6));
+      shard->last_tick = now;
+      g_time_val_add(&shard->last_tick, -(diff - diff_sec * 1e6));
     }
   else if (diff < 0)
     {
@@ -165,9 +218,18 @@ _grouping_by_timer_tick(GroupingBy *self)
        * is changed.  We don't update patterndb's idea of the time now, wait
        * another tick instead to update that instead.
        */
-      self->last_tick = now;
+      shard->last_tick = now;
     }
-  g_static_mutex_unlock(&self->lock);
+  g_static_mutex_unlock(&shard->lock);
+}
+
+void
+_grouping_by_timer_tick(GroupingBy *self)
+{
+  gint i;
+
+  for (i = 0; i < GROUPING_BY_SHARDS; i++)
+    _grouping_by_shard_timer_tick(&self->state->shards[i]);
 }
 
 static void
@@ -182,6 +244,78 @@ grouping_by_timer_tick(gpointer s)
   iv_timer_register(&self->tick);
 }
 
+static GroupingByShard *
+_lookup_shard(GroupingBy *self, CorrellationKey *key)
+{
+  return &self->state->shards[correllation_key_hash(key) % GROUPING_BY_SHARDS];
+}
+
+static void
+grouping_by_streaming_context_free(CorrellationContext *s)
+{
+  GroupingByStreamingContext *self = (GroupingByStreamingContext *) s;
+  gint i;
+
+  for (i = 0; i < self->num_accumulators; i++)
+    accumulator_state_clear(&self->accumulators[i]);
+  g_free(self->accumulators);
+  correllation_context_free_method(s);
+}
+
+static CorrellationContext *
+grouping_by_context_new(GroupingBy *self, CorrellationKey *key)
+{
+  GroupingByStreamingContext *context;
+
+  if (self->aggregate_mode != GBA_STREAMING)
+    return correllation_context_new(key);
+
+  context = g_new0(GroupingByStreamingContext, 1);
+  correllation_context_init(&context->super, key);
+  context->super.free_fn = grouping_by_streaming_context_free;
+  context->num_accumulators = self->accumulators->len;
+  context->accumulators = g_new0(AccumulatorState, context->num_accumulators);
+  return &context->super;
+}
+
+static gint64
+_get_num_messages(GroupingBy *self, CorrellationContext *context)
+{
+  if (self->aggregate_mode != GBA_STREAMING)
+    return context->messages->len;
+
+  return ((GroupingByStreamingContext *) context)->num_messages;
+}
+
+/* NOTE: the lock of the shard should be acquired before calling this function. */
+static void
+_add_message_to_context(GroupingBy *self, GroupingByShard *shard, CorrellationContext *context, LogMessage *msg)
+{
+  GroupingByStreamingContext *streaming_context = (GroupingByStreamingContext *) context;
+  gint i;
+
+  if (self->aggregate_mode != GBA_STREAMING)
+    {
+      g_ptr_array_add(context->messages, log_msg_ref(msg));
+      return;
+    }
+
+  for (i = 0; i < streaming_context->num_accumulators; i++)
+    accumulator_update(g_ptr_array_index(self->accumulators, i), &streaming_context->accumulators[i], msg, shard->scratch);
+  streaming_context->num_messages++;
+
+  if (context->messages->len == 0)
+    {
+      g_ptr_array_add(context->messages, log_msg_ref(msg));
+      g_ptr_array_add(context->messages, log_msg_ref(msg));
+    }
+  else
+    {
+      log_msg_unref(g_ptr_array_index(context->messages, 1));
+      g_ptr_array_index(context->messages, 1) = log_msg_ref(msg);
+    }
+}
+
 static gboolean
 _evaluate_having(GroupingBy *self, CorrellationContext *context)
 {
@@ -191,6 +325,28 @@ _evaluate_having(GroupingBy *self, CorrellationContext *context)
   return filter_expr_eval_with_context(self->having_condition_expr, (LogMessage **) context->messages->pdata, context->messages->len);
 }
 
+static LogMessage *
+_generate_synthetic_message(GroupingBy *self, CorrellationContext *context, GString *buffer)
+{
+  GroupingByStreamingContext *streaming_context = (GroupingByStreamingContext *) context;
+  LogMessage *msg;
+  gint i;
+
+  if (self->aggregate_mode != GBA_STREAMING)
+    return synthetic_message_generate_with_context(self->synthetic_message, context, buffer);
+
+  msg = synthetic_message_generate_with_context(self->streaming_message, context, buffer);
+  for (i = 0; i < streaming_context->num_accumulators; i++)
+    {
+      Accumulator *accumulator = g_ptr_array_index(self->accumulators, i);
+
+      g_string_truncate(buffer, 0);
+      accumulator_format(accumulator, &streaming_context->accumulators[i], buffer);
+      log_msg_set_value_by_name(msg, accumulator->name, buffer->str, buffer->len);
+    }
+  return msg;
+}
+
 static void
 grouping_by_emit_synthetic(GroupingBy *self, CorrellationContext *context)
 {
@@ -200,7 +356,7 @@ grouping_by_emit_synthetic(GroupingBy *self, CorrellationContext *context)
     {
       GString *buffer = g_string_sized_new(256);
 
-      msg = synthetic_message_generate_with_context(self->synthetic_message, context, buffer);
+      msg = _generate_synthetic_message(self, context, buffer);
       stateful_parser_emit_synthetic(&self->super, msg);
       log_msg_unref(msg);
       g_string_free(buffer, TRUE);
@@ -231,108 +387,101 @@ grouping_by_expire_entry(TimerWheel *wheel, guint64 now, gpointer user_data)
                         log_expr_node_format_location(self->super.super.super.expr_node,
                                                       buf, sizeof(buf))));
   grouping_by_emit_synthetic(self, context);
-  g_hash_table_remove(self->correllation->state, &context->key);
+  g_hash_table_remove(_lookup_shard(self, &context->key)->correllation->state, &context->key);
 
   /* correllation_context_free is automatically called when returning from
      this function by the timerwheel code as a destroy notify
      callback. */
 }
 
-
 static gchar *
 grouping_by_format_persist_name(GroupingBy *self)
 {
   static gchar persist_name[512];
 
-  g_snprintf(persist_name, sizeof(persist_name), "correllation()");
+  g_snprintf(persist_name, sizeof(persist_name), "grouping-by(%s,%s)",
+             self->super.super.name,
+             self->key_template ? self->key_template->template : "");
   return persist_name;
 }
 
-static gboolean
+static void
 _perform_groupby(GroupingBy *self, LogMessage *msg)
 {
   GString *buffer = g_string_sized_new(32);
   CorrellationContext *context = NULL;
+  GroupingByShard *shard;
+  CorrellationKey key;
   gchar buf[256];
 
-  g_static_mutex_lock(&self->lock);
-  grouping_by_set_time(self, &msg->timestamps[LM_TS_STAMP]);
-  if (self->key_template)
-    {
-      CorrellationKey key;
+  log_template_format(self->key_template, msg, NULL, LTZ_LOCAL, 0, NULL, buffer);
+  log_msg_set_value(msg, context_id_handle, buffer->str, -1);
 
-      log_template_format(self->key_template, msg, NULL, LTZ_LOCAL, 0, NULL, buffer);
-      log_msg_set_value(msg, context_id_handle, buffer->str, -1);
+  correllation_key_setup(&key, self->scope, msg, buffer->str);
+  shard = _lookup_shard(self, &key);
 
-      correllation_key_setup(&key, self->scope, msg, buffer->str);
-      context = g_hash_table_lookup(self->correllation->state, &key);
-      if (!context)
-        {
-          msg_debug("Correllation context lookup failure, starting a new context",
-                    evt_tag_str("key", buffer->str),
-                    evt_tag_int("timeout", self->timeout),
-                    evt_tag_int("expiration", timer_wheel_get_time(self->timer_wheel) + self->timeout),
-                    evt_tag_str("location",
-                                log_expr_node_format_location(self->super.super.super.expr_node,
-                                                              buf, sizeof(buf))));
-          context = correllation_context_new(&key);
-          g_hash_table_insert(self->correllation->state, &context->key, context);
-          g_string_steal(buffer);
-        }
-      else
-        {
-          msg_debug("Correllation context lookup successful",
-                    evt_tag_str("key", buffer->str),
-                    evt_tag_int("timeout", self->timeout),
-                    evt_tag_int("expiration", timer_wheel_get_time(self->timer_wheel) + self->timeout),
-                    evt_tag_int("num_messages", context->messages->len),
-                    evt_tag_str("location",
-                                log_expr_node_format_location(self->super.super.super.expr_node,
-                                                              buf, sizeof(buf))));
-        }
+  g_static_mutex_lock(&shard->lock);
+  grouping_by_set_time(shard, &msg->timestamps[LM_TS_STAMP]);
+  context = g_hash_table_lookup(shard->correllation->state, &key);
+  if (!context)
+    {
+      msg_debug("Correllation context lookup failure, starting a new context",
+                evt_tag_str("key", buffer->str),
+                evt_tag_int("timeout", self->timeout),
+                evt_tag_int("expiration", timer_wheel_get_time(shard->timer_wheel) + self->timeout),
+                evt_tag_str("location",
+                            log_expr_node_format_location(self->super.super.super.expr_node,
+                                                          buf, sizeof(buf))));
+      context = grouping_by_context_new(self, &key);
+      g_hash_table_insert(shard->correllation->state, &context->key, context);
+      g_string_steal(buffer);
+    }
+  else
+    {
+      msg_debug("Correllation context lookup successful",
+                evt_tag_str("key", buffer->str),
+                evt_tag_int("timeout", self->timeout),
+                evt_tag_int("expiration", timer_wheel_get_time(shard->timer_wheel) + self->timeout),
+                evt_tag_int("num_messages", _get_num_messages(self, context)),
+                evt_tag_str("location",
+                            log_expr_node_format_location(self->super.super.super.expr_node,
+                                                          buf, sizeof(buf))));
+    }
 
-      g_ptr_array_add(context->messages, log_msg_ref(msg));
+  _add_message_to_context(self, shard, context, msg);
 
-      if (self->trigger_condition_expr &&
-          filter_expr_eval(self->trigger_condition_expr, msg))
+  if (self->trigger_condition_expr &&
+      filter_expr_eval(self->trigger_condition_expr, msg))
+    {
+      msg_verbose("Correllation close-condition() met, closing state",
+                  evt_tag_str("key", context->key.session_id),
+                  evt_tag_int("timeout", self->timeout),
+                  evt_tag_int("num_messages", _get_num_messages(self, context)),
+                  evt_tag_str("location",
+                              log_expr_node_format_location(self->super.super.super.expr_node,
+                                                            buf, sizeof(buf))));
+      /* close down state */
+      if (context->timer)
+        timer_wheel_del_timer(shard->timer_wheel, context->timer);
+      grouping_by_expire_entry(shard->timer_wheel, timer_wheel_get_time(shard->timer_wheel), context);
+    }
+  else
+    {
+      if (context->timer)
         {
-          msg_verbose("Correllation close-condition() met, closing state",
-                    evt_tag_str("key", context->key.session_id),
-                    evt_tag_int("timeout", self->timeout),
-                    evt_tag_int("num_messages", context->messages->len),
-                    evt_tag_str("location",
-                                log_expr_node_format_location(self->super.super.super.expr_node,
-                                                              buf, sizeof(buf))));
-          /* close down state */
-          if (context->timer)
-            timer_wheel_del_timer(self->timer_wheel, context->timer);
-          grouping_by_expire_entry(self->timer_wheel, timer_wheel_get_time(self->timer_wheel), context);
+          timer_wheel_mod_timer(shard->timer_wheel, context->timer, self->timeout);
         }
       else
         {
-
-          if (context->timer)
-            {
-              timer_wheel_mod_timer(self->timer_wheel, context->timer, self->timeout);
-            }
-          else
-            {
-              context->timer = timer_wheel_add_timer(self->timer_wheel, self->timeout, grouping_by_expire_entry, correllation_context_ref(context), (GDestroyNotify) correllation_context_unref);
-            }
+          context->timer = timer_wheel_add_timer(shard->timer_wheel, self->timeout, grouping_by_expire_entry, correllation_context_ref(context), (GDestroyNotify) correllation_context_unref);
         }
     }
-  else
-    {
-      context = NULL;
-    }
 
-  g_static_mutex_unlock(&self->lock);
+  g_static_mutex_unlock(&shard->lock);
 
-  if (context)
-    log_msg_write_protect(msg);
+  log_msg_write_protect(msg);
 
   g_string_free(buffer, TRUE);
-  return TRUE;
 }
 
 static gboolean
@@ -349,22 +498,213 @@ grouping_by_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *path_
 {
   GroupingBy *self = (GroupingBy *) s;
 
-  if (_evaluate_where(self, pmsg, path_options))
-    return _perform_groupby(self, log_msg_make_writable(pmsg, path_options));
+  if (self->key_template && _evaluate_where(self, pmsg, path_options))
+    _perform_groupby(self, log_msg_make_writable(pmsg, path_options));
   return TRUE;
 }
 
+static GroupingByState *
+grouping_by_state_new(const gchar *layout)
+{
+  GroupingByState *self = g_new0(GroupingByState, 1);
+  gint i;
+
+  self->layout = g_strdup(layout);
+  for (i = 0; i < GROUPING_BY_SHARDS; i++)
+    {
+      GroupingByShard *shard = &self->shards[i];
+
+      g_static_mutex_init(&shard->lock);
+      shard->timer_wheel = timer_wheel_new();
+      shard->correllation = correllation_state_new();
+      shard->scratch = g_string_sized_new(64);
+      cached_g_current_time(&shard->last_tick);
+    }
+  return self;
+}
+
+static void
+grouping_by_state_free(GroupingByState *self)
+{
+  gint i;
+
+  for (i = 0; i < GROUPING_BY_SHARDS; i++)
+    {
+      GroupingByShard *shard = &self->shards[i];
+
+      timer_wheel_free(shard->timer_wheel);
+      correllation_state_free(shard->correllation);
+      g_string_free(shard->scratch, TRUE);
+      g_static_mutex_free(&shard->lock);
+    }
+  g_free(self->layout);
+  g_free(self);
+}
+
+/*
+ * Destroy notify of the persisted state: it is called if no parser of
+ * the new configuration claimed the state (e.g. the parser was renamed or
+ * its key() changed), or if its layout doesn't match, in which case the
+ * pending contexts are lost.
+ */
+static void
+grouping_by_state_drop(GroupingByState *self)
+{
+  guint num_contexts = 0;
+  gint i;
+
+  for (i = 0; i < GROUPING_BY_SHARDS; i++)
+    num_contexts += g_hash_table_size(self->shards[i].correllation->state);
+
+  if (num_contexts > 0)
+    msg_warning("grouping-by() state was not reused after reload, dropping pending contexts",
+                evt_tag_str("layout", self->layout),
+                evt_tag_int("contexts", num_contexts));
+  grouping_by_state_free(self);
+}
+
+/*
+ * A value that is not an accumulator is generated from the first and the
+ * last message of a streaming context, so it may only refer to these (as
+ * @1 and @0) and template functions must be bound to one of them, as
+ * they would otherwise see these two messages instead of the context.
+ */
+static gboolean
+_is_streaming_value(LogTemplate *value)
+{
+  GList *p;
+
+  for (p = value->compiled_template; p; p = p->next)
+    {
+      LogTemplateElem *e = (LogTemplateElem *) p->data;
+
+      /* msg_ref is one larger than the index, 0 means unspecified */
+      if (e->msg_ref > 2)
+        return FALSE;
+      if (e->type == LTE_FUNC && e->msg_ref == 0)
+        return FALSE;
+    }
+  return TRUE;
+}
+
+/*
+ * Splits the values of the synthetic message into accumulators and the
+ * rest, which is generated from the first and the last message of the
+ * context.
+ */
+static gboolean
+_compile_accumulators(GroupingBy *self)
+{
+  gchar buf[256];
+  gint i;
+
+  self->accumulators = g_ptr_array_new();
+  self->streaming_message = synthetic_message_new();
+  if (!self->synthetic_message)
+    return TRUE;
+
+  synthetic_message_set_inherit_mode(self->streaming_message, self->synthetic_message->inherit_mode);
+  if (self->synthetic_message->tags)
+    {
+      self->streaming_message->tags = g_array_new(FALSE, FALSE, sizeof(LogTagId));
+      g_array_append_vals(self->streaming_message->tags, self->synthetic_message->tags->data, self->synthetic_message->tags->len);
+    }
+
+  for (i = 0; self->synthetic_message->values && i < self->synthetic_message->values->len; i++)
+    {
+      LogTemplate *value = g_ptr_array_index(self->synthetic_message->values, i);
+      Accumulator *accumulator = accumulator_new_from_template(value);
+
+      if (accumulator)
+        {
+          g_ptr_array_add(self->accumulators, accumulator);
+          continue;
+        }
+
+      if (!_is_streaming_value(value))
+        {
+          msg_error("grouping-by(): in aggregate-mode(streaming) a value must either be a single aggregate function "
+                    "or only refer to the last (@0) or the first (@1) message of the context",
+                    evt_tag_str("name", value->name),
+                    evt_tag_str("value", value->template),
+                    evt_tag_str("location",
+                                log_expr_node_format_location(self->super.super.super.expr_node,
+                                                              buf, sizeof(buf))));
+          return FALSE;
+        }
+      synthetic_message_add_value_template(self->streaming_message, value->name, value);
+    }
+  return TRUE;
+}
+
+static gboolean
+_check_streaming_options(GroupingBy *self)
+{
+  gchar buf[256];
+
+  if (self->having_condition_expr)
+    {
+      msg_error("grouping-by(): having() is not supported in aggregate-mode(streaming), as the messages of the "
+                "context are not retained",
+                evt_tag_str("location",
+                            log_expr_node_format_location(self->super.super.super.expr_node,
+                                                          buf, sizeof(buf))));
+      return FALSE;
+    }
+  return TRUE;
+}
+
+static gchar *
+_format_state_layout(GroupingBy *self)
+{
+  GString *layout = g_string_new(self->aggregate_mode == GBA_STREAMING ? "streaming" : "retain");
+  gint i;
+
+  for (i = 0; self->accumulators && i < self->accumulators->len; i++)
+    {
+      Accumulator *accumulator = g_ptr_array_index(self->accumulators, i);
+
+      g_string_append_printf(layout, ",%s=%d", accumulator->name, accumulator->type);
+    }
+  return g_string_free(layout, FALSE);
+}
+
 static gboolean
 grouping_by_init(LogPipe *s)
 {
   GroupingBy *self = (GroupingBy *) s;
   GlobalConfig *cfg = log_pipe_get_config(s);
+  gchar *layout;
+  gint i;
+
+  if (!log_parser_init_method(s))
+    return FALSE;
 
-  self->correllation = cfg_persist_config_fetch(cfg, grouping_by_format_persist_name(self));
-  if (!self->correllation)
+  if (self->aggregate_mode == GBA_STREAMING)
     {
-      self->correllation = correllation_state_new();
+      if (!_check_streaming_options(self))
+        return FALSE;
+      if (!self->accumulators && !_compile_accumulators(self))
+        return FALSE;
     }
+
+  layout = _format_state_layout(self);
+  if (!self->state)
+    {
+      self->state = cfg_persist_config_fetch(cfg, grouping_by_format_persist_name(self));
+      if (self->state && strcmp(self->state->layout, layout) != 0)
+        {
+          grouping_by_state_drop(self->state);
+          self->state = NULL;
+        }
+    }
+  if (!self->state)
+    self->state = grouping_by_state_new(layout);
+  g_free(layout);
+
+  for (i = 0; i < GROUPING_BY_SHARDS; i++)
+    timer_wheel_set_associated_data(self->state->shards[i].timer_wheel, self, NULL);
+
   iv_validate_now();
   IV_TIMER_INIT(&self->tick);
   self->tick.cookie = self;
@@ -387,8 +727,12 @@ grouping_by_deinit(LogPipe *s)
       iv_timer_unregister(&self->tick);
     }
 
-  cfg_persist_config_add(cfg, grouping_by_format_persist_name(self), self->correllation, (GDestroyNotify) correllation_state_free, FALSE);
-  self->correllation = NULL;
+  /* there's no persist config to keep the state in when shutting down */
+  if (cfg->persist)
+    cfg_persist_config_add(cfg, grouping_by_format_persist_name(self), self->state, (GDestroyNotify) grouping_by_state_drop, FALSE);
+  else
+    grouping_by_state_free(self->state);
+  self->state = NULL;
   return TRUE;
 }
 
@@ -402,6 +746,7 @@ grouping_by_clone(LogPipe *s)
   cloned = grouping_by_new(s->cfg);
   grouping_by_set_key_template(cloned, self->key_template);
   grouping_by_set_timeout(cloned, self->timeout);
+  grouping_by_set_aggregate_mode(cloned, self->aggregate_mode);
   return &cloned->super;
 }
 
@@ -410,11 +755,18 @@ grouping_by_free(LogPipe *s)
 {
   GroupingBy *self = (GroupingBy *) s;
 
-  g_static_mutex_free(&self->lock);
+  if (self->state)
+    grouping_by_state_free(self->state);
   log_template_unref(self->key_template);
   if (self->synthetic_message)
     synthetic_message_free(self->synthetic_message);
-  timer_wheel_free(self->timer_wheel);
+  if (self->accumulators)
+    {
+      g_ptr_array_foreach(self->accumulators, (GFunc) accumulator_free, NULL);
+      g_ptr_array_free(self->accumulators, TRUE);
+    }
+  if (self->streaming_message)
+    synthetic_message_free(self->streaming_message);
   stateful_parser_free_method(s);
 }
 
@@ -429,14 +781,21 @@ grouping_by_new(GlobalConfig *cfg)
   self->super.super.super.deinit = grouping_by_deinit;
   self->super.super.super.clone = grouping_by_clone;
   self->super.super.process = grouping_by_process;
-  g_static_mutex_init(&self->lock);
   self->scope = RCS_GLOBAL;
-  self->timer_wheel = timer_wheel_new();
-  timer_wheel_set_associated_data(self->timer_wheel, self, NULL);
-  cached_g_current_time(&self->last_tick);
+  self->aggregate_mode = GBA_RETAIN;
   return &self->super.super;
 }
 
+gint
+grouping_by_lookup_aggregate_mode(const gchar *aggregate_mode)
+{
+  if (strcmp(aggregate_mode, "retain") == 0)
+    return GBA_RETAIN;
+  else if (strcmp(aggregate_mode, "streaming") == 0)
+    return GBA_STREAMING;
+  return -1;
+}
+
 void
 grouping_by_global_init(void)
 {
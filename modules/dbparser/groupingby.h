@@ -26,14 +26,24 @@
 #include "synthetic-message.h"
 #include "filter/filter-expr.h"
 
+typedef enum
+{
+  /* contexts retain their messages until they expire */
+  GBA_RETAIN,
+  /* aggregates are computed incrementally, messages are not retained */
+  GBA_STREAMING,
+} GroupingByAggregateMode;
+
 void grouping_by_set_key_template(LogParser *s, LogTemplate *context_id);
 void grouping_by_set_timeout(LogParser *s, gint timeout);
 void grouping_by_set_scope(LogParser *s, CorrellationScope scope);
+void grouping_by_set_aggregate_mode(LogParser *s, GroupingByAggregateMode aggregate_mode);
 void grouping_by_set_synthetic_message(LogParser *s, SyntheticMessage *message);
 void grouping_by_set_trigger_condition(LogParser *s, FilterExprNode *filter_expr);
 void grouping_by_set_where_condition(LogParser *s, FilterExprNode *filter_expr);
 void grouping_by_set_having_condition(LogParser *s, FilterExprNode *filter_expr);
 LogParser *grouping_by_new(GlobalConfig *cfg);
+gint grouping_by_lookup_aggregate_mode(const gchar *aggregate_mode);
 void grouping_by_global_init(void);
 
 #endif
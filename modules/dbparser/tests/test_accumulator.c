@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2016 BalaBit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "accumulator.h"
+#include "testutils.h"
+#include "template_lib.h"
+#include "apphook.h"
+#include "plugin.h"
+#include "cfg.h"
+#include "logmsg/logmsg.h"
+
+#define ACCUMULATOR_TESTCASE(testfunc, ...) { testcase_begin("%s(%s)", #testfunc, #__VA_ARGS__); testfunc(__VA_ARGS__); testcase_end(); }
+
+static Accumulator *
+_compile_accumulator(const gchar *template)
+{
+  LogTemplate *value_template = log_template_new(configuration, NULL);
+  Accumulator *accumulator;
+
+  assert_true(log_template_compile(value_template, template, NULL), "error compiling template: %s", template);
+  log_template_set_name(value_template, "VALUE");
+  accumulator = accumulator_new_from_template(value_template);
+  log_template_unref(value_template);
+  return accumulator;
+}
+
+static void
+assert_accumulated_value(const gchar *template, const gchar *values[], const gchar *expected)
+{
+  Accumulator *accumulator = _compile_accumulator(template);
+  AccumulatorState state = { 0 };
+  GString *scratch = g_string_new("");
+  GString *result = g_string_new("");
+  const gchar **value;
+
+  assert_not_null(accumulator, "template should be compiled into an accumulator: %s", template);
+  assert_string(accumulator->name, "VALUE", "accumulator should inherit the name of the value");
+
+  for (value = values; *value; value++)
+    {
+      LogMessage *msg = create_empty_message();
+
+      log_msg_set_value_by_name(msg, "NUMBER", *value, -1);
+      accumulator_update(accumulator, &state, msg, scratch);
+      log_msg_unref(msg);
+    }
+
+  accumulator_format(accumulator, &state, result);
+  assert_string(result->str, expected, "accumulated value mismatch, template: %s", template);
+
+  accumulator_state_clear(&state);
+  accumulator_free(accumulator);
+  g_string_free(scratch, TRUE);
+  g_string_free(result, TRUE);
+}
+
+static void
+test_aggregate_functions_are_compiled(void)
+{
+  const gchar *values[] = { "1", "-1", "3", "1", NULL };
+
+  assert_accumulated_value("$(context-length)", values, "4");
+  assert_accumulated_value("$(sum ${NUMBER})", values, "4");
+  assert_accumulated_value("$(min ${NUMBER})", values, "-1");
+  assert_accumulated_value("$(max ${NUMBER})", values, "3");
+  assert_accumulated_value("$(average ${NUMBER})", values, "1");
+  assert_accumulated_value("$(distinct-count ${NUMBER})", values, "3");
+  assert_accumulated_value("  $(sum \"${NUMBER}\")  ", values, "4");
+  assert_accumulated_value("$(sum $(+ ${NUMBER} 1))", values, "8");
+}
+
+static void
+test_invalid_numbers_are_skipped(void)
+{
+  const gchar *values[] = { "abc", "1", "c", "2", "", NULL };
+  const gchar *invalid_values[] = { "abc", "", NULL };
+
+  assert_accumulated_value("$(sum ${NUMBER})", values, "3");
+  assert_accumulated_value("$(min ${NUMBER})", values, "1");
+  assert_accumulated_value("$(max ${NUMBER})", values, "2");
+  assert_accumulated_value("$(average ${NUMBER})", values, "1");
+  assert_accumulated_value("$(distinct-count ${NUMBER})", values, "4");
+
+  assert_accumulated_value("$(sum ${NUMBER})", invalid_values, "");
+  assert_accumulated_value("$(average ${NUMBER})", invalid_values, "");
+  assert_accumulated_value("$(distinct-count ${NONEXISTENT})", invalid_values, "0");
+}
+
+static void
+test_other_templates_are_not_compiled(void)
+{
+  const gchar *templates[] =
+  {
+    "${NUMBER}",
+    "$(echo ${NUMBER})",
+    "$(sum ${NUMBER}) total",
+    "total: $(sum ${NUMBER})",
+    "$(sum ${NUMBER}) $(max ${NUMBER})",
+    "$(sum $(+ ${NUMBER} 1) extra)",
+    NULL
+  };
+  const gchar **template;
+
+  for (template = templates; *template; template++)
+    assert_null(_compile_accumulator(*template), "template should not be compiled into an accumulator: %s", *template);
+}
+
+static void
+test_distinct_count_estimate(void)
+{
+  Accumulator *accumulator = _compile_accumulator("$(distinct-count ${NUMBER})");
+  AccumulatorState state = { 0 };
+  GString *scratch = g_string_new("");
+  GString *result = g_string_new("");
+  gchar number[16];
+  gint64 estimate;
+  gint i;
+
+  for (i = 0; i < 20000; i++)
+    {
+      LogMessage *msg = create_empty_message();
+
+      /* each value is added twice */
+      g_snprintf(number, sizeof(number), "%d", i % 10000);
+      log_msg_set_value_by_name(msg, "NUMBER", number, -1);
+      accumulator_update(accumulator, &state, msg, scratch);
+      log_msg_unref(msg);
+    }
+
+  accumulator_format(accumulator, &state, result);
+  estimate = g_ascii_strtoll(result->str, NULL, 10);
+  assert_true(estimate > 8500 && estimate < 11500, "distinct-count estimate is too far off: %s", result->str);
+
+  accumulator_state_clear(&state);
+  accumulator_free(accumulator);
+  g_string_free(scratch, TRUE);
+  g_string_free(result, TRUE);
+}
+
+int
+main(int argc, char **argv)
+{
+  app_startup();
+  init_template_tests();
+  plugin_load_module("basicfuncs", configuration, NULL);
+
+  ACCUMULATOR_TESTCASE(test_aggregate_functions_are_compiled);
+  ACCUMULATOR_TESTCASE(test_invalid_numbers_are_skipped);
+  ACCUMULATOR_TESTCASE(test_other_templates_are_not_compiled);
+  ACCUMULATOR_TESTCASE(test_distinct_count_estimate);
+
+  deinit_template_tests();
+  app_shutdown();
+  return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "geoip-cache.h"
+
+#include <iv_list.h>
+#include <string.h>
+
+typedef struct _GeoIPCacheEntry
+{
+  struct iv_list_head list;
+  guint32 ipnum;
+  GeoIPResult result;
+} GeoIPCacheEntry;
+
+typedef struct _GeoIPCacheShard
+{
+  GStaticMutex lock;
+  GHashTable *entries;
+  /* least recently used first */
+  struct iv_list_head lru;
+  gint size;
+} GeoIPCacheShard;
+
+struct _GeoIPCache
+{
+  GeoIPCacheShard shards[GEOIP_CACHE_SHARDS];
+};
+
+static inline GeoIPCacheShard *
+_get_shard(GeoIPCache *self, guint32 ipnum)
+{
+  /* neighbouring addresses are often looked up together, mix the bits */
+  return &self->shards[(ipnum * 2654435761U) >> 28];
+}
+
+static void
+_entry_free(GeoIPCacheEntry *entry)
+{
+  iv_list_del(&entry->list);
+  g_free(entry);
+}
+
+gboolean
+geoip_cache_lookup(GeoIPCache *self, guint32 ipnum, GeoIPResult *result)
+{
+  GeoIPCacheShard *shard = _get_shard(self, ipnum);
+  GeoIPCacheEntry *entry;
+
+  g_static_mutex_lock(&shard->lock);
+  entry = g_hash_table_lookup(shard->entries, &ipnum);
+  if (entry)
+    {
+      iv_list_del(&entry->list);
+      iv_list_add_tail(&entry->list, &shard->lru);
+      *result = entry->result;
+    }
+  g_static_mutex_unlock(&shard->lock);
+  return entry != NULL;
+}
+
+void
+geoip_cache_store(GeoIPCache *self, guint32 ipnum, const GeoIPResult *result)
+{
+  GeoIPCacheShard *shard = _get_shard(self, ipnum);
+  GeoIPCacheEntry *entry;
+
+  g_static_mutex_lock(&shard->lock);
+  entry = g_hash_table_lookup(shard->entries, &ipnum);
+  if (!entry)
+    {
+      if ((gint) g_hash_table_size(shard->entries) >= shard->size)
+        {
+          /* reuse the least recently used entry */
+          entry = iv_list_entry(shard->lru.next, GeoIPCacheEntry, list);
+          g_hash_table_steal(shard->entries, &entry->ipnum);
+        }
+      else
+        {
+          entry = g_new(GeoIPCacheEntry, 1);
+          INIT_IV_LIST_HEAD(&entry->list);
+        }
+      entry->ipnum = ipnum;
+      g_hash_table_insert(shard->entries, &entry->ipnum, entry);
+    }
+  iv_list_del(&entry->list);
+  iv_list_add_tail(&entry->list, &shard->lru);
+  entry->result = *result;
+  g_static_mutex_unlock(&shard->lock);
+}
+
+GeoIPCache *
+geoip_cache_new(gint size)
+{
+  GeoIPCache *self = g_new0(GeoIPCache, 1);
+  gint i;
+
+  for (i = 0; i < GEOIP_CACHE_SHARDS; i++)
+    {
+      GeoIPCacheShard *shard = &self->shards[i];
+
+      g_static_mutex_init(&shard->lock);
+      shard->entries = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, (GDestroyNotify) _entry_free);
+      INIT_IV_LIST_HEAD(&shard->lru);
+      shard->size = MAX((size + GEOIP_CACHE_SHARDS - 1) / GEOIP_CACHE_SHARDS, 1);
+    }
+  return self;
+}
+
+void
+geoip_cache_free(GeoIPCache *self)
+{
+  gint i;
+
+  for (i = 0; i < GEOIP_CACHE_SHARDS; i++)
+    {
+      g_hash_table_destroy(self->shards[i].entries);
+      g_static_mutex_free(&self->shards[i].lock);
+    }
+  g_free(self);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef GEOIP_CACHE_H_INCLUDED
+#define GEOIP_CACHE_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/*
+ * The result of a lookup, formatted the way it is stored in the message.
+ * Empty strings stand for fields the database had no value for.
+ */
+typedef struct _GeoIPResult
+{
+  gchar country_code[4];
+  gchar latitude[32];
+  gchar longitude[32];
+} GeoIPResult;
+
+typedef struct _GeoIPCache GeoIPCache;
+
+#define GEOIP_CACHE_SHARDS 16
+
+/*
+ * Bounded LRU cache of lookup results keyed by IPv4 address.  It is
+ * shared by the threads using the parser, the addresses are spread over
+ * GEOIP_CACHE_SHARDS independently locked shards, each evicting its own
+ * least recently used entry.  @size is split evenly between the shards,
+ * so it is rounded up to a multiple of GEOIP_CACHE_SHARDS: cache-size()
+ * values below that hold one entry per shard.
+ */
+GeoIPCache *geoip_cache_new(gint size);
+void geoip_cache_free(GeoIPCache *self);
+
+gboolean geoip_cache_lookup(GeoIPCache *self, guint32 ipnum, GeoIPResult *result);
+void geoip_cache_store(GeoIPCache *self, guint32 ipnum, const GeoIPResult *result);
+
+#endif
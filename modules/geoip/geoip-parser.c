@@ -22,25 +22,32 @@
  */
 
 #include "geoip-parser.h"
+#include "geoip-cache.h"
 #include "parser/parser-expr.h"
-#include "scratch-buffers.h"
+#include "stats/stats-registry.h"
 
 #include <GeoIPCity.h>
+#include <arpa/inet.h>
 
 typedef struct
 {
   LogParser super;
   GeoIP *gi;
+  GeoIPCache *cache;
+  gint cache_size;
 
   gchar *database;
   gchar *prefix;
 
   struct
   {
-    gchar *country_code;
-    gchar *longitude;
-    gchar *latitude;
+    NVHandle country_code;
+    NVHandle longitude;
+    NVHandle latitude;
   } dest;
+
+  StatsCounterItem *cache_hits;
+  StatsCounterItem *cache_misses;
 } GeoIPParser;
 
 void
@@ -52,17 +59,22 @@ geoip_parser_set_prefix(LogParser *s, const gchar *prefix)
   self->prefix = g_strdup(prefix);
 }
 
-static void
-geoip_parser_reset_fields(GeoIPParser *self)
+static NVHandle
+_get_field_handle(GeoIPParser *self, const gchar *field)
 {
-  g_free(self->dest.country_code);
-  self->dest.country_code = g_strdup_printf("%scountry_code", self->prefix);
+  gchar *name = g_strdup_printf("%s%s", self->prefix, field);
+  NVHandle handle = log_msg_get_value_handle(name);
 
-  g_free(self->dest.longitude);
-  self->dest.longitude = g_strdup_printf("%slongitude", self->prefix);
+  g_free(name);
+  return handle;
+}
 
-  g_free(self->dest.latitude);
-  self->dest.latitude = g_strdup_printf("%slatitude", self->prefix);
+static void
+geoip_parser_reset_fields(GeoIPParser *self)
+{
+  self->dest.country_code = _get_field_handle(self, "country_code");
+  self->dest.longitude = _get_field_handle(self, "longitude");
+  self->dest.latitude = _get_field_handle(self, "latitude");
 }
 
 void
@@ -74,57 +86,110 @@ geoip_parser_set_database(LogParser *s, const gchar *database)
   self->database = g_strdup(database);
 }
 
-static gboolean
-geoip_parser_process(LogParser *s, LogMessage **pmsg,
-                     const LogPathOptions *path_options,
-                     const gchar *input, gsize input_len)
+void
+geoip_parser_set_cache_size(LogParser *s, gint cache_size)
 {
   GeoIPParser *self = (GeoIPParser *) s;
-  LogMessage *msg = log_msg_make_writable(pmsg, path_options);
-  GeoIPRecord *record;
-  SBGString *value;
 
-  if (!self->dest.country_code &&
-      !self->dest.latitude &&
-      !self->dest.longitude)
-    return TRUE;
+  self->cache_size = cache_size;
+}
 
-  record = GeoIP_record_by_name(self->gi, input);
+static void
+_format_result(GeoIPResult *result, GeoIPRecord *record, const gchar *country)
+{
+  memset(result, 0, sizeof(*result));
 
   if (!record)
     {
-      const char *country;
-
-      country = GeoIP_country_code_by_name(self->gi, input);
       if (country)
-        log_msg_set_value_by_name(msg, self->dest.country_code,
-                                  country,
-                                  strlen(country));
-
-      return TRUE;
+        g_strlcpy(result->country_code, country, sizeof(result->country_code));
+      return;
     }
 
   if (record->country_code)
-    log_msg_set_value_by_name(msg, self->dest.country_code,
-                              record->country_code,
-                              strlen(record->country_code));
+    g_strlcpy(result->country_code, record->country_code, sizeof(result->country_code));
+  g_snprintf(result->latitude, sizeof(result->latitude), "%f", record->latitude);
+  g_snprintf(result->longitude, sizeof(result->longitude), "%f", record->longitude);
+  GeoIPRecord_delete(record);
+}
 
-  value = sb_gstring_acquire();
+static void
+_lookup_by_ipnum(GeoIPParser *self, guint32 ipnum, GeoIPResult *result)
+{
+  GeoIPRecord *record = GeoIP_record_by_ipnum(self->gi, ipnum);
 
-  g_string_printf(sb_gstring_string(value), "%f",
-                  record->latitude);
-  log_msg_set_value_by_name(msg, self->dest.latitude,
-                            sb_gstring_string(value)->str,
-                            sb_gstring_string(value)->len);
+  _format_result(result, record, record ? NULL : GeoIP_country_code_by_ipnum(self->gi, ipnum));
+}
 
-  g_string_printf(sb_gstring_string(value), "%f",
-                  record->longitude);
-  log_msg_set_value_by_name(msg, self->dest.longitude,
-                            sb_gstring_string(value)->str,
-                            sb_gstring_string(value)->len);
+static void
+_lookup_by_name(GeoIPParser *self, const gchar *input, GeoIPResult *result)
+{
+  GeoIPRecord *record = GeoIP_record_by_name(self->gi, input);
 
-  GeoIPRecord_delete(record);
-  sb_gstring_release(value);
+  _format_result(result, record, record ? NULL : GeoIP_country_code_by_name(self->gi, input));
+}
+
+static gboolean
+_parse_ipv4_address(const gchar *input, gsize input_len, guint32 *ipnum)
+{
+  gchar buf[INET_ADDRSTRLEN];
+  struct in_addr addr;
+
+  if (input_len >= sizeof(buf))
+    return FALSE;
+
+  memcpy(buf, input, input_len);
+  buf[input_len] = 0;
+  if (inet_pton(AF_INET, buf, &addr) != 1)
+    return FALSE;
+
+  *ipnum = ntohl(addr.s_addr);
+  return TRUE;
+}
+
+static void
+_set_field(LogMessage *msg, NVHandle handle, const gchar *value)
+{
+  if (value[0])
+    log_msg_set_value(msg, handle, value, strlen(value));
+}
+
+/*
+ * Only IPv4 addresses are cached, anything else (e.g. a hostname, which
+ * GeoIP resolves on its own) is looked up every time.
+ */
+static gboolean
+geoip_parser_process(LogParser *s, LogMessage **pmsg,
+                     const LogPathOptions *path_options,
+                     const gchar *input, gsize input_len)
+{
+  GeoIPParser *self = (GeoIPParser *) s;
+  LogMessage *msg = log_msg_make_writable(pmsg, path_options);
+  GeoIPResult result;
+  guint32 ipnum;
+
+  if (!_parse_ipv4_address(input, input_len, &ipnum))
+    {
+      _lookup_by_name(self, input, &result);
+    }
+  else if (!self->cache)
+    {
+      _lookup_by_ipnum(self, ipnum, &result);
+    }
+  else if (geoip_cache_lookup(self->cache, ipnum, &result))
+    {
+      stats_counter_inc(self->cache_hits);
+    }
+  else
+    {
+      stats_counter_inc(self->cache_misses);
+      _lookup_by_ipnum(self, ipnum, &result);
+      geoip_cache_store(self->cache, ipnum, &result);
+    }
+
+  _set_field(msg, self->dest.country_code, result.country_code);
+  _set_field(msg, self->dest.latitude, result.latitude);
+  _set_field(msg, self->dest.longitude, result.longitude);
 
   return TRUE;
 }
@@ -139,6 +204,7 @@ geoip_parser_clone(LogPipe *s)
 
   geoip_parser_set_database(&cloned->super, self->database);
   geoip_parser_set_prefix(&cloned->super, self->prefix);
+  geoip_parser_set_cache_size(&cloned->super, self->cache_size);
   geoip_parser_reset_fields(cloned);
 
   return &cloned->super.super;
@@ -149,9 +215,6 @@ geoip_parser_free(LogPipe *s)
 {
   GeoIPParser *self = (GeoIPParser *) s;
 
-  g_free(self->dest.country_code);
-  g_free(self->dest.latitude);
-  g_free(self->dest.longitude);
   g_free(self->database);
   g_free(self->prefix);
 
@@ -160,6 +223,29 @@ geoip_parser_free(LogPipe *s)
   log_parser_free_method(s);
 }
 
+static void
+_register_cache_stats(GeoIPParser *self, gboolean register_counters)
+{
+  gchar *hits_instance = g_strdup_printf("%s,cache_hits", self->super.name);
+  gchar *misses_instance = g_strdup_printf("%s,cache_misses", self->super.name);
+
+  stats_lock();
+  if (register_counters)
+    {
+      stats_register_counter(1, SCS_GLOBAL, "geoip", hits_instance, SC_TYPE_PROCESSED, &self->cache_hits);
+      stats_register_counter(1, SCS_GLOBAL, "geoip", misses_instance, SC_TYPE_PROCESSED, &self->cache_misses);
+    }
+  else
+    {
+      stats_unregister_counter(SCS_GLOBAL, "geoip", hits_instance, SC_TYPE_PROCESSED, &self->cache_hits);
+      stats_unregister_counter(SCS_GLOBAL, "geoip", misses_instance, SC_TYPE_PROCESSED, &self->cache_misses);
+    }
+  stats_unlock();
+
+  g_free(hits_instance);
+  g_free(misses_instance);
+}
+
 static gboolean
 geoip_parser_init(LogPipe *s)
 {
@@ -171,7 +257,29 @@ geoip_parser_init(LogPipe *s)
 
   if (!self->gi)
     return FALSE;
-  return log_parser_init_method(s);
+  if (!log_parser_init_method(s))
+    return FALSE;
+
+  if (self->cache_size > 0)
+    {
+      self->cache = geoip_cache_new(self->cache_size);
+      _register_cache_stats(self, TRUE);
+    }
+  return TRUE;
+}
+
+static gboolean
+geoip_parser_deinit(LogPipe *s)
+{
+  GeoIPParser *self = (GeoIPParser *) s;
+
+  if (self->cache)
+    {
+      _register_cache_stats(self, FALSE);
+      geoip_cache_free(self->cache);
+      self->cache = NULL;
+    }
+  return TRUE;
 }
 
 LogParser *
@@ -181,12 +289,14 @@ geoip_parser_new(GlobalConfig *cfg)
 
   log_parser_init_instance(&self->super, cfg);
   self->super.super.init = geoip_parser_init;
+  self->super.super.deinit = geoip_parser_deinit;
   self->super.super.free_fn = geoip_parser_free;
   self->super.super.clone = geoip_parser_clone;
   self->super.process = geoip_parser_process;
 
   geoip_parser_set_database(&self->super, "/usr/share/GeoIP/GeoIP.dat");
   geoip_parser_set_prefix(&self->super, ".geoip.");
+  geoip_parser_set_cache_size(&self->super, 4096);
 
   return &self->super;
 }
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include "geoip-cache.h"
+#include "testutils.h"
+
+#include <string.h>
+
+static GeoIPResult
+_result(const gchar *country_code)
+{
+  GeoIPResult result;
+
+  memset(&result, 0, sizeof(result));
+  g_strlcpy(result.country_code, country_code, sizeof(result.country_code));
+  g_snprintf(result.latitude, sizeof(result.latitude), "%s-lat", country_code);
+  g_snprintf(result.longitude, sizeof(result.longitude), "%s-long", country_code);
+  return result;
+}
+
+static void
+_store(GeoIPCache *cache, guint32 ipnum, const gchar *country_code)
+{
+  GeoIPResult result = _result(country_code);
+
+  geoip_cache_store(cache, ipnum, &result);
+}
+
+static void
+_assert_cached(GeoIPCache *cache, guint32 ipnum, const gchar *country_code)
+{
+  GeoIPResult result, expected = _result(country_code);
+
+  assert_true(geoip_cache_lookup(cache, ipnum, &result), "Address should be cached, ipnum=%u", ipnum);
+  assert_string(result.country_code, expected.country_code, "Cached country code mismatch, ipnum=%u", ipnum);
+  assert_string(result.latitude, expected.latitude, "Cached latitude mismatch, ipnum=%u", ipnum);
+  assert_string(result.longitude, expected.longitude, "Cached longitude mismatch, ipnum=%u", ipnum);
+}
+
+static void
+_assert_not_cached(GeoIPCache *cache, guint32 ipnum)
+{
+  GeoIPResult result;
+
+  assert_false(geoip_cache_lookup(cache, ipnum, &result), "Address should not be cached, ipnum=%u", ipnum);
+}
+
+/*
+ * Addresses are spread over the shards by a hash, find one that lands in
+ * the same shard as @ipnum: with a single entry per shard, storing it
+ * evicts @ipnum.
+ */
+static guint32
+_find_address_in_the_same_shard(guint32 ipnum, guint32 start)
+{
+  GeoIPCache *probe = geoip_cache_new(GEOIP_CACHE_SHARDS);
+  GeoIPResult result = _result("XX");
+  guint32 candidate;
+
+  for (candidate = start; ; candidate++)
+    {
+      if (candidate == ipnum)
+        continue;
+      geoip_cache_store(probe, ipnum, &result);
+      geoip_cache_store(probe, candidate, &result);
+      if (!geoip_cache_lookup(probe, ipnum, &result))
+        break;
+    }
+  geoip_cache_free(probe);
+  return candidate;
+}
+
+static void
+test_lookup_returns_the_stored_result(void)
+{
+  GeoIPCache *cache = geoip_cache_new(1024);
+
+  testcase_begin("%s", __FUNCTION__);
+  _assert_not_cached(cache, 0x0a000001);
+
+  _store(cache, 0x0a000001, "HU");
+  _store(cache, 0x0a000002, "AT");
+  _assert_cached(cache, 0x0a000001, "HU");
+  _assert_cached(cache, 0x0a000002, "AT");
+  _assert_not_cached(cache, 0x0a000003);
+
+  _store(cache, 0x0a000001, "DE");
+  _assert_cached(cache, 0x0a000001, "DE");
+
+  geoip_cache_free(cache);
+  testcase_end();
+}
+
+static void
+test_least_recently_used_entry_is_evicted(void)
+{
+  guint32 a = 0xc0a80001;
+  guint32 b = _find_address_in_the_same_shard(a, 0xc0a80100);
+  guint32 c = _find_address_in_the_same_shard(a, b + 1);
+  GeoIPCache *cache = geoip_cache_new(2 * GEOIP_CACHE_SHARDS);
+
+  testcase_begin("%s", __FUNCTION__);
+  _store(cache, a, "HU");
+  _store(cache, b, "AT");
+  _store(cache, c, "DE");
+
+  _assert_not_cached(cache, a);
+  _assert_cached(cache, b, "AT");
+  _assert_cached(cache, c, "DE");
+
+  geoip_cache_free(cache);
+  testcase_end();
+}
+
+static void
+test_lookup_refreshes_the_entry(void)
+{
+  guint32 a = 0xc0a80001;
+  guint32 b = _find_address_in_the_same_shard(a, 0xc0a80100);
+  guint32 c = _find_address_in_the_same_shard(a, b + 1);
+  guint32 d = _find_address_in_the_same_shard(a, c + 1);
+  GeoIPCache *cache = geoip_cache_new(2 * GEOIP_CACHE_SHARDS);
+
+  testcase_begin("%s", __FUNCTION__);
+  _store(cache, a, "HU");
+  _store(cache, b, "AT");
+  _assert_cached(cache, a, "HU");
+  _store(cache, c, "DE");
+
+  _assert_cached(cache, a, "HU");
+  _assert_not_cached(cache, b);
+  _assert_cached(cache, c, "DE");
+
+  /* storing an address that is already cached refreshes it as well */
+  _store(cache, a, "SK");
+  _store(cache, d, "PL");
+
+  _assert_cached(cache, a, "SK");
+  _assert_not_cached(cache, c);
+  _assert_cached(cache, d, "PL");
+
+  geoip_cache_free(cache);
+  testcase_end();
+}
+
+static void
+test_evicted_entries_are_reused(void)
+{
+  GeoIPCache *cache = geoip_cache_new(GEOIP_CACHE_SHARDS);
+  GeoIPResult result;
+  guint32 ipnum;
+  gint cached = 0;
+
+  testcase_begin("%s", __FUNCTION__);
+  for (ipnum = 0x0a000000; ipnum < 0x0a000000 + 1000; ipnum++)
+    {
+      _store(cache, ipnum, ipnum % 2 ? "HU" : "AT");
+      _assert_cached(cache, ipnum, ipnum % 2 ? "HU" : "AT");
+    }
+
+  for (ipnum = 0x0a000000; ipnum < 0x0a000000 + 1000; ipnum++)
+    {
+      if (geoip_cache_lookup(cache, ipnum, &result))
+        {
+          assert_string(result.country_code, ipnum % 2 ? "HU" : "AT",
+                        "Reused entry returned a stale result, ipnum=%u", ipnum);
+          cached++;
+        }
+    }
+  assert_true(cached > 0 && cached <= GEOIP_CACHE_SHARDS,
+              "The cache should hold at most one entry per shard, cached=%d", cached);
+
+  geoip_cache_free(cache);
+  testcase_end();
+}
+
+static void
+test_small_sizes_keep_an_entry_per_shard(void)
+{
+  guint32 a = 0xc0a80001;
+  guint32 b = _find_address_in_the_same_shard(a, 0xc0a80100);
+  GeoIPCache *cache = geoip_cache_new(1);
+  GeoIPResult result;
+  guint32 ipnum;
+  gint cached = 0;
+
+  testcase_begin("%s", __FUNCTION__);
+  for (ipnum = 0x0a000000; ipnum < 0x0a000000 + 1000; ipnum++)
+    _store(cache, ipnum, "HU");
+  for (ipnum = 0x0a000000; ipnum < 0x0a000000 + 1000; ipnum++)
+    cached += geoip_cache_lookup(cache, ipnum, &result);
+  assert_gint(cached, GEOIP_CACHE_SHARDS, "A cache-size() below the number of shards is rounded up");
+
+  _store(cache, a, "AT");
+  _store(cache, b, "DE");
+  _assert_not_cached(cache, a);
+  _assert_cached(cache, b, "DE");
+
+  geoip_cache_free(cache);
+  testcase_end();
+}
+
+int
+main(int argc, char **argv)
+{
+  test_lookup_returns_the_stored_result();
+  test_least_recently_used_entry_is_evicted();
+  test_lookup_refreshes_the_entry();
+  test_evicted_entries_are_reused();
+  test_small_sizes_keep_an_entry_per_shard();
+  return 0;
+}
@@ -37,6 +37,11 @@ static CfgLexerKeyword http_keywords[] = {
   { "headers",      KW_HEADERS },
   { "method",       KW_METHOD },
   { "body",         KW_BODY },
+  { "batch_bytes",  KW_BATCH_BYTES },
+  { "body_prefix",  KW_BODY_PREFIX },
+  { "body_suffix",  KW_BODY_SUFFIX },
+  { "delimiter",    KW_DELIMITER },
+  { "compress",     KW_COMPRESS },
   { NULL }
 };
 
@@ -27,6 +27,9 @@
 #define METHOD_TYPE_POST 1
 #define METHOD_TYPE_PUT  2
 
+/* X-Syslog-Host, X-Syslog-Program, X-Syslog-Facility and X-Syslog-Level */
+#define HTTP_SYSLOG_HEADERS 4
+
 #include "logthrdestdrv.h"
 
 typedef struct
@@ -41,6 +44,17 @@ typedef struct
   short int method_type;
   LogTemplate *body_template;
   LogTemplateOptions template_options;
+
+  /* batching */
+  glong batch_bytes;
+  gchar *body_prefix;
+  gchar *body_suffix;
+  gchar *delimiter;
+  gboolean compress;
+  GString *request_body;
+  GString *compressed_body;
+  GString *syslog_headers[HTTP_SYSLOG_HEADERS];
+  GString *batch_syslog_headers[HTTP_SYSLOG_HEADERS];
 } HTTPDestinationDriver;
 
 gboolean http_dd_init(LogPipe *s);
@@ -53,6 +67,11 @@ void http_dd_set_method(LogDriver *d, const gchar *method);
 void http_dd_set_user_agent(LogDriver *d, const gchar *user_agent);
 void http_dd_set_headers(LogDriver *d, GList *headers);
 void http_dd_set_body(LogDriver *d, LogTemplate *body);
+void http_dd_set_batch_bytes(LogDriver *d, glong batch_bytes);
+void http_dd_set_body_prefix(LogDriver *d, const gchar *body_prefix);
+void http_dd_set_body_suffix(LogDriver *d, const gchar *body_suffix);
+void http_dd_set_delimiter(LogDriver *d, const gchar *delimiter);
+void http_dd_set_compress(LogDriver *d, gboolean compress);
 LogTemplateOptions *http_dd_get_template_options(LogDriver *d);
 
 #endif
@@ -21,10 +21,15 @@
  */
 
 #include <curl/curl.h>
+#include <string.h>
 
 #include "syslog-names.h"
 #include "http-plugin.h"
 
+#if SYSLOG_NG_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 static gchar *
 _format_persist_name(LogThrDestDriver *s)
 {
@@ -56,6 +61,40 @@ _http_write_cb(char *ptr, size_t size, size_t nmemb, void *userdata)
     return nmemb * size;
 }
 
+static gboolean
+_is_batching_enabled(HTTPDestinationDriver *self)
+{
+  return self->super.batch.lines > 1 || self->super.batch.timeout > 0 || self->batch_bytes > 0;
+}
+
+/* options that do not change between requests are only set once, so the
+ * same handle (and its keep-alive connection) is reused for every request */
+static void
+_set_static_curl_opts(HTTPDestinationDriver *self)
+{
+  curl_easy_reset(self->curl);
+
+  curl_easy_setopt(self->curl, CURLOPT_WRITEFUNCTION, _http_write_cb);
+
+  curl_easy_setopt(self->curl, CURLOPT_URL, self->url);
+
+  if (self->user)
+    curl_easy_setopt(self->curl, CURLOPT_USERNAME, self->user);
+
+  if (self->password)
+    curl_easy_setopt(self->curl, CURLOPT_PASSWORD, self->password);
+
+  if (self->user_agent)
+    curl_easy_setopt(self->curl, CURLOPT_USERAGENT, self->user_agent);
+
+#if LIBCURL_VERSION_NUM >= 0x071900
+  curl_easy_setopt(self->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+#endif
+
+  if (self->method_type == METHOD_TYPE_PUT)
+    curl_easy_setopt(self->curl, CURLOPT_CUSTOMREQUEST, "PUT");
+}
+
 static void
 _thread_init(LogThrDestDriver *s)
 {
@@ -65,6 +104,8 @@ _thread_init(LogThrDestDriver *s)
   if (!self->user_agent)
     self->user_agent = g_strdup_printf("syslog-ng %s/libcurl %s",
                                         SYSLOG_NG_VERSION, curl_info->version);
+
+  _set_static_curl_opts(self);
 }
 
 static void
@@ -81,114 +122,241 @@ _connect(LogThrDestDriver *s)
 static void
 _disconnect(LogThrDestDriver *s)
 {
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) s;
+
+  /* the pending batch is rewound by LogThrDestDriver */
+  g_string_truncate(self->request_body, 0);
 }
 
-static struct curl_slist *
-_get_curl_headers(HTTPDestinationDriver *self, LogMessage *msg)
+static void
+_format_syslog_headers(LogMessage *msg, GString *headers[HTTP_SYSLOG_HEADERS])
 {
-  GList *header = NULL;
-  struct curl_slist *curl_headers = NULL;
-  gchar header_host[128] = {0};
-  gchar header_program[32] = {0};
-  gchar header_facility[32] = {0};
-  gchar header_level[32] = {0};
+  g_string_printf(headers[0], "X-Syslog-Host: %s", log_msg_get_value(msg, LM_V_HOST, NULL));
+  g_string_printf(headers[1], "X-Syslog-Program: %s", log_msg_get_value(msg, LM_V_PROGRAM, NULL));
+  g_string_printf(headers[2], "X-Syslog-Facility: %s",
+                  syslog_name_lookup_name_by_value(msg->pri & LOG_FACMASK, sl_facilities));
+  g_string_printf(headers[3], "X-Syslog-Level: %s",
+                  syslog_name_lookup_name_by_value(msg->pri & LOG_PRIMASK, sl_levels));
+}
 
-  g_snprintf(header_host, sizeof(header_host),
-    "X-Syslog-Host: %s", log_msg_get_value(msg, LM_V_HOST, NULL));
-  curl_headers = curl_slist_append(curl_headers, header_host);
+/* a batch only carries the X-Syslog-* headers all of its messages agree on,
+ * the others are left empty */
+static void
+_merge_batch_syslog_headers(HTTPDestinationDriver *self, LogMessage *msg)
+{
+  gint i;
 
-  g_snprintf(header_program, sizeof(header_program),
-    "X-Syslog-Program: %s", log_msg_get_value(msg, LM_V_PROGRAM, NULL));
-  curl_headers = curl_slist_append(curl_headers, header_program);
+  if (self->super.batch.size == 0)
+    {
+      _format_syslog_headers(msg, self->batch_syslog_headers);
+      return;
+    }
 
-  g_snprintf(header_facility, sizeof(header_facility),
-    "X-Syslog-Facility: %s", syslog_name_lookup_name_by_value(msg->pri & LOG_FACMASK, sl_facilities));
-  curl_headers = curl_slist_append(curl_headers, header_facility);
+  _format_syslog_headers(msg, self->syslog_headers);
+  for (i = 0; i < HTTP_SYSLOG_HEADERS; i++)
+    {
+      if (!g_string_equal(self->batch_syslog_headers[i], self->syslog_headers[i]))
+        g_string_truncate(self->batch_syslog_headers[i], 0);
+    }
+}
 
-  g_snprintf(header_level, sizeof(header_level),
-    "X-Syslog-Level: %s", syslog_name_lookup_name_by_value(msg->pri & LOG_PRIMASK, sl_levels));
-  curl_headers = curl_slist_append(curl_headers, header_level);
+static struct curl_slist *
+_get_curl_headers(HTTPDestinationDriver *self, GString *syslog_headers[HTTP_SYSLOG_HEADERS])
+{
+  GList *header;
+  struct curl_slist *curl_headers = NULL;
+  gint i;
 
-  header = self->headers;
-  while (header != NULL) {
+  for (i = 0; i < HTTP_SYSLOG_HEADERS; i++)
+    {
+      if (syslog_headers[i]->len > 0)
+        curl_headers = curl_slist_append(curl_headers, syslog_headers[i]->str);
+    }
+
+  for (header = self->headers; header; header = g_list_next(header))
     curl_headers = curl_slist_append(curl_headers, (gchar *)header->data);
-    header = g_list_next(header);
-  }
+
+  if (self->compress)
+    curl_headers = curl_slist_append(curl_headers, "Content-Encoding: gzip");
 
   return curl_headers;
 }
 
-static GString *
-_get_body_rendered(HTTPDestinationDriver *self, LogMessage *msg)
+static void
+_append_body_rendered(HTTPDestinationDriver *self, LogMessage *msg, GString *body)
 {
-  GString *body_rendered = NULL;
+  if (self->body_template)
+    log_template_append_format(self->body_template, msg, &self->template_options, LTZ_SEND,
+                               self->super.seq_num, NULL, body);
+  else
+    {
+      gssize len;
+      const gchar *value = log_msg_get_value(msg, LM_V_MESSAGE, &len);
 
-  if (self->body_template) {
-    body_rendered = g_string_new(NULL);
-    log_template_format(self->body_template, msg, &self->template_options, LTZ_SEND,
-                        self->super.seq_num, NULL, body_rendered);
-  }
-  return body_rendered;
+      g_string_append_len(body, value, len);
+    }
 }
 
-static void
-_set_curl_opt(HTTPDestinationDriver *self, LogMessage *msg, struct curl_slist *curl_headers, GString *body_rendered)
+#if SYSLOG_NG_HAVE_ZLIB
+static gboolean
+_compress_body(GString *compressed, const GString *body)
 {
-  curl_easy_reset(self->curl);
+  z_stream zs;
+  gint rc;
 
-  curl_easy_setopt(self->curl, CURLOPT_WRITEFUNCTION, _http_write_cb);
-
-  curl_easy_setopt(self->curl, CURLOPT_URL, self->url);
-
-  if (self->user)
-    curl_easy_setopt(self->curl, CURLOPT_USERNAME, self->user);
+  memset(&zs, 0, sizeof(zs));
 
-  if (self->password)
-    curl_easy_setopt(self->curl, CURLOPT_PASSWORD, self->password);
+  /* 16 added to the window bits selects the gzip wrapper */
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return FALSE;
 
-  if (self->user_agent)
-    curl_easy_setopt(self->curl, CURLOPT_USERAGENT, self->user_agent);
+  g_string_set_size(compressed, deflateBound(&zs, body->len) + 32);
+  zs.next_in = (Bytef *) body->str;
+  zs.avail_in = body->len;
+  zs.next_out = (Bytef *) compressed->str;
+  zs.avail_out = compressed->len;
 
+  rc = deflate(&zs, Z_FINISH);
+  deflateEnd(&zs);
 
-  curl_easy_setopt(self->curl, CURLOPT_HTTPHEADER, curl_headers);
+  if (rc != Z_STREAM_END)
+    return FALSE;
 
-  const gchar *body = body_rendered ? body_rendered->str : log_msg_get_value(msg, LM_V_MESSAGE, NULL);
+  g_string_truncate(compressed, zs.total_out);
+  return TRUE;
+}
+#endif
 
-  curl_easy_setopt(self->curl, CURLOPT_POSTFIELDS, body);
-  if (self->method_type == METHOD_TYPE_PUT)
-    curl_easy_setopt(self->curl, CURLOPT_CUSTOMREQUEST, "PUT");
+static worker_insert_result_t
+_map_http_status_to_worker_status(HTTPDestinationDriver *self, glong http_code)
+{
+  if (http_code >= 500)
+    {
+      msg_error("http: server returned an error, retrying",
+                evt_tag_str("url", self->url),
+                evt_tag_int("status_code", http_code),
+                evt_tag_str("driver", self->super.super.super.id));
+      return WORKER_INSERT_RESULT_ERROR;
+    }
+  if (http_code >= 400)
+    {
+      msg_error("http: server rejected the request, dropping messages",
+                evt_tag_str("url", self->url),
+                evt_tag_int("status_code", http_code),
+                evt_tag_str("driver", self->super.super.super.id));
+      return WORKER_INSERT_RESULT_REJECTED;
+    }
+  return WORKER_INSERT_RESULT_SUCCESS;
 }
 
 static worker_insert_result_t
-_insert(LogThrDestDriver *s, LogMessage *msg)
+_send_request(HTTPDestinationDriver *self, struct curl_slist *curl_headers, GString *body)
 {
   CURLcode ret;
+  glong http_code = 0;
 
-  HTTPDestinationDriver *self = (HTTPDestinationDriver *) s;
-
-  struct curl_slist * curl_headers = _get_curl_headers(self, msg);
-  GString *body_rendered = _get_body_rendered(self, msg);
+#if SYSLOG_NG_HAVE_ZLIB
+  if (self->compress)
+    {
+      if (!_compress_body(self->compressed_body, body))
+        {
+          msg_error("http: error compressing request body",
+                    evt_tag_str("driver", self->super.super.super.id));
+          return WORKER_INSERT_RESULT_DROP;
+        }
+      body = self->compressed_body;
+    }
+#endif
 
-  _set_curl_opt(self, msg, curl_headers, body_rendered);
+  curl_easy_setopt(self->curl, CURLOPT_HTTPHEADER, curl_headers);
+  curl_easy_setopt(self->curl, CURLOPT_POSTFIELDS, body->str);
+  curl_easy_setopt(self->curl, CURLOPT_POSTFIELDSIZE, (long) body->len);
 
-  if ((ret = curl_easy_perform(self->curl)) != CURLE_OK) {
+  if ((ret = curl_easy_perform(self->curl)) != CURLE_OK)
+    {
       msg_error("curl: error sending HTTP request",
                 evt_tag_str("error", curl_easy_strerror(ret)));
+      return WORKER_INSERT_RESULT_ERROR;
+    }
 
-      if (body_rendered)
-        g_string_free(body_rendered, TRUE);
+  curl_easy_getinfo(self->curl, CURLINFO_RESPONSE_CODE, &http_code);
+  return _map_http_status_to_worker_status(self, http_code);
+}
 
-      curl_slist_free_all(curl_headers);
+static worker_insert_result_t
+_insert_single(HTTPDestinationDriver *self, LogMessage *msg)
+{
+  worker_insert_result_t result;
+  struct curl_slist *curl_headers;
 
-      return WORKER_INSERT_RESULT_ERROR;
-  }
+  _format_syslog_headers(msg, self->syslog_headers);
+  curl_headers = _get_curl_headers(self, self->syslog_headers);
+
+  g_string_truncate(self->request_body, 0);
+  _append_body_rendered(self, msg, self->request_body);
 
-  if (body_rendered)
-    g_string_free(body_rendered, TRUE);
+  result = _send_request(self, curl_headers, self->request_body);
 
+  g_string_truncate(self->request_body, 0);
   curl_slist_free_all(curl_headers);
 
-  return WORKER_INSERT_RESULT_SUCCESS;
+  return result;
+}
+
+static worker_insert_result_t
+_insert_batched(HTTPDestinationDriver *self, LogMessage *msg)
+{
+  _merge_batch_syslog_headers(self, msg);
+
+  if (self->super.batch.size == 0)
+    {
+      g_string_truncate(self->request_body, 0);
+      if (self->body_prefix)
+        g_string_append(self->request_body, self->body_prefix);
+    }
+  else
+    {
+      g_string_append(self->request_body, self->delimiter);
+    }
+
+  _append_body_rendered(self, msg, self->request_body);
+
+  if (self->batch_bytes > 0 && self->request_body->len >= self->batch_bytes)
+    self->super.batch.flush_requested = TRUE;
+
+  return WORKER_INSERT_RESULT_QUEUED;
+}
+
+static worker_insert_result_t
+_insert(LogThrDestDriver *s, LogMessage *msg)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) s;
+
+  if (_is_batching_enabled(self))
+    return _insert_batched(self, msg);
+
+  return _insert_single(self, msg);
+}
+
+static worker_insert_result_t
+_flush(LogThrDestDriver *s)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) s;
+  worker_insert_result_t result;
+  struct curl_slist *curl_headers;
+
+  if (self->super.batch.size == 0)
+    return WORKER_INSERT_RESULT_SUCCESS;
+
+  if (self->body_suffix)
+    g_string_append(self->request_body, self->body_suffix);
+
+  curl_headers = _get_curl_headers(self, self->batch_syslog_headers);
+  result = _send_request(self, curl_headers, self->request_body);
+
+  g_string_truncate(self->request_body, 0);
+  curl_slist_free_all(curl_headers);
+  return result;
 }
 
 void
@@ -268,6 +436,49 @@ http_dd_set_body(LogDriver *d, LogTemplate *body)
   self->body_template = log_template_ref(body);
 }
 
+void
+http_dd_set_batch_bytes(LogDriver *d, glong batch_bytes)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  self->batch_bytes = batch_bytes;
+}
+
+void
+http_dd_set_body_prefix(LogDriver *d, const gchar *body_prefix)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  g_free(self->body_prefix);
+  self->body_prefix = g_strdup(body_prefix);
+}
+
+void
+http_dd_set_body_suffix(LogDriver *d, const gchar *body_suffix)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  g_free(self->body_suffix);
+  self->body_suffix = g_strdup(body_suffix);
+}
+
+void
+http_dd_set_delimiter(LogDriver *d, const gchar *delimiter)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  g_free(self->delimiter);
+  self->delimiter = g_strdup(delimiter);
+}
+
+void
+http_dd_set_compress(LogDriver *d, gboolean compress)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  self->compress = compress;
+}
+
 LogTemplateOptions *
 http_dd_get_template_options(LogDriver *d)
 {
@@ -291,6 +502,15 @@ http_dd_init(LogPipe *s)
     self->url = g_strdup(HTTP_DEFAULT_URL);
   }
 
+#if !SYSLOG_NG_HAVE_ZLIB
+  if (self->compress)
+    {
+      msg_warning("WARNING: syslog-ng was compiled without zlib support, compress() is ignored",
+                  evt_tag_str("driver", self->super.super.super.id));
+      self->compress = FALSE;
+    }
+#endif
+
   return log_threaded_dest_driver_start(s);
 }
 
@@ -304,6 +524,7 @@ static void
 http_dd_free(LogPipe *s)
 {
   HTTPDestinationDriver *self = (HTTPDestinationDriver *)s;
+  gint i;
 
   curl_easy_cleanup(self->curl);
   curl_global_cleanup();
@@ -313,6 +534,16 @@ http_dd_free(LogPipe *s)
   g_free(self->password);
   g_free(self->user_agent);
   g_list_free_full(self->headers, g_free);
+  g_free(self->body_prefix);
+  g_free(self->body_suffix);
+  g_free(self->delimiter);
+  g_string_free(self->request_body, TRUE);
+  g_string_free(self->compressed_body, TRUE);
+  for (i = 0; i < HTTP_SYSLOG_HEADERS; i++)
+    {
+      g_string_free(self->syslog_headers[i], TRUE);
+      g_string_free(self->batch_syslog_headers[i], TRUE);
+    }
 
   log_threaded_dest_driver_free(s);
 }
@@ -322,6 +553,7 @@ LogDriver *
 http_dd_new(GlobalConfig *cfg)
 {
   HTTPDestinationDriver *self = g_new0(HTTPDestinationDriver, 1);
+  gint i;
 
   log_threaded_dest_driver_init_instance(&self->super, cfg);
 
@@ -332,11 +564,21 @@ http_dd_new(GlobalConfig *cfg)
   self->super.worker.connect = _connect;
   self->super.worker.disconnect = _disconnect;
   self->super.worker.insert = _insert;
+  self->super.worker.flush = _flush;
   self->super.format.persist_name = _format_persist_name;
   self->super.format.stats_instance = _format_stats_instance;
   self->super.stats_source = SCS_HTTP;
   self->super.super.super.super.free_fn = http_dd_free;
 
+  self->delimiter = g_strdup("\n");
+  self->request_body = g_string_sized_new(1024);
+  self->compressed_body = g_string_sized_new(1024);
+  for (i = 0; i < HTTP_SYSLOG_HEADERS; i++)
+    {
+      self->syslog_headers[i] = g_string_sized_new(64);
+      self->batch_syslog_headers[i] = g_string_sized_new(64);
+    }
+
   curl_global_init(CURL_GLOBAL_ALL);
 
   if (!(self->curl = curl_easy_init())) {
@@ -168,6 +168,12 @@ java_dd_close(LogThrDestDriver *s)
     }
 }
 
+static gboolean
+_is_batching_enabled(JavaDestDriver *self)
+{
+  return self->super.batch.lines > 1 || self->super.batch.timeout > 0;
+}
+
 static worker_insert_result_t
 java_worker_insert(LogThrDestDriver *s, LogMessage *msg)
 {
@@ -178,20 +184,91 @@ java_worker_insert(LogThrDestDriver *s, LogMessage *msg)
       return WORKER_INSERT_RESULT_NOT_CONNECTED;
     }
 
+  if (_is_batching_enabled(self))
+    {
+      g_ptr_array_add(self->batch, log_msg_ref(msg));
+      return WORKER_INSERT_RESULT_QUEUED;
+    }
+
   gboolean sent = java_dd_send_to_object(self, msg);
   return sent ? WORKER_INSERT_RESULT_SUCCESS : WORKER_INSERT_RESULT_ERROR;
 }
 
+static void
+_free_batch(JavaDestDriver *self)
+{
+  g_ptr_array_foreach(self->batch, (GFunc) log_msg_unref, NULL);
+  g_ptr_array_set_size(self->batch, 0);
+}
+
+/*
+ * The successfully sent prefix of the batch is acked, the rest of it is
+ * retried.  If the queue ran empty while the batch was waiting for
+ * batch-timeout(), Java is notified about that now, so that it does not
+ * flush its own buffers before the last batch arrives.
+ */
+static worker_insert_result_t
+java_worker_flush(LogThrDestDriver *s)
+{
+  JavaDestDriver *self = (JavaDestDriver *)s;
+  worker_insert_result_t result = WORKER_INSERT_RESULT_SUCCESS;
+  gint sent;
+
+  if (self->batch->len == 0)
+    return WORKER_INSERT_RESULT_SUCCESS;
+
+  if (!java_dd_open(s))
+    {
+      result = WORKER_INSERT_RESULT_NOT_CONNECTED;
+      goto exit;
+    }
+
+  sent = java_destination_proxy_send_batch(self->proxy, (LogMessage **) self->batch->pdata, self->batch->len);
+  log_threaded_dest_driver_batch_accept(s, sent);
+  if (sent < (gint) self->batch->len)
+    {
+      result = WORKER_INSERT_RESULT_ERROR;
+    }
+  else if (self->queue_empty_pending)
+    {
+      self->queue_empty_pending = FALSE;
+      java_destination_proxy_on_message_queue_empty(self->proxy);
+    }
+
+exit:
+  _free_batch(self);
+  return result;
+}
+
+static void
+java_worker_disconnect(LogThrDestDriver *s)
+{
+  JavaDestDriver *self = (JavaDestDriver *)s;
+
+  _free_batch(self);
+  self->queue_empty_pending = FALSE;
+  java_dd_close(s);
+}
+
 static void
 java_worker_message_queue_empty(LogThrDestDriver *d)
 {
   JavaDestDriver *self = (JavaDestDriver *)d;
+
+  if (self->batch->len > 0)
+    {
+      self->queue_empty_pending = TRUE;
+      return;
+    }
   java_destination_proxy_on_message_queue_empty(self->proxy);
 }
 
 static void
 java_worker_thread_deinit(LogThrDestDriver *d)
 {
+  JavaDestDriver *self = (JavaDestDriver *)d;
+
+  _free_batch(self);
   java_dd_close(d);
   java_machine_detach_thread();
 }
@@ -220,6 +297,9 @@ java_dd_free(LogPipe *s)
 
   log_template_options_destroy(&self->template_options);
   g_string_free(self->class_path, TRUE);
+
+  _free_batch(self);
+  g_ptr_array_free(self->batch, TRUE);
 }
 
 static void
@@ -250,7 +330,8 @@ java_dd_new(GlobalConfig *cfg)
   self->super.worker.thread_deinit = java_worker_thread_deinit;
   self->super.worker.insert = java_worker_insert;
   self->super.worker.connect = java_dd_open;
-  self->super.worker.disconnect = java_dd_close;
+  self->super.worker.disconnect = java_worker_disconnect;
+  self->super.worker.flush = java_worker_flush;
   self->super.worker.worker_message_queue_empty = java_worker_message_queue_empty;
 
   self->super.format.stats_instance = java_dd_format_stats_instance;
@@ -265,6 +346,7 @@ java_dd_new(GlobalConfig *cfg)
 
   self->formatted_message = g_string_sized_new(1024);
   self->options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+  self->batch = g_ptr_array_new();
 
   log_template_options_defaults(&self->template_options);
 
@@ -49,6 +49,12 @@ typedef struct
   GString *formatted_message;
   GHashTable *options;
   LogTemplateOptions template_options;
+  /* messages waiting for the next flush, they are handed over to Java in
+   * a single call */
+  GPtrArray *batch;
+  /* the queue ran empty while a batch was pending, onMessageQueueEmpty()
+   * is called once the batch is sent */
+  gboolean queue_empty_pending;
 } JavaDestDriver;
 
 LogDriver *java_dd_new(GlobalConfig *cfg);
@@ -38,6 +38,8 @@ typedef struct _JavaDestinationImpl
   jmethodID mi_deinit;
   jmethodID mi_send;
   jmethodID mi_send_msg;
+  jmethodID mi_send_batch;
+  jmethodID mi_send_batch_msg;
   jmethodID mi_open;
   jmethodID mi_close;
   jmethodID mi_is_opened;
@@ -53,6 +55,7 @@ struct _JavaDestinationProxy
   LogTemplate *template;
   GString *formatted_message; 
   JavaLogMessageProxy *msg_builder;
+  jclass string_class;
   gchar *name_by_uniq_options;
 };
 
@@ -101,6 +104,22 @@ __load_destination_object(JavaDestinationProxy *self, const gchar *class_name, c
                 evt_tag_str("method", "boolean send(String) or boolean send(LogMessage)"));
     }
 
+  /* only present in classes derived from TextLogDestination or
+   * StructuredLogDestination, batches are sent one by one otherwise */
+  self->dest_impl.mi_send_batch = CALL_JAVA_FUNCTION(java_env, GetMethodID, self->loaded_class, "sendBatchProxy", "([Ljava/lang/String;)I");
+  self->dest_impl.mi_send_batch_msg = CALL_JAVA_FUNCTION(java_env, GetMethodID, self->loaded_class, "sendBatchProxy", "([Lorg/syslog_ng/LogMessage;)I");
+  (*java_env)->ExceptionClear(java_env);
+
+  jclass string_class = CALL_JAVA_FUNCTION(java_env, FindClass, "java/lang/String");
+  if (!string_class)
+    {
+      msg_error("Can't find class",
+                evt_tag_str("class_name", "java.lang.String"));
+      return FALSE;
+    }
+  self->string_class = CALL_JAVA_FUNCTION(java_env, NewGlobalRef, string_class);
+  CALL_JAVA_FUNCTION(java_env, DeleteLocalRef, string_class);
+
   self->dest_impl.mi_on_message_queue_empty = CALL_JAVA_FUNCTION(java_env, GetMethodID, self->loaded_class, "onMessageQueueEmptyProxy", "()V");
   if (!self->dest_impl.mi_on_message_queue_empty)
     {
@@ -176,6 +195,11 @@ java_destination_proxy_free(JavaDestinationProxy *self)
     {
       java_log_message_proxy_free(self->msg_builder);
     }
+
+  if (self->string_class)
+    {
+      CALL_JAVA_FUNCTION(env, DeleteGlobalRef, self->string_class);
+    }
   java_machine_unref(self->java_machine);
   g_string_free(self->formatted_message, TRUE);
   g_free(self->name_by_uniq_options);
@@ -249,6 +273,87 @@ java_destination_proxy_send(JavaDestinationProxy *self, LogMessage *msg)
     }
 }
 
+static gint
+__queue_native_batch(JavaDestinationProxy *self, JNIEnv *env, LogMessage **msgs, gint count)
+{
+  jobjectArray jmsgs = java_log_message_proxy_create_java_array(self->msg_builder, count);
+  gint i;
+
+  if (!jmsgs)
+    return 0;
+
+  for (i = 0; i < count; i++)
+    {
+      jobject jmsg = java_log_message_proxy_create_java_object(self->msg_builder, msgs[i]);
+
+      if (!jmsg)
+        {
+          CALL_JAVA_FUNCTION(env, DeleteLocalRef, jmsgs);
+          return 0;
+        }
+      CALL_JAVA_FUNCTION(env, SetObjectArrayElement, jmsgs, i, jmsg);
+      CALL_JAVA_FUNCTION(env, DeleteLocalRef, jmsg);
+    }
+
+  jint sent = CALL_JAVA_FUNCTION(env, CallIntMethod, self->dest_impl.dest_object, self->dest_impl.mi_send_batch_msg, jmsgs);
+  CALL_JAVA_FUNCTION(env, DeleteLocalRef, jmsgs);
+  return sent;
+}
+
+static gint
+__queue_formatted_batch(JavaDestinationProxy *self, JNIEnv *env, LogMessage **msgs, gint count)
+{
+  jobjectArray messages = CALL_JAVA_FUNCTION(env, NewObjectArray, count, self->string_class, NULL);
+  gint i;
+
+  if (!messages)
+    return 0;
+
+  for (i = 0; i < count; i++)
+    {
+      log_template_format(self->template, msgs[i], NULL, LTZ_LOCAL, 0, NULL, self->formatted_message);
+      jstring message = CALL_JAVA_FUNCTION(env, NewStringUTF, self->formatted_message->str);
+
+      if (!message)
+        {
+          CALL_JAVA_FUNCTION(env, DeleteLocalRef, messages);
+          return 0;
+        }
+      CALL_JAVA_FUNCTION(env, SetObjectArrayElement, messages, i, message);
+      CALL_JAVA_FUNCTION(env, DeleteLocalRef, message);
+    }
+
+  jint sent = CALL_JAVA_FUNCTION(env, CallIntMethod, self->dest_impl.dest_object, self->dest_impl.mi_send_batch, messages);
+  CALL_JAVA_FUNCTION(env, DeleteLocalRef, messages);
+  return sent;
+}
+
+/*
+ * Sends the messages with a single call into Java and returns the number
+ * of messages sent successfully from the start of @msgs.
+ */
+gint
+java_destination_proxy_send_batch(JavaDestinationProxy *self, LogMessage **msgs, gint count)
+{
+  JNIEnv *env = java_machine_get_env(self->java_machine, &env);
+  gint sent;
+
+  if (self->dest_impl.mi_send_msg && self->dest_impl.mi_send_batch_msg)
+    sent = __queue_native_batch(self, env, msgs, count);
+  else if (!self->dest_impl.mi_send_msg && self->dest_impl.mi_send_batch)
+    sent = __queue_formatted_batch(self, env, msgs, count);
+  else
+    {
+      for (sent = 0; sent < count; sent++)
+        {
+          if (!java_destination_proxy_send(self, msgs[sent]))
+            break;
+        }
+    }
+
+  return CLAMP(sent, 0, count);
+}
+
 gchar *
 java_destination_proxy_get_name_by_uniq_options(JavaDestinationProxy *self)
 {
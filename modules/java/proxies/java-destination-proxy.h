@@ -40,6 +40,7 @@ void java_destination_proxy_deinit(JavaDestinationProxy *self);
 void java_destination_proxy_on_message_queue_empty(JavaDestinationProxy *self);
 gchar *java_destination_proxy_get_name_by_uniq_options(JavaDestinationProxy *self);
 gboolean java_destination_proxy_send(JavaDestinationProxy *self, LogMessage *msg);
+gint java_destination_proxy_send_batch(JavaDestinationProxy *self, LogMessage **msgs, gint count);
 gboolean java_destination_proxy_open(JavaDestinationProxy *self);
 void java_destination_proxy_close(JavaDestinationProxy *self);
 gboolean java_destination_proxy_is_opened(JavaDestinationProxy *self);
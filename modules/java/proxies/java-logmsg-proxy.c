@@ -130,6 +130,14 @@ java_log_message_proxy_create_java_object(JavaLogMessageProxy *self, LogMessage
   return jmsg;
 }
 
+jobjectArray
+java_log_message_proxy_create_java_array(JavaLogMessageProxy *self, gsize length)
+{
+  JNIEnv *java_env = java_machine_get_env(self->java_machine, &java_env);
+
+  return CALL_JAVA_FUNCTION(java_env, NewObjectArray, length, self->loaded_class, NULL);
+}
+
 void
 java_log_message_proxy_free(JavaLogMessageProxy *self)
 {
@@ -35,5 +35,6 @@ JavaLogMessageProxy *java_log_message_proxy_new();
 void java_log_message_proxy_free(JavaLogMessageProxy *self);
 
 jobject java_log_message_proxy_create_java_object(JavaLogMessageProxy *self, LogMessage *msg);
+jobjectArray java_log_message_proxy_create_java_array(JavaLogMessageProxy *self, gsize length);
 
 #endif /* JAVA_LOGMSG_PROXY_H_ */
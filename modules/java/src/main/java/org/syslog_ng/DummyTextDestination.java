@@ -25,13 +25,27 @@ package org.syslog_ng;
 
 public class DummyTextDestination extends TextLogDestination {
 
+  private static final long REPORT_INTERVAL_NANOS = 5000000000L;
+
   private String name;
 
+  /* with option("benchmark", "yes") messages are only counted and the
+   * throughput is reported periodically */
+  private boolean benchmark;
+  private long messages;
+  private long batches;
+  private long characters;
+  private long intervalMessages;
+  private long intervalStart;
+
   public DummyTextDestination(long arg0) {
     super(arg0);
   }
 
   public void deinit() {
+    if (benchmark)
+      InternalMessageSender.info("Dummy destination totals: " + messages + " messages, " +
+                                 batches + " batches, " + characters + " characters");
     InternalMessageSender.debug("Deinit");
   }
 
@@ -46,6 +60,8 @@ public class DummyTextDestination extends TextLogDestination {
       InternalMessageSender.error("Name is a required option for this destination");
       return false;
     }
+    benchmark = "yes".equals(getOption("benchmark"));
+    intervalStart = System.nanoTime();
     InternalMessageSender.debug("Init " + name);
     return true;
   }
@@ -65,10 +81,48 @@ public class DummyTextDestination extends TextLogDestination {
   }
 
   public boolean send(String arg0) {
+    if (benchmark) {
+      count(arg0);
+      batches++;
+      report();
+      return true;
+    }
     InternalMessageSender.debug("Incoming message: " + arg0);
     return true;
   }
 
+  @Override
+  public int sendBatch(String[] formattedMessages) {
+    if (!benchmark)
+      return super.sendBatch(formattedMessages);
+
+    for (String formattedMessage : formattedMessages)
+      count(formattedMessage);
+    batches++;
+    report();
+    return formattedMessages.length;
+  }
+
+  private void count(String formattedMessage) {
+    messages++;
+    intervalMessages++;
+    characters += formattedMessage.length();
+  }
+
+  private void report() {
+    long now = System.nanoTime();
+    long elapsed = now - intervalStart;
+
+    if (elapsed < REPORT_INTERVAL_NANOS)
+      return;
+
+    InternalMessageSender.info("Dummy destination throughput: " +
+                               (intervalMessages * 1000000000L / elapsed) + " msg/sec, " +
+                               "average batch size: " + (batches > 0 ? messages / batches : 0));
+    intervalMessages = 0;
+    intervalStart = now;
+  }
+
   @Override
   public String getNameByUniqOptions() {
     InternalMessageSender.debug("getNameByUniqOptions");
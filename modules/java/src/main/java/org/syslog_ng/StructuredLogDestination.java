@@ -42,4 +42,35 @@ public abstract class StructuredLogDestination extends LogDestination {
 			msg.release();
 		}
 	}
+
+	/*
+	 * Called with a whole batch when batch-lines() or batch-timeout() is
+	 * set.  Returns the number of messages sent from the start of the
+	 * array, the rest of the batch is retried later.  The messages must
+	 * not be used after returning.
+	 */
+	protected int sendBatch(LogMessage[] msgs) {
+		int sent = 0;
+
+		for (LogMessage msg : msgs) {
+			if (!send(msg))
+				break;
+			sent++;
+		}
+		return sent;
+	}
+
+	public int sendBatchProxy(LogMessage[] msgs) {
+		try {
+			return sendBatch(msgs);
+		}
+		catch (Exception e) {
+			sendExceptionMessage(e);
+			return 0;
+		}
+		finally {
+			for (LogMessage msg : msgs)
+				msg.release();
+		}
+	}
 }
\ No newline at end of file
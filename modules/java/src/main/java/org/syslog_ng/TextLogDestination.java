@@ -39,4 +39,30 @@ public abstract class TextLogDestination extends LogDestination {
 			return false;
 		}
 	}
+
+	/*
+	 * Called with a whole batch when batch-lines() or batch-timeout() is
+	 * set.  Returns the number of messages sent from the start of the
+	 * array, the rest of the batch is retried later.
+	 */
+	protected int sendBatch(String[] formattedMessages) {
+		int sent = 0;
+
+		for (String formattedMessage : formattedMessages) {
+			if (!send(formattedMessage))
+				break;
+			sent++;
+		}
+		return sent;
+	}
+
+	public int sendBatchProxy(String[] formattedMessages) {
+		try {
+			return sendBatch(formattedMessages);
+		}
+		catch (Exception e) {
+			sendExceptionMessage(e);
+			return 0;
+		}
+	}
 }
\ No newline at end of file
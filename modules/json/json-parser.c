@@ -21,15 +21,12 @@
  */
 
 #include "json-parser.h"
-#include "dot-notation.h"
+#include "json-scanner.h"
 #include "scratch-buffers.h"
 
 #include <string.h>
 #include <ctype.h>
 
-#include <json.h>
-#include <json_object_private.h>
-
 typedef struct _JSONParser
 {
   LogParser super;
@@ -67,181 +64,100 @@ json_parser_set_extract_prefix(LogParser *s, const gchar *extract_prefix)
   self->extract_prefix = g_strdup(extract_prefix);
 }
 
+/*
+ * Scanned values are collected as records of (name length, name, NUL,
+ * value length, value) and are only stored in the message once the whole
+ * document turned out to be valid, so that a syntax error doesn't leave
+ * half of the members behind.
+ */
 static void
-json_parser_process_object(struct json_object *jso,
-                                const gchar *prefix,
-                                LogMessage *msg);
-
-static void
-json_parser_process_single(struct json_object *jso,
-                                const gchar *prefix,
-                                const gchar *obj_key,
-                                LogMessage *msg)
+json_parser_collect_scanned_value(const gchar *name, gsize name_len,
+                                  const gchar *value, gsize value_len,
+                                  gpointer user_data)
 {
-  SBGString *key, *value;
-  gboolean parsed = FALSE;
-
-  if (!jso)
-    return;
-
-  key = sb_gstring_acquire();
-  value = sb_gstring_acquire();
-
-  switch (json_object_get_type(jso))
-    {
-    case json_type_boolean:
-      parsed = TRUE;
-      if (json_object_get_boolean(jso))
-        g_string_assign(sb_gstring_string(value), "true");
-      else
-        g_string_assign(sb_gstring_string(value), "false");
-      break;
-    case json_type_double:
-      parsed = TRUE;
-      g_string_printf(sb_gstring_string(value), "%f",
-                       json_object_get_double(jso));
-      break;
-    case json_type_int:
-      parsed = TRUE;
-      g_string_printf(sb_gstring_string(value), "%i",
-                       json_object_get_int(jso));
-      break;
-    case json_type_string:
-      parsed = TRUE;
-      g_string_assign(sb_gstring_string(value),
-                       json_object_get_string(jso));
-      break;
-    case json_type_object:
-      if (prefix)
-        g_string_assign(sb_gstring_string(key), prefix);
-      g_string_append(sb_gstring_string(key), obj_key);
-      g_string_append_c(sb_gstring_string(key), '.');
-      json_parser_process_object(jso, sb_gstring_string(key)->str, msg);
-      break;
-    case json_type_array:
-      {
-        gint i, plen;
-
-        g_string_assign(sb_gstring_string(key), obj_key);
+  GString *values = (GString *) user_data;
 
-        plen = sb_gstring_string(key)->len;
-
-        for (i = 0; i < json_object_array_length(jso); i++)
-          {
-            g_string_truncate(sb_gstring_string(key), plen);
-            g_string_append_printf(sb_gstring_string(key), "[%d]", i);
-            json_parser_process_single(json_object_array_get_idx(jso, i),
-                                            prefix,
-                                            sb_gstring_string(key)->str, msg);
-          }
-        break;
-      }
-    case json_type_null:
-      break;
-    default:
-      msg_error("JSON parser encountered an unknown type, skipping",
-                 evt_tag_str("key", obj_key));
-      break;
-    }
-
-  if (parsed)
-    {
-      if (prefix)
-        {
-          g_string_assign(sb_gstring_string(key), prefix);
-          g_string_append(sb_gstring_string(key), obj_key);
-          log_msg_set_value_by_name(msg,
-                             sb_gstring_string(key)->str,
-                             sb_gstring_string(value)->str,
-                             sb_gstring_string(value)->len);
-        }
-      else
-        log_msg_set_value_by_name(msg,
-                           obj_key,
-                           sb_gstring_string(value)->str,
-                           sb_gstring_string(value)->len);
-    }
-
-  sb_gstring_release(key);
-  sb_gstring_release(value);
+  g_string_append_len(values, (const gchar *) &name_len, sizeof(name_len));
+  g_string_append_len(values, name, name_len);
+  g_string_append_c(values, 0);
+  g_string_append_len(values, (const gchar *) &value_len, sizeof(value_len));
+  g_string_append_len(values, value, value_len);
 }
 
 static void
-json_parser_process_object(struct json_object *jso,
-                                const gchar *prefix,
-                                LogMessage *msg)
+json_parser_set_collected_values(LogMessage *msg, GString *values)
 {
-  struct json_object_iter itr;
+  const gchar *p = values->str;
+  const gchar *end = values->str + values->len;
+  const gchar *name;
+  gsize name_len, value_len;
 
-  json_object_object_foreachC(jso, itr)
+  while (p < end)
     {
-      json_parser_process_single(itr.val, prefix, itr.key, msg);
+      memcpy(&name_len, p, sizeof(name_len));
+      name = p + sizeof(name_len);
+      p = name + name_len + 1;
+      memcpy(&value_len, p, sizeof(value_len));
+      p += sizeof(value_len);
+      log_msg_set_value(msg, log_msg_get_value_handle(name), p, value_len);
+      p += value_len;
     }
 }
 
+/*
+ * Members are collected as the scanner finds them, without building a
+ * json-c object tree first.  With extract-prefix() only the members of
+ * the object at that path are collected.
+ */
 static gboolean
-json_parser_extract(JSONParser *self, struct json_object *jso, LogMessage *msg)
+json_parser_process_scanned(JSONParser *self, LogMessage **pmsg, const LogPathOptions *path_options,
+                            const gchar *input, gsize input_len)
 {
-  if (self->extract_prefix)
-    jso = json_extract(jso, self->extract_prefix);
+  SBGString *values = sb_gstring_acquire();
+  const gchar *error = NULL;
+  gboolean result;
 
-  if (!jso || !json_object_is_type(jso, json_type_object))
+  if (self->extract_prefix)
+    result = json_scanner_scan_subtree(input, input_len, self->extract_prefix, self->prefix,
+                                       json_parser_collect_scanned_value, sb_gstring_string(values), &error);
+  else
+    result = json_scanner_scan_object(input, input_len, self->prefix,
+                                      json_parser_collect_scanned_value, sb_gstring_string(values), &error);
+  if (result)
     {
-      return FALSE;
+      log_msg_make_writable(pmsg, path_options);
+      json_parser_set_collected_values(*pmsg, sb_gstring_string(values));
     }
-  
-  json_parser_process_object(jso, self->prefix, msg);
-  return TRUE;
-}
-
-#ifndef JSON_C_VERSION
-const char *
-json_tokener_error_desc(enum json_tokener_error err)
-{
-  return json_tokener_errors[err];
+  else
+    {
+      msg_error("Unparsable JSON stream encountered",
+                evt_tag_str("input", input),
+                evt_tag_str("error", error));
+    }
+  sb_gstring_release(values);
+  return result;
 }
-#endif
 
 static gboolean
 json_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *path_options, const gchar *input, gsize input_len)
 {
   JSONParser *self = (JSONParser *) s;
-  struct json_object *jso;
-  struct json_tokener *tok;
 
   if (self->marker)
     {
-      if (strncmp(input, self->marker, self->marker_len) != 0)
+      if (input_len < self->marker_len || strncmp(input, self->marker, self->marker_len) != 0)
         return FALSE;
       input += self->marker_len;
+      input_len -= self->marker_len;
 
-      while (isspace(*input))
-        input++;
-    }
-
-  tok = json_tokener_new();
-  jso = json_tokener_parse_ex(tok, input, input_len);
-  if (tok->err != json_tokener_success || !jso)
-    {
-      msg_error("Unparsable JSON stream encountered",
-                evt_tag_str ("input", input),
-                tok->err != json_tokener_success ? evt_tag_str ("error", json_tokener_error_desc(tok->err)) : NULL);
-      json_tokener_free (tok);
-      return FALSE;
-    }
-  json_tokener_free(tok);
-
-  log_msg_make_writable(pmsg, path_options);
-  if (!json_parser_extract(self, jso, *pmsg))
-    {
-      msg_error("Error extracting JSON members into LogMessage as the top-level JSON object is not an object",
-                evt_tag_str ("input", input));
-      json_object_put(jso);
-      return FALSE;
+      while (input_len > 0 && isspace(*input))
+        {
+          input++;
+          input_len--;
+        }
     }
-  json_object_put(jso);
 
-  return TRUE;
+  return json_parser_process_scanned(self, pmsg, path_options, input, input_len);
 }
 
 static LogPipe *
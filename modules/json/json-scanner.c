@@ -0,0 +1,654 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ */
+
+#include "json-scanner.h"
+#include "scratch-buffers.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+/*
+ * A single pass JSON scanner that reports scalar values as it finds them,
+ * without building a document tree.  It accepts what json-c accepts in
+ * practice: both double and single quoted strings, the NaN, Infinity and
+ * -Infinity literals, and trailing data after the top-level object is
+ * ignored.
+ */
+
+#define JSON_SCANNER_MAX_DEPTH 64
+
+/* an element of a dot notation path: a member name or an array index */
+typedef struct _JSONScannerPathElem
+{
+  const gchar *name;
+  gsize name_len;
+  gint index;
+} JSONScannerPathElem;
+
+typedef struct _JSONScanner
+{
+  const gchar *p;
+  const gchar *end;
+  GString *name;
+  GString *value;
+  JSONScannerValueFunc value_func;
+  gpointer user_data;
+  const gchar *error;
+  gint depth;
+
+  /* values are only reported within the subtree at @path, the elements
+   * of the path leading to the current position are @matched */
+  const JSONScannerPathElem *path;
+  gint path_len;
+  gint matched;
+  const gchar *name_prefix;
+  GString *subtree_name;
+  gboolean emitting;
+  gboolean subtree_found;
+} JSONScanner;
+
+static gboolean _scan_value(JSONScanner *self);
+
+static inline gboolean
+_fail(JSONScanner *self, const gchar *error)
+{
+  if (!self->error)
+    self->error = error;
+  return FALSE;
+}
+
+static inline void
+_skip_whitespace(JSONScanner *self)
+{
+  while (self->p < self->end && (*self->p == ' ' || *self->p == '\t' || *self->p == '\n' || *self->p == '\r'))
+    self->p++;
+}
+
+static inline gboolean
+_expect_char(JSONScanner *self, gchar c)
+{
+  _skip_whitespace(self);
+  if (self->p >= self->end || *self->p != c)
+    return FALSE;
+  self->p++;
+  return TRUE;
+}
+
+static gint
+_hex_value(gchar c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+static gboolean
+_scan_hex4(JSONScanner *self, gunichar *result)
+{
+  gint i, digit;
+
+  if (self->end - self->p < 4)
+    return FALSE;
+
+  *result = 0;
+  for (i = 0; i < 4; i++)
+    {
+      digit = _hex_value(self->p[i]);
+      if (digit < 0)
+        return FALSE;
+      *result = (*result << 4) | digit;
+    }
+  self->p += 4;
+  return TRUE;
+}
+
+static gboolean
+_scan_unicode_escape(JSONScanner *self, GString *result)
+{
+  gunichar c, low;
+
+  if (!_scan_hex4(self, &c))
+    return _fail(self, "invalid \\u escape");
+
+  if (c >= 0xD800 && c <= 0xDBFF)
+    {
+      /* high surrogate, must be followed by a low one */
+      if (self->end - self->p < 6 || self->p[0] != '\\' || self->p[1] != 'u')
+        return _fail(self, "unpaired surrogate in \\u escape");
+      self->p += 2;
+      if (!_scan_hex4(self, &low) || low < 0xDC00 || low > 0xDFFF)
+        return _fail(self, "unpaired surrogate in \\u escape");
+      c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+    }
+  g_string_append_unichar(result, c);
+  return TRUE;
+}
+
+static gboolean
+_scan_escaped_string(JSONScanner *self, gchar quote, GString *result)
+{
+  gchar c;
+
+  while (self->p < self->end)
+    {
+      c = *self->p++;
+      if (c == quote)
+        return TRUE;
+
+      if (c != '\\')
+        {
+          g_string_append_c(result, c);
+          continue;
+        }
+
+      if (self->p >= self->end)
+        break;
+
+      c = *self->p++;
+      switch (c)
+        {
+        case 'b':
+          g_string_append_c(result, '\b');
+          break;
+        case 'f':
+          g_string_append_c(result, '\f');
+          break;
+        case 'n':
+          g_string_append_c(result, '\n');
+          break;
+        case 'r':
+          g_string_append_c(result, '\r');
+          break;
+        case 't':
+          g_string_append_c(result, '\t');
+          break;
+        case 'u':
+          if (!_scan_unicode_escape(self, result))
+            return FALSE;
+          break;
+        default:
+          /* \" \' \\ \/ and anything else stand for themselves */
+          g_string_append_c(result, c);
+          break;
+        }
+    }
+  return _fail(self, "unterminated string");
+}
+
+/*
+ * Strings without escapes are returned in place, otherwise they are
+ * unescaped into @buffer.
+ */
+static gboolean
+_scan_string(JSONScanner *self, GString *buffer, const gchar **str, gsize *len)
+{
+  gchar quote = *self->p++;
+  const gchar *start = self->p;
+  const gchar *p = start;
+
+  while (p < self->end && *p != quote && *p != '\\')
+    p++;
+
+  if (p >= self->end)
+    return _fail(self, "unterminated string");
+
+  if (*p == quote)
+    {
+      *str = start;
+      *len = p - start;
+      self->p = p + 1;
+      return TRUE;
+    }
+
+  g_string_truncate(buffer, 0);
+  g_string_append_len(buffer, start, p - start);
+  self->p = p;
+  if (!_scan_escaped_string(self, quote, buffer))
+    return FALSE;
+
+  *str = buffer->str;
+  *len = buffer->len;
+  return TRUE;
+}
+
+static inline void
+_emit(JSONScanner *self, const gchar *value, gsize value_len)
+{
+  if (self->emitting)
+    self->value_func(self->name->str, self->name->len, value, value_len, self->user_data);
+}
+
+static gboolean
+_scan_literal(JSONScanner *self, const gchar *literal, gsize literal_len)
+{
+  if (self->end - self->p < literal_len || memcmp(self->p, literal, literal_len) != 0)
+    return _fail(self, "invalid literal");
+  self->p += literal_len;
+  return TRUE;
+}
+
+static inline const gchar *
+_skip_digits(const gchar *p, const gchar *end)
+{
+  while (p < end && *p >= '0' && *p <= '9')
+    p++;
+  return p;
+}
+
+static gboolean
+_scan_number(JSONScanner *self)
+{
+  const gchar *start = self->p;
+  const gchar *p = start, *digits;
+
+  if (p < self->end && *p == '-')
+    p++;
+
+  if (p < self->end && *p == 'I')
+    {
+      self->p = p;
+      if (!_scan_literal(self, "Infinity", 8))
+        return FALSE;
+      _emit(self, start, self->p - start);
+      return TRUE;
+    }
+
+  digits = p;
+  p = _skip_digits(p, self->end);
+  if (p == digits)
+    return _fail(self, "invalid number");
+
+  if (p < self->end && *p == '.')
+    {
+      digits = ++p;
+      p = _skip_digits(p, self->end);
+      if (p == digits)
+        return _fail(self, "invalid number");
+    }
+
+  if (p < self->end && (*p == 'e' || *p == 'E'))
+    {
+      p++;
+      if (p < self->end && (*p == '+' || *p == '-'))
+        p++;
+      digits = p;
+      p = _skip_digits(p, self->end);
+      if (p == digits)
+        return _fail(self, "invalid number");
+    }
+
+  self->p = p;
+  _emit(self, start, p - start);
+  return TRUE;
+}
+
+static gboolean _scan_object(JSONScanner *self, gboolean top_level);
+
+static gboolean
+_path_enter_member(JSONScanner *self, const gchar *key, gsize key_len)
+{
+  const JSONScannerPathElem *elem;
+
+  if (self->matched != self->depth || self->matched >= self->path_len)
+    return FALSE;
+
+  elem = &self->path[self->matched];
+  if (!elem->name || elem->name_len != key_len || memcmp(elem->name, key, key_len) != 0)
+    return FALSE;
+
+  self->matched++;
+  return TRUE;
+}
+
+static gboolean
+_path_enter_element(JSONScanner *self, gint index)
+{
+  if (self->matched != self->depth || self->matched >= self->path_len ||
+      self->path[self->matched].name || self->path[self->matched].index != index)
+    return FALSE;
+
+  self->matched++;
+  return TRUE;
+}
+
+/*
+ * The value at the end of the path has to be an object, its members are
+ * reported with names relative to it.
+ */
+static gboolean
+_scan_subtree(JSONScanner *self)
+{
+  GString *outer_name = self->name;
+  gboolean result;
+
+  _skip_whitespace(self);
+  if (self->p >= self->end || *self->p != '{')
+    return _scan_value(self);
+
+  if (++self->depth > JSON_SCANNER_MAX_DEPTH)
+    return _fail(self, "nesting too deep");
+  self->p++;
+
+  self->subtree_found = TRUE;
+  self->emitting = TRUE;
+  self->name = self->subtree_name;
+  g_string_assign(self->name, self->name_prefix ? : "");
+
+  result = _scan_object(self, TRUE);
+
+  self->name = outer_name;
+  self->emitting = FALSE;
+  self->depth--;
+  return result;
+}
+
+static gboolean
+_scan_member_value(JSONScanner *self, gboolean entered_path)
+{
+  gboolean result;
+
+  if (!entered_path)
+    return _scan_value(self);
+
+  result = self->matched == self->path_len ? _scan_subtree(self) : _scan_value(self);
+  self->matched--;
+  return result;
+}
+
+static gboolean
+_scan_object(JSONScanner *self, gboolean top_level)
+{
+  gsize name_len = self->name->len;
+  const gchar *key;
+  gsize key_len;
+  gboolean entered_path;
+
+  /* the opening brace has been consumed */
+  if (_expect_char(self, '}'))
+    return TRUE;
+
+  do
+    {
+      _skip_whitespace(self);
+      if (self->p >= self->end || (*self->p != '"' && *self->p != '\''))
+        return _fail(self, "object member name expected");
+
+      g_string_truncate(self->name, name_len);
+      if (!top_level)
+        g_string_append_c(self->name, '.');
+      if (!_scan_string(self, self->value, &key, &key_len))
+        return FALSE;
+      g_string_append_len(self->name, key, key_len);
+      entered_path = _path_enter_member(self, key, key_len);
+
+      if (!_expect_char(self, ':'))
+        return _fail(self, "':' expected after object member name");
+
+      if (!_scan_member_value(self, entered_path))
+        return FALSE;
+    }
+  while (_expect_char(self, ','));
+
+  g_string_truncate(self->name, name_len);
+  if (!_expect_char(self, '}'))
+    return _fail(self, "',' or '}' expected in object");
+  return TRUE;
+}
+
+static gboolean
+_scan_array(JSONScanner *self)
+{
+  gsize name_len = self->name->len;
+  gint index = 0;
+
+  /* the opening bracket has been consumed */
+  if (_expect_char(self, ']'))
+    return TRUE;
+
+  do
+    {
+      g_string_truncate(self->name, name_len);
+      g_string_append_printf(self->name, "[%d]", index);
+      if (!_scan_member_value(self, _path_enter_element(self, index)))
+        return FALSE;
+      index++;
+    }
+  while (_expect_char(self, ','));
+
+  g_string_truncate(self->name, name_len);
+  if (!_expect_char(self, ']'))
+    return _fail(self, "',' or ']' expected in array");
+  return TRUE;
+}
+
+static gboolean
+_scan_nested(JSONScanner *self, gboolean object)
+{
+  gboolean result;
+
+  if (++self->depth > JSON_SCANNER_MAX_DEPTH)
+    return _fail(self, "nesting too deep");
+
+  self->p++;
+  result = object ? _scan_object(self, FALSE) : _scan_array(self);
+  self->depth--;
+  return result;
+}
+
+static gboolean
+_scan_value(JSONScanner *self)
+{
+  const gchar *str;
+  gsize len;
+
+  _skip_whitespace(self);
+  if (self->p >= self->end)
+    return _fail(self, "unexpected end of input");
+
+  switch (*self->p)
+    {
+    case '{':
+      return _scan_nested(self, TRUE);
+    case '[':
+      return _scan_nested(self, FALSE);
+    case '"':
+    case '\'':
+      if (!_scan_string(self, self->value, &str, &len))
+        return FALSE;
+      _emit(self, str, len);
+      return TRUE;
+    case 't':
+      if (!_scan_literal(self, "true", 4))
+        return FALSE;
+      _emit(self, "true", 4);
+      return TRUE;
+    case 'f':
+      if (!_scan_literal(self, "false", 5))
+        return FALSE;
+      _emit(self, "false", 5);
+      return TRUE;
+    case 'n':
+      return _scan_literal(self, "null", 4);
+    case 'N':
+      if (!_scan_literal(self, "NaN", 3))
+        return FALSE;
+      _emit(self, "NaN", 3);
+      return TRUE;
+    default:
+      return _scan_number(self);
+    }
+}
+
+static gboolean
+_scan_document(JSONScanner *self, const gchar *input, gsize input_len, gboolean object_only)
+{
+  SBGString *name, *value, *subtree_name;
+  gboolean result, object;
+
+  self->p = input;
+  self->end = input + input_len;
+
+  _skip_whitespace(self);
+  object = self->p < self->end && *self->p == '{';
+  if (!object && (object_only || self->p >= self->end || *self->p != '['))
+    return _fail(self, object_only ? "the top-level JSON element is not an object"
+                 : "the top-level JSON element is not an object or array");
+  self->p++;
+
+  name = sb_gstring_acquire();
+  value = sb_gstring_acquire();
+  subtree_name = sb_gstring_acquire();
+  self->name = sb_gstring_string(name);
+  self->value = sb_gstring_string(value);
+  self->subtree_name = sb_gstring_string(subtree_name);
+  g_string_assign(self->name, self->emitting && self->name_prefix ? self->name_prefix : "");
+
+  result = object ? _scan_object(self, TRUE) : _scan_array(self);
+
+  sb_gstring_release(name);
+  sb_gstring_release(value);
+  sb_gstring_release(subtree_name);
+  return result;
+}
+
+/*
+ * Scans a JSON document whose top-level element must be an object,
+ * reporting its members prefixed by @name_prefix.  Values may already
+ * have been reported when an error is found later in the input, so the
+ * caller should only use them if the scan succeeded.
+ */
+gboolean
+json_scanner_scan_object(const gchar *input, gsize input_len, const gchar *name_prefix,
+                         JSONScannerValueFunc value_func, gpointer user_data,
+                         const gchar **error)
+{
+  JSONScanner self;
+
+  memset(&self, 0, sizeof(self));
+  self.value_func = value_func;
+  self.user_data = user_data;
+  self.name_prefix = name_prefix;
+  self.emitting = TRUE;
+
+  if (!_scan_document(&self, input, input_len, TRUE))
+    {
+      *error = self.error;
+      return FALSE;
+    }
+  return TRUE;
+}
+
+static gboolean
+_parse_path(const gchar *path, JSONScannerPathElem *elems, gint *elems_len)
+{
+  const gchar *p = path;
+  gchar *end;
+
+  *elems_len = 0;
+  if (*p == '.')
+    p++;
+
+  while (*p)
+    {
+      JSONScannerPathElem *elem = &elems[*elems_len];
+
+      if (*elems_len >= JSON_SCANNER_MAX_DEPTH)
+        return FALSE;
+
+      if (*p == '[')
+        {
+          elem->name = NULL;
+          elem->name_len = 0;
+          elem->index = strtol(p + 1, &end, 10);
+          if (end == p + 1 || *end != ']' || elem->index < 0)
+            return FALSE;
+          p = end + 1;
+        }
+      else
+        {
+          elem->name = p;
+          elem->index = -1;
+          while (*p && *p != '.' && *p != '[' && *p != ']')
+            p++;
+          elem->name_len = p - elem->name;
+          if (elem->name_len == 0)
+            return FALSE;
+        }
+      (*elems_len)++;
+
+      if (*p == '.')
+        {
+          p++;
+          if (*p == 0 || *p == '.' || *p == '[')
+            return FALSE;
+        }
+      else if (*p != 0 && *p != '[')
+        {
+          return FALSE;
+        }
+    }
+  return TRUE;
+}
+
+/*
+ * Like json_scanner_scan_object(), but reports the members of the object
+ * found at @path, a dot notation path like "foo.bar[1]", instead of the
+ * members of the top-level element, which may be an array here.  The
+ * whole document is validated all the same.
+ */
+gboolean
+json_scanner_scan_subtree(const gchar *input, gsize input_len, const gchar *path, const gchar *name_prefix,
+                          JSONScannerValueFunc value_func, gpointer user_data,
+                          const gchar **error)
+{
+  JSONScannerPathElem elems[JSON_SCANNER_MAX_DEPTH];
+  JSONScanner self;
+
+  memset(&self, 0, sizeof(self));
+  if (!_parse_path(path, elems, &self.path_len))
+    {
+      *error = "invalid path";
+      return FALSE;
+    }
+  if (self.path_len == 0)
+    return json_scanner_scan_object(input, input_len, name_prefix, value_func, user_data, error);
+
+  self.value_func = value_func;
+  self.user_data = user_data;
+  self.name_prefix = name_prefix;
+  self.path = elems;
+
+  if (!_scan_document(&self, input, input_len, FALSE))
+    {
+      *error = self.error;
+      return FALSE;
+    }
+  if (!self.subtree_found)
+    {
+      *error = "the JSON element at the path is not an object";
+      return FALSE;
+    }
+  return TRUE;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ */
+
+#ifndef JSON_SCANNER_H_INCLUDED
+#define JSON_SCANNER_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/*
+ * Called for every scalar in the document with its flattened name
+ * ("object.member", "array[0]") and textual value: strings unescaped,
+ * numbers exactly as written, booleans as "true"/"false".  Nulls are
+ * skipped.  The value is not NUL terminated.
+ */
+typedef void (*JSONScannerValueFunc)(const gchar *name, gsize name_len,
+                                     const gchar *value, gsize value_len,
+                                     gpointer user_data);
+
+gboolean json_scanner_scan_object(const gchar *input, gsize input_len, const gchar *name_prefix,
+                                  JSONScannerValueFunc value_func, gpointer user_data,
+                                  const gchar **error);
+gboolean json_scanner_scan_subtree(const gchar *input, gsize input_len, const gchar *path, const gchar *name_prefix,
+                                   JSONScannerValueFunc value_func, gpointer user_data,
+                                   const gchar **error);
+
+#endif
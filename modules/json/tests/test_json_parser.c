@@ -142,7 +142,7 @@ test_json_parser_validate_type_representation(void)
   assert_log_message_value(msg, log_msg_get_value_handle(".prefix.int"), "123");
   assert_log_message_value(msg, log_msg_get_value_handle(".prefix.booltrue"), "true");
   assert_log_message_value(msg, log_msg_get_value_handle(".prefix.boolfalse"), "false");
-  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.double"), "1.230000");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.double"), "1.23");
   assert_log_message_value(msg, log_msg_get_value_handle(".prefix.object.member1"), "foo");
   assert_log_message_value(msg, log_msg_get_value_handle(".prefix.object.member2"), "bar");
   assert_log_message_value(msg, log_msg_get_value_handle(".prefix.array[0]"), "1");
@@ -151,6 +151,87 @@ test_json_parser_validate_type_representation(void)
   log_msg_unref(msg);
 }
 
+static void
+test_json_parser_preserves_the_original_representation_of_numbers(void)
+{
+  LogMessage *msg;
+
+  msg = parse_json_into_log_message("{'big': 12345678901234567890, 'neg': -42, 'exp': 1.5e-7, 'frac': 0.10}");
+  assert_log_message_value(msg, log_msg_get_value_handle("big"), "12345678901234567890");
+  assert_log_message_value(msg, log_msg_get_value_handle("neg"), "-42");
+  assert_log_message_value(msg, log_msg_get_value_handle("exp"), "1.5e-7");
+  assert_log_message_value(msg, log_msg_get_value_handle("frac"), "0.10");
+  log_msg_unref(msg);
+}
+
+static void
+test_json_parser_flattens_nested_objects_and_arrays(void)
+{
+  LogMessage *msg;
+
+  msg = parse_json_into_log_message("{\"a\": {\"b\": {\"c\": \"deep\"}, \"list\": [{\"x\": 1}, [2, 3], {}]}, \"empty\": []}");
+  assert_log_message_value(msg, log_msg_get_value_handle("a.b.c"), "deep");
+  assert_log_message_value(msg, log_msg_get_value_handle("a.list[0].x"), "1");
+  assert_log_message_value(msg, log_msg_get_value_handle("a.list[1][0]"), "2");
+  assert_log_message_value(msg, log_msg_get_value_handle("a.list[1][1]"), "3");
+  log_msg_unref(msg);
+}
+
+static void
+test_json_parser_unescapes_strings(void)
+{
+  LogMessage *msg;
+
+  msg = parse_json_into_log_message("{\"esc\": \"tab\\there \\\"quoted\\\" back\\\\slash\\/\", "
+                                    "\"uni\": \"\\u00e1rv\\u00edzt\\u0171r\\u0151 \\ud83d\\ude00\", "
+                                    "\"key\\u0020with space\": \"v\"}");
+  assert_log_message_value(msg, log_msg_get_value_handle("esc"), "tab\there \"quoted\" back\\slash/");
+  assert_log_message_value(msg, log_msg_get_value_handle("uni"), "\xc3\xa1rv\xc3\xadzt\xc5\xb1r\xc5\x91 \xf0\x9f\x98\x80");
+  assert_log_message_value(msg, log_msg_get_value_handle("key with space"), "v");
+  log_msg_unref(msg);
+}
+
+static void
+test_json_parser_fails_for_truncated_json(void)
+{
+  assert_json_parser_fails("{'foo': 'bar'");
+  assert_json_parser_fails("{'foo': 'bar");
+  assert_json_parser_fails("{'foo': {'bar': [1, 2}}");
+  assert_json_parser_fails("{'foo': tru}");
+  assert_json_parser_fails("{'foo': \"\\ud83d\"}");
+}
+
+static void
+test_json_parser_leaves_the_message_intact_on_syntax_errors(void)
+{
+  LogMessage *msg;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  const gchar *json = "{'foo': 'bar', 'nested': {'baz': 1}, 'broken': ]}";
+
+  msg = log_msg_new_empty();
+  assert_false(log_parser_process(json_parser, &msg, &path_options, json, strlen(json)),
+               "expected json-parser failure and it returned success, json=%s", json);
+  assert_log_message_value(msg, log_msg_get_value_handle("foo"), NULL);
+  assert_log_message_value(msg, log_msg_get_value_handle("nested.baz"), NULL);
+  log_msg_unref(msg);
+}
+
+static void
+test_json_parser_accepts_nan_and_infinity_literals(void)
+{
+  LogMessage *msg;
+
+  msg = parse_json_into_log_message("{'nan': NaN, 'inf': Infinity, 'neginf': -Infinity, 'list': [NaN]}");
+  assert_log_message_value(msg, log_msg_get_value_handle("nan"), "NaN");
+  assert_log_message_value(msg, log_msg_get_value_handle("inf"), "Infinity");
+  assert_log_message_value(msg, log_msg_get_value_handle("neginf"), "-Infinity");
+  assert_log_message_value(msg, log_msg_get_value_handle("list[0]"), "NaN");
+  log_msg_unref(msg);
+
+  assert_json_parser_fails("{'nan': Nan}");
+  assert_json_parser_fails("{'inf': -Inf}");
+}
+
 static void
 test_json_parser_fails_for_non_object_top_element(void)
 {
@@ -169,6 +250,55 @@ test_json_parser_extracts_subobjects_if_extract_prefix_is_specified(void)
   log_msg_unref(msg);
 }
 
+static void
+test_json_parser_extract_prefix_keeps_the_representation_of_values(void)
+{
+  LogMessage *msg, *extracted_msg;
+  const gchar *names[] = { "big", "double", "exp", "nan", "bool", "obj.list[0]", "obj.list[1]", "obj.str", NULL };
+  gint i;
+
+  msg = parse_json_into_log_message("{'big': 12345678901234567890, 'double': 1.23, 'exp': 1.5e-7, 'nan': NaN, "
+                                    "'bool': true, 'obj': {'list': [-42, 'x'], 'str': 'a\\tb'}}");
+
+  json_parser_set_extract_prefix(json_parser, "doc");
+  extracted_msg = parse_json_into_log_message("{'other': 2.5, 'doc': {'big': 12345678901234567890, 'double': 1.23, "
+                                              "'exp': 1.5e-7, 'nan': NaN, 'bool': true, "
+                                              "'obj': {'list': [-42, 'x'], 'str': 'a\\tb'}}}");
+
+  for (i = 0; names[i]; i++)
+    assert_log_message_value(extracted_msg, log_msg_get_value_handle(names[i]),
+                             log_msg_get_value(msg, log_msg_get_value_handle(names[i]), NULL));
+  assert_log_message_value(extracted_msg, log_msg_get_value_handle("double"), "1.23");
+  assert_log_message_value(extracted_msg, log_msg_get_value_handle("other"), NULL);
+  log_msg_unref(extracted_msg);
+  log_msg_unref(msg);
+}
+
+static void
+test_json_parser_extract_prefix_follows_the_structure_of_the_document(void)
+{
+  LogMessage *msg;
+
+  json_parser_set_prefix(json_parser, ".prefix.");
+  json_parser_set_extract_prefix(json_parser, "a.b[1]");
+  msg = parse_json_into_log_message("{'a.b': [{}, {'wrong': 1}], 'a': {'b': [{'x': 1}, {'y': 2, 'z': {'w': 3}}]}}");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.y"), "2");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.z.w"), "3");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.x"), NULL);
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.wrong"), NULL);
+  log_msg_unref(msg);
+}
+
+static void
+test_json_parser_extract_prefix_fails_without_an_object_at_the_path(void)
+{
+  json_parser_set_extract_prefix(json_parser, "doc");
+  assert_json_parser_fails("{'other': {'foo': 'bar'}}");
+  assert_json_parser_fails("{'doc': 'bar'}");
+  assert_json_parser_fails("{'doc': [{'foo': 'bar'}]}");
+  assert_json_parser_fails("{'doc': {'foo': 'bar'}, 'broken': ]}");
+}
+
 static void
 test_json_parser(void)
 {
@@ -178,8 +308,17 @@ test_json_parser(void)
   JSON_PARSER_TESTCASE(test_json_parser_fails_when_marker_is_not_present);
   JSON_PARSER_TESTCASE(test_json_parser_fails_for_invalid_json);
   JSON_PARSER_TESTCASE(test_json_parser_validate_type_representation);
+  JSON_PARSER_TESTCASE(test_json_parser_preserves_the_original_representation_of_numbers);
+  JSON_PARSER_TESTCASE(test_json_parser_flattens_nested_objects_and_arrays);
+  JSON_PARSER_TESTCASE(test_json_parser_unescapes_strings);
+  JSON_PARSER_TESTCASE(test_json_parser_fails_for_truncated_json);
+  JSON_PARSER_TESTCASE(test_json_parser_leaves_the_message_intact_on_syntax_errors);
+  JSON_PARSER_TESTCASE(test_json_parser_accepts_nan_and_infinity_literals);
   JSON_PARSER_TESTCASE(test_json_parser_fails_for_non_object_top_element);
   JSON_PARSER_TESTCASE(test_json_parser_extracts_subobjects_if_extract_prefix_is_specified);
+  JSON_PARSER_TESTCASE(test_json_parser_extract_prefix_keeps_the_representation_of_values);
+  JSON_PARSER_TESTCASE(test_json_parser_extract_prefix_follows_the_structure_of_the_document);
+  JSON_PARSER_TESTCASE(test_json_parser_extract_prefix_fails_without_an_object_at_the_path);
 }
 
 int
@@ -21,13 +21,13 @@
 
 #include "kv-parser.h"
 #include "kv-scanner.h"
+#include "scratch-buffers.h"
 
 typedef struct _KVParser
 {
   LogParser super;
   gchar *prefix;
   gsize prefix_len;
-  GString *formatted_key;
   KVScanner *kv_scanner;
 } KVParser;
 
@@ -57,35 +57,54 @@ kv_parser_set_value_separator(LogParser *s, gchar value_separator)
   kv_scanner_set_value_separator(self->kv_scanner, value_separator);
 }
 
+/* @formatted_key starts out with the prefix, which is kept between keys */
 static const gchar *
-_get_formatted_key(KVParser *self, const gchar *key)
+_get_formatted_key(KVParser *self, GString *formatted_key, const gchar *key)
 {
   if (!self->prefix)
     return key;
-  else if (self->formatted_key->len > 0)
-    g_string_truncate(self->formatted_key, self->prefix_len);
-  else
-    g_string_assign(self->formatted_key, self->prefix);
-  g_string_append(self->formatted_key, key);
-  return self->formatted_key->str;
+
+  g_string_truncate(formatted_key, self->prefix_len);
+  g_string_append(formatted_key, key);
+  return formatted_key->str;
 }
 
+/*
+ * The parser is shared by all threads, so the scanning state lives on
+ * the stack and in scratch buffers, which are reused from message to
+ * message without allocations.
+ */
 static gboolean
 kv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *path_options, const gchar *input, gsize input_len)
 {
   KVParser *self = (KVParser *) s;
+  SBGString *formatted_key = sb_gstring_acquire();
+  SBGString *key = sb_gstring_acquire();
+  SBGString *value = sb_gstring_acquire();
+  SBGString *decoded_value = sb_gstring_acquire();
+  KVScanner kv_scanner;
+
+  kv_scanner_init_from(&kv_scanner, self->kv_scanner,
+                       sb_gstring_string(key), sb_gstring_string(value), sb_gstring_string(decoded_value));
+  if (self->prefix)
+    g_string_assign(sb_gstring_string(formatted_key), self->prefix);
 
   log_msg_make_writable(pmsg, path_options);
-  /* FIXME: input length */
-  kv_scanner_input(self->kv_scanner, input);
-  while (kv_scanner_scan_next(self->kv_scanner))
+  kv_scanner_input(&kv_scanner, input, input_len);
+  while (kv_scanner_scan_next(&kv_scanner))
     {
+      const gchar *name = _get_formatted_key(self, sb_gstring_string(formatted_key),
+                                             kv_scanner_get_current_key(&kv_scanner));
 
-      /* FIXME: value length */
-      log_msg_set_value_by_name(*pmsg,
-                                _get_formatted_key(self, kv_scanner_get_current_key(self->kv_scanner)),
-                                kv_scanner_get_current_value(self->kv_scanner), -1);
+      log_msg_set_value(*pmsg, log_msg_get_value_handle(name),
+                        kv_scanner_get_current_value(&kv_scanner),
+                        kv_scanner_get_current_value_len(&kv_scanner));
     }
+
+  sb_gstring_release(formatted_key);
+  sb_gstring_release(key);
+  sb_gstring_release(value);
+  sb_gstring_release(decoded_value);
   return TRUE;
 }
 
@@ -107,22 +126,10 @@ kv_parser_free(LogPipe *s)
   KVParser *self = (KVParser *)s;
 
   kv_scanner_free(self->kv_scanner);
-  g_string_free(self->formatted_key, TRUE);
   g_free(self->prefix);
   log_parser_free_method(s);
 }
 
-static gboolean
-kv_parser_process_threaded(LogParser *s, LogMessage **pmsg, const LogPathOptions *path_options, const gchar *input, gsize input_len)
-{
-  LogParser *self = (LogParser *)log_pipe_clone(&s->super);
-
-  gboolean ok = kv_parser_process(self, pmsg, path_options, input, input_len);
-
-  log_pipe_unref(&self->super);
-  return ok;
-}
-
 LogParser *
 kv_parser_new(GlobalConfig *cfg, KVScanner *kv_scanner)
 {
@@ -131,9 +138,8 @@ kv_parser_new(GlobalConfig *cfg, KVScanner *kv_scanner)
   log_parser_init_instance(&self->super, cfg);
   self->super.super.free_fn = kv_parser_free;
   self->super.super.clone = kv_parser_clone;
-  self->super.process = kv_parser_process_threaded;
+  self->super.process = kv_parser_process;
 
   self->kv_scanner = kv_scanner;
-  self->formatted_key = g_string_sized_new(32);
   return &self->super;
 }
@@ -38,18 +38,19 @@ kv_scanner_set_value_separator(KVScanner *self, gchar value_separator)
   self->value_separator = value_separator;
 }
 
+/* @input need not be NUL terminated, unless @input_len is -1 */
 void
-kv_scanner_input(KVScanner *self, const gchar *input)
+kv_scanner_input(KVScanner *self, const gchar *input, gssize input_len)
 {
   self->input = input;
-  self->input_len = strlen(input);
+  self->input_len = input_len < 0 ? strlen(input) : input_len;
   self->input_pos = 0;
 }
 
 static gboolean
 _kv_scanner_skip_space(KVScanner *self)
 {
-  while (self->input[self->input_pos] == ' ')
+  while (self->input_pos < self->input_len && self->input[self->input_pos] == ' ')
     self->input_pos++;
   return TRUE;
 }
@@ -68,11 +69,12 @@ static gboolean
 _kv_scanner_extract_key(KVScanner *self)
 {
   const gchar *input_ptr = &self->input[self->input_pos];
+  const gchar *input_end = &self->input[self->input_len];
   const gchar *start_of_key;
   const gchar *separator;
   gsize len;
 
-  separator = strchr(input_ptr, self->value_separator);
+  separator = memchr(input_ptr, self->value_separator, input_end - input_ptr);
   do
     {
       if (!separator)
@@ -82,7 +84,7 @@ _kv_scanner_extract_key(KVScanner *self)
         start_of_key--;
       len = separator - start_of_key;
       if (len < 1)
-        separator = strchr(separator + 1, self->value_separator);
+        separator = memchr(separator + 1, self->value_separator, input_end - (separator + 1));
     }
   while (len < 1);
 
@@ -125,27 +127,28 @@ _decode_backslash_escape(KVScanner *self, gchar ch)
 }
 
 static gboolean
-_is_delimiter(const gchar *cur)
+_is_delimiter(const gchar *cur, const gchar *end)
 {
-  return (*cur == ' ') || (strncmp(cur, ", ", 2) == 0);
+  return (*cur == ' ') || (*cur == ',' && cur + 1 < end && *(cur + 1) == ' ');
 }
 
 static gboolean
 _kv_scanner_extract_value(KVScanner *self)
 {
-  const gchar *cur;
+  const gchar *cur, *end;
 
   g_string_truncate(self->value, 0);
   self->value_was_quoted = FALSE;
   cur = &self->input[self->input_pos];
+  end = &self->input[self->input_len];
 
   self->quote_state = KV_QUOTE_INITIAL;
-  while (*cur && self->quote_state != KV_QUOTE_FINISH)
+  while (cur < end && self->quote_state != KV_QUOTE_FINISH)
     {
       switch (self->quote_state)
         {
         case KV_QUOTE_INITIAL:
-          if (_is_delimiter(cur))
+          if (_is_delimiter(cur, end))
             {
               self->quote_state = KV_QUOTE_FINISH;
             }
@@ -216,6 +219,12 @@ kv_scanner_get_current_value(KVScanner *self)
   return self->value->str;
 }
 
+gsize
+kv_scanner_get_current_value_len(KVScanner *self)
+{
+  return self->value->len;
+}
+
 void
 kv_scanner_free_method(KVScanner *self)
 {
@@ -235,6 +244,26 @@ kv_scanner_clone(KVScanner *self)
   return cloned;
 }
 
+/*
+ * Sets up @self, usually allocated on the stack, to scan with the settings
+ * of @source, using the buffers supplied by the caller as its working
+ * storage.  This way a single configured scanner can be shared by all
+ * threads without cloning it for every message.  @self must not be freed.
+ */
+void
+kv_scanner_init_from(KVScanner *self, KVScanner *source, GString *key, GString *value, GString *decoded_value)
+{
+  *self = *source;
+  self->key = key;
+  self->value = value;
+  self->decoded_value = decoded_value;
+  self->free_fn = NULL;
+
+  g_string_truncate(self->key, 0);
+  g_string_truncate(self->value, 0);
+  g_string_truncate(self->decoded_value, 0);
+}
+
 void
 kv_scanner_init(KVScanner *self)
 {
@@ -43,13 +43,15 @@ struct _KVScanner
 };
 
 void kv_scanner_set_value_separator(KVScanner *self, gchar value_separator);
-void kv_scanner_input(KVScanner *self, const gchar *input);
+void kv_scanner_input(KVScanner *self, const gchar *input, gssize input_len);
 gboolean kv_scanner_scan_next(KVScanner *self);
 const gchar *kv_scanner_get_current_key(KVScanner *self);
 const gchar *kv_scanner_get_current_value(KVScanner *self);
+gsize kv_scanner_get_current_value_len(KVScanner *self);
 KVScanner *kv_scanner_clone(KVScanner *self);
 void kv_scanner_free_method(KVScanner *self);
 void kv_scanner_init(KVScanner *self);
+void kv_scanner_init_from(KVScanner *self, KVScanner *source, GString *key, GString *value, GString *decoded_value);
 
 KVScanner *kv_scanner_new(void);
 void kv_scanner_free(KVScanner *self);
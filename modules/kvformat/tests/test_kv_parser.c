@@ -120,11 +120,27 @@ test_kv_parser_audit(void)
   log_msg_unref(msg);
 }
 
+static void
+test_kv_parser_stops_at_input_len(void)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg = log_msg_new_empty();
+  const gchar *input = "foo=bar baz=truncated";
+
+  kv_parser_set_prefix(kv_parser, ".prefix.");
+  assert_true(log_parser_process(kv_parser, &msg, &path_options, input, strlen("foo=bar baz=trunc")),
+              "kv-parser is expected to succeed");
+  assert_log_message_value_by_name(msg, ".prefix.foo", "bar");
+  assert_log_message_value_by_name(msg, ".prefix.baz", "trunc");
+  log_msg_unref(msg);
+}
+
 static void
 test_kv_parser(void)
 {
   KV_PARSER_TESTCASE(test_kv_parser_basics);
   KV_PARSER_TESTCASE(test_kv_parser_audit);
+  KV_PARSER_TESTCASE(test_kv_parser_stops_at_input_len);
 }
 
 int
@@ -111,7 +111,7 @@ _scan_kv_pairs_fn(KVScanner *scanner, const gchar *input, ScanTestFn fn, va_list
 {
   g_assert(input);
 
-  kv_scanner_input(scanner, input);
+  kv_scanner_input(scanner, input, -1);
   gboolean expect_more = TRUE;
   while (fn(scanner, args, &expect_more))
     {
@@ -92,28 +92,28 @@ static void
 test_linux_audit_scanner_audit_style_hex_dump_is_decoded(void)
 {
   /* not decoded as no characters to be escaped, kernel only escapes stuff below 0x21, above 0x7e and the quote character */
-  kv_scanner_input(kv_scanner, "proctitle=41607E");
+  kv_scanner_input(kv_scanner, "proctitle=41607E", -1);
   assert_next_kv_is("proctitle", "41607E");
   assert_no_more_tokens();
 
-  kv_scanner_input(kv_scanner, "proctitle=412042");
+  kv_scanner_input(kv_scanner, "proctitle=412042", -1);
   assert_next_kv_is("proctitle", "A B");
   assert_no_more_tokens();
 
   /* odd number of chars, not decoded */
-  kv_scanner_input(kv_scanner, "proctitle=41204");
+  kv_scanner_input(kv_scanner, "proctitle=41204", -1);
   assert_next_kv_is("proctitle", "41204");
   assert_no_more_tokens();
 
-  kv_scanner_input(kv_scanner, "proctitle=C3A17276C3AD7A74C5B172C59174C3BC6BC3B67266C3BA72C3B367C3A970");
+  kv_scanner_input(kv_scanner, "proctitle=C3A17276C3AD7A74C5B172C59174C3BC6BC3B67266C3BA72C3B367C3A970", -1);
   assert_next_kv_is("proctitle", "árvíztűrőtükörfúrógép");
   assert_no_more_tokens();
 
-  kv_scanner_input(kv_scanner, "proctitle=2F62696E2F7368002D65002F6574632F696E69742E642F706F737466697800737461747573");
+  kv_scanner_input(kv_scanner, "proctitle=2F62696E2F7368002D65002F6574632F696E69742E642F706F737466697800737461747573", -1);
   assert_next_kv_is("proctitle", "/bin/sh\t-e\t/etc/init.d/postfix\tstatus");
   assert_no_more_tokens();
 
-  kv_scanner_input(kv_scanner, "a1=2F62696E2F7368202D6C");
+  kv_scanner_input(kv_scanner, "a1=2F62696E2F7368202D6C", -1);
   assert_next_kv_is("a1", "/bin/sh -l");
   assert_no_more_tokens();
 }
@@ -31,6 +31,7 @@
 #include "stats/stats.h"
 #include "string-list.h"
 #include "str-utils.h"
+#include "seqnum.h"
 
 #ifndef SCS_PYTHON
 #define SCS_PYTHON 0
@@ -47,12 +48,20 @@ typedef struct
   GHashTable *options;
   ValuePairs *vp;
 
+  /* messages waiting for the next flush, in batch mode the interpreter
+   * lock is only acquired once per batch */
+  GPtrArray *batch;
+
+  StatsCounterItem *gil_wait_time;
+  glong gil_wait_nsec;
+
   struct
   {
     PyObject *class;
     PyObject *instance;
     PyObject *is_opened;
     PyObject *send;
+    PyObject *send_batch;
   } py;
 } PythonDestDriver;
 
@@ -131,6 +140,19 @@ python_dd_format_stats_instance(LogThrDestDriver *d)
   return persist_name;
 }
 
+/* there is no counter type for durations, the "processed" counter of this
+ * instance holds the time spent waiting for the GIL in milliseconds */
+static gchar *
+python_dd_format_gil_stats_instance(PythonDestDriver *self)
+{
+  static gchar stats_instance[1024];
+
+  g_snprintf(stats_instance, sizeof(stats_instance),
+             "%s,gil_wait_msec",
+             self->class);
+  return stats_instance;
+}
+
 static gchar *
 python_dd_format_persist_name(LogThrDestDriver *d)
 {
@@ -143,6 +165,12 @@ python_dd_format_persist_name(LogThrDestDriver *d)
   return persist_name;
 }
 
+/* acquire the interpreter lock, accounting the time spent waiting for it */
+static PyGILState_STATE
+_py_acquire_gil(PythonDestDriver *self)
+{
+  return _py_acquire_gil_with_stats(self->gil_wait_time, &self->gil_wait_nsec);
+}
 
 static PyObject *
 _py_invoke_function(PythonDestDriver *self, PyObject *func, PyObject *arg)
@@ -318,6 +346,7 @@ _py_init_bindings(PythonDestDriver *self)
   /* these are fast paths, store references to be faster */
   self->py.is_opened = _py_get_attr_or_null(self->py.instance, "is_opened");
   self->py.send = _py_get_attr_or_null(self->py.instance, "send");
+  self->py.send_batch = _py_get_attr_or_null(self->py.instance, "send_batch");
   if (!self->py.send)
     {
       msg_error("Error initializing Python destination, class does not have a send() method",
@@ -334,6 +363,7 @@ _py_free_bindings(PythonDestDriver *self)
   Py_CLEAR(self->py.instance);
   Py_CLEAR(self->py.is_opened);
   Py_CLEAR(self->py.send);
+  Py_CLEAR(self->py.send_batch);
 }
 
 static gboolean
@@ -349,50 +379,168 @@ _py_init_object(PythonDestDriver *self)
   return TRUE;
 }
 
+static gboolean
+_py_construct_message(PythonDestDriver *self, LogMessage *msg, gint32 seq_num, PyObject **msg_object)
+{
+  gboolean success;
+
+  if (!self->vp)
+    {
+      *msg_object = py_log_message_new(msg);
+      return TRUE;
+    }
+
+  success = py_value_pairs_apply(self->vp, &self->template_options, seq_num, msg, msg_object);
+  if (!success && (self->template_options.on_error & ON_ERROR_DROP_MESSAGE))
+    return FALSE;
+  return TRUE;
+}
+
+static void
+_report_send_failure(PythonDestDriver *self, const gchar *method)
+{
+  msg_error("Python send method returned failure, suspending destination for time_reopen()",
+            evt_tag_str("driver", self->super.super.super.id),
+            evt_tag_str("class", self->class),
+            evt_tag_str("method", method),
+            evt_tag_int("time_reopen", self->super.time_reopen));
+}
+
+static gboolean
+_is_batching_enabled(PythonDestDriver *self)
+{
+  return self->super.batch.lines > 1 || self->super.batch.timeout > 0;
+}
+
 static worker_insert_result_t
 python_dd_insert(LogThrDestDriver *d, LogMessage *msg)
 {
   PythonDestDriver *self = (PythonDestDriver *)d;
   worker_insert_result_t result = WORKER_INSERT_RESULT_ERROR;
-  gboolean success;
   PyObject *msg_object;
   PyGILState_STATE gstate;
 
-  gstate = PyGILState_Ensure();
+  if (_is_batching_enabled(self))
+    {
+      g_ptr_array_add(self->batch, log_msg_ref(msg));
+      return WORKER_INSERT_RESULT_QUEUED;
+    }
+
+  gstate = _py_acquire_gil(self);
   if (!_py_invoke_is_opened(self))
     {
       result = WORKER_INSERT_RESULT_NOT_CONNECTED;
       goto exit;
     }
-  if (self->vp)
+  if (!_py_construct_message(self, msg, self->super.seq_num, &msg_object))
+    goto exit;
+
+  if (_py_invoke_send(self, msg_object))
+    result = WORKER_INSERT_RESULT_SUCCESS;
+  else
+    _report_send_failure(self, "send");
+  Py_DECREF(msg_object);
+
+ exit:
+  PyGILState_Release(gstate);
+  return result;
+}
+
+/* hand over the whole batch as a list to send_batch(), messages that
+ * cannot be formatted are dropped */
+static worker_insert_result_t
+_py_flush_via_send_batch(PythonDestDriver *self)
+{
+  PyObject *msg_list, *msg_object;
+  gint32 seq_num = self->super.batch.seq_num;
+  gint i, dropped = 0;
+  gboolean success;
+
+  msg_list = PyList_New(0);
+  for (i = 0; i < self->batch->len; i++)
     {
-      success = py_value_pairs_apply(self->vp, &self->template_options, self->super.seq_num, msg, &msg_object);
-      if (!success && (self->template_options.on_error & ON_ERROR_DROP_MESSAGE))
+      if (!_py_construct_message(self, g_ptr_array_index(self->batch, i), seq_num, &msg_object))
+        dropped++;
+      else
         {
-          goto exit;
+          PyList_Append(msg_list, msg_object);
+          Py_DECREF(msg_object);
         }
+      step_sequence_number(&seq_num);
     }
-  else
-    {
-      msg_object = py_log_message_new(msg);
-    }
 
-  success = _py_invoke_send(self, msg_object);
-  if (success)
+  success = _py_invoke_bool_function(self, self->py.send_batch, msg_list);
+  Py_DECREF(msg_list);
+
+  if (!success)
     {
-      result = WORKER_INSERT_RESULT_SUCCESS;
+      _report_send_failure(self, "send_batch");
+      return WORKER_INSERT_RESULT_ERROR;
     }
-  else
+
+  /* the whole batch is settled at once, so it does not matter which
+   * messages of it are counted as dropped */
+  log_threaded_dest_driver_batch_drop(&self->super, dropped);
+  return WORKER_INSERT_RESULT_SUCCESS;
+}
+
+/* call send() for each message while holding the interpreter lock only
+ * once, the successfully sent prefix of the batch is acked even if a
+ * later message fails */
+static worker_insert_result_t
+_py_flush_via_send(PythonDestDriver *self)
+{
+  PyObject *msg_object;
+  gint i;
+
+  for (i = 0; i < self->batch->len; i++)
     {
-      msg_error("Python send() method returned failure, suspending destination for time_reopen()",
-                evt_tag_str("driver", self->super.super.super.id),
-                evt_tag_str("class", self->class),
-                evt_tag_int("time_reopen", self->super.time_reopen));
+      /* batch.seq_num is stepped as each message is settled */
+      if (!_py_construct_message(self, g_ptr_array_index(self->batch, i), self->super.batch.seq_num, &msg_object))
+        {
+          log_threaded_dest_driver_batch_drop(&self->super, 1);
+          continue;
+        }
+
+      if (!_py_invoke_send(self, msg_object))
+        {
+          Py_DECREF(msg_object);
+          _report_send_failure(self, "send");
+          return WORKER_INSERT_RESULT_ERROR;
+        }
+      Py_DECREF(msg_object);
+      log_threaded_dest_driver_batch_accept(&self->super, 1);
     }
-  Py_DECREF(msg_object);
+  return WORKER_INSERT_RESULT_SUCCESS;
+}
 
- exit:
+static void
+_free_batch(PythonDestDriver *self)
+{
+  g_ptr_array_foreach(self->batch, (GFunc) log_msg_unref, NULL);
+  g_ptr_array_set_size(self->batch, 0);
+}
+
+static worker_insert_result_t
+python_dd_flush(LogThrDestDriver *d)
+{
+  PythonDestDriver *self = (PythonDestDriver *)d;
+  worker_insert_result_t result;
+  PyGILState_STATE gstate;
+
+  if (self->batch->len == 0)
+    return WORKER_INSERT_RESULT_SUCCESS;
+
+  gstate = _py_acquire_gil(self);
+  if (!_py_invoke_is_opened(self))
+    result = WORKER_INSERT_RESULT_NOT_CONNECTED;
+  else if (self->py.send_batch)
+    result = _py_flush_via_send_batch(self);
+  else
+    result = _py_flush_via_send(self);
   PyGILState_Release(gstate);
+
+  _free_batch(self);
   return result;
 }
 
@@ -401,7 +549,7 @@ python_dd_open(PythonDestDriver *self)
 {
   PyGILState_STATE gstate;
 
-  gstate = PyGILState_Ensure();
+  gstate = _py_acquire_gil(self);
   if (!_py_invoke_is_opened(self))
     _py_invoke_open(self);
 
@@ -413,7 +561,7 @@ python_dd_close(PythonDestDriver *self)
 {
   PyGILState_STATE gstate;
 
-  gstate = PyGILState_Ensure();
+  gstate = _py_acquire_gil(self);
   if (_py_invoke_is_opened(self))
     _py_invoke_close(self);
   PyGILState_Release(gstate);
@@ -440,6 +588,7 @@ python_dd_disconnect(LogThrDestDriver *d)
 {
   PythonDestDriver *self = (PythonDestDriver *) d;
 
+  _free_batch(self);
   python_dd_close(self);
 }
 
@@ -472,6 +621,12 @@ python_dd_init(LogPipe *d)
 
   PyGILState_Release(gstate);
 
+  stats_lock();
+  stats_register_counter(0, SCS_PYTHON | SCS_DESTINATION, self->super.super.super.id,
+                         python_dd_format_gil_stats_instance(self),
+                         SC_TYPE_PROCESSED, &self->gil_wait_time);
+  stats_unlock();
+
   msg_verbose("Python destination initialized",
               evt_tag_str("driver", self->super.super.super.id),
               evt_tag_str("class", self->class));
@@ -493,6 +648,12 @@ python_dd_deinit(LogPipe *d)
   _py_invoke_deinit(self);
   PyGILState_Release(gstate);
 
+  stats_lock();
+  stats_unregister_counter(SCS_PYTHON | SCS_DESTINATION, self->super.super.super.id,
+                           python_dd_format_gil_stats_instance(self),
+                           SC_TYPE_PROCESSED, &self->gil_wait_time);
+  stats_unlock();
+
   return log_threaded_dest_driver_deinit_method(d);
 }
 
@@ -510,6 +671,8 @@ python_dd_free(LogPipe *d)
 
   g_free(self->class);
 
+  _free_batch(self);
+  g_ptr_array_free(self->batch, TRUE);
   value_pairs_unref(self->vp);
 
   if (self->options)
@@ -534,12 +697,14 @@ python_dd_new(GlobalConfig *cfg)
   self->super.worker.thread_deinit = python_dd_worker_deinit;
   self->super.worker.disconnect = python_dd_disconnect;
   self->super.worker.insert = python_dd_insert;
+  self->super.worker.flush = python_dd_flush;
 
   self->super.format.stats_instance = python_dd_format_stats_instance;
   self->super.format.persist_name = python_dd_format_persist_name;
   self->super.stats_source = SCS_PYTHON;
 
   self->options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+  self->batch = g_ptr_array_new();
 
   return (LogDriver *)self;
 }
@@ -23,6 +23,9 @@
  */
 #include "python-helpers.h"
 #include "messages.h"
+#include "timeutils.h"
+
+#include <time.h>
 
 const gchar *
 _py_get_callable_name(PyObject *callable, gchar *buf, gsize buf_len)
@@ -156,3 +159,27 @@ _py_resolve_qualified_name(const gchar *name)
   g_free(attribute_name);
   return value;
 }
+
+/*
+ * Acquires the interpreter lock, adding the time spent waiting for it to
+ * @wait_time in milliseconds.  The sub-millisecond remainder is carried
+ * over in @wait_nsec, which must not be shared between threads.
+ */
+PyGILState_STATE
+_py_acquire_gil_with_stats(StatsCounterItem *wait_time, glong *wait_nsec)
+{
+  struct timespec start, stop;
+  PyGILState_STATE gstate;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  gstate = PyGILState_Ensure();
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+
+  *wait_nsec += timespec_diff_nsec(&stop, &start);
+  if (*wait_nsec >= 1000000)
+    {
+      stats_counter_add(wait_time, *wait_nsec / 1000000);
+      *wait_nsec %= 1000000;
+    }
+  return gstate;
+}
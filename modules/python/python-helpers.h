@@ -25,11 +25,13 @@
 #define PYTHON_HELPERS_H_INCLUDED 1
 
 #include "python-module.h"
+#include "stats/stats.h"
 
 const gchar *_py_get_callable_name(PyObject *callable, gchar *buf, gsize buf_len);
 const gchar *_py_format_exception_text(gchar *buf, gsize buf_len);
 PyObject *_py_get_attr_or_null(PyObject *o, const gchar *attr);
 PyObject *_py_do_import(const gchar *modname);
 PyObject *_py_resolve_qualified_name(const gchar *name);
+PyGILState_STATE _py_acquire_gil_with_stats(StatsCounterItem *wait_time, glong *wait_nsec);
 
 #endif
@@ -72,6 +72,7 @@ python_module_init(GlobalConfig *cfg, CfgArgs *args G_GNUC_UNUSED)
 {
   _py_init_interpreter();
   python_debugger_init();
+  tf_python_register_stats();
   plugin_register(cfg, python_plugins, G_N_ELEMENTS(python_plugins));
   return TRUE;
 }
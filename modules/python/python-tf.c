@@ -26,8 +26,35 @@
 #include "python-main.h"
 #include "template/simple-function.h"
 #include "python-logmsg.h"
+#include "tls-support.h"
+#include "stats/stats-registry.h"
 #include <time.h>
 
+TLS_BLOCK_START
+{
+  glong gil_wait_nsec;
+}
+TLS_BLOCK_END;
+
+#define local_gil_wait_nsec __tls_deref(gil_wait_nsec)
+
+/* shared by every $(python) invocation, template functions have no
+ * per-instance state to hang a counter on.  Holds milliseconds, not a
+ * message count, despite being registered as SC_TYPE_PROCESSED */
+static StatsCounterItem *gil_wait_time;
+
+void
+tf_python_register_stats(void)
+{
+  if (gil_wait_time)
+    return;
+
+  stats_lock();
+  stats_register_counter(0, SCS_GLOBAL, "python", "tf_python,gil_wait_msec",
+                         SC_TYPE_PROCESSED, &gil_wait_time);
+  stats_unlock();
+}
+
 static PyObject *
 _py_construct_args_tuple(LogMessage *msg, gint argc, GString *argv[])
 {
@@ -102,7 +129,7 @@ tf_python(LogMessage *msg, gint argc, GString *argv[], GString *result)
     return;
   function_name = argv[0]->str;
 
-  gstate = PyGILState_Ensure();
+  gstate = _py_acquire_gil_with_stats(gil_wait_time, &local_gil_wait_nsec);
 
   if (!(ret = _py_invoke_template_function(function_name, msg, argc, argv)) ||
       !_py_convert_return_value_to_result(function_name, ret, result))
@@ -30,4 +30,6 @@
 
 TEMPLATE_FUNCTION_PROTOTYPE(tf_python);
 
+void tf_python_register_stats(void);
+
 #endif
@@ -54,3 +54,13 @@ class DummyPythonDest(LogDestination):
     def send(self, msg):
         print('queue', msg)
         return True
+
+
+class DummyPythonBatchDest(LogDestination):
+    """Example for batch mode, enabled by the batch-lines() and
+    batch-timeout() options.  If send_batch() is not defined, send() is
+    called for each message of the batch."""
+
+    def send_batch(self, msgs):
+        print('queue batch', len(msgs))
+        return True
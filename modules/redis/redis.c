@@ -177,20 +177,16 @@ redis_dd_disconnect(LogThrDestDriver *s)
  * Worker thread
  */
 
-static worker_insert_result_t
-redis_worker_insert(LogThrDestDriver *s, LogMessage *msg)
+static gboolean
+_is_pipelining_enabled(RedisDriver *self)
 {
-  RedisDriver *self = (RedisDriver *)s;
-  redisReply *reply;
-  const char *argv[5];
-  size_t argvlen[5];
-  int argc = 2;
-
-  if (!redis_dd_connect(self, TRUE))
-    return WORKER_INSERT_RESULT_NOT_CONNECTED;
+  return self->super.batch.lines > 1 || self->super.batch.timeout > 0;
+}
 
-  if (self->c->err)
-    return WORKER_INSERT_RESULT_ERROR;
+static gint
+_format_command(RedisDriver *self, LogMessage *msg, const char **argv, size_t *argvlen)
+{
+  int argc = 2;
 
   log_template_format(self->key, msg, &self->template_options, LTZ_SEND,
                       self->super.seq_num, NULL, self->key_str);
@@ -220,7 +216,24 @@ redis_worker_insert(LogThrDestDriver *s, LogMessage *msg)
       argvlen[3] = self->param2_str->len;
       argc++;
     }
+  return argc;
+}
 
+static worker_insert_result_t
+redis_worker_insert_single(RedisDriver *self, LogMessage *msg)
+{
+  redisReply *reply;
+  const char *argv[5];
+  size_t argvlen[5];
+  int argc;
+
+  if (!redis_dd_connect(self, TRUE))
+    return WORKER_INSERT_RESULT_NOT_CONNECTED;
+
+  if (self->c->err)
+    return WORKER_INSERT_RESULT_ERROR;
+
+  argc = _format_command(self, msg, argv, argvlen);
   reply = redisCommandArgv(self->c, argc, argv, argvlen);
 
   if (!reply)
@@ -247,6 +260,94 @@ redis_worker_insert(LogThrDestDriver *s, LogMessage *msg)
   return WORKER_INSERT_RESULT_SUCCESS;
 }
 
+/*
+ * In pipelined mode commands are only appended to the output buffer of
+ * the connection, they are sent and their replies are read when the
+ * batch is flushed.  The connection is checked once per batch, as a PING
+ * in the middle would be answered after the pending commands.
+ */
+static worker_insert_result_t
+redis_worker_insert_pipelined(RedisDriver *self, LogMessage *msg)
+{
+  const char *argv[5];
+  size_t argvlen[5];
+  int argc;
+
+  if (self->super.batch.size == 0 && !redis_dd_connect(self, TRUE))
+    return WORKER_INSERT_RESULT_NOT_CONNECTED;
+
+  if (!self->c || self->c->err)
+    return WORKER_INSERT_RESULT_ERROR;
+
+  argc = _format_command(self, msg, argv, argvlen);
+  if (redisAppendCommandArgv(self->c, argc, argv, argvlen) != REDIS_OK)
+    return WORKER_INSERT_RESULT_ERROR;
+
+  return WORKER_INSERT_RESULT_QUEUED;
+}
+
+static worker_insert_result_t
+redis_worker_insert(LogThrDestDriver *s, LogMessage *msg)
+{
+  RedisDriver *self = (RedisDriver *)s;
+
+  if (_is_pipelining_enabled(self))
+    return redis_worker_insert_pipelined(self, msg);
+
+  return redis_worker_insert_single(self, msg);
+}
+
+/*
+ * Replies arrive in the order of the commands, so each message is acked
+ * as soon as its reply is read.  If the connection breaks, only the
+ * messages whose replies are missing remain in the batch to be retried.
+ * An error reply means that the server rejected that single command,
+ * retrying it would not help, so it is dropped.
+ */
+static worker_insert_result_t
+redis_worker_flush(LogThrDestDriver *s)
+{
+  RedisDriver *self = (RedisDriver *)s;
+  redisReply *reply;
+  gint sent = self->super.batch.size;
+
+  if (!self->c || self->c->err)
+    return WORKER_INSERT_RESULT_NOT_CONNECTED;
+
+  while (self->super.batch.size > 0)
+    {
+      if (redisGetReply(self->c, (void **) &reply) != REDIS_OK)
+        {
+          msg_error("REDIS server error while reading pipelined replies, suspending",
+                    evt_tag_str("driver", self->super.super.super.id),
+                    evt_tag_str("error", self->c->errstr),
+                    evt_tag_int("unacknowledged", self->super.batch.size),
+                    evt_tag_int("time_reopen", self->super.time_reopen));
+          return WORKER_INSERT_RESULT_ERROR;
+        }
+
+      if (reply->type == REDIS_REPLY_ERROR)
+        {
+          msg_error("REDIS server rejected command, dropping message",
+                    evt_tag_str("driver", self->super.super.super.id),
+                    evt_tag_str("command", self->command->str),
+                    evt_tag_str("error", reply->str));
+          log_threaded_dest_driver_batch_drop(&self->super, 1);
+        }
+      else
+        {
+          log_threaded_dest_driver_batch_accept(&self->super, 1);
+        }
+      freeReplyObject(reply);
+    }
+
+  msg_debug("REDIS pipelined commands sent",
+            evt_tag_str("driver", self->super.super.super.id),
+            evt_tag_str("command", self->command->str),
+            evt_tag_int("commands", sent));
+  return WORKER_INSERT_RESULT_SUCCESS;
+}
+
 static void
 redis_worker_thread_init(LogThrDestDriver *d)
 {
@@ -330,6 +431,7 @@ redis_dd_new(GlobalConfig *cfg)
   self->super.worker.thread_deinit = redis_worker_thread_deinit;
   self->super.worker.disconnect = redis_dd_disconnect;
   self->super.worker.insert = redis_worker_insert;
+  self->super.worker.flush = redis_worker_flush;
 
   self->super.format.stats_instance = redis_dd_format_stats_instance;
   self->super.format.persist_name = redis_dd_format_persist_name;
@@ -103,6 +103,24 @@ static GOptionEntry stats_options[] =
   { NULL,    0,   0, G_OPTION_ARG_NONE, NULL,                        NULL,             NULL }
 };
 
+static gchar *query_options_format = "csv";
+static gchar *query_options_component = "*";
+static gchar *query_options_id = "*";
+static gchar *query_options_instance = "*";
+
+static GOptionEntry query_options[] =
+{
+  { "format", 'f', 0, G_OPTION_ARG_STRING, &query_options_format,
+    "output format, csv (default) or compact", "<csv|compact>" },
+  { "component", 0, 0, G_OPTION_ARG_STRING, &query_options_component,
+    "glob pattern on the component name (e.g. dst.tcp)", "<glob>" },
+  { "id", 0, 0, G_OPTION_ARG_STRING, &query_options_id,
+    "glob pattern on the id of the counter", "<glob>" },
+  { "instance", 0, 0, G_OPTION_ARG_STRING, &query_options_instance,
+    "glob pattern on the instance of the counter", "<glob>" },
+  { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL }
+};
+
 static GOptionEntry verbose_options[] =
 {
   { "set", 's', 0, G_OPTION_ARG_STRING, &verbose_set,
@@ -132,6 +150,32 @@ slng_stats(int argc, char *argv[], const gchar *mode)
   return 0;
 }
 
+static gint
+slng_query(int argc, char *argv[], const gchar *mode)
+{
+  gchar *command;
+  GString *rsp;
+
+  if (strchr(query_options_format, ' ') || strchr(query_options_component, ' ') || strchr(query_options_id, ' '))
+    {
+      fprintf(stderr, "Only the --instance pattern may contain spaces\n");
+      return 1;
+    }
+
+  command = g_strdup_printf("QUERY %s %s %s %s\n", query_options_format, query_options_component, query_options_id, query_options_instance);
+  rsp = slng_run_command(command);
+  g_free(command);
+
+  if (rsp == NULL)
+    return 1;
+
+  printf("%s\n", rsp->str);
+
+  g_string_free(rsp, TRUE);
+
+  return 0;
+}
+
 static gint
 slng_stop(int argc, char *argv[], const gchar *mode)
 {
@@ -162,6 +206,21 @@ slng_reload(int argc, char *argv[], const gchar *mode)
   return 0;
 }
 
+static gint
+slng_threads(int argc, char *argv[], const gchar *mode)
+{
+  GString *rsp = slng_run_command("THREADS\n");
+
+  if (rsp == NULL)
+    return 1;
+
+  printf("%s\n", rsp->str);
+
+  g_string_free(rsp, TRUE);
+
+  return 0;
+}
+
 static GOptionEntry no_options[] =
 {
   { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL }
@@ -202,11 +261,13 @@ static struct
 } modes[] =
 {
   { "stats", stats_options, "Query/reset syslog-ng statistics", slng_stats },
+  { "query", query_options, "Query syslog-ng statistics filtered by component, id and instance", slng_query },
   { "verbose", verbose_options, "Enable/query verbose messages", slng_verbose },
   { "debug", verbose_options, "Enable/query debug messages", slng_verbose },
   { "trace", verbose_options, "Enable/query trace messages", slng_verbose },
   { "stop", no_options, "Stop syslog-ng process", slng_stop },
   { "reload", no_options, "Reload syslog-ng", slng_reload },
+  { "threads", no_options, "List threads with their CPU and NUMA node placement", slng_threads },
   { NULL, NULL },
 };
 
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+/*
+ * json-parser-bench: measures json-parser() over a generated corpus of
+ * nested documents, both on its own and with extract-prefix(), which is
+ * measured by wrapping each document into {"doc": ...} and extracting
+ * "doc".
+ *
+ *   tests/bench/json-parser-bench -n 200000 -d 3 -w 5
+ */
+
+#include "syslog-ng.h"
+#include "apphook.h"
+#include "logmsg/logmsg.h"
+#include "json-parser.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static gint number_of_messages = 200000;
+static gint corpus_size = 64;
+static gint depth = 3;
+static gint width = 5;
+
+static GOptionEntry bench_options[] =
+{
+  { "number", 'n', 0, G_OPTION_ARG_INT, &number_of_messages, "Number of messages parsed in each run (default: 200000)", "<number>" },
+  { "corpus", 'c', 0, G_OPTION_ARG_INT, &corpus_size, "Number of distinct documents (default: 64)", "<number>" },
+  { "depth",  'd', 0, G_OPTION_ARG_INT, &depth, "Nesting depth of the documents (default: 3)", "<number>" },
+  { "width",  'w', 0, G_OPTION_ARG_INT, &width, "Number of members in each object (default: 5)", "<number>" },
+  { NULL }
+};
+
+static guint64
+_get_monotonic_nsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (guint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* objects nest @level deep, every member cycles through the value types */
+static void
+_generate_object(GString *doc, gint seed, gint level)
+{
+  gint i;
+
+  g_string_append_c(doc, '{');
+  for (i = 0; i < width; i++)
+    {
+      if (i > 0)
+        g_string_append(doc, ", ");
+      g_string_append_printf(doc, "\"member%d\": ", i);
+
+      if (level > 1 && i == 0)
+        {
+          _generate_object(doc, seed + 1, level - 1);
+          continue;
+        }
+
+      switch ((seed + i) % 5)
+        {
+        case 0:
+          g_string_append_printf(doc, "\"value %d with an \\\"escape\\\"\"", seed);
+          break;
+        case 1:
+          g_string_append_printf(doc, "\"plain string value %d\"", seed);
+          break;
+        case 2:
+          g_string_append_printf(doc, "%d", seed * 7919);
+          break;
+        case 3:
+          g_string_append_printf(doc, "%d.%03d", seed, i);
+          break;
+        case 4:
+          g_string_append_printf(doc, "[%d, true, \"item\"]", seed);
+          break;
+        }
+    }
+  g_string_append_c(doc, '}');
+}
+
+static gchar **
+_generate_corpus(gboolean wrapped, gsize *total_len)
+{
+  gchar **corpus = g_new0(gchar *, corpus_size + 1);
+  GString *doc = g_string_sized_new(1024);
+  gint i;
+
+  *total_len = 0;
+  for (i = 0; i < corpus_size; i++)
+    {
+      g_string_truncate(doc, 0);
+      if (wrapped)
+        g_string_append(doc, "{\"doc\": ");
+      _generate_object(doc, i, depth);
+      if (wrapped)
+        g_string_append_c(doc, '}');
+      corpus[i] = g_strdup(doc->str);
+      *total_len += doc->len;
+    }
+  g_string_free(doc, TRUE);
+  return corpus;
+}
+
+static void
+_run(const gchar *name, LogParser *parser, gchar **corpus, gsize corpus_len)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg;
+  guint64 start, elapsed;
+  gint i, failed = 0;
+
+  start = _get_monotonic_nsec();
+  for (i = 0; i < number_of_messages; i++)
+    {
+      const gchar *input = corpus[i % corpus_size];
+
+      msg = log_msg_new_empty();
+      if (!log_parser_process(parser, &msg, &path_options, input, strlen(input)))
+        failed++;
+      log_msg_unref(msg);
+    }
+  elapsed = _get_monotonic_nsec() - start;
+
+  printf("%s: rate=%.0f msg/sec, throughput=%.1f MiB/sec, failed=%d\n",
+         name,
+         (gdouble) number_of_messages * 1e9 / elapsed,
+         (gdouble) corpus_len / corpus_size * number_of_messages * 1e9 / elapsed / (1024 * 1024),
+         failed);
+}
+
+int
+main(int argc, char *argv[])
+{
+  GOptionContext *ctx;
+  GError *error = NULL;
+  LogParser *parser;
+  gchar **corpus;
+  gsize corpus_len;
+
+  ctx = g_option_context_new("- json-parser() benchmark");
+  g_option_context_add_main_entries(ctx, bench_options, NULL);
+  if (!g_option_context_parse(ctx, &argc, &argv, &error))
+    {
+      fprintf(stderr, "Error parsing command line arguments: %s\n", error ? error->message : "Invalid arguments");
+      g_option_context_free(ctx);
+      return 1;
+    }
+  g_option_context_free(ctx);
+
+  if (number_of_messages <= 0 || corpus_size <= 0 || depth <= 0 || width <= 0)
+    {
+      fprintf(stderr, "The number of messages, the corpus size, depth and width must be positive\n");
+      return 1;
+    }
+
+  app_startup();
+
+  corpus = _generate_corpus(FALSE, &corpus_len);
+  printf("corpus: %d documents, %.0f bytes on average\n", corpus_size, (gdouble) corpus_len / corpus_size);
+  parser = json_parser_new(NULL);
+  json_parser_set_prefix(parser, ".json.");
+  _run("streaming", parser, corpus, corpus_len);
+  log_pipe_unref(&parser->super);
+  g_strfreev(corpus);
+
+  corpus = _generate_corpus(TRUE, &corpus_len);
+  parser = json_parser_new(NULL);
+  json_parser_set_prefix(parser, ".json.");
+  json_parser_set_extract_prefix(parser, "doc");
+  _run("extract-prefix", parser, corpus, corpus_len);
+  log_pipe_unref(&parser->super);
+  g_strfreev(corpus);
+
+  app_shutdown();
+  return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+/*
+ * nvregistry-bench: measures how name-value lookups by name scale with
+ * the number of threads.  Every thread does what a parser like
+ * json-parser() does for each message: it creates a message and sets a
+ * number of fields by name, each of which resolves the name to a handle
+ * in the global NVRegistry.
+ *
+ *   tests/bench/nvregistry-bench -t 16 -n 200000 -f 20
+ */
+
+#include "syslog-ng.h"
+#include "apphook.h"
+#include "logmsg/logmsg.h"
+
+#include <stdio.h>
+#include <time.h>
+
+static gint max_threads = 8;
+static gint number_of_messages = 200000;
+static gint num_fields = 20;
+
+static GOptionEntry bench_options[] =
+{
+  { "threads", 't', 0, G_OPTION_ARG_INT, &max_threads, "Maximum number of threads, measured in powers of two from 1 (default: 8)", "<number>" },
+  { "number",  'n', 0, G_OPTION_ARG_INT, &number_of_messages, "Number of messages processed by each thread (default: 200000)", "<number>" },
+  { "fields",  'f', 0, G_OPTION_ARG_INT, &num_fields, "Number of fields set on each message (default: 20)", "<number>" },
+  { NULL }
+};
+
+static gchar **field_names;
+static GMutex *start_lock;
+static GCond *start_cond;
+static gboolean started;
+
+static guint64
+_get_monotonic_nsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (guint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static gpointer
+_parse_messages(gpointer user_data)
+{
+  LogMessage *msg;
+  gint i, j;
+
+  g_mutex_lock(start_lock);
+  while (!started)
+    g_cond_wait(start_cond, start_lock);
+  g_mutex_unlock(start_lock);
+
+  for (i = 0; i < number_of_messages; i++)
+    {
+      msg = log_msg_new_empty();
+      for (j = 0; j < num_fields; j++)
+        log_msg_set_value_by_name(msg, field_names[j], "value", 5);
+      log_msg_unref(msg);
+    }
+  return NULL;
+}
+
+static void
+_run(gint num_threads)
+{
+  GThread **threads = g_new0(GThread *, num_threads);
+  guint64 start, elapsed;
+  gint i;
+
+  started = FALSE;
+  for (i = 0; i < num_threads; i++)
+    threads[i] = g_thread_create(_parse_messages, NULL, TRUE, NULL);
+
+  g_mutex_lock(start_lock);
+  started = TRUE;
+  start = _get_monotonic_nsec();
+  g_cond_broadcast(start_cond);
+  g_mutex_unlock(start_lock);
+
+  for (i = 0; i < num_threads; i++)
+    g_thread_join(threads[i]);
+  elapsed = _get_monotonic_nsec() - start;
+  g_free(threads);
+
+  printf("threads=%d, rate=%.0f msg/sec, lookups=%.0f /sec, per thread=%.0f msg/sec\n",
+         num_threads,
+         (gdouble) number_of_messages * num_threads * 1e9 / elapsed,
+         (gdouble) number_of_messages * num_threads * num_fields * 1e9 / elapsed,
+         (gdouble) number_of_messages * 1e9 / elapsed);
+}
+
+int
+main(int argc, char *argv[])
+{
+  GOptionContext *ctx;
+  GError *error = NULL;
+  gint i;
+
+  ctx = g_option_context_new("- NVRegistry lookup contention benchmark");
+  g_option_context_add_main_entries(ctx, bench_options, NULL);
+  if (!g_option_context_parse(ctx, &argc, &argv, &error))
+    {
+      fprintf(stderr, "Error parsing command line arguments: %s\n", error ? error->message : "Invalid arguments");
+      g_option_context_free(ctx);
+      return 1;
+    }
+  g_option_context_free(ctx);
+
+  if (max_threads <= 0 || number_of_messages <= 0 || num_fields <= 0)
+    {
+      fprintf(stderr, "The number of threads, messages and fields must be positive\n");
+      return 1;
+    }
+
+  app_startup();
+
+  start_lock = g_mutex_new();
+  start_cond = g_cond_new();
+
+  /* the names are registered up front, only the lookups are measured */
+  field_names = g_new0(gchar *, num_fields);
+  for (i = 0; i < num_fields; i++)
+    {
+      field_names[i] = g_strdup_printf(".json.field%d", i);
+      log_msg_get_value_handle(field_names[i]);
+    }
+
+  for (i = 1; i < max_threads; i *= 2)
+    _run(i);
+  _run(max_threads);
+
+  for (i = 0; i < num_fields; i++)
+    g_free(field_names[i]);
+  g_free(field_names);
+  g_cond_free(start_cond);
+  g_mutex_free(start_lock);
+  app_shutdown();
+  return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+/*
+ * serialize-bench: measures LogMessage serialization the way disk queues
+ * use it, reporting the CPU time per message for both directions and the
+ * serialized size.
+ *
+ *   tests/bench/serialize-bench -n 1000000 --values 20 --value-length 32
+ */
+
+#include "syslog-ng.h"
+#include "apphook.h"
+#include "logmsg/logmsg.h"
+#include "logmsg/logmsg-serialize.h"
+#include "serialize.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static gint number_of_messages = 1000000;
+static gint num_values = 10;
+static gint value_length = 16;
+
+static GOptionEntry bench_options[] =
+{
+  { "number",       'n', 0, G_OPTION_ARG_INT, &number_of_messages, "Number of messages to serialize and deserialize (default: 1000000)", "<number>" },
+  { "values",       'v', 0, G_OPTION_ARG_INT, &num_values, "Number of name-value pairs added to the message (default: 10)", "<number>" },
+  { "value-length", 'l', 0, G_OPTION_ARG_INT, &value_length, "Length of the added values (default: 16)", "<length>" },
+  { NULL }
+};
+
+static guint64
+_get_cpu_nsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (guint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static LogMessage *
+_construct_message(void)
+{
+  LogMessage *msg = log_msg_new_empty();
+  gchar *value = g_strnfill(value_length, 'x');
+  gint i;
+
+  log_msg_set_value(msg, LM_V_HOST, "bench-host.example.com", -1);
+  log_msg_set_value(msg, LM_V_PROGRAM, "serialize-bench", -1);
+  log_msg_set_value(msg, LM_V_PID, "12345", -1);
+  log_msg_set_value(msg, LM_V_MESSAGE, "An application event log entry, long enough to resemble a real one", -1);
+  log_msg_set_value_by_name(msg, ".SDATA.meta.sequenceId", "42", -1);
+  log_msg_set_tag_by_name(msg, "bench");
+
+  for (i = 0; i < num_values; i++)
+    {
+      gchar name[32];
+
+      g_snprintf(name, sizeof(name), "bench.field%d", i);
+      log_msg_set_value_by_name(msg, name, value, -1);
+    }
+  g_free(value);
+  return msg;
+}
+
+static guint64
+_bench_serialize(LogMessage *msg, GString *serialized)
+{
+  guint64 start = _get_cpu_nsec();
+  SerializeArchive *sa;
+  gint i;
+
+  for (i = 0; i < number_of_messages; i++)
+    {
+      g_string_truncate(serialized, 0);
+      sa = serialize_string_archive_new(serialized);
+      log_msg_serialize(msg, sa);
+      serialize_archive_free(sa);
+    }
+  return _get_cpu_nsec() - start;
+}
+
+static guint64
+_bench_deserialize(GString *serialized)
+{
+  guint64 start = _get_cpu_nsec();
+  SerializeArchive *sa;
+  LogMessage *msg;
+  gint i;
+
+  for (i = 0; i < number_of_messages; i++)
+    {
+      msg = log_msg_new_empty();
+      sa = serialize_string_archive_new(serialized);
+      if (!log_msg_deserialize(msg, sa))
+        {
+          fprintf(stderr, "Error deserializing message\n");
+          exit(1);
+        }
+      serialize_archive_free(sa);
+      log_msg_unref(msg);
+    }
+  return _get_cpu_nsec() - start;
+}
+
+int
+main(int argc, char *argv[])
+{
+  GOptionContext *ctx;
+  GError *error = NULL;
+  GString *serialized;
+  LogMessage *msg;
+  guint64 serialize_nsec, deserialize_nsec;
+
+  ctx = g_option_context_new("- LogMessage serialization benchmark");
+  g_option_context_add_main_entries(ctx, bench_options, NULL);
+  if (!g_option_context_parse(ctx, &argc, &argv, &error))
+    {
+      fprintf(stderr, "Error parsing command line arguments: %s\n", error ? error->message : "Invalid arguments");
+      g_option_context_free(ctx);
+      return 1;
+    }
+  g_option_context_free(ctx);
+
+  if (number_of_messages <= 0 || num_values < 0 || value_length < 0)
+    {
+      fprintf(stderr, "The number of messages must be positive, the number and length of values can't be negative\n");
+      return 1;
+    }
+
+  app_startup();
+
+  msg = _construct_message();
+  serialized = g_string_sized_new(1024);
+
+  serialize_nsec = _bench_serialize(msg, serialized);
+  deserialize_nsec = _bench_deserialize(serialized);
+
+  printf("messages=%d, size=%" G_GSIZE_FORMAT " bytes/msg, serialize=%.1f nsec/msg, deserialize=%.1f nsec/msg\n",
+         number_of_messages, serialized->len,
+         (gdouble) serialize_nsec / number_of_messages,
+         (gdouble) deserialize_nsec / number_of_messages);
+
+  g_string_free(serialized, TRUE);
+  log_msg_unref(msg);
+  app_shutdown();
+  return 0;
+}
@@ -0,0 +1,701 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+/*
+ * syslog-ng-bench: measures the message processing pipeline of a
+ * configuration without any I/O.
+ *
+ * The configuration is loaded as usual, then the drivers of the named
+ * source are replaced by an in-process LogSource, the drivers of every
+ * other source are removed and every destination is replaced by a sink
+ * that acknowledges and counts the messages it receives.  Messages,
+ * either synthetic or read from a corpus file, are parsed and posted to
+ * the source via log_source_post(), just like LogReader does, and the
+ * whole pipeline runs synchronously in the calling thread.
+ *
+ * It is built by "make bench", e.g. from the build directory:
+ *
+ *   tests/bench/syslog-ng-bench -f bench.conf -s s_network -n 1000000 -S \
+ *     --module-path=modules/syslogformat/.libs:modules/basicfuncs/.libs
+ */
+
+#include "syslog-ng.h"
+#include "cfg.h"
+#include "cfg-tree.h"
+#include "apphook.h"
+#include "mainloop.h"
+#include "messages.h"
+#include "logsource.h"
+#include "logmsg/logmsg.h"
+#include "msg-format.h"
+#include "plugin.h"
+#include "reloc.h"
+#include "resolved-configurable-paths.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static gchar *source_name;
+static gchar *corpus_file;
+static gint number_of_messages = 1000000;
+static gint warmup_messages = 10000;
+static gboolean profile_stages = FALSE;
+
+static GOptionEntry bench_options[] =
+{
+  { "cfgfile",     'f', 0, G_OPTION_ARG_STRING, &resolvedConfigurablePaths.cfgfilename, "Configuration file to benchmark", "<config>" },
+  { "module-path",   0, 0, G_OPTION_ARG_STRING, &resolvedConfigurablePaths.initial_module_path, "Set the list of colon separated directories to search for modules, default=" SYSLOG_NG_MODULE_PATH, "<path>" },
+  { "source",      's', 0, G_OPTION_ARG_STRING, &source_name, "Name of the source to inject messages into", "<name>" },
+  { "input",       'i', 0, G_OPTION_ARG_STRING, &corpus_file, "Read messages from a file, one per line, instead of generating them", "<filename>" },
+  { "number",      'n', 0, G_OPTION_ARG_INT, &number_of_messages, "Number of messages to measure (default: 1000000)", "<number>" },
+  { "warmup",      'w', 0, G_OPTION_ARG_INT, &warmup_messages, "Number of messages to process before measuring (default: 10000)", "<number>" },
+  { "stages",      'S', 0, G_OPTION_ARG_NONE, &profile_stages, "Measure the CPU time spent in each stage of the pipeline (slows down processing)", NULL },
+  { NULL }
+};
+
+/************************************************************************************
+ * Allocation counter
+ ************************************************************************************/
+
+#ifdef __GLIBC__
+
+#define BENCH_COUNT_ALLOCATIONS 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static gboolean count_allocations;
+static gint allocations;
+
+/* overrides the libc allocator for the whole process, including libsyslog-ng and glib */
+void *
+malloc(size_t size)
+{
+  if (count_allocations)
+    g_atomic_int_inc(&allocations);
+  return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+  if (count_allocations)
+    g_atomic_int_inc(&allocations);
+  return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+  if (count_allocations)
+    g_atomic_int_inc(&allocations);
+  return __libc_realloc(ptr, size);
+}
+
+#endif
+
+/************************************************************************************
+ * Stage profiler
+ ************************************************************************************/
+
+typedef struct _BenchStage
+{
+  gchar *name;
+  guint64 calls;
+  guint64 cpu_nsec;
+} BenchStage;
+
+static GHashTable *stages_by_pipe;
+static GHashTable *stages_by_name;
+static BenchStage *current_stage;
+static guint64 current_stage_start;
+
+static guint64
+_get_thread_cpu_nsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (guint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static gchar *
+_format_stage_name(LogPipe *pipe)
+{
+  LogExprNode *node;
+  gchar location[128];
+
+  for (node = pipe->expr_node; node; node = node->parent)
+    {
+      if (node->name)
+        return g_strdup_printf("%s(%s)", log_expr_node_get_content_name(node->content), node->name);
+    }
+
+  if (!pipe->expr_node)
+    return g_strdup("internal");
+
+  return g_strdup_printf("%s at %s", log_expr_node_get_content_name(pipe->expr_node->content),
+                         log_expr_node_format_location(pipe->expr_node, location, sizeof(location)));
+}
+
+static BenchStage *
+_lookup_stage(LogPipe *pipe)
+{
+  BenchStage *stage;
+  gchar *name;
+
+  stage = g_hash_table_lookup(stages_by_pipe, pipe);
+  if (stage)
+    return stage;
+
+  name = _format_stage_name(pipe);
+  stage = g_hash_table_lookup(stages_by_name, name);
+  if (!stage)
+    {
+      stage = g_new0(BenchStage, 1);
+      stage->name = name;
+      g_hash_table_insert(stages_by_name, stage->name, stage);
+    }
+  else
+    {
+      g_free(name);
+    }
+  g_hash_table_insert(stages_by_pipe, pipe, stage);
+  return stage;
+}
+
+static void
+_stage_switch(BenchStage *stage)
+{
+  guint64 now = _get_thread_cpu_nsec();
+
+  if (current_stage)
+    current_stage->cpu_nsec += now - current_stage_start;
+  current_stage = stage;
+  current_stage_start = now;
+  if (stage)
+    stage->calls++;
+}
+
+/*
+ * Pipes forward messages by calling the next one, so the time between two
+ * steps is what the first pipe spent on the message before passing it on.
+ */
+static gboolean
+_profile_pipe_step(LogPipe *pipe, LogMessage *msg, const LogPathOptions *path_options)
+{
+  _stage_switch(_lookup_stage(pipe));
+  return TRUE;
+}
+
+static void
+_free_stage(BenchStage *stage)
+{
+  g_free(stage->name);
+  g_free(stage);
+}
+
+static void
+bench_stages_init(void)
+{
+  stages_by_pipe = g_hash_table_new(g_direct_hash, g_direct_equal);
+  stages_by_name = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify) _free_stage);
+}
+
+static void
+bench_stages_reset(void)
+{
+  g_hash_table_remove_all(stages_by_pipe);
+  g_hash_table_remove_all(stages_by_name);
+  current_stage = NULL;
+}
+
+static void
+bench_stages_deinit(void)
+{
+  g_hash_table_destroy(stages_by_pipe);
+  g_hash_table_destroy(stages_by_name);
+}
+
+static gint
+_compare_stages(gconstpointer a, gconstpointer b)
+{
+  const BenchStage *stage_a = *(const BenchStage **) a;
+  const BenchStage *stage_b = *(const BenchStage **) b;
+
+  if (stage_a->cpu_nsec == stage_b->cpu_nsec)
+    return 0;
+  return stage_a->cpu_nsec > stage_b->cpu_nsec ? -1 : 1;
+}
+
+static void
+bench_stages_report(guint64 messages)
+{
+  GPtrArray *stages = g_ptr_array_new();
+  GHashTableIter iter;
+  gpointer value;
+  guint64 total = 0;
+  gint i;
+
+  g_hash_table_iter_init(&iter, stages_by_name);
+  while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+      g_ptr_array_add(stages, value);
+      total += ((BenchStage *) value)->cpu_nsec;
+    }
+  g_ptr_array_sort(stages, _compare_stages);
+
+  printf("\n%-48s %12s %12s %8s\n", "Stage", "Calls", "nsec/msg", "Share");
+  for (i = 0; i < stages->len; i++)
+    {
+      BenchStage *stage = g_ptr_array_index(stages, i);
+
+      printf("%-48s %12" G_GUINT64_FORMAT " %12.1f %7.1f%%\n",
+             stage->name, stage->calls,
+             (gdouble) stage->cpu_nsec / messages,
+             total ? (gdouble) stage->cpu_nsec * 100 / total : 0.0);
+    }
+  g_ptr_array_free(stages, TRUE);
+}
+
+/************************************************************************************
+ * Source and sink
+ ************************************************************************************/
+
+typedef struct _BenchSource
+{
+  LogSource super;
+  LogSourceOptions options;
+  gchar *name;
+} BenchSource;
+
+static gboolean
+bench_source_init(LogPipe *s)
+{
+  BenchSource *self = (BenchSource *) s;
+
+  log_source_options_init(&self->options, log_pipe_get_config(s), self->name);
+  log_source_set_options(&self->super, &self->options, 0, SCS_INTERNAL, "bench", self->name, FALSE, FALSE, s->expr_node);
+  return log_source_init(s);
+}
+
+static void
+bench_source_free(LogPipe *s)
+{
+  BenchSource *self = (BenchSource *) s;
+
+  log_source_options_destroy(&self->options);
+  g_free(self->name);
+  log_source_free(s);
+}
+
+static BenchSource *
+bench_source_new(GlobalConfig *cfg, const gchar *name)
+{
+  BenchSource *self = g_new0(BenchSource, 1);
+
+  log_source_init_instance(&self->super, cfg);
+  log_source_options_defaults(&self->options);
+  /* messages are acknowledged before log_source_post() returns, a window
+   * larger than 1 is only needed if the configuration holds on to them */
+  self->options.init_window_size = 100000;
+  self->name = g_strdup(name);
+  self->super.super.flags |= PIF_SOURCE;
+  self->super.super.init = bench_source_init;
+  self->super.super.free_fn = bench_source_free;
+  return self;
+}
+
+typedef struct _BenchSink
+{
+  LogPipe super;
+  gchar *name;
+  guint64 received;
+} BenchSink;
+
+static GList *sinks;
+
+static void
+bench_sink_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options, gpointer user_data)
+{
+  BenchSink *self = (BenchSink *) s;
+
+  self->received++;
+  log_msg_ack(msg, path_options, AT_PROCESSED);
+  log_msg_unref(msg);
+}
+
+static void
+bench_sink_free(LogPipe *s)
+{
+  BenchSink *self = (BenchSink *) s;
+
+  sinks = g_list_remove(sinks, self);
+  g_free(self->name);
+  log_pipe_free_method(s);
+}
+
+static BenchSink *
+bench_sink_new(GlobalConfig *cfg, const gchar *name)
+{
+  BenchSink *self = g_new0(BenchSink, 1);
+
+  log_pipe_init_instance(&self->super, cfg);
+  self->name = g_strdup(name ? : "#anon-destination");
+  self->super.queue = bench_sink_queue;
+  self->super.free_fn = bench_sink_free;
+  sinks = g_list_append(sinks, self);
+  return self;
+}
+
+/************************************************************************************
+ * Configuration rewriting
+ ************************************************************************************/
+
+static void
+_replace_children(LogExprNode *node, LogPipe *pipe)
+{
+  LogExprNode *child, *next;
+
+  for (child = node->children; child; child = next)
+    {
+      next = child->next;
+      log_expr_node_free(child);
+    }
+  node->children = NULL;
+
+  if (pipe)
+    {
+      child = log_expr_node_new_pipe(pipe, NULL);
+      child->parent = node;
+      node->children = child;
+    }
+}
+
+static void
+_replace_endpoints(LogExprNode *node, GlobalConfig *cfg, BenchSource **source)
+{
+  LogExprNode *child;
+
+  if (node->layout == ENL_REFERENCE)
+    return;
+
+  if (node->content == ENC_SOURCE)
+    {
+      if (node->name && strcmp(node->name, source_name) == 0)
+        {
+          *source = bench_source_new(cfg, node->name);
+          _replace_children(node, log_pipe_ref(&(*source)->super.super));
+        }
+      else
+        {
+          _replace_children(node, NULL);
+        }
+      return;
+    }
+
+  if (node->content == ENC_DESTINATION)
+    {
+      _replace_children(node, &bench_sink_new(cfg, node->name)->super);
+      return;
+    }
+
+  for (child = node->children; child; child = child->next)
+    _replace_endpoints(child, cfg, source);
+}
+
+static BenchSource *
+bench_rewrite_config(GlobalConfig *cfg)
+{
+  BenchSource *source = NULL;
+  GHashTableIter iter;
+  gpointer value;
+  gint i;
+
+  g_hash_table_iter_init(&iter, cfg->tree.objects);
+  while (g_hash_table_iter_next(&iter, NULL, &value))
+    _replace_endpoints((LogExprNode *) value, cfg, &source);
+
+  for (i = 0; i < cfg->tree.rules->len; i++)
+    _replace_endpoints((LogExprNode *) g_ptr_array_index(cfg->tree.rules, i), cfg, &source);
+
+  return source;
+}
+
+/************************************************************************************
+ * Message corpus
+ ************************************************************************************/
+
+#define BENCH_SYNTHETIC_MESSAGES 1024
+
+static GPtrArray *
+_load_corpus(const gchar *filename)
+{
+  GPtrArray *lines = g_ptr_array_new_with_free_func(g_free);
+  GError *error = NULL;
+  gchar *contents;
+  gchar **split;
+  gint i;
+
+  if (!g_file_get_contents(filename, &contents, NULL, &error))
+    {
+      fprintf(stderr, "Error reading input file: %s\n", error->message);
+      g_error_free(error);
+      g_ptr_array_free(lines, TRUE);
+      return NULL;
+    }
+
+  split = g_strsplit(contents, "\n", -1);
+  for (i = 0; split[i]; i++)
+    {
+      if (split[i][0])
+        g_ptr_array_add(lines, g_strdup(split[i]));
+    }
+  g_strfreev(split);
+  g_free(contents);
+
+  if (lines->len == 0)
+    {
+      fprintf(stderr, "Input file contains no messages: %s\n", filename);
+      g_ptr_array_free(lines, TRUE);
+      return NULL;
+    }
+  return lines;
+}
+
+static GPtrArray *
+_generate_corpus(void)
+{
+  GPtrArray *lines = g_ptr_array_new_with_free_func(g_free);
+  gint i;
+
+  for (i = 0; i < BENCH_SYNTHETIC_MESSAGES; i++)
+    g_ptr_array_add(lines, g_strdup_printf("<%d>Mar  1 12:00:%02d bench-host-%d bench[%d]: seq: %010d, thread: 0000, runid: 1456830000, "
+                                           "stamp: 2016-03-01T12:00:%02d PADDPADDPADDPADDPADDPADDPADDPADDPADDPADDPADDPADDPADDPADD",
+                                           8 + i % 184, i % 60, i % 16, 1000 + i % 32, i, i % 60));
+  return lines;
+}
+
+/************************************************************************************
+ * Main
+ ************************************************************************************/
+
+static guint64
+_get_process_cpu_usec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (guint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static gboolean
+_post_messages(BenchSource *source, GPtrArray *corpus, MsgFormatOptions *parse_options, BenchStage *parse_stage, gint count)
+{
+  gint i;
+
+  for (i = 0; i < count; i++)
+    {
+      const gchar *line = g_ptr_array_index(corpus, i % corpus->len);
+      LogMessage *msg;
+
+      if (!log_source_free_to_send(&source->super))
+        {
+          fprintf(stderr, "The flow-control window of the source is exhausted, something in the configuration holds on to messages\n");
+          return FALSE;
+        }
+
+      if (parse_stage)
+        _stage_switch(parse_stage);
+
+      msg = log_msg_new(line, strlen(line), NULL, parse_options);
+      log_msg_refcache_start_producer(msg);
+      log_source_post(&source->super, msg);
+      log_msg_refcache_stop();
+
+      if (parse_stage)
+        _stage_switch(NULL);
+    }
+  return TRUE;
+}
+
+static void
+_report(gint count, guint64 wall_usec, guint64 cpu_usec)
+{
+  GList *l;
+
+  printf("messages = %d, time = %.3f sec, cpu = %.3f sec\n",
+         count, (gdouble) wall_usec / G_USEC_PER_SEC, (gdouble) cpu_usec / G_USEC_PER_SEC);
+  printf("rate = %.2f msg/sec, cpu = %.1f nsec/msg\n",
+         wall_usec ? (gdouble) count * G_USEC_PER_SEC / wall_usec : 0.0,
+         (gdouble) cpu_usec * 1000 / count);
+#ifdef BENCH_COUNT_ALLOCATIONS
+  printf("allocations = %.2f per msg\n", (gdouble) allocations / count);
+#endif
+
+  for (l = sinks; l; l = l->next)
+    {
+      BenchSink *sink = (BenchSink *) l->data;
+
+      printf("destination %s received = %" G_GUINT64_FORMAT "\n", sink->name, sink->received);
+    }
+
+  if (profile_stages)
+    bench_stages_report(count);
+}
+
+static gint
+bench_run(GlobalConfig *cfg, BenchSource *source, GPtrArray *corpus)
+{
+  MsgFormatOptions parse_options;
+  BenchStage *parse_stage = NULL;
+  guint64 wall_start, cpu_start;
+  GList *l;
+  gint rc = 0;
+
+  msg_format_options_defaults(&parse_options);
+  msg_format_options_init(&parse_options, cfg);
+  if (!parse_options.format_handler)
+    {
+      fprintf(stderr, "The syslog message format is not available, is the syslogformat module loaded?\n");
+      rc = 1;
+      goto exit;
+    }
+
+  if (profile_stages)
+    {
+      bench_stages_init();
+      pipe_single_step_hook = _profile_pipe_step;
+    }
+
+  if (!_post_messages(source, corpus, &parse_options, NULL, warmup_messages))
+    {
+      rc = 1;
+      goto exit;
+    }
+
+  for (l = sinks; l; l = l->next)
+    ((BenchSink *) l->data)->received = 0;
+  if (profile_stages)
+    {
+      bench_stages_reset();
+      parse_stage = g_new0(BenchStage, 1);
+      parse_stage->name = g_strdup("message parsing");
+      g_hash_table_insert(stages_by_name, parse_stage->name, parse_stage);
+    }
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+  count_allocations = TRUE;
+#endif
+  wall_start = g_get_monotonic_time();
+  cpu_start = _get_process_cpu_usec();
+
+  if (!_post_messages(source, corpus, &parse_options, parse_stage, number_of_messages))
+    rc = 1;
+
+  _report(number_of_messages, g_get_monotonic_time() - wall_start, _get_process_cpu_usec() - cpu_start);
+#ifdef BENCH_COUNT_ALLOCATIONS
+  count_allocations = FALSE;
+#endif
+
+exit:
+  if (profile_stages)
+    {
+      pipe_single_step_hook = NULL;
+      bench_stages_deinit();
+    }
+  msg_format_options_destroy(&parse_options);
+  return rc;
+}
+
+int
+main(int argc, char *argv[])
+{
+  GOptionContext *ctx;
+  GError *error = NULL;
+  GlobalConfig *cfg;
+  BenchSource *source;
+  GPtrArray *corpus;
+  gchar *persist_file;
+  gint rc = 1;
+
+  resolved_configurable_paths_init(&resolvedConfigurablePaths);
+
+  ctx = g_option_context_new("- in-process benchmark of a syslog-ng configuration");
+  g_option_context_add_main_entries(ctx, bench_options, NULL);
+  if (!g_option_context_parse(ctx, &argc, &argv, &error))
+    {
+      fprintf(stderr, "Error parsing command line arguments: %s\n", error ? error->message : "Invalid arguments");
+      g_option_context_free(ctx);
+      return 1;
+    }
+  g_option_context_free(ctx);
+
+  if (!source_name)
+    {
+      fprintf(stderr, "The name of the source to inject messages into must be specified with --source\n");
+      return 1;
+    }
+  if (number_of_messages <= 0 || warmup_messages < 0)
+    {
+      fprintf(stderr, "The number of messages must be positive\n");
+      return 1;
+    }
+
+  corpus = corpus_file ? _load_corpus(corpus_file) : _generate_corpus();
+  if (!corpus)
+    return 1;
+
+  log_stderr = TRUE;
+  app_startup();
+
+  cfg = cfg_new(0);
+  if (!cfg_read_config(cfg, resolvedConfigurablePaths.cfgfilename, FALSE, NULL))
+    goto exit;
+
+  source = bench_rewrite_config(cfg);
+  if (!source)
+    {
+      fprintf(stderr, "Source not found in the configuration: %s\n", source_name);
+      goto exit;
+    }
+
+  /* the real persist file must not be touched */
+  persist_file = g_strdup_printf("%s/syslog-ng-bench.%d.persist", g_get_tmp_dir(), (gint) getpid());
+  if (main_loop_initialize_state(cfg, persist_file))
+    {
+      rc = bench_run(cfg, source, corpus);
+      cfg_deinit(cfg);
+    }
+  unlink(persist_file);
+  g_free(persist_file);
+
+exit:
+  cfg_free(cfg);
+  g_ptr_array_free(corpus, TRUE);
+  app_shutdown();
+  return rc;
+}
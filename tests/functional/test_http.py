@@ -0,0 +1,156 @@
+#############################################################################
+# Copyright (c) 2016 Balabit
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License version 2 as published
+# by the Free Software Foundation, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# As an additional exemption you are allowed to compile & link against the
+# OpenSSL libraries as published by the OpenSSL project. See the file
+# COPYING for details.
+#
+#############################################################################
+
+from globals import *
+from log import *
+from messagegen import *
+from messagecheck import *
+from control import stop_syslogng
+from BaseHTTPServer import HTTPServer, BaseHTTPRequestHandler
+from StringIO import StringIO
+import threading
+
+http_port_number = port_number + 4
+reject_port_number = port_number + 6
+
+config = """@version: 3.8
+
+options { ts_format(iso); chain_hostnames(no); keep_hostname(yes); threaded(yes); };
+
+source s_int { internal(); };
+source s_tcp { tcp(port(%(port_number)d)); };
+source s_tcp_reject { tcp(port(%(reject_port_number)d)); };
+
+destination d_http {
+    http(url("http://127.0.0.1:%(http_port_number)d/")
+         body("${ISODATE} ${HOST} ${MSGHDR}${MSG}")
+         batch-lines(25)
+         batch-timeout(100)
+         time-reopen(1));
+};
+
+# a suspended destination would not deliver anything within the test
+destination d_http_reject {
+    http(url("http://127.0.0.1:%(http_port_number)d/reject")
+         body("${ISODATE} ${HOST} ${MSGHDR}${MSG}")
+         batch-lines(25)
+         batch-timeout(100)
+         time-reopen(3600));
+};
+
+log { source(s_tcp); destination(d_http); };
+log { source(s_tcp_reject); destination(d_http_reject); };
+
+""" % locals()
+
+
+class StubHTTPServer(HTTPServer):
+    def reset(self, fail_requests=0, fail_status=503):
+        self.lock = threading.Lock()
+        self.lines = []
+        self.rejected_lines = []
+        self.syslog_hosts = []
+        self.requests = 0
+        self.fail_requests = fail_requests
+        self.fail_status = fail_status
+
+
+class StubHTTPRequestHandler(BaseHTTPRequestHandler):
+    def do_POST(self):
+        body = self.rfile.read(int(self.headers.getheader('Content-Length', 0)))
+
+        with self.server.lock:
+            self.server.requests += 1
+            if self.server.fail_requests > 0:
+                self.server.fail_requests -= 1
+                if self.server.fail_status < 500:
+                    self.server.rejected_lines.extend(body.split('\n'))
+                self.send_response(self.server.fail_status)
+            else:
+                self.server.lines.extend(body.split('\n'))
+                self.server.syslog_hosts.append(self.headers.getheader('X-Syslog-Host'))
+                self.send_response(200)
+        self.send_header('Content-Length', '0')
+        self.end_headers()
+
+    def log_message(self, format, *args):
+        pass
+
+stub_server = None
+
+def check_env():
+    global stub_server
+
+    if not has_module('curl'):
+        print 'HTTP module is not available, skipping HTTP test'
+        return False
+
+    stub_server = StubHTTPServer(('127.0.0.1', http_port_number), StubHTTPRequestHandler)
+    stub_server.reset()
+    t = threading.Thread(target=stub_server.serve_forever)
+    t.daemon = True
+    t.start()
+    return True
+
+def send_and_check(fail_requests, fail_status=503, port=port_number):
+    stub_server.reset(fail_requests, fail_status)
+
+    s = SocketSender(AF_INET, ('localhost', port), dgram=0, repeat=200)
+    expected = s.sendMessages('http', pri=7)
+
+    stopped = stop_syslogng()
+    if not stopped:
+        return False
+
+    # rejected batches are dropped, not retried, so every message has to
+    # show up exactly once in one of the two lists
+    with stub_server.lock:
+        received = StringIO('\n'.join(stub_server.rejected_lines + stub_server.lines) + '\n')
+        requests = stub_server.requests
+        syslog_hosts = stub_server.syslog_hosts
+
+    if not check_reader_expected(received, expected, 1, syslog_prefix, 0):
+        return False
+
+    if requests - fail_requests >= len(stub_server.lines):
+        print_user('messages were not batched, requests=%d, messages=%d' % (requests, len(stub_server.lines)))
+        return False
+
+    if syslog_hosts != ['bzorp'] * len(syslog_hosts):
+        print_user('batched requests lack the X-Syslog-Host header: %s' % str(syslog_hosts))
+        return False
+    return True
+
+def test_http_batching():
+    return send_and_check(0)
+
+def test_http_retry_failed_batch():
+    return send_and_check(2)
+
+def test_http_rejected_batch_does_not_suspend():
+    if not send_and_check(1, fail_status=400, port=reject_port_number):
+        return False
+
+    if len(stub_server.rejected_lines) == 0:
+        print_user('no batch was rejected')
+        return False
+    return True
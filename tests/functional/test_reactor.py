@@ -0,0 +1,92 @@
+#############################################################################
+# Copyright (c) 2007-2015 Balabit
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License version 2 as published
+# by the Free Software Foundation, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# As an additional exemption you are allowed to compile & link against the
+# OpenSSL libraries as published by the OpenSSL project. See the file
+# COPYING for details.
+#
+#############################################################################
+
+import signal
+
+from globals import *
+from log import *
+from messagegen import *
+from messagecheck import *
+import messagegen
+import control
+
+# readers are spread over the reactors round-robin, so with more
+# connections than reactors every reactor serves several of them
+syslogng_args = ('--reactor-threads', '2')
+
+config = """@version: 3.8
+
+options { ts_format(iso); chain_hostnames(no); keep_hostname(yes); threaded(yes); };
+
+source s_int { internal(); };
+# a small window makes the readers suspend and resume on flow-control
+source s_stream { unix-stream("log-stream" flags(expect-hostname) log_iw_size(100)); tcp(port(%(port_number)d) log_iw_size(100) log_fetch_limit(4)); };
+
+filter f_reactor { message("reactor"); };
+
+destination d_reactor { file("test-reactor.log"); };
+
+log { source(s_stream); filter(f_reactor); destination(d_reactor); flags(flow-control); };
+""" % locals()
+
+def send_interleaved(senders, msg, repeat, on_half=None):
+    print_user("generating %d messages over %d interleaved connections" % (repeat, len(senders)))
+
+    messagegen.need_to_flush = True
+    sessions = []
+    for s in senders:
+        s.initSender()
+        sessions.append(messagegen.session_counter)
+        messagegen.session_counter = messagegen.session_counter + 1
+
+    for counter in range(1, repeat):
+        if on_half and counter == repeat / 2:
+            on_half()
+        for (s, session) in zip(senders, sessions):
+            s.sendMessage('<7>%s %s %03d/%05d %s %s' % (syslog_prefix, msg, session, counter, str(s), padding))
+
+    return [(msg, session, repeat) for session in sessions]
+
+def reactor_senders():
+    return (
+        SocketSender(AF_INET, ('localhost', port_number), dgram=0),
+        SocketSender(AF_INET, ('localhost', port_number), dgram=0),
+        SocketSender(AF_INET, ('localhost', port_number), dgram=0),
+        SocketSender(AF_INET, ('localhost', port_number), dgram=0, send_by_bytes=1),
+        SocketSender(AF_UNIX, 'log-stream', dgram=0),
+        SocketSender(AF_UNIX, 'log-stream', dgram=0),
+    )
+
+def test_reactor_order():
+    expected = send_interleaved(reactor_senders(), 'reactor', 1000)
+    return check_file_expected("test-reactor", expected, settle_time=6)
+
+def test_reactor_reload():
+
+    def reload():
+        # the reactors park their jobs while the configuration is
+        # reloaded, and rearm them once the readers are resumed
+        print_user("Sending syslog-ng the HUP signal in the middle of the traffic")
+        os.kill(control.syslogng_pid, signal.SIGHUP)
+
+    expected = send_interleaved(reactor_senders(), 'reactor', 1000, on_half=reload)
+    return check_file_expected("test-reactor", expected, settle_time=6)
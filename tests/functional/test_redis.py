@@ -0,0 +1,170 @@
+#############################################################################
+# Copyright (c) 2016 Balabit
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License version 2 as published
+# by the Free Software Foundation, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# As an additional exemption you are allowed to compile & link against the
+# OpenSSL libraries as published by the OpenSSL project. See the file
+# COPYING for details.
+#
+#############################################################################
+
+from globals import *
+from log import *
+from messagegen import *
+from messagecheck import *
+from control import stop_syslogng
+from StringIO import StringIO
+import socket
+import threading
+
+redis_port_number = port_number + 5
+
+config = """@version: 3.8
+
+options { ts_format(iso); chain_hostnames(no); keep_hostname(yes); threaded(yes); };
+
+source s_int { internal(); };
+source s_tcp { tcp(port(%(port_number)d)); };
+
+destination d_redis {
+    redis(host("127.0.0.1")
+          port(%(redis_port_number)d)
+          command("RPUSH", "syslog", "${ISODATE} ${HOST} ${MSGHDR}${MSG}")
+          batch-lines(25)
+          batch-timeout(100)
+          time-reopen(1));
+};
+
+log { source(s_tcp); destination(d_redis); };
+
+""" % locals()
+
+
+def parse_command(buf):
+    """Parses a RESP array of bulk strings, returns (args, rest) or None if incomplete."""
+    if not buf.startswith('*') or '\r\n' not in buf:
+        return None
+    header, rest = buf.split('\r\n', 1)
+    args = []
+    for i in range(int(header[1:])):
+        if '\r\n' not in rest:
+            return None
+        length, rest = rest.split('\r\n', 1)
+        length = int(length[1:])
+        if len(rest) < length + 2:
+            return None
+        args.append(rest[:length])
+        rest = rest[length + 2:]
+    return (args, rest)
+
+
+class StubRedisServer(object):
+    """Understands PING and RPUSH, optionally drops the connection once
+    after storing a given number of values, without replying to the rest."""
+
+    def __init__(self, port):
+        self.listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.listener.bind(('127.0.0.1', port))
+        self.listener.listen(5)
+        self.reset()
+
+    def reset(self, drop_after=0):
+        self.lock = threading.Lock()
+        self.lines = []
+        self.max_commands_per_read = 0
+        self.drop_after = drop_after
+
+    def serve_forever(self):
+        while True:
+            conn, addr = self.listener.accept()
+            t = threading.Thread(target=self.handle, args=(conn,))
+            t.daemon = True
+            t.start()
+
+    def handle(self, conn):
+        buf = ''
+        while True:
+            data = conn.recv(65536)
+            if not data:
+                break
+            buf += data
+            replies = []
+            commands = 0
+            while True:
+                parsed = parse_command(buf)
+                if not parsed:
+                    break
+                args, buf = parsed
+                commands += 1
+                with self.lock:
+                    if args[0].upper() == 'PING':
+                        replies.append('+PONG\r\n')
+                        continue
+                    if self.drop_after > 0 and len(self.lines) >= self.drop_after:
+                        self.drop_after = 0
+                        conn.sendall(''.join(replies))
+                        conn.close()
+                        return
+                    self.lines.append(args[2])
+                    replies.append(':%d\r\n' % len(self.lines))
+            with self.lock:
+                self.max_commands_per_read = max(self.max_commands_per_read, commands)
+            conn.sendall(''.join(replies))
+        conn.close()
+
+stub_server = None
+
+def check_env():
+    global stub_server
+
+    if not has_module('redis'):
+        print 'Redis module is not available, skipping Redis test'
+        return False
+
+    stub_server = StubRedisServer(redis_port_number)
+    t = threading.Thread(target=stub_server.serve_forever)
+    t.daemon = True
+    t.start()
+    return True
+
+def send_and_check(drop_after):
+    stub_server.reset(drop_after)
+
+    s = SocketSender(AF_INET, ('localhost', port_number), dgram=0, repeat=200)
+    expected = s.sendMessages('redis', pri=7)
+
+    stopped = stop_syslogng()
+    if not stopped:
+        return False
+
+    with stub_server.lock:
+        received = StringIO('\n'.join(stub_server.lines) + '\n')
+        max_commands_per_read = stub_server.max_commands_per_read
+
+    # a lost or duplicated message shows up as a gap or reordering in the session
+    if not check_reader_expected(received, expected, 1, syslog_prefix, 0):
+        return False
+
+    if max_commands_per_read <= 1:
+        print_user('commands were not pipelined')
+        return False
+    return True
+
+def test_redis_pipelining():
+    return send_and_check(0)
+
+def test_redis_retry_unacknowledged_commands():
+    return send_and_check(110)
@@ -44,7 +44,18 @@ destination d_sql {
         flush-lines(25) flush_timeout(100));
 };
 
-log { source(s_tcp); destination(d_sql); };
+destination d_sql_multi_row {
+    sql(type(sqlite3) database("%(current_dir)s/test-sql-multi-row.db") host(dummy) port(1234) username(dummy) password(dummy)
+        table("logs")
+        null("@NULL@")
+        columns("date datetime", "host", "program", "pid", "msg")
+        values("$DATE", "$HOST", "$PROGRAM", "${PID:-@NULL@}", "$MSG")
+        indexes("date", "host", "program")
+        flags(explicit-commits, multi-row-insert)
+        flush-lines(25) flush_timeout(100));
+};
+
+log { source(s_tcp); destination(d_sql); destination(d_sql_multi_row); };
 
 """ % locals()
 
@@ -96,4 +107,46 @@ def test_sql():
     time.sleep(10)
     stopped = stop_syslogng()
     time.sleep(5)
-    return stopped and check_sql_expected("%s/test-sql.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345")
+    return stopped and \
+           check_sql_expected("%s/test-sql.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345") and \
+           check_sql_expected("%s/test-sql-multi-row.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345")
+
+def count_sql_rows(dbname, tablename):
+    try:
+        return int(os.popen("""echo "select count(*) from %s;" | sqlite3 %s 2>/dev/null""" % (tablename, dbname), "r").read().strip() or 0)
+    except ValueError:
+        return 0
+
+# polls all tables in the same loop, so every table is timed from the same
+# starting point, returns the time it took for each table to reach its
+# expected row count or None if it did not make it in time
+def wait_for_sql_rows(tables, timeout=60):
+    start = time.time()
+    elapsed = dict.fromkeys(tables)
+    while None in elapsed.values() and time.time() - start <= timeout:
+        for (dbname, tablename, count) in tables:
+            if elapsed[(dbname, tablename, count)] is None and count_sql_rows(dbname, tablename) >= count:
+                elapsed[(dbname, tablename, count)] = time.time() - start
+        time.sleep(0.05)
+    return elapsed
+
+def test_sql_throughput():
+    s = SocketSender(AF_INET, ('localhost', port_number), dgram=0, repeat=5000)
+
+    single_row_db = "%s/test-sql.db" % current_dir
+    multi_row_db = "%s/test-sql-multi-row.db" % current_dir
+    single_row = (single_row_db, "logs", count_sql_rows(single_row_db, "logs") + 4999)
+    multi_row = (multi_row_db, "logs", count_sql_rows(multi_row_db, "logs") + 4999)
+
+    s.sendMessages('sqlperf', pri=7)
+
+    elapsed = wait_for_sql_rows((single_row, multi_row))
+    stopped = stop_syslogng()
+
+    if None in elapsed.values():
+        print_user("Not all records were written to the SQL tables in time")
+        return False
+
+    print_user("SQL throughput: single-row=%.0f msg/sec, multi-row=%.0f msg/sec" %
+               (4999 / max(elapsed[single_row], 0.001), 4999 / max(elapsed[multi_row], 0.001)))
+    return stopped
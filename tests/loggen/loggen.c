@@ -38,6 +38,7 @@
 #include <string.h>
 #include <glib.h>
 #include <signal.h>
+#include <poll.h>
 
 #include <openssl/crypto.h>
 #include <openssl/x509.h>
@@ -82,6 +83,10 @@ int dont_parse = 0;
 static gint display_version;
 char *sdata_value = NULL;
 int permanent = 0;
+int sender_threads = 0;
+char *listen_address = NULL;
+int receive_timeout = 5;
+int embed_send_time = 0;
 
 /* results */
 guint64 sum_count;
@@ -356,30 +361,111 @@ format_timezone_offset_with_colon(char *timestamp, int timestamp_size, struct tm
   strncat(timestamp, offset, timestamp_size - strlen(timestamp) -1);
 }
 
+typedef struct _LoggenConnection
+{
+  int sock;
+  int id;
+  SSL *ssl;
+  send_data_t send_func;
+  void *send_func_ud;
+  unsigned long seq;
+} LoggenConnection;
+
+static guint64
+monotonic_usec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (guint64) ts.tv_sec * USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+/*
+ * Token bucket pacing: tokens accumulate continuously at @rate per second
+ * up to a burst of 1msec worth of messages, a message can be sent whenever
+ * a whole token is available.  Returns the number of microseconds to wait
+ * before the next message can be sent.
+ */
+typedef struct _TokenBucket
+{
+  double rate;
+  double tokens;
+  double burst;
+  guint64 last_refill;
+} TokenBucket;
+
+static void
+token_bucket_init(TokenBucket *self, double rate)
+{
+  self->rate = rate;
+  self->burst = MAX(1.0, rate / 1000);
+  self->tokens = 1.0;
+  self->last_refill = monotonic_usec();
+}
+
+static long
+token_bucket_take(TokenBucket *self)
+{
+  guint64 now = monotonic_usec();
+
+  self->tokens = MIN(self->burst, self->tokens + (now - self->last_refill) * self->rate / USEC_PER_SEC);
+  self->last_refill = now;
+
+  if (self->tokens < 1.0)
+    return (long) ((1.0 - self->tokens) * USEC_PER_SEC / self->rate) + 1;
+
+  self->tokens -= 1.0;
+  return 0;
+}
+
+static void
+sleep_usec(long usec)
+{
+  struct timespec tspec;
+
+  tspec.tv_sec = usec / USEC_PER_SEC;
+  tspec.tv_nsec = (usec % USEC_PER_SEC) * 1000;
+  while (nanosleep(&tspec, &tspec) < 0 && errno == EINTR)
+    ;
+}
+
+static void
+format_counter(char *dest, const char *format, guint64 value, int width)
+{
+  char intbuf[32];
+
+  snprintf(intbuf, sizeof(intbuf), format, value);
+  memcpy(dest, intbuf, width);
+}
+
 static guint64
-gen_messages(send_data_t send_func, void *send_func_ud, int thread_id, FILE *readfrom)
+gen_messages(LoggenConnection *conns, int num_conns, int thread_id, FILE *readfrom)
 {
-  struct timeval now, start, last_ts_format, last_throttle_check;
+  struct timeval now, start, last_ts_format;
   char linebuf[MAX_MESSAGE_LENGTH + 1];
   char stamp[32];
-  char intbuf[16];
   int linelen = 0;
   int i, run_id;
   unsigned long count = 0, last_count = 0;
   char padding[] = "PADD";
-  long buckets = rate - (rate / 10);
+  TokenBucket bucket;
+  long wait_usec;
   double diff_usec;
   struct timeval diff_tv;
-  int pos_timestamp1 = 0, pos_timestamp2 = 0, pos_seq = 0;
+  int pos_timestamp1 = 0, pos_timestamp2 = 0, pos_seq = 0, pos_prg = 0, pos_conn = 0, pos_sent = 0;
   int rc, hdr_len = 0;
   gint64 sum_linelen = 0;
   char *testsdata = NULL;
+  const char *sent_field = embed_send_time ? "sent: 0000000000000000 " : "";
+  LoggenConnection *conn;
 
   gettimeofday(&start, NULL);
   now = start;
-  last_throttle_check = now;
   run_id = start.tv_sec;
 
+  /* the rate is specified per active connection */
+  token_bucket_init(&bucket, (double) rate * num_conns);
+
   /* force reformat of the timestamp */
   last_ts_format = now;
   last_ts_format.tv_sec--;
@@ -400,19 +486,23 @@ gen_messages(send_data_t send_func, void *send_func_ud, int thread_id, FILE *rea
           if (sock_type == SOCK_STREAM && framing)
             hdr_len = snprintf(linebuf, sizeof(linebuf), "%d ", message_length);
 
-          linelen = snprintf(linebuf + hdr_len, sizeof(linebuf) - hdr_len, "<38>1 2007-12-24T12:28:51+02:00 localhost prg%05d 1234 - %s \xEF\xBB\xBFseq: %010d, thread: %04d, runid: %-10d, stamp: %-19s ", thread_id, testsdata, 0, thread_id, run_id, "");
+          linelen = snprintf(linebuf + hdr_len, sizeof(linebuf) - hdr_len, "<38>1 2007-12-24T12:28:51+02:00 localhost prg%05d 1234 - %s \xEF\xBB\xBFseq: %010d, thread: %04d, runid: %-10d, stamp: %-19s %s", conns[0].id, testsdata, 0, conns[0].id, run_id, "", sent_field);
 
           pos_timestamp1 = 6 + hdr_len;
+          pos_prg = 45 + hdr_len;
           pos_seq = 68 + hdr_len + strlen(testsdata) - 1;
           pos_timestamp2 = 120 + hdr_len + strlen(testsdata) - 1;
         }
       else
         {
-          linelen = snprintf(linebuf, sizeof(linebuf), "<38>2007-12-24T12:28:51 localhost prg%05d[1234]: seq: %010d, thread: %04d, runid: %-10d, stamp: %-19s ", thread_id, 0, thread_id, run_id, "");
+          linelen = snprintf(linebuf, sizeof(linebuf), "<38>2007-12-24T12:28:51 localhost prg%05d[1234]: seq: %010d, thread: %04d, runid: %-10d, stamp: %-19s %s", conns[0].id, 0, conns[0].id, run_id, "", sent_field);
           pos_timestamp1 = 4;
+          pos_prg = 37;
           pos_seq = 55;
           pos_timestamp2 = 107;
         }
+      pos_conn = pos_seq + 20;
+      pos_sent = pos_timestamp2 + 26;
 
       if (linelen > message_length)
         {
@@ -431,35 +521,17 @@ gen_messages(send_data_t send_func, void *send_func_ud, int thread_id, FILE *rea
   raw_message_length = linelen = strlen(linebuf);
   while (permanent || time_val_diff_in_usec(&now, &start) < ((int64_t)interval) * USEC_PER_SEC)
     {
-      if(number_of_messages != 0 && count >= number_of_messages)
+      if(number_of_messages != 0 && count >= (unsigned long) number_of_messages * num_conns)
         {
           break;
         }
       gettimeofday(&now, NULL);
 
-      diff_usec = time_val_diff_in_usec(&now, &last_throttle_check);
-      if (buckets == 0 || diff_usec > 1e5)
-        {
-          /* check rate every 0.1sec */
-          long new_buckets;
-
-          new_buckets = (rate * diff_usec) / USEC_PER_SEC;
-          if (new_buckets)
-            {
-              buckets = MIN(rate, buckets + new_buckets);
-              last_throttle_check = now;
-            }
-        }
-
-      if (buckets == 0)
+      wait_usec = token_bucket_take(&bucket);
+      if (wait_usec > 0)
         {
-          struct timespec tspec;
-          long msec = (1000 / rate) + 1;
-
-          tspec.tv_sec = msec / 1000;
-          tspec.tv_nsec = (msec % 1000) * 1e6;
-          while (nanosleep(&tspec, &tspec) < 0 && errno == EINTR)
-            ;
+          /* don't oversleep the end of the test */
+          sleep_usec(MIN(wait_usec, 100000));
           continue;
         }
 
@@ -510,20 +582,24 @@ gen_messages(send_data_t send_func, void *send_func_ud, int thread_id, FILE *rea
           last_count = count;
         }
 
+      /* connections take turns, each has its own sequence */
+      conn = &conns[count % num_conns];
       if (!readfrom)
         {
-          /* add sequence number */
-          snprintf(intbuf, sizeof(intbuf), "%010ld", count);
-          memcpy(&linebuf[pos_seq], intbuf, 10);
+          format_counter(&linebuf[pos_prg], "%05" G_GUINT64_FORMAT, conn->id, 5);
+          format_counter(&linebuf[pos_conn], "%04" G_GUINT64_FORMAT, conn->id, 4);
+          format_counter(&linebuf[pos_seq], "%010" G_GUINT64_FORMAT, conn->seq, 10);
+          if (embed_send_time)
+            format_counter(&linebuf[pos_sent], "%016" G_GUINT64_FORMAT, monotonic_usec(), 16);
         }
 
-      rc = write_chunk(send_func, send_func_ud, linebuf, linelen);
+      rc = write_chunk(conn->send_func, conn->send_func_ud, linebuf, linelen);
       if (rc < 0)
         {
           fprintf(stderr, "Send error %s, results may be skewed.\n", strerror(errno));
           break;
         }
-      buckets--;
+      conn->seq++;
       count++;
     }
 
@@ -544,49 +620,52 @@ gen_messages(send_data_t send_func, void *send_func_ud, int thread_id, FILE *rea
   return count;
 }
 
-static guint64
-gen_messages_ssl(int sock, int id, FILE *readfrom)
-{
-  int ret = 0;
-  int err;
-  SSL_CTX* ctx;
-  SSL *ssl;
+static SSL_CTX *ssl_ctx;
 
-  /* Initialize SSL library */
-  OpenSSL_add_ssl_algorithms();
-
-  if (NULL == (ctx = SSL_CTX_new(SSLv23_client_method())))
-    return 1;
+static gboolean
+connection_open(LoggenConnection *conn, int id)
+{
+  memset(conn, 0, sizeof(*conn));
+  conn->id = id;
+  conn->sock = connect_server();
+  if (conn->sock < 0)
+    return FALSE;
 
-  if (NULL == (ssl = SSL_new(ctx)))
-    return 1;
+  if (!usessl)
+    {
+      conn->send_func = send_plain;
+      conn->send_func_ud = GINT_TO_POINTER(conn->sock);
+      return TRUE;
+    }
 
-  SSL_load_error_strings();
-  ERR_load_crypto_strings();
+  if (NULL == (conn->ssl = SSL_new(ssl_ctx)))
+    return FALSE;
 
-  SSL_set_fd (ssl, sock);
-  if (-1 == (err = SSL_connect(ssl)))
+  SSL_set_fd(conn->ssl, conn->sock);
+  if (SSL_connect(conn->ssl) <= 0)
     {
       fprintf(stderr, "SSL connect failed\n");
       ERR_print_errors_fp(stderr);
-      return 2;
+      return FALSE;
     }
-
-  ret = gen_messages(send_ssl, ssl, id, readfrom);
-
-  SSL_shutdown (ssl);
-
-  /* Clean up. */
-  SSL_free (ssl);
-  SSL_CTX_free (ctx);
-
-  return ret;
+  conn->send_func = send_ssl;
+  conn->send_func_ud = conn->ssl;
+  return TRUE;
 }
 
-static guint64
-gen_messages_plain(int sock, int id, FILE *readfrom)
+static void
+connection_close(LoggenConnection *conn)
 {
-  return gen_messages(send_plain, GINT_TO_POINTER(sock), id, readfrom);
+  if (conn->ssl)
+    {
+      SSL_shutdown(conn->ssl);
+      SSL_free(conn->ssl);
+    }
+  if (conn->sock >= 0)
+    {
+      shutdown(conn->sock, SHUT_RDWR);
+      close(conn->sock);
+    }
 }
 
 GMutex *thread_lock;
@@ -630,21 +709,27 @@ error:
   return NULL;
 }
 
+/* sender thread @id drives active connections id, id + sender_threads, ... */
 gpointer
 active_thread(gpointer st)
 {
 
   int id = GPOINTER_TO_INT(st);
-  gint sock;
+  LoggenConnection *conns;
+  int owned_conns, num_conns = 0, i;
   guint64 count;
   struct timeval start, end, diff_tv;
   FILE *readfrom = NULL;
 
-  sock = connect_server();
-  if (sock < 0)
-    goto error;
+  owned_conns = (active_connections - id + sender_threads - 1) / sender_threads;
+  conns = g_new0(LoggenConnection, owned_conns);
+  for (i = id; i < active_connections; i += sender_threads)
+    {
+      if (!connection_open(&conns[num_conns++], i))
+        goto error;
+    }
   g_mutex_lock(thread_lock);
-  connect_finished++;
+  connect_finished += owned_conns;
   if (connect_finished == active_connections + idle_connections)
     g_cond_signal(thread_connected);
 
@@ -673,25 +758,29 @@ active_thread(gpointer st)
     }
 
   gettimeofday(&start, NULL);
-  count = (usessl ? gen_messages_ssl : gen_messages_plain)(sock, id, readfrom);
-  shutdown(sock, SHUT_RDWR);
+  count = gen_messages(conns, num_conns, id, readfrom);
   gettimeofday(&end, NULL);
   time_val_diff_in_timeval(&diff_tv, &end, &start);
+  for (i = 0; i < num_conns; i++)
+    connection_close(&conns[i]);
+  g_free(conns);
 
   g_mutex_lock(thread_lock);
   sum_count += count;
   time_val_add_time_val(&sum_time, &sum_time, &diff_tv);
   active_finished++;
-  if (active_finished == active_connections)
+  if (active_finished == sender_threads)
     g_cond_signal(thread_finished);
   g_mutex_unlock(thread_lock);
-  close(sock);
   if (readfrom && readfrom != stdin)
     fclose(readfrom);
   return NULL;
 error:
+  for (i = 0; i < num_conns; i++)
+    connection_close(&conns[i]);
+  g_free(conns);
   g_mutex_lock(thread_lock);
-  connect_finished++;
+  connect_finished += owned_conns;
   active_finished++;
   g_cond_signal(thread_connected);
   g_cond_signal(thread_finished);
@@ -699,6 +788,311 @@ error:
   return NULL;
 }
 
+/*
+ * Receiver: listens for the messages relayed by syslog-ng and measures
+ * their latency based on the "sent" field, and loss/reordering based on
+ * the per-connection sequence numbers.
+ */
+
+#define LATENCY_SUB_BUCKETS 8
+#define LATENCY_BUCKETS 240
+
+guint64 latency_buckets[LATENCY_BUCKETS];
+guint64 received_count;
+guint64 reordered_count;
+glong *max_seq_seen;
+volatile gboolean receiver_stop;
+
+static int
+latency_bucket(guint64 value)
+{
+  int msb;
+
+  value = MIN(value, G_MAXUINT32);
+  if (value < LATENCY_SUB_BUCKETS)
+    return value;
+  msb = g_bit_storage(value) - 1;
+  return (msb - 2) * LATENCY_SUB_BUCKETS + ((value >> (msb - 3)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+static guint64
+latency_bucket_upper_bound(int bucket)
+{
+  if (bucket < LATENCY_SUB_BUCKETS)
+    return bucket;
+  return ((guint64) (LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS + 1) << (bucket / LATENCY_SUB_BUCKETS - 1)) - 1;
+}
+
+static guint64
+latency_percentile(guint64 count, double percentile)
+{
+  guint64 rank = (guint64) (count * percentile / 100 + 0.5);
+  guint64 seen = 0;
+  int i;
+
+  rank = MAX(rank, 1);
+  for (i = 0; i < LATENCY_BUCKETS; i++)
+    {
+      seen += latency_buckets[i];
+      if (seen >= rank)
+        return latency_bucket_upper_bound(i);
+    }
+  return latency_bucket_upper_bound(LATENCY_BUCKETS - 1);
+}
+
+static void
+process_received_line(const char *line, guint64 now)
+{
+  const char *p;
+  long seq, conn_id;
+  guint64 sent;
+
+  if (!(p = strstr(line, "seq: ")))
+    return;
+  seq = strtol(p + 5, NULL, 10);
+  if (!(p = strstr(p, "thread: ")))
+    return;
+  conn_id = strtol(p + 8, NULL, 10);
+  if (!(p = strstr(p, "sent: ")))
+    return;
+  sent = g_ascii_strtoull(p + 6, NULL, 10);
+
+  received_count++;
+  if (now >= sent)
+    latency_buckets[latency_bucket(now - sent)]++;
+
+  if (conn_id < 0 || conn_id >= active_connections)
+    return;
+  if (seq < max_seq_seen[conn_id])
+    reordered_count++;
+  else
+    max_seq_seen[conn_id] = seq;
+}
+
+typedef struct _ReceiverConnection
+{
+  int fd;
+  char buf[MAX_MESSAGE_LENGTH * 2];
+  int len;
+} ReceiverConnection;
+
+/* returns FALSE when the connection is closed */
+static gboolean
+receiver_read(ReceiverConnection *rconn)
+{
+  guint64 now;
+  char *line, *eol;
+  int rc;
+
+  if (sock_type == SOCK_DGRAM)
+    rconn->len = 0;
+
+  rc = recv(rconn->fd, rconn->buf + rconn->len, sizeof(rconn->buf) - rconn->len - 1, 0);
+  if (rc <= 0)
+    return sock_type == SOCK_DGRAM || (rc < 0 && errno == EINTR);
+
+  now = monotonic_usec();
+  rconn->len += rc;
+  rconn->buf[rconn->len] = 0;
+
+  g_mutex_lock(thread_lock);
+  if (sock_type == SOCK_DGRAM)
+    {
+      process_received_line(rconn->buf, now);
+    }
+  else
+    {
+      line = rconn->buf;
+      while ((eol = memchr(line, '\n', rconn->buf + rconn->len - line)))
+        {
+          *eol = 0;
+          process_received_line(line, now);
+          line = eol + 1;
+        }
+      rconn->len -= line - rconn->buf;
+      /* drop overlong lines */
+      if (rconn->len == sizeof(rconn->buf) - 1)
+        rconn->len = 0;
+      memmove(rconn->buf, line, rconn->len);
+    }
+  g_mutex_unlock(thread_lock);
+  return TRUE;
+}
+
+gpointer
+receiver_thread(gpointer st)
+{
+  int listen_fd = GPOINTER_TO_INT(st);
+  GPtrArray *rconns = g_ptr_array_new();
+  GArray *pfds = g_array_new(FALSE, TRUE, sizeof(struct pollfd));
+  ReceiverConnection *rconn;
+  struct pollfd pfd;
+  int i;
+
+  if (sock_type == SOCK_DGRAM)
+    {
+      rconn = g_new0(ReceiverConnection, 1);
+      rconn->fd = listen_fd;
+      g_ptr_array_add(rconns, rconn);
+    }
+
+  while (!receiver_stop)
+    {
+      g_array_set_size(pfds, 0);
+      pfd.fd = listen_fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (sock_type == SOCK_STREAM)
+        g_array_append_val(pfds, pfd);
+      for (i = 0; i < rconns->len; i++)
+        {
+          pfd.fd = ((ReceiverConnection *) g_ptr_array_index(rconns, i))->fd;
+          g_array_append_val(pfds, pfd);
+        }
+
+      if (poll((struct pollfd *) pfds->data, pfds->len, 100) <= 0)
+        continue;
+
+      for (i = pfds->len - 1; i >= 0; i--)
+        {
+          struct pollfd *p = &g_array_index(pfds, struct pollfd, i);
+
+          if (!p->revents)
+            continue;
+
+          if (sock_type == SOCK_STREAM && i == 0)
+            {
+              int fd = accept(listen_fd, NULL, NULL);
+
+              if (fd >= 0)
+                {
+                  rconn = g_new0(ReceiverConnection, 1);
+                  rconn->fd = fd;
+                  g_ptr_array_add(rconns, rconn);
+                }
+              continue;
+            }
+
+          rconn = g_ptr_array_index(rconns, sock_type == SOCK_STREAM ? i - 1 : i);
+          if (!receiver_read(rconn))
+            {
+              close(rconn->fd);
+              g_ptr_array_remove_fast(rconns, rconn);
+              g_free(rconn);
+            }
+        }
+    }
+
+  for (i = 0; i < rconns->len; i++)
+    {
+      rconn = g_ptr_array_index(rconns, i);
+      if (rconn->fd != listen_fd)
+        close(rconn->fd);
+      g_free(rconn);
+    }
+  g_ptr_array_free(rconns, TRUE);
+  g_array_free(pfds, TRUE);
+  close(listen_fd);
+  return NULL;
+}
+
+static int
+receiver_listen(const char *address)
+{
+  int fd;
+  int on = 1;
+
+  if (unix_socket)
+    {
+      struct sockaddr_un saun;
+
+      fd = socket(AF_UNIX, sock_type, 0);
+      if (fd < 0)
+        goto error;
+      memset(&saun, 0, sizeof(saun));
+      saun.sun_family = AF_UNIX;
+      strncpy(saun.sun_path, address, sizeof(saun.sun_path) - 1);
+      unlink(saun.sun_path);
+      if (bind(fd, (struct sockaddr *) &saun, sizeof(saun)) < 0)
+        goto error_close;
+    }
+  else
+    {
+      struct sockaddr_in6 s_in6;
+      struct sockaddr_in s_in;
+
+      fd = socket(use_ipv6 ? AF_INET6 : AF_INET, sock_type, 0);
+      if (fd < 0)
+        goto error;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+      if (use_ipv6)
+        {
+          memset(&s_in6, 0, sizeof(s_in6));
+          s_in6.sin6_family = AF_INET6;
+          s_in6.sin6_addr = in6addr_any;
+          s_in6.sin6_port = htons(atoi(address));
+          if (bind(fd, (struct sockaddr *) &s_in6, sizeof(s_in6)) < 0)
+            goto error_close;
+        }
+      else
+        {
+          memset(&s_in, 0, sizeof(s_in));
+          s_in.sin_family = AF_INET;
+          s_in.sin_addr.s_addr = htonl(INADDR_ANY);
+          s_in.sin_port = htons(atoi(address));
+          if (bind(fd, (struct sockaddr *) &s_in, sizeof(s_in)) < 0)
+            goto error_close;
+        }
+    }
+
+  if (sock_type == SOCK_STREAM && listen(fd, 255) < 0)
+    goto error_close;
+  return fd;
+
+error_close:
+  close(fd);
+error:
+  fprintf(stderr, "Error creating the receiver socket: %s\n", g_strerror(errno));
+  return -1;
+}
+
+/* waits until everything sent is received, or nothing arrives for receive_timeout seconds */
+static void
+receiver_drain(void)
+{
+  guint64 last_received = 0, received;
+  int idle_usec = 0;
+
+  while (idle_usec < receive_timeout * USEC_PER_SEC)
+    {
+      g_mutex_lock(thread_lock);
+      received = received_count;
+      g_mutex_unlock(thread_lock);
+
+      if (received >= sum_count)
+        break;
+      if (received != last_received)
+        idle_usec = 0;
+      last_received = received;
+
+      sleep_usec(100000);
+      idle_usec += 100000;
+    }
+}
+
+static void
+receiver_report(void)
+{
+  fprintf(stderr, "received=%" G_GUINT64_FORMAT ", lost=%" G_GUINT64_FORMAT ", reordered=%" G_GUINT64_FORMAT "\n",
+          received_count, sum_count > received_count ? sum_count - received_count : 0, reordered_count);
+  if (received_count)
+    fprintf(stderr, "latency (usec): p50=%" G_GUINT64_FORMAT ", p90=%" G_GUINT64_FORMAT ", p99=%" G_GUINT64_FORMAT
+            ", p99.9=%" G_GUINT64_FORMAT ", max=%" G_GUINT64_FORMAT "\n",
+            latency_percentile(received_count, 50), latency_percentile(received_count, 90),
+            latency_percentile(received_count, 99), latency_percentile(received_count, 99.9),
+            latency_percentile(received_count, 100));
+}
+
 static GOptionEntry loggen_options[] = {
   { "rate", 'r', 0, G_OPTION_ARG_INT, &rate, "Number of messages to generate per second", "<msg/sec/active connection>" },
   { "inet", 'i', 0, G_OPTION_ARG_NONE, &unix_socket_i, "Use IP-based transport (TCP, UDP)", NULL },
@@ -714,6 +1108,9 @@ static GOptionEntry loggen_options[] = {
   { "no-framing", 'F', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &framing, "Don't use syslog-protocol style framing, even if syslog-proto is set", NULL },
   { "active-connections", 0, 0, G_OPTION_ARG_INT, &active_connections, "Number of active connections to the server (default = 1)", "<number>" },
   { "idle-connections", 0, 0, G_OPTION_ARG_INT, &idle_connections, "Number of inactive connections to the server (default = 0)", "<number>" },
+  { "threads", 't', 0, G_OPTION_ARG_INT, &sender_threads, "Number of sender threads the active connections are distributed over (default = one per active connection)", "<number>" },
+  { "listen", 0, 0, G_OPTION_ARG_STRING, &listen_address, "Receive the relayed messages on this port (or path with --unix) and report latency, loss and reordering", "<port|path>" },
+  { "receive-timeout", 0, 0, G_OPTION_ARG_INT, &receive_timeout, "Seconds to wait for outstanding messages after sending finished (default = 5)", "<sec>" },
   { "use-ssl", 'U', 0, G_OPTION_ARG_NONE, &usessl, "Use ssl layer", NULL },
   { "read-file", 'R', 0, G_OPTION_ARG_STRING, &read_file, "Read log messages from file", "<filename>" },
   { "loop-reading", 'l', 0, G_OPTION_ARG_NONE, &loop_reading, "Read the file specified in read-file option in loop (it will restart the reading if reached the end of the file)", NULL },
@@ -749,6 +1146,7 @@ main(int argc, char *argv[])
   int i;
   guint64 diff_usec;
   GOptionGroup *group;
+  GThread *receiver = NULL;
 
   g_thread_init(NULL);
   tzset();
@@ -781,6 +1179,17 @@ main(int argc, char *argv[])
       return 1;
     }
 
+  if (sender_threads <= 0 || sender_threads > active_connections)
+    sender_threads = active_connections;
+
+  if (listen_address)
+    {
+      if (read_file != NULL)
+        fprintf(stderr, "Warning: messages read from file carry no send timestamp, latency won't be measured\n");
+      else
+        embed_send_time = 1;
+    }
+
   if (unix_socket_i)
     unix_socket = 0;
   if (unix_socket_x)
@@ -889,11 +1298,27 @@ main(int argc, char *argv[])
       dest_addr = (struct sockaddr *) &saun;
       dest_addr_len = sizeof(saun);
     }
-  if (active_connections + idle_connections > 10000)
+  if (sender_threads + idle_connections > 10000)
     {
       fprintf(stderr, "Loggen doesn't support more than 10k threads.\n");
       return 2;
     }
+  if (active_connections > 10000)
+    {
+      fprintf(stderr, "Loggen doesn't support more than 10k active connections.\n");
+      return 2;
+    }
+
+  if (usessl)
+    {
+      /* Initialize SSL library */
+      OpenSSL_add_ssl_algorithms();
+      SSL_load_error_strings();
+      ERR_load_crypto_strings();
+
+      if (NULL == (ssl_ctx = SSL_CTX_new(SSLv23_client_method())))
+        return 1;
+    }
 
   /* used for startup & to signal inactive threads to exit */
   thread_cond = g_cond_new();
@@ -912,7 +1337,21 @@ main(int argc, char *argv[])
       if (!g_thread_create_full(idle_thread, NULL, 1024 * 64, FALSE, FALSE, G_THREAD_PRIORITY_NORMAL, NULL))
         goto stop_and_exit;
     }
-  for (i = 0; i < active_connections; i++)
+  if (listen_address)
+    {
+      int listen_fd = receiver_listen(listen_address);
+
+      if (listen_fd < 0)
+        return 2;
+
+      max_seq_seen = g_new(glong, active_connections);
+      for (i = 0; i < active_connections; i++)
+        max_seq_seen[i] = -1;
+      receiver = g_thread_create(receiver_thread, GINT_TO_POINTER(listen_fd), TRUE, NULL);
+      if (!receiver)
+        goto stop_and_exit;
+    }
+  for (i = 0; i < sender_threads; i++)
     {
       if (!g_thread_create_full(active_thread, GINT_TO_POINTER(i), 1024 * 64, FALSE, FALSE, G_THREAD_PRIORITY_NORMAL, NULL))
         goto stop_and_exit;
@@ -927,7 +1366,7 @@ main(int argc, char *argv[])
   g_cond_broadcast(thread_cond);
 
   /* wait until active ones finish */
-  while (active_finished < active_connections)
+  while (active_finished < sender_threads)
     g_cond_wait(thread_finished, thread_lock);
 
   /* tell inactive ones to exit (active ones exit automatically) */
@@ -935,8 +1374,8 @@ main(int argc, char *argv[])
   g_cond_broadcast(thread_cond);
   g_mutex_unlock(thread_lock);
 
-  sum_time.tv_sec /= active_connections;
-  sum_time.tv_usec /= active_connections;
+  sum_time.tv_sec /= sender_threads;
+  sum_time.tv_usec /= sender_threads;
   diff_usec = sum_time.tv_sec * USEC_PER_SEC + sum_time.tv_usec;
 
   fprintf(stderr, "average rate = %.2lf msg/sec, count=%"G_GUINT64_FORMAT", time=%ld.%03ld, (average) msg size=%d, bandwidth=%.2lf kB/sec\n",
@@ -944,7 +1383,21 @@ main(int argc, char *argv[])
     (double) sum_count * USEC_PER_SEC / diff_usec, sum_count, sum_time.tv_sec, sum_time.tv_usec / 1000, raw_message_length,
     (double) sum_count * raw_message_length * (USEC_PER_SEC / 1024) / diff_usec);
 
+  if (receiver)
+    {
+      receiver_drain();
+      receiver_stop = TRUE;
+      g_thread_join(receiver);
+      receiver = NULL;
+      receiver_report();
+    }
+
 stop_and_exit:
+  if (receiver)
+    {
+      receiver_stop = TRUE;
+      g_thread_join(receiver);
+    }
   threads_start = TRUE;
   threads_stop = TRUE;
   g_mutex_lock(thread_lock);
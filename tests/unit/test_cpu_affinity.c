@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2016 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <string.h>
+
+#include "testutils.h"
+#include "cpu-affinity.h"
+#include "apphook.h"
+
+#define CPU_AFFINITY_TESTCASE(testfunc, ...) { testcase_begin("%s(%s)", #testfunc, #__VA_ARGS__); testfunc(__VA_ARGS__); testcase_end(); }
+
+static void
+assert_cpu_list_normalized(const gchar *spec, const gchar *expected)
+{
+  GArray *cpus = cpu_affinity_parse(spec);
+  GString *formatted = g_string_new("");
+
+  assert_not_null(cpus, "CPU list should be accepted: %s", spec);
+  cpu_affinity_format(cpus, formatted);
+  assert_string(formatted->str, expected, "CPU list formatted incorrectly: %s", spec);
+
+  g_string_free(formatted, TRUE);
+  cpu_affinity_free(cpus);
+}
+
+static void
+assert_cpu_list_rejected(const gchar *spec)
+{
+  assert_null(cpu_affinity_parse(spec), "CPU list should be rejected: %s", spec);
+}
+
+static void
+test_parse_cpu_lists(void)
+{
+  assert_cpu_list_normalized("0", "0");
+  assert_cpu_list_normalized("0-3", "0-3");
+  assert_cpu_list_normalized("0-3,8", "0-3,8");
+  assert_cpu_list_normalized("8, 0-3", "0-3,8");
+  assert_cpu_list_normalized("1,2,3,5", "1-3,5");
+  assert_cpu_list_normalized("0-2,1-4", "0-4");
+}
+
+static void
+test_invalid_cpu_lists_are_rejected(void)
+{
+  assert_cpu_list_rejected("");
+  assert_cpu_list_rejected("a");
+  assert_cpu_list_rejected("3-1");
+  assert_cpu_list_rejected("1-");
+  assert_cpu_list_rejected("1;2");
+  assert_cpu_list_rejected("-1");
+  assert_cpu_list_rejected("100000");
+}
+
+static void
+test_select_wraps_around(void)
+{
+  GArray *cpus = cpu_affinity_parse("2,4,6");
+  GArray *selected;
+
+  selected = cpu_affinity_select(cpus, 1);
+  assert_gint(selected->len, 1, "selected set should contain a single CPU");
+  assert_gint(g_array_index(selected, gint, 0), 4, "second CPU should be selected");
+  cpu_affinity_free(selected);
+
+  selected = cpu_affinity_select(cpus, 4);
+  assert_gint(g_array_index(selected, gint, 0), 4, "selection should wrap around");
+  cpu_affinity_free(selected);
+
+  cpu_affinity_free(cpus);
+}
+
+static void
+test_registered_threads_are_listed(void)
+{
+  GString *threads;
+
+  cpu_affinity_register_thread("test-thread");
+  threads = cpu_affinity_format_threads();
+  assert_true(strstr(threads->str, "\ntest-thread;") != NULL, "registered thread should be listed: %s", threads->str);
+  g_string_free(threads, TRUE);
+
+  cpu_affinity_unregister_thread();
+  threads = cpu_affinity_format_threads();
+  assert_true(strstr(threads->str, "test-thread") == NULL, "unregistered thread should not be listed: %s", threads->str);
+  g_string_free(threads, TRUE);
+}
+
+int
+main(int argc, char **argv)
+{
+  app_startup();
+
+  CPU_AFFINITY_TESTCASE(test_parse_cpu_lists);
+  CPU_AFFINITY_TESTCASE(test_invalid_cpu_lists_are_rejected);
+  CPU_AFFINITY_TESTCASE(test_select_wraps_around);
+  CPU_AFFINITY_TESTCASE(test_registered_threads_are_listed);
+
+  app_shutdown();
+  return 0;
+}
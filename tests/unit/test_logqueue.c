@@ -22,6 +22,7 @@
 
 #include "logqueue.h"
 #include "logqueue-fifo.h"
+#include "logqueue-ring.h"
 #include "logpipe.h"
 #include "apphook.h"
 #include "plugin.h"
@@ -40,13 +41,15 @@ MsgFormatOptions parse_options;
 
 #define OVERFLOW_SIZE 10000
 
+typedef LogQueue *(*LogQueueConstructor)(gint qoverflow_size, const gchar *persist_name);
+
 void
-testcase_zero_diskbuf_and_normal_acks()
+testcase_zero_diskbuf_and_normal_acks(LogQueueConstructor queue_new)
 {
   LogQueue *q;
   gint i;
 
-  q = log_queue_fifo_new(OVERFLOW_SIZE, NULL);
+  q = queue_new(OVERFLOW_SIZE, NULL);
   log_queue_set_use_backlog(q, TRUE);
 
   fed_messages = 0;
@@ -66,12 +69,12 @@ testcase_zero_diskbuf_and_normal_acks()
 }
 
 void
-testcase_zero_diskbuf_alternating_send_acks()
+testcase_zero_diskbuf_alternating_send_acks(LogQueueConstructor queue_new)
 {
   LogQueue *q;
   gint i;
 
-  q = log_queue_fifo_new(OVERFLOW_SIZE, NULL);
+  q = queue_new(OVERFLOW_SIZE, NULL);
   log_queue_set_use_backlog(q, TRUE);
 
   fed_messages = 0;
@@ -98,6 +101,7 @@ testcase_zero_diskbuf_alternating_send_acks()
 
 GStaticMutex tlock;
 glong sum_time;
+glong consume_time;
 
 gpointer
 threaded_feed(gpointer args)
@@ -153,10 +157,12 @@ threaded_consume(gpointer st)
   LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
   gint loops = 0;
   gint msg_count = 0;
+  GTimeVal start, end;
 
   /* just to make sure time is properly cached */
   iv_init();
 
+  g_get_current_time(&start);
   while (msg_count < MESSAGES_SUM)
     {
       gint slept = 0;
@@ -192,6 +198,8 @@ threaded_consume(gpointer st)
         }
       loops++;
     }
+  g_get_current_time(&end);
+  consume_time += g_time_val_diff(&end, &start);
 
   iv_deinit();
   return NULL;
@@ -200,7 +208,7 @@ threaded_consume(gpointer st)
 gpointer
 output_thread(gpointer args)
 {
-  WorkerOptions wo;
+  WorkerOptions wo = { 0 };
   wo.is_output_thread = TRUE;
   main_loop_worker_thread_start(&wo);
   struct timespec ns;
@@ -215,18 +223,20 @@ output_thread(gpointer args)
 
 
 void
-testcase_with_threads()
+testcase_with_threads(LogQueueConstructor queue_new, const gchar *queue_name)
 {
   LogQueue *q;
   GThread *thread_feed[FEEDERS], *thread_consume;
   GThread *other_threads[FEEDERS];
   gint i, j;
 
+  sum_time = 0;
+  consume_time = 0;
   log_queue_set_max_threads(FEEDERS);
   for (i = 0; i < TEST_RUNS; i++)
     {
       fprintf(stderr,"starting testrun: %d\n",i);
-      q = log_queue_fifo_new(MESSAGES_SUM, NULL);
+      q = queue_new(MESSAGES_SUM, NULL);
       log_queue_set_use_backlog(q, TRUE);
 
       for (j = 0; j < FEEDERS; j++)
@@ -248,7 +258,96 @@ testcase_with_threads()
 
       log_queue_unref(q);
     }
-  fprintf(stderr, "Feed speed: %.2lf\n", (double) TEST_RUNS * MESSAGES_SUM * 1000000 / sum_time);
+  fprintf(stderr, "Feed speed (%s): %.2lf\n", queue_name, (double) TEST_RUNS * MESSAGES_SUM * 1000000 / sum_time);
+  fprintf(stderr, "Consume speed (%s): %.2lf\n", queue_name, (double) TEST_RUNS * MESSAGES_SUM * 1000000 / consume_time);
+}
+
+/* single producer/consumer throughput with the backlog acked in chunks,
+ * the way LogThrDestDriver based destinations use the queue */
+#define THROUGHPUT_MESSAGES 200000
+#define THROUGHPUT_ACK_CHUNK 64
+
+gpointer
+threaded_feed_and_consume(gpointer args)
+{
+  LogQueue *q = args;
+  char *msg_str = "<155>2006-02-11T10:34:56+01:00 bzorp syslog-ng[23323]: árvíztűrőtükörfúrógép";
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg, *tmpl;
+  GSockAddr *sa;
+  gint i, popped;
+
+  iv_init();
+  main_loop_worker_thread_start(NULL);
+
+  sa = g_sockaddr_inet_new("10.10.10.10", 1010);
+  tmpl = log_msg_new(msg_str, strlen(msg_str), sa, &parse_options);
+  g_sockaddr_unref(sa);
+
+  for (i = 0; i < THROUGHPUT_MESSAGES; i++)
+    {
+      msg = log_msg_clone_cow(tmpl, &path_options);
+      log_msg_add_ack(msg, &path_options);
+      msg->ack_func = test_ack;
+      log_queue_push_tail(q, msg, &path_options);
+
+      if ((i & 0xFF) == 0xFF)
+        {
+          main_loop_worker_invoke_batch_callbacks();
+
+          popped = 0;
+          while ((msg = log_queue_pop_head(q, &path_options)) != NULL)
+            {
+              log_msg_unref(msg);
+              if (++popped % THROUGHPUT_ACK_CHUNK == 0)
+                {
+                  /* exercise rewind: resend the last message of each chunk */
+                  log_queue_rewind_backlog(q, 1);
+                  log_queue_ack_backlog(q, THROUGHPUT_ACK_CHUNK - 1);
+                }
+            }
+          log_queue_ack_backlog(q, popped);
+        }
+    }
+  main_loop_worker_invoke_batch_callbacks();
+  while ((msg = log_queue_pop_head(q, &path_options)) != NULL)
+    log_msg_unref(msg);
+  log_queue_ack_backlog(q, THROUGHPUT_MESSAGES);
+
+  log_msg_unref(tmpl);
+  main_loop_worker_thread_stop();
+  iv_deinit();
+  return NULL;
+}
+
+void
+testcase_throughput(LogQueueConstructor queue_new, const gchar *queue_name)
+{
+  LogQueue *q;
+  GThread *thread;
+  GTimeVal start, end;
+
+  log_queue_set_max_threads(1);
+  q = queue_new(THROUGHPUT_MESSAGES, NULL);
+  log_queue_set_use_backlog(q, TRUE);
+
+  fed_messages = THROUGHPUT_MESSAGES;
+  acked_messages = 0;
+
+  g_get_current_time(&start);
+  thread = g_thread_create(threaded_feed_and_consume, q, TRUE, NULL);
+  g_thread_join(thread);
+  g_get_current_time(&end);
+
+  if (fed_messages != acked_messages || log_queue_get_length(q) != 0)
+    {
+      fprintf(stderr, "%s: did not receive enough acknowledgements: fed_messages=%d, acked_messages=%d\n",
+              queue_name, fed_messages, acked_messages);
+      exit(1);
+    }
+  fprintf(stderr, "Throughput (%s): %.2lf msg/sec\n", queue_name,
+          (double) THROUGHPUT_MESSAGES * 1000000 / g_time_val_diff(&end, &start));
+  log_queue_unref(q);
 }
 
 int
@@ -264,13 +363,20 @@ main()
   msg_format_options_init(&parse_options, configuration);
 
   fprintf(stderr,"Start testcase_with_threads\n");
-  testcase_with_threads();
+  testcase_with_threads(log_queue_fifo_new, "fifo");
+  testcase_with_threads(log_queue_ring_new, "ring");
 
 #if 1
   fprintf(stderr,"Start testcase_zero_diskbuf_alternating_send_acks\n");
-  testcase_zero_diskbuf_alternating_send_acks();
+  testcase_zero_diskbuf_alternating_send_acks(log_queue_fifo_new);
+  testcase_zero_diskbuf_alternating_send_acks(log_queue_ring_new);
   fprintf(stderr,"Start testcase_zero_diskbuf_and_normal_acks\n");
-  testcase_zero_diskbuf_and_normal_acks();
+  testcase_zero_diskbuf_and_normal_acks(log_queue_fifo_new);
+  testcase_zero_diskbuf_and_normal_acks(log_queue_ring_new);
 #endif
+
+  fprintf(stderr,"Start testcase_throughput\n");
+  testcase_throughput(log_queue_fifo_new, "fifo");
+  testcase_throughput(log_queue_ring_new, "ring");
   return 0;
 }
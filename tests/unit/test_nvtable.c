@@ -124,6 +124,61 @@ test_nv_registry()
   nv_registry_free(reg);
 }
 
+#define CONCURRENT_THREADS 8
+#define CONCURRENT_NAMES 5000
+
+static NVRegistry *concurrent_reg;
+static NVHandle concurrent_handles[CONCURRENT_THREADS][CONCURRENT_NAMES];
+
+static gpointer
+_alloc_handles_concurrently(gpointer user_data)
+{
+  gint thread_index = GPOINTER_TO_INT(user_data);
+  gint i, name_index;
+  gchar name[32];
+
+  /* every thread walks the names in a different order */
+  for (i = 0; i < CONCURRENT_NAMES; i++)
+    {
+      name_index = (i + thread_index * (CONCURRENT_NAMES / CONCURRENT_THREADS)) % CONCURRENT_NAMES;
+      if (thread_index % 2)
+        name_index = CONCURRENT_NAMES - 1 - name_index;
+      g_snprintf(name, sizeof(name), "concurrent.name%05d", name_index);
+      concurrent_handles[thread_index][name_index] = nv_registry_alloc_handle(concurrent_reg, name);
+    }
+  return NULL;
+}
+
+static void
+test_nv_registry_concurrent_alloc()
+{
+  const gchar *builtins[] = { "BUILTIN1", NULL };
+  GThread *threads[CONCURRENT_THREADS];
+  const gchar *name;
+  gchar expected_name[32];
+  gint i, j;
+
+  concurrent_reg = nv_registry_new(builtins);
+  for (i = 0; i < CONCURRENT_THREADS; i++)
+    threads[i] = g_thread_create(_alloc_handles_concurrently, GINT_TO_POINTER(i), TRUE, NULL);
+  for (i = 0; i < CONCURRENT_THREADS; i++)
+    g_thread_join(threads[i]);
+
+  for (j = 0; j < CONCURRENT_NAMES; j++)
+    {
+      TEST_ASSERT(concurrent_handles[0][j] != 0);
+      for (i = 1; i < CONCURRENT_THREADS; i++)
+        TEST_ASSERT(concurrent_handles[i][j] == concurrent_handles[0][j]);
+
+      g_snprintf(expected_name, sizeof(expected_name), "concurrent.name%05d", j);
+      name = nv_registry_get_handle_name(concurrent_reg, concurrent_handles[0][j], NULL);
+      TEST_ASSERT(strcmp(name, expected_name) == 0);
+      TEST_ASSERT(nv_registry_get_handle(concurrent_reg, expected_name) == concurrent_handles[0][j]);
+    }
+  TEST_ASSERT(concurrent_reg->names->len == CONCURRENT_NAMES + 1);
+  nv_registry_free(concurrent_reg);
+}
+
 /*
  * NVTable:
  *
@@ -755,6 +810,195 @@ test_nvtable_lookup()
     }
 }
 
+/*
+ * The dynamic slot lookup caches the position of each handle from the
+ * previous table it was seen in.  Tables with different sizes and
+ * insertion orders share those hints, including handles that fold to the
+ * same hint, so every lookup and insert here is likely to start from a
+ * stale one.
+ */
+#define STALE_HINT_HANDLES 12
+
+static void
+_assert_nvtable_dyn_entries_sorted(NVTable *tab, gint expected_count)
+{
+  NVDynValue *dyn_entries = nv_table_get_dyn_entries(tab);
+  gint i;
+
+  TEST_ASSERT(tab->num_dyn_entries == expected_count);
+  for (i = 1; i < tab->num_dyn_entries; i++)
+    TEST_ASSERT(NV_TABLE_DYNVALUE_HANDLE(dyn_entries[i - 1]) < NV_TABLE_DYNVALUE_HANDLE(dyn_entries[i]));
+}
+
+static NVTable *
+_build_nvtable_with_stale_hints(NVHandle *handles, gint count)
+{
+  NVTable *tab;
+  gchar name[16];
+  gboolean new_entry;
+  gint i;
+
+  tab = nv_table_new(STATIC_VALUES, STALE_HINT_HANDLES, 4096);
+  for (i = 0; i < count; i++)
+    {
+      g_snprintf(name, sizeof(name), "VAL%d", handles[i]);
+      TEST_ASSERT(nv_table_add_value(tab, handles[i], name, strlen(name), name, strlen(name), &new_entry));
+      TEST_ASSERT(new_entry);
+      _assert_nvtable_dyn_entries_sorted(tab, i + 1);
+    }
+  return tab;
+}
+
+static void
+_assert_nvtable_contains_exactly(NVTable *tab, NVHandle *handles, gint count, NVHandle *all_handles, gint all_count)
+{
+  gchar name[16];
+  gint i, j;
+
+  for (i = 0; i < all_count; i++)
+    {
+      gboolean expected = FALSE;
+
+      for (j = 0; j < count; j++)
+        if (handles[j] == all_handles[i])
+          expected = TRUE;
+
+      if (expected)
+        {
+          g_snprintf(name, sizeof(name), "VAL%d", all_handles[i]);
+          TEST_NVTABLE_ASSERT(tab, all_handles[i], name, strlen(name));
+        }
+      else
+        {
+          TEST_ASSERT(nv_table_is_value_set(tab, all_handles[i]) == FALSE);
+        }
+    }
+}
+
+static void
+test_nvtable_stale_slot_hints(void)
+{
+  NVHandle all_handles[STALE_HINT_HANDLES] =
+  {
+    20, 21, 22, 30, 40, 50, 60, 70, 20 + 4096, 30 + 4096, 40 + 8192, 1000
+  };
+  NVHandle ascending[] = { 20, 21, 22, 30, 40, 50, 60, 70, 1000, 4116, 4126, 8232 };
+  NVHandle descending[] = { 8232, 4126, 4116, 1000, 70, 60, 50, 40, 30, 22, 21, 20 };
+  NVHandle sparse[] = { 70, 21, 4126, 50 };
+  NVHandle colliding[] = { 4116, 40, 20, 8232, 30 };
+  NVTable *tabs[4];
+  gchar name[16];
+  gboolean new_entry;
+  gint i, round;
+
+  for (round = 0; round < 3; round++)
+    {
+      tabs[0] = _build_nvtable_with_stale_hints(ascending, G_N_ELEMENTS(ascending));
+      tabs[1] = _build_nvtable_with_stale_hints(sparse, G_N_ELEMENTS(sparse));
+      tabs[2] = _build_nvtable_with_stale_hints(descending, G_N_ELEMENTS(descending));
+      tabs[3] = _build_nvtable_with_stale_hints(colliding, G_N_ELEMENTS(colliding));
+
+      /* look the tables up interleaved, so each lookup follows a hint left by another table */
+      for (i = 0; i < 2; i++)
+        {
+          _assert_nvtable_contains_exactly(tabs[1], sparse, G_N_ELEMENTS(sparse), all_handles, STALE_HINT_HANDLES);
+          _assert_nvtable_contains_exactly(tabs[0], ascending, G_N_ELEMENTS(ascending), all_handles, STALE_HINT_HANDLES);
+          _assert_nvtable_contains_exactly(tabs[3], colliding, G_N_ELEMENTS(colliding), all_handles, STALE_HINT_HANDLES);
+          _assert_nvtable_contains_exactly(tabs[2], descending, G_N_ELEMENTS(descending), all_handles, STALE_HINT_HANDLES);
+        }
+
+      /* replacing an existing value must find its slot instead of inserting a new one */
+      for (i = 0; i < G_N_ELEMENTS(sparse); i++)
+        {
+          g_snprintf(name, sizeof(name), "VAL%d", sparse[i]);
+          TEST_ASSERT(nv_table_add_value(tabs[0], sparse[i], name, strlen(name), name, strlen(name), &new_entry));
+          TEST_ASSERT(!new_entry);
+          _assert_nvtable_dyn_entries_sorted(tabs[0], G_N_ELEMENTS(ascending));
+        }
+
+      for (i = 0; i < G_N_ELEMENTS(tabs); i++)
+        nv_table_unref(tabs[i]);
+    }
+}
+
+#define BENCHMARK_TABLES 10000
+#define BENCHMARK_VALUES 150
+
+static void
+_benchmark_nvtable(const gchar *title, NVHandle *handles)
+{
+  NVTable *tab;
+  GTimeVal start, end;
+  gdouble insert_rate, lookup_rate;
+  gchar name[16];
+  gssize len;
+  gint i, x;
+
+  /* includes allocating and freeing the tables, as a LogMessage would */
+  g_get_current_time(&start);
+  for (x = 0; x < BENCHMARK_TABLES; x++)
+    {
+      tab = nv_table_new(STATIC_VALUES, BENCHMARK_VALUES, 8192);
+      for (i = 0; i < BENCHMARK_VALUES; i++)
+        {
+          g_snprintf(name, sizeof(name), "VAL%d", handles[i]);
+          TEST_ASSERT(nv_table_add_value(tab, handles[i], name, strlen(name), name, strlen(name), NULL));
+        }
+      nv_table_unref(tab);
+    }
+  g_get_current_time(&end);
+  insert_rate = BENCHMARK_TABLES * BENCHMARK_VALUES * 1e6 / MAX(g_time_val_diff(&end, &start), 1);
+
+  tab = nv_table_new(STATIC_VALUES, BENCHMARK_VALUES, 8192);
+  for (i = 0; i < BENCHMARK_VALUES; i++)
+    {
+      g_snprintf(name, sizeof(name), "VAL%d", handles[i]);
+      TEST_ASSERT(nv_table_add_value(tab, handles[i], name, strlen(name), name, strlen(name), NULL));
+    }
+
+  g_get_current_time(&start);
+  for (x = 0; x < BENCHMARK_TABLES; x++)
+    {
+      for (i = 0; i < BENCHMARK_VALUES; i++)
+        {
+          nv_table_get_value(tab, handles[i], &len);
+          TEST_ASSERT(len > 0);
+        }
+    }
+  g_get_current_time(&end);
+  lookup_rate = BENCHMARK_TABLES * BENCHMARK_VALUES * 1e6 / MAX(g_time_val_diff(&end, &start), 1);
+  nv_table_unref(tab);
+
+  printf("NVTable %s, %d dynamic values: insert %12.3f values/sec, lookup %12.3f values/sec\n",
+         title, BENCHMARK_VALUES, insert_rate, lookup_rate);
+}
+
+static void
+test_nvtable_benchmark(void)
+{
+  NVHandle handles[BENCHMARK_VALUES], tmp;
+  gint i, j;
+
+  /* names of a parser arrive in the order their handles were allocated */
+  for (i = 0; i < BENCHMARK_VALUES; i++)
+    handles[i] = DYN_HANDLE + i;
+  _benchmark_nvtable("ascending handles", handles);
+
+  for (i = 0; i < BENCHMARK_VALUES; i++)
+    handles[i] = DYN_HANDLE + BENCHMARK_VALUES - 1 - i;
+  _benchmark_nvtable("descending handles", handles);
+
+  /* the same random order in every table */
+  for (i = BENCHMARK_VALUES - 1; i > 0; i--)
+    {
+      j = rand() % (i + 1);
+      tmp = handles[i];
+      handles[i] = handles[j];
+      handles[j] = tmp;
+    }
+  _benchmark_nvtable("random handles", handles);
+}
+
 static void
 test_nvtable_clone_grows_the_cloned_structure(void)
 {
@@ -904,8 +1148,10 @@ test_nvtable(void)
   test_nvtable_indirect();
   test_nvtable_others();
   test_nvtable_lookup();
+  test_nvtable_stale_slot_hints();
   test_nvtable_clone();
   test_nvtable_realloc();
+  test_nvtable_benchmark();
 }
 
 int
@@ -913,6 +1159,7 @@ main(int argc, char *argv[])
 {
   app_startup();
   test_nv_registry();
+  test_nv_registry_concurrent_alloc();
   test_nvtable();
   app_shutdown();
   return 0;
@@ -321,6 +321,47 @@ test_tail()
   ring_buffer_free(&rb);
 }
 
+static void
+test_push_head()
+{
+  RingBuffer rb;
+  TestData *td;
+
+  ring_buffer_alloc(&rb, sizeof(TestData), 103);
+  _ringbuffer_fill2(&rb, 102, 1, TRUE);
+
+  td = ring_buffer_push_head(&rb);
+  assert_true(td != NULL, "push_head failed on a non-full buffer");
+  td->idx = 0;
+
+  assert_true(ring_buffer_push_head(&rb) == NULL, "cannot push_head to a full buffer");
+  assert_test_data_idx_range_in(&rb, 0, 102);
+
+  ring_buffer_free(&rb);
+}
+
+static void
+test_grow_keeps_ordering()
+{
+  RingBuffer rb;
+
+  ring_buffer_alloc(&rb, sizeof(TestData), 103);
+  _ringbuffer_fill2(&rb, 103, 0, TRUE);
+
+  /* make the content wrap around the end of the buffer */
+  ring_buffer_drop(&rb, 50);
+  _ringbuffer_fill2(&rb, 50, 103, TRUE);
+
+  ring_buffer_grow(&rb, 256);
+  assert_true(ring_buffer_capacity(&rb) == 256, "grow did not change the capacity");
+  assert_test_data_idx_range_in(&rb, 50, 152);
+
+  _ringbuffer_fill2(&rb, 10, 153, TRUE);
+  assert_test_data_idx_range_in(&rb, 50, 162);
+
+  ring_buffer_free(&rb);
+}
+
 int main(int argc, char **argv)
 {
   RINGBUFFER_TESTCASE(test_init_buffer_state);
@@ -336,6 +377,8 @@ int main(int argc, char **argv)
   RINGBUFFER_TESTCASE(test_broken_continual_range);
   RINGBUFFER_TESTCASE(test_push_after_pop);
   RINGBUFFER_TESTCASE(test_tail);
+  RINGBUFFER_TESTCASE(test_push_head);
+  RINGBUFFER_TESTCASE(test_grow_keeps_ordering);
 
   return 0;
 }
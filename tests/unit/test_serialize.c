@@ -41,6 +41,9 @@ main()
   SerializeArchive *a;
   gchar buf[256];
   guint32 num;
+  guint64 varints[] = { 0, 1, 127, 128, 16383, 16384, G_MAXUINT32, G_MAXUINT64 };
+  guint64 num64;
+  gint i;
 
   app_startup();
 
@@ -64,6 +67,27 @@ main()
   TEST_ASSERT(strcmp(value->str, "kismacska") == 0);
   serialize_read_string(a, value);
   TEST_ASSERT(strcmp(value->str, "tarkabarka") == 0);
+  serialize_archive_free(a);
+
+  g_string_truncate(stream, 0);
+  a = serialize_string_archive_new(stream);
+  for (i = 0; i < G_N_ELEMENTS(varints); i++)
+    serialize_write_varint(a, varints[i]);
+  TEST_ASSERT(stream->len == 1 + 1 + 1 + 2 + 2 + 3 + 5 + 10);
+  for (i = 0; i < G_N_ELEMENTS(varints); i++)
+    {
+      TEST_ASSERT(serialize_read_varint(a, &num64));
+      TEST_ASSERT(num64 == varints[i]);
+    }
+  serialize_archive_free(a);
+
+  /* a varint that doesn't fit into 32 bits */
+  g_string_truncate(stream, 0);
+  a = serialize_string_archive_new(stream);
+  a->silent = TRUE;
+  serialize_write_varint(a, (guint64) G_MAXUINT32 + 1);
+  TEST_ASSERT(!serialize_read_varint32(a, &num));
+  serialize_archive_free(a);
 
   app_shutdown();
   return 0;